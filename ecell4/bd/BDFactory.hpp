@@ -14,6 +14,12 @@ namespace ecell4
 namespace bd
 {
 
+enum BDParticleSpaceType
+{
+    CELL_LIST_SPACE = 0,
+    SOA_SPACE = 1
+};
+
 class BDFactory:
     public SimulatorFactory<BDWorld, BDSimulator>
 {
@@ -26,8 +32,11 @@ public:
 
 public:
 
-    BDFactory(const Integer3& matrix_sizes = default_matrix_sizes(), Real bd_dt_factor = default_bd_dt_factor())
-        : base_type(), rng_(), matrix_sizes_(matrix_sizes), bd_dt_factor_(bd_dt_factor)
+    BDFactory(const Integer3& matrix_sizes = default_matrix_sizes(), Real bd_dt_factor = default_bd_dt_factor(),
+              const BDParticleSpaceType space_type = default_space_type(),
+              const Integer num_threads = default_num_threads())
+        : base_type(), rng_(), matrix_sizes_(matrix_sizes), bd_dt_factor_(bd_dt_factor),
+        space_type_(space_type), num_threads_(num_threads)
     {
         ; // do nothing
     }
@@ -47,6 +56,16 @@ public:
         return -1.0;
     }
 
+    static inline const BDParticleSpaceType default_space_type()
+    {
+        return CELL_LIST_SPACE;
+    }
+
+    static inline const Integer default_num_threads()
+    {
+        return 1;
+    }
+
     this_type& rng(const boost::shared_ptr<RandomNumberGenerator>& rng)
     {
         rng_ = rng;
@@ -62,6 +81,19 @@ protected:
 
     virtual world_type* create_world(const Real3& edge_lengths) const
     {
+        if (space_type_ == SOA_SPACE)
+        {
+            if (rng_)
+            {
+                return create_bd_world_soa_impl(edge_lengths, matrix_sizes_, rng_);
+            }
+
+            boost::shared_ptr<RandomNumberGenerator>
+                rng(new GSLRandomNumberGenerator());
+            rng->seed();
+            return create_bd_world_soa_impl(edge_lengths, matrix_sizes_, rng);
+        }
+
         if (rng_)
         {
             return new world_type(edge_lengths, matrix_sizes_, rng_);
@@ -75,14 +107,11 @@ protected:
     virtual simulator_type* create_simulator(
         const boost::shared_ptr<world_type>& w, const boost::shared_ptr<Model>& m) const
     {
-        if (bd_dt_factor_ > 0)
-        {
-            return new simulator_type(w, m, bd_dt_factor_);
-        }
-        else
-        {
-            return new simulator_type(w, m);
-        }
+        simulator_type* sim(
+            bd_dt_factor_ > 0 ? new simulator_type(w, m, bd_dt_factor_)
+                              : new simulator_type(w, m));
+        sim->set_num_threads(num_threads_);
+        return sim;
     }
 
 protected:
@@ -90,6 +119,8 @@ protected:
     boost::shared_ptr<RandomNumberGenerator> rng_;
     Integer3 matrix_sizes_;
     Real bd_dt_factor_;
+    BDParticleSpaceType space_type_;
+    Integer num_threads_;
 };
 
 } // bd
@@ -1,7 +1,11 @@
+#include <algorithm>
+#include <cmath>
 #include <iterator>
+#include <limits>
 
 #include <ecell4/core/exceptions.hpp>
 #include <ecell4/core/Species.hpp>
+#include <ecell4/core/parallel.hpp>
 
 #include "BDPropagator.hpp"
 
@@ -19,8 +23,15 @@ bool BDPropagator::operator()()
         return false;
     }
 
-    const ParticleID pid(queue_.back().first);
+    const ParticleID pid(queue_.back());
     queue_.pop_back();
+
+    if (soa_space_ != NULL)
+    {
+        propagate_in_soa_space(pid);
+        return true;
+    }
+
     Particle particle(world_.get_particle(pid).second);
 
     if (attempt_reaction(pid, particle))
@@ -66,19 +77,273 @@ bool BDPropagator::operator()()
     }
 }
 
+/**
+ * the same as the rest of operator(), but reading the arrays of the space
+ * directly. A Particle is made only for a reaction.
+ */
+void BDPropagator::propagate_in_soa_space(const ParticleID& pid)
+{
+    typedef ParticleSpaceSoAImpl::index_type index_type;
+
+    ParticleSpaceSoAImpl& space(*soa_space_);
+    const index_type i(space.index(pid));
+    const ParticleSpaceSoAImpl::species_id_type id(space.species_id_at(i));
+
+    if (has_first_order_reaction(id) && attempt_reaction(pid, space.particle_at(i)))
+    {
+        return;
+    }
+
+    const Real D(space.D_at(i));
+    if (D == 0)
+    {
+        return;
+    }
+
+    const Real radius(space.radius_at(i));
+    const Real3 newpos(
+        world_.apply_boundary(
+            space.position_at(i) + random_displacement_3d(rng(), dt(), D)));
+
+    std::size_t num_overlapped(0);
+    index_type closest(i);
+    space.for_each_particle_within_radius(newpos, radius,
+        [&](const index_type j, const Real)
+        {
+            if (j != i && num_overlapped++ == 0)
+            {
+                closest = j;
+            }
+        });
+
+    switch (num_overlapped)
+    {
+    case 0:
+        space.update_position(i, newpos);
+        return;
+    case 1:
+        attempt_reaction(
+            pid, Particle(space.species_at(id), newpos, radius, D),
+            space.pid_at(closest), space.particle_at(closest));
+        return;
+    default:
+        return;
+    }
+}
+
+bool BDPropagator::propagate_in_slabs(const std::size_t num_threads)
+{
+    typedef ParticleSpaceSoAImpl::index_type index_type;
+
+    if (soa_space_ == NULL || soa_space_->matrix_sizes()[0] < 2)
+    {
+        return false;
+    }
+
+    ParticleSpaceSoAImpl& space(*soa_space_);
+    const std::size_t num_cells(space.matrix_sizes()[0]);
+    // the number of slabs must be even not to put the first and last
+    // ones, which are next to each other, in the same colour.
+    const std::size_t num_slabs(num_cells % 2 == 0 ? num_cells : num_cells - 1);
+
+    std::vector<std::vector<index_type> > indices(num_slabs);
+    for (index_type i(0); i < space.size(); ++i)
+    {
+        const std::size_t slab(
+            space.position2cell(space.position_at(i))[0] * num_slabs / num_cells);
+        indices[slab].push_back(i);
+
+        // fill the cache here, which is only read in threads.
+        has_first_order_reaction(space.species_id_at(i));
+    }
+
+    // the streams of one seed are independent, and cheap to make.
+    const Integer seed(rng_.uniform_int(0, std::numeric_limits<int>::max()));
+    std::vector<boost::shared_ptr<RandomNumberGenerator> > rngs;
+    rngs.reserve(num_slabs);
+    for (std::size_t slab(0); slab < num_slabs; ++slab)
+    {
+        rngs.push_back(boost::shared_ptr<RandomNumberGenerator>(
+            new PhiloxRandomNumberGenerator(seed, slab)));
+    }
+
+    std::vector<std::vector<deferred_move_type> > deferred(num_slabs);
+    std::vector<std::size_t> even, odd;
+    for (std::size_t slab(0); slab < num_slabs; slab += 2)
+    {
+        even.push_back(slab);
+        odd.push_back(slab + 1);
+    }
+
+    const auto propagate = [&](const std::size_t slab)
+        {
+            propagate_slab(slab, num_slabs, indices[slab], *rngs[slab], deferred[slab]);
+        };
+    parallel_for_each(num_threads, even, propagate);
+    parallel_for_each(num_threads, odd, propagate);
+
+    queue_.clear();
+    for (std::size_t slab(0); slab < num_slabs; ++slab)
+    {
+        for (std::vector<deferred_move_type>::const_iterator i(deferred[slab].begin());
+             i != deferred[slab].end(); ++i)
+        {
+            resolve_deferred_move(*i);
+        }
+    }
+    return true;
+}
+
+/**
+ * move the particles in a slab, which is read only by the neighboring ones.
+ * Neither a Particle nor a reaction is made here.
+ */
+void BDPropagator::propagate_slab(
+    const std::size_t slab, const std::size_t num_slabs,
+    std::vector<ParticleSpaceSoAImpl::index_type>& indices,
+    RandomNumberGenerator& rng, std::vector<deferred_move_type>& deferred)
+{
+    typedef ParticleSpaceSoAImpl::index_type index_type;
+
+    ParticleSpaceSoAImpl& space(*soa_space_);
+    const std::size_t num_cells(space.matrix_sizes()[0]);
+
+    shuffle(rng, indices);
+
+    // the displacements of all the particles are drawn at once.
+    std::vector<Real> noise(3 * indices.size());
+    rng.fill_gaussian(noise.data(), noise.data() + noise.size(), 1.0);
+
+    for (std::size_t k(0); k < indices.size(); ++k)
+    {
+        const index_type i(indices[k]);
+
+        if (first_order_cache_[space.species_id_at(i)] > 0)
+        {
+            const deferred_move_type move = {space.pid_at(i), Real3(), true};
+            deferred.push_back(move);
+            continue;
+        }
+
+        const Real D(space.D_at(i));
+        if (D == 0)
+        {
+            continue;
+        }
+
+        const Real3 displacement(noise[3 * k], noise[3 * k + 1], noise[3 * k + 2]);
+        const Real3 newpos(
+            world_.apply_boundary(
+                space.position_at(i) + displacement * std::sqrt(2 * D * dt_)));
+        const deferred_move_type move = {space.pid_at(i), newpos, false};
+        if (space.position2cell(newpos)[0] * num_slabs / num_cells != slab)
+        {
+            deferred.push_back(move);
+            continue;
+        }
+
+        std::size_t num_overlapped(0);
+        space.for_each_particle_within_radius(newpos, space.radius_at(i),
+            [&](const index_type j, const Real)
+            {
+                if (j != i)
+                {
+                    ++num_overlapped;
+                }
+            });
+
+        switch (num_overlapped)
+        {
+        case 0:
+            space.update_position(i, newpos);
+            break;
+        case 1:
+            deferred.push_back(move);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/**
+ * finish a move left by propagate_slab in the same way as
+ * propagate_in_soa_space. The particle may be gone by a former reaction.
+ */
+void BDPropagator::resolve_deferred_move(const deferred_move_type& move)
+{
+    typedef ParticleSpaceSoAImpl::index_type index_type;
+
+    ParticleSpaceSoAImpl& space(*soa_space_);
+    if (!space.has_particle(move.pid))
+    {
+        return;
+    }
+    else if (move.full)
+    {
+        propagate_in_soa_space(move.pid);
+        return;
+    }
+
+    const index_type i(space.index(move.pid));
+    const Real radius(space.radius_at(i));
+
+    std::size_t num_overlapped(0);
+    index_type closest(i);
+    space.for_each_particle_within_radius(move.newpos, radius,
+        [&](const index_type j, const Real)
+        {
+            if (j != i && num_overlapped++ == 0)
+            {
+                closest = j;
+            }
+        });
+
+    switch (num_overlapped)
+    {
+    case 0:
+        space.update_position(i, move.newpos);
+        return;
+    case 1:
+        attempt_reaction(
+            move.pid,
+            Particle(space.species_at(space.species_id_at(i)), move.newpos, radius, space.D_at(i)),
+            space.pid_at(closest), space.particle_at(closest));
+        return;
+    default:
+        return;
+    }
+}
+
+bool BDPropagator::has_first_order_reaction(
+    const ParticleSpaceSoAImpl::species_id_type id)
+{
+    if (id >= first_order_cache_.size())
+    {
+        first_order_cache_.resize(id + 1, 0);
+    }
+    if (first_order_cache_[id] == 0)
+    {
+        const bool found(
+            !model_.query_reaction_rules_view(soa_space_->species_at(id)).empty());
+        first_order_cache_[id] = (found ? 1 : -1);
+    }
+    return (first_order_cache_[id] > 0);
+}
+
 bool BDPropagator::attempt_reaction(
     const ParticleID& pid, const Particle& particle)
 {
-    std::vector<ReactionRule> reaction_rules(
-        model_.query_reaction_rules(particle.species()));
-    if (reaction_rules.size() == 0)
+    const ReactionRuleView reaction_rules(
+        model_.query_reaction_rules_view(particle.species()));
+    if (reaction_rules.empty())
     {
         return false;
     }
 
     const Real rnd(rng().uniform(0, 1));
     Real prob(0);
-    for (std::vector<ReactionRule>::const_iterator i(reaction_rules.begin());
+    for (ReactionRuleView::const_iterator i(reaction_rules.begin());
          i != reaction_rules.end(); ++i)
     {
         const ReactionRule& rr(*i);
@@ -196,10 +461,10 @@ bool BDPropagator::attempt_reaction(
     const ParticleID& pid1, const Particle& particle1,
     const ParticleID& pid2, const Particle& particle2)
 {
-    std::vector<ReactionRule> reaction_rules(
-        model_.query_reaction_rules(
+    const ReactionRuleView reaction_rules(
+        model_.query_reaction_rules_view(
             particle1.species(), particle2.species()));
-    if (reaction_rules.size() == 0)
+    if (reaction_rules.empty())
     {
         return false;
     }
@@ -209,7 +474,7 @@ bool BDPropagator::attempt_reaction(
     const Real rnd(rng().uniform(0, 1));
     Real prob(0);
 
-    for (std::vector<ReactionRule>::const_iterator i(reaction_rules.begin());
+    for (ReactionRuleView::const_iterator i(reaction_rules.begin());
          i != reaction_rules.end(); ++i)
     {
         const ReactionRule& rr(*i);
@@ -290,9 +555,8 @@ bool BDPropagator::attempt_reaction(
 void BDPropagator::remove_particle(const ParticleID& pid)
 {
     world_.remove_particle(pid);
-    particle_finder cmp(pid);
-    std::vector<std::pair<ParticleID, Particle> >::iterator
-        i(std::find_if(queue_.begin(), queue_.end(), cmp));
+    std::vector<ParticleID>::iterator
+        i(std::find(queue_.begin(), queue_.end(), pid));
     if (i != queue_.end())
     {
         queue_.erase(i);
@@ -77,14 +77,46 @@ public:
         Model& model, BDWorld& world, RandomNumberGenerator& rng, const Real& dt,
         std::vector<std::pair<ReactionRule, reaction_info_type> >& last_reactions)
         : model_(model), world_(world), rng_(rng), dt_(dt),
-        last_reactions_(last_reactions), max_retry_count_(1)
+        last_reactions_(last_reactions), max_retry_count_(1),
+        soa_space_(world_.soa_particle_space())
     {
-        queue_ = world_.list_particles();
+        if (soa_space_ != NULL)
+        {
+            soa_space_->sort_by_cell();
+            queue_.reserve(soa_space_->size());
+            for (ParticleSpaceSoAImpl::index_type i(0); i < soa_space_->size(); ++i)
+            {
+                queue_.push_back(soa_space_->pid_at(i));
+            }
+        }
+        else
+        {
+            const BDWorld::particle_container_type& particles(world_.particles());
+            queue_.reserve(particles.size());
+            for (BDWorld::particle_container_type::const_iterator i(particles.begin());
+                 i != particles.end(); ++i)
+            {
+                queue_.push_back((*i).first);
+            }
+        }
         shuffle(rng_, queue_);
     }
 
     bool operator()();
 
+    /**
+     * propagate all the particles in the queue with the given number of
+     * threads, and return false without doing anything if the space is not
+     * a ParticleSpaceSoAImpl or has less than two cells along the x-axis.
+     * The cells are split into slabs along the x-axis, and the even and
+     * odd slabs are moved in turn, each with its own random number generator.
+     * Particles with a first order reaction, leaving its slab or colliding
+     * with another are left to the serial phase following it. This draws
+     * a trajectory different from that of operator() even with one thread,
+     * so BDSimulator calls this only with two or more threads.
+     */
+    bool propagate_in_slabs(const std::size_t num_threads);
+
     inline Real dt() const
     {
         return dt_;
@@ -133,6 +165,25 @@ public:
         return random_ipv_3d(rng(), sigma, t, D);
     }
 
+protected:
+
+    struct deferred_move_type
+    {
+        ParticleID pid;
+        Real3 newpos;
+        bool full;  // propagate from the beginning, ignoring newpos
+    };
+
+protected:
+
+    void propagate_in_soa_space(const ParticleID& pid);
+    void propagate_slab(
+        const std::size_t slab, const std::size_t num_slabs,
+        std::vector<ParticleSpaceSoAImpl::index_type>& indices,
+        RandomNumberGenerator& rng, std::vector<deferred_move_type>& deferred);
+    void resolve_deferred_move(const deferred_move_type& move);
+    bool has_first_order_reaction(const ParticleSpaceSoAImpl::species_id_type id);
+
 protected:
 
     Model& model_;
@@ -142,7 +193,14 @@ protected:
     std::vector<std::pair<ReactionRule, reaction_info_type> >& last_reactions_;
     Integer max_retry_count_;
 
-    BDWorld::particle_container_type queue_;
+    std::vector<ParticleID> queue_;
+
+    /**
+     * the space of the world when it is a ParticleSpaceSoAImpl, or NULL.
+     * Whether each species has a first order reaction is cached by its id.
+     */
+    ParticleSpaceSoAImpl* soa_space_;
+    std::vector<signed char> first_order_cache_;
 };
 
 } // bd
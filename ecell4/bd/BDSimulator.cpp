@@ -70,6 +70,10 @@ void BDSimulator::step()
 
     {
         BDPropagator propagator(*model_, *world_, *rng(), dt(), last_reactions_);
+        if (num_threads_ > 1)
+        {
+            propagator.propagate_in_slabs(num_threads_);
+        }
         while (propagator())
         {
             ; // do nothing here
@@ -30,13 +30,15 @@ public:
     BDSimulator(
         boost::shared_ptr<BDWorld> world, boost::shared_ptr<Model> model,
         Real bd_dt_factor = 1e-5)
-        : base_type(world, model), dt_(0), bd_dt_factor_(bd_dt_factor), dt_set_by_user_(false)
+        : base_type(world, model), dt_(0), bd_dt_factor_(bd_dt_factor), dt_set_by_user_(false),
+        num_threads_(1)
     {
         initialize();
     }
 
     BDSimulator(boost::shared_ptr<BDWorld> world, Real bd_dt_factor = 1e-5)
-        : base_type(world), dt_(0), bd_dt_factor_(bd_dt_factor), dt_set_by_user_(false)
+        : base_type(world), dt_(0), bd_dt_factor_(bd_dt_factor), dt_set_by_user_(false),
+        num_threads_(1)
     {
         initialize();
     }
@@ -127,6 +129,27 @@ public:
         dt_set_by_user_ = true;
     }
 
+    /**
+     * set the number of threads to propagate particles. More than one thread
+     * is used only with a ParticleSpaceSoAImpl having two or more cells along
+     * the x-axis, and a trajectory then depends on the number of cells but
+     * not on that of threads. One thread keeps the serial propagation,
+     * whose trajectory differs from that of two or more threads.
+     */
+    void set_num_threads(const Integer num_threads)
+    {
+        if (num_threads < 1)
+        {
+            throw std::invalid_argument("The number of threads must be positive.");
+        }
+        num_threads_ = num_threads;
+    }
+
+    Integer num_threads() const
+    {
+        return num_threads_;
+    }
+
     inline boost::shared_ptr<RandomNumberGenerator> rng()
     {
         return (*world_).rng();
@@ -145,6 +168,7 @@ protected:
     Real dt_;
     const Real bd_dt_factor_;
     bool dt_set_by_user_;
+    Integer num_threads_;
     std::vector<std::pair<ReactionRule, reaction_info_type> > last_reactions_;
 };
 
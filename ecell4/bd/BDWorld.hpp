@@ -12,6 +12,7 @@
 #include <ecell4/core/SerialIDGenerator.hpp>
 #include <ecell4/core/ParticleSpace.hpp>
 #include <ecell4/core/ParticleSpaceCellListImpl.hpp>
+#include <ecell4/core/ParticleSpaceSoAImpl.hpp>
 #include <ecell4/core/Model.hpp>
 #include <ecell4/core/WorldInterface.hpp>
 
@@ -57,6 +58,12 @@ public:
         ;
     }
 
+    BDWorld(ParticleSpace* space, boost::shared_ptr<RandomNumberGenerator> rng)
+        : ps_(space), rng_(rng)
+    {
+        ;
+    }
+
     BDWorld(const std::string& filename)
         : ps_(new particle_space_type(Real3(1, 1, 1)))
     {
@@ -333,6 +340,14 @@ public:
         return (*ps_).particles();
     }
 
+    /**
+     * return the particle space if it is a ParticleSpaceSoAImpl, or NULL.
+     */
+    ParticleSpaceSoAImpl* soa_particle_space()
+    {
+        return dynamic_cast<ParticleSpaceSoAImpl*>(ps_.get());
+    }
+
     void save(const std::string& filename) const
     {
 #ifdef WITH_HDF5
@@ -411,6 +426,15 @@ protected:
     boost::weak_ptr<Model> model_;
 };
 
+inline
+BDWorld*
+create_bd_world_soa_impl(
+    const Real3& edge_lengths, const Integer3& matrix_sizes,
+    const boost::shared_ptr<RandomNumberGenerator>& rng)
+{
+    return new BDWorld(new ParticleSpaceSoAImpl(edge_lengths, matrix_sizes), rng);
+}
+
 } // bd
 
 } // ecell4
@@ -9,6 +9,7 @@
 
 #include <ecell4/core/NetworkModel.hpp>
 #include "../BDSimulator.hpp"
+#include "../BDFactory.hpp"
 
 using namespace ecell4;
 using namespace ecell4::bd;
@@ -59,3 +60,115 @@ BOOST_AUTO_TEST_CASE(BDSimulator_test_step2)
     BDSimulator target(world, model);
     target.step();
 }
+
+BOOST_AUTO_TEST_CASE(BDSimulator_test_soa_space)
+{
+    const Real L(1e-7);
+    const Real3 edge_lengths(L, L, L);
+    const Integer3 matrix_sizes(4, 4, 4);
+    const Real radius(2.5e-9);
+    boost::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+    rng->seed(1);
+
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    const Species sp1("A", radius, 1e-12), sp2("B", radius, 1e-12), sp3("C", radius, 1e-12);
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 1e+6));
+    model->add_reaction_rule(create_binding_reaction_rule(sp1, sp2, sp3, 1e-19));
+
+    BDFactory factory(matrix_sizes, 1e-3, SOA_SPACE);
+    factory.rng(rng);
+    boost::shared_ptr<BDWorld> world(factory.world(edge_lengths));
+    BOOST_CHECK(world->soa_particle_space() != NULL);
+
+    world->bind_to(model);
+    world->add_molecules(sp1, 50);
+    world->add_molecules(sp2, 50);
+
+    boost::shared_ptr<BDSimulator> sim(factory.simulator(world, model));
+    std::size_t num_reactions(0);
+    for (Integer i(0); i < 100; ++i)
+    {
+        sim->step();
+        num_reactions += sim->last_reactions().size();
+    }
+
+    BOOST_CHECK(num_reactions > 0);
+    BOOST_CHECK_EQUAL(
+        world->num_molecules(sp1) + world->num_molecules(sp2) + world->num_molecules(sp3) * 2, 100);
+    BOOST_CHECK_EQUAL(world->num_particles(), world->list_particles().size());
+}
+
+boost::shared_ptr<BDWorld> run_with_threads(const Integer num_threads)
+{
+    const Real L(1e-7);
+    const Real radius(2.5e-9);
+    boost::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+    rng->seed(1);
+
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    const Species sp1("A", radius, 1e-12), sp2("B", radius, 1e-12), sp3("C", radius, 1e-12);
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 1e+6));
+    model->add_reaction_rule(create_binding_reaction_rule(sp1, sp2, sp3, 1e-19));
+
+    BDFactory factory(Integer3(5, 4, 4), 1e-3, SOA_SPACE, num_threads);
+    factory.rng(rng);
+    boost::shared_ptr<BDWorld> world(factory.world(Real3(L, L, L)));
+    world->bind_to(model);
+    world->add_molecules(sp1, 50);
+    world->add_molecules(sp2, 50);
+
+    boost::shared_ptr<BDSimulator> sim(factory.simulator(world, model));
+    BOOST_CHECK_EQUAL(sim->num_threads(), num_threads);
+    for (Integer i(0); i < 100; ++i)
+    {
+        sim->step();
+    }
+
+    BOOST_CHECK_EQUAL(
+        world->num_molecules(sp1) + world->num_molecules(sp2) + world->num_molecules(sp3) * 2, 100);
+    return world;
+}
+
+void check_same_particles(const BDWorld& world1, const BDWorld& world2)
+{
+    const std::vector<std::pair<ParticleID, Particle> > particles(world1.list_particles());
+    BOOST_CHECK_EQUAL(particles.size(), world2.num_particles());
+    for (std::vector<std::pair<ParticleID, Particle> >::const_iterator i(particles.begin());
+         i != particles.end(); ++i)
+    {
+        BOOST_CHECK(world2.has_particle((*i).first));
+        const Particle p(world2.get_particle((*i).first).second);
+        BOOST_CHECK_EQUAL(p.species().serial(), (*i).second.species().serial());
+        BOOST_CHECK_EQUAL(p.position(), (*i).second.position());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BDSimulator_test_num_threads)
+{
+    // more threads propagate in slabs, and the trajectory does not depend on their number.
+    check_same_particles(*run_with_threads(2), *run_with_threads(4));
+}
+
+BOOST_AUTO_TEST_CASE(BDSimulator_test_one_thread)
+{
+    // one thread propagates serially, drawing another trajectory from the same seed.
+    const boost::shared_ptr<BDWorld> world1(run_with_threads(1));
+    check_same_particles(*world1, *run_with_threads(1));
+
+    const boost::shared_ptr<BDWorld> world2(run_with_threads(2));
+    bool moved_differently(world1->num_particles() != world2->num_particles());
+    const std::vector<std::pair<ParticleID, Particle> > particles(world1->list_particles());
+    for (std::vector<std::pair<ParticleID, Particle> >::const_iterator i(particles.begin());
+         i != particles.end() && !moved_differently; ++i)
+    {
+        moved_differently = (!world2->has_particle((*i).first)
+            || world2->get_particle((*i).first).second.position() != (*i).second.position());
+    }
+    BOOST_CHECK(moved_differently);
+}
@@ -64,6 +64,14 @@ struct AABB
     Real3 draw_position(
         boost::shared_ptr<RandomNumberGenerator>& rng) const;
     bool test_AABB(const Real3& l, const Real3& u) const;
+
+    void bounding_box(
+        const Real3& edge_lengths, Real3& lower, Real3& upper) const
+    {
+        lower = lower_;
+        upper = upper_;
+    }
+
     bool test_segment(const Real3& p0, const Real3& p1) const;
     std::pair<bool, Real> intersect_ray(const Real3& p, const Real3& d) const;
 
@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "CalendarEventQueue.hpp"
+
+
+namespace ecell4
+{
+
+void CalendarEventQueue::clear()
+{
+    times_.clear();
+    buckets_of_.clear();
+    slots_.clear();
+    buckets_.clear();
+    buckets_.resize(2);
+    width_ = 1.0;
+    cursor_ = 0;
+    top_valid_ = false;
+    top_ = 0;
+    num_walks_ = 0;
+    walk_cost_ = 0;
+    retune_ = false;
+}
+
+CalendarEventQueue::day_type CalendarEventQueue::day(const Real time) const
+{
+    // clamp not to overflow for a far future.
+    const Real limit(static_cast<Real>(std::numeric_limits<day_type>::max() / 2));
+    const Real d(std::floor(time / width_));
+    return static_cast<day_type>(std::max(-limit, std::min(limit, d)));
+}
+
+void CalendarEventQueue::push(const Real time)
+{
+    const index_type i(times_.size());
+    times_.push_back(time);
+    buckets_of_.push_back(0);
+    slots_.push_back(0);
+    insert(i);
+
+    if (size() > 2 * num_buckets())
+    {
+        resize();
+    }
+}
+
+void CalendarEventQueue::erase(const index_type i)
+{
+    detach(i);
+
+    const index_type last(times_.size() - 1);
+    if (i != last)
+    {
+        times_[i] = times_[last];
+        buckets_of_[i] = buckets_of_[last];
+        slots_[i] = slots_[last];
+        buckets_[buckets_of_[i]][slots_[i]] = i;
+        if (top_valid_ && top_ == last)
+        {
+            top_ = i;
+        }
+    }
+    times_.pop_back();
+    buckets_of_.pop_back();
+    slots_.pop_back();
+
+    if (num_buckets() > 1 && 4 * size() < num_buckets())
+    {
+        resize();
+    }
+}
+
+void CalendarEventQueue::update(const index_type i, const Real time)
+{
+    detach(i);
+    times_[i] = time;
+    insert(i);
+
+    if (retune_)
+    {
+        resize();
+    }
+}
+
+void CalendarEventQueue::rebuild()
+{
+    if (retune_)
+    {
+        resize();
+    }
+}
+
+CalendarEventQueue::index_type CalendarEventQueue::top() const
+{
+    if (!top_valid_)
+    {
+        find_top();
+    }
+    return top_;
+}
+
+CalendarEventQueue::index_type CalendarEventQueue::second() const
+{
+    const index_type first(top());
+    index_type retval(first == 0 ? 1 : 0);
+    for (index_type i(0); i < times_.size(); ++i)
+    {
+        if (i != first && times_[i] < times_[retval])
+        {
+            retval = i;
+        }
+    }
+    return retval;
+}
+
+bool CalendarEventQueue::check() const
+{
+    size_type num_items(0);
+    for (std::vector<std::vector<index_type> >::const_iterator b(buckets_.begin());
+         b != buckets_.end(); ++b)
+    {
+        num_items += (*b).size();
+    }
+    if (num_items != times_.size())
+    {
+        return false;
+    }
+
+    for (index_type i(0); i < times_.size(); ++i)
+    {
+        if (buckets_of_[i] != bucket(times_[i]) || buckets_[buckets_of_[i]][slots_[i]] != i)
+        {
+            return false;
+        }
+        if (times_[i] != inf && day(times_[i]) < cursor_)
+        {
+            return false;
+        }
+        if (top_valid_ && times_[i] < times_[top_])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CalendarEventQueue::insert(const index_type i)
+{
+    const Real t(times_[i]);
+    const size_type b(bucket(t));
+    buckets_of_[i] = b;
+    slots_[i] = buckets_[b].size();
+    buckets_[b].push_back(i);
+
+    if (t != inf && day(t) < cursor_)
+    {
+        cursor_ = day(t);
+    }
+    if (top_valid_ && t < times_[top_])
+    {
+        top_ = i;
+    }
+}
+
+void CalendarEventQueue::detach(const index_type i)
+{
+    std::vector<index_type>& b(buckets_[buckets_of_[i]]);
+    const index_type last(b.back());
+    b[slots_[i]] = last;
+    slots_[last] = slots_[i];
+    b.pop_back();
+
+    if (top_valid_ && top_ == i)
+    {
+        top_valid_ = false;
+    }
+}
+
+void CalendarEventQueue::find_top() const
+{
+    const size_type n(num_buckets());
+    const std::vector<index_type>& infinite(buckets_[n]);
+    size_type cost(0);
+
+    if (infinite.size() == times_.size())
+    {
+        top_ = infinite.front();
+        top_valid_ = true;
+        return;
+    }
+
+    // walk a year of days from the cursor.
+    bool found(false);
+    for (size_type k(0); k < n && !found; ++k)
+    {
+        const day_type d(cursor_ + k);
+        const std::vector<index_type>& b(buckets_[bucket_of_day(d)]);
+        cost += 1 + b.size();
+        for (std::vector<index_type>::const_iterator j(b.begin()); j != b.end(); ++j)
+        {
+            if (day(times_[*j]) <= d && (!found || times_[*j] < times_[top_]))
+            {
+                top_ = *j;
+                found = true;
+            }
+        }
+        if (found)
+        {
+            cursor_ = d;
+        }
+    }
+
+    // no time within a year. search all directly.
+    if (!found)
+    {
+        top_ = 0;
+        for (index_type i(1); i < times_.size(); ++i)
+        {
+            if (times_[i] < times_[top_])
+            {
+                top_ = i;
+            }
+        }
+        cursor_ = day(times_[top_]);
+        cost += times_.size();
+    }
+    top_valid_ = true;
+
+    ++num_walks_;
+    walk_cost_ += cost;
+    if (num_walks_ >= std::max<size_type>(n, 16))
+    {
+        // a walk must visit a few buckets with a few items each.
+        if (walk_cost_ > 8 * num_walks_)
+        {
+            retune_ = true;
+        }
+        num_walks_ = 0;
+        walk_cost_ = 0;
+    }
+}
+
+void CalendarEventQueue::resize()
+{
+    // the width is thrice the mean separation of the nearest times.
+    std::vector<Real> finite;
+    finite.reserve(times_.size());
+    for (std::vector<Real>::const_iterator i(times_.begin()); i != times_.end(); ++i)
+    {
+        if (*i != inf)
+        {
+            finite.push_back(*i);
+        }
+    }
+
+    const size_type num_samples(std::min<size_type>(finite.size(), 25));
+    if (num_samples >= 2)
+    {
+        std::nth_element(finite.begin(), finite.begin() + (num_samples - 1), finite.end());
+        const Real tmin(*std::min_element(finite.begin(), finite.begin() + num_samples));
+        const Real width(3.0 * (finite[num_samples - 1] - tmin) / (num_samples - 1));
+        if (width > 0.0 && width < inf)
+        {
+            width_ = width;
+        }
+    }
+
+    buckets_.clear();
+    buckets_.resize(std::max<size_type>(times_.size(), 1) + 1);
+    cursor_ = std::numeric_limits<day_type>::max();
+    top_valid_ = false;
+    for (index_type i(0); i < times_.size(); ++i)
+    {
+        insert(i);
+    }
+    if (cursor_ == std::numeric_limits<day_type>::max())
+    {
+        cursor_ = 0;
+    }
+
+    num_walks_ = 0;
+    walk_cost_ = 0;
+    retune_ = false;
+}
+
+} // ecell4
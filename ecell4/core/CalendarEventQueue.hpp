@@ -0,0 +1,143 @@
+#ifndef ECELL4_CALENDAR_EVENT_QUEUE_HPP
+#define ECELL4_CALENDAR_EVENT_QUEUE_HPP
+
+#include <vector>
+#include <boost/cstdint.hpp>
+
+#include "types.hpp"
+
+
+namespace ecell4
+{
+
+/**
+ * A calendar queue (Brown, CACM 1988) of the times of items indexed from
+ * zero, with the same interface as HeapEventQueue. A time t falls into the
+ * bucket floor(t / width) modulo the number of buckets, and an update just
+ * moves an item between two buckets. The top is found by walking the buckets
+ * from that of the last top, which takes O(1) when the width is close to
+ * the separation of the nearest times. Infinite times are kept aside.
+ * The number of buckets follows that of items, and the width is retuned
+ * from the nearest times whenever the walks get long, which suits the
+ * exponentially distributed times of many independent events.
+ */
+class CalendarEventQueue
+{
+public:
+
+    typedef std::size_t index_type;
+    typedef std::size_t size_type;
+
+public:
+
+    CalendarEventQueue()
+    {
+        clear();
+    }
+
+    size_type size() const
+    {
+        return times_.size();
+    }
+
+    void clear();
+
+    /**
+     * add the time of the next index, size().
+     */
+    void push(const Real time);
+
+    /**
+     * remove the time of the index, and give the last index to it.
+     */
+    void erase(const index_type i);
+
+    void update(const index_type i, const Real time);
+
+    /**
+     * set a time without updating the order until rebuild is called.
+     * An update only costs O(1) here, and it is done at once.
+     */
+    void assign(const index_type i, const Real time)
+    {
+        update(i, time);
+    }
+
+    void rebuild();
+
+    index_type top() const;
+
+    Real top_time() const
+    {
+        return times_[top()];
+    }
+
+    /**
+     * the index with the second earliest time. This costs O(n).
+     */
+    index_type second() const;
+
+    Real time(const index_type i) const
+    {
+        return times_[i];
+    }
+
+    bool check() const;
+
+    Real width() const
+    {
+        return width_;
+    }
+
+    size_type num_buckets() const
+    {
+        return buckets_.size() - 1;
+    }
+
+protected:
+
+    typedef boost::int64_t day_type;
+
+    day_type day(const Real time) const;
+
+    size_type bucket_of_day(const day_type d) const
+    {
+        const day_type n(num_buckets());
+        return static_cast<size_type>(((d % n) + n) % n);
+    }
+
+    size_type bucket(const Real time) const
+    {
+        return (time == inf ? num_buckets() : bucket_of_day(day(time)));
+    }
+
+    void insert(const index_type i);
+    void detach(const index_type i);
+    void find_top() const;
+
+    /**
+     * reset the number of buckets and the width, and rearrange all the items.
+     */
+    void resize();
+
+protected:
+
+    std::vector<Real> times_;
+    std::vector<size_type> buckets_of_, slots_;
+    std::vector<std::vector<index_type> > buckets_;
+    Real width_;
+
+    /**
+     * the day to start the walk from, which no finite time precedes,
+     * and the cached top. The costs of walks are counted to retune.
+     */
+    mutable day_type cursor_;
+    mutable bool top_valid_;
+    mutable index_type top_;
+    mutable size_type num_walks_, walk_cost_;
+    mutable bool retune_;
+};
+
+} // ecell4
+
+#endif /* ECELL4_CALENDAR_EVENT_QUEUE_HPP */
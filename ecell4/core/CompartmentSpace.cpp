@@ -25,6 +25,19 @@ bool CompartmentSpaceVectorImpl::has_species(const Species& sp) const
     return std::find(species_.begin(), species_.end(), sp) != species_.end();
 }
 
+CompartmentSpaceVectorImpl::species_id_type
+    CompartmentSpaceVectorImpl::get_species_id(const Species& sp) const
+{
+    species_map_type::const_iterator i(index_map_.find(sp));
+    if (i == index_map_.end())
+    {
+        std::ostringstream message;
+        message << "Speices [" << sp.serial() << "] not found";
+        throw NotFound(message.str());
+    }
+    return (*i).second;
+}
+
 void CompartmentSpaceVectorImpl::set_volume(const Real& volume)
 {
     if (volume <= 0)
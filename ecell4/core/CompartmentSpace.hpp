@@ -174,6 +174,10 @@ protected:
     typedef utils::get_mapper_mf<
         Species, num_molecules_container_type::size_type>::type species_map_type;
 
+public:
+
+    typedef num_molecules_container_type::size_type species_id_type;
+
 public:
 
     CompartmentSpaceVectorImpl(const Real3& edge_lengths)
@@ -222,6 +226,24 @@ public:
 
     std::vector<Species> list_species() const;
 
+    /**
+     * return a dense integer ID of the given species.
+     * IDs are assigned in the order of appearance, i.e. the order of
+     * list_species(). Releasing a species moves the last species into
+     * the freed ID, so the ID of the last one changes then.
+     */
+    species_id_type get_species_id(const Species& sp) const;
+
+    const Species& get_species(const species_id_type& id) const
+    {
+        return species_[id];
+    }
+
+    Integer num_molecules_by_id(const species_id_type& id) const
+    {
+        return num_molecules_[id];
+    }
+
     virtual void save(const std::string& filename) const
     {
         throw NotSupported(
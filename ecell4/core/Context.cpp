@@ -1,6 +1,8 @@
 #include "Context.hpp"
 #include <string>
 #include <sstream>
+#include <algorithm>
+#include <cctype>
 
 
 namespace ecell4
@@ -498,6 +500,11 @@ protected:
 //     }
 // };
 
+inline bool is_not_name_char(const char c)
+{
+    return !(std::isalnum(static_cast<unsigned char>(c)) || c == '_');
+}
+
 Species format_species(const Species& sp)
 {
     // {
@@ -532,6 +539,17 @@ Species format_species(const Species& sp)
     //     std::cout << std::endl;
     // }
 
+    // a bare name, e.g. "A", is formatted as it is.
+    const Species::serial_type& serial(sp.serial());
+    if (sp.is_formatted()
+        || (serial != "" && std::find_if(serial.begin(), serial.end(), is_not_name_char)
+            == serial.end()))
+    {
+        Species newsp(serial);
+        newsp.formatted_ = true;
+        return newsp;
+    }
+
     species_structure comp(sp);
     const std::vector<UnitSpecies>::size_type num_units = comp.units().size();
 
@@ -591,6 +609,7 @@ Species format_species(const Species& sp)
         }
         newsp.add_unit(usp);
     }
+    newsp.formatted_ = true;
     return newsp;
 }
 
@@ -0,0 +1,534 @@
+#ifndef ECELL4_ENSEMBLE_RUNNER_HPP
+#define ECELL4_ENSEMBLE_RUNNER_HPP
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <stdint.h>
+#include <exception>
+#include <stdexcept>
+#include <boost/shared_ptr.hpp>
+
+#include "types.hpp"
+#include "Model.hpp"
+#include "RandomNumberGenerator.hpp"
+#include "observers.hpp"
+#include "exceptions.hpp"
+
+
+namespace ecell4
+{
+
+/**
+ * A streaming estimator of a quantile by the P-square algorithm
+ * (Jain and Chlamtac, 1985). It holds only five markers however many
+ * values are given. The estimate depends slightly on the order of values.
+ */
+class QuantileEstimator
+{
+public:
+
+    QuantileEstimator(const Real p = 0.5)
+        : p_(p), count_(0)
+    {
+        if (p < 0.0 || p > 1.0)
+        {
+            throw std::invalid_argument("A quantile must be in [0, 1].");
+        }
+    }
+
+    const Real p() const
+    {
+        return p_;
+    }
+
+    const Integer count() const
+    {
+        return count_;
+    }
+
+    void add(const Real x)
+    {
+        if (count_ < 5)
+        {
+            q_[count_] = x;
+            ++count_;
+            if (count_ == 5)
+            {
+                std::sort(q_, q_ + 5);
+                for (unsigned int i(0); i < 5; ++i)
+                {
+                    n_[i] = i;
+                }
+                desired_[0] = 0.0;
+                desired_[1] = 2.0 * p_;
+                desired_[2] = 4.0 * p_;
+                desired_[3] = 2.0 + 2.0 * p_;
+                desired_[4] = 4.0;
+            }
+            return;
+        }
+
+        ++count_;
+
+        unsigned int k;
+        if (x < q_[0])
+        {
+            q_[0] = x;
+            k = 0;
+        }
+        else if (x >= q_[4])
+        {
+            q_[4] = x;
+            k = 3;
+        }
+        else
+        {
+            k = 0;
+            while (x >= q_[k + 1])
+            {
+                ++k;
+            }
+        }
+
+        for (unsigned int i(k + 1); i < 5; ++i)
+        {
+            ++n_[i];
+        }
+        desired_[1] += 0.5 * p_;
+        desired_[2] += p_;
+        desired_[3] += 0.5 * (1.0 + p_);
+        desired_[4] += 1.0;
+
+        for (unsigned int i(1); i < 4; ++i)
+        {
+            const Real d(desired_[i] - n_[i]);
+            if ((d >= 1.0 && n_[i + 1] - n_[i] > 1)
+                || (d <= -1.0 && n_[i - 1] - n_[i] < -1))
+            {
+                const Integer sign(d > 0.0 ? +1 : -1);
+                const Real qp(parabolic(i, sign));
+                if (q_[i - 1] < qp && qp < q_[i + 1])
+                {
+                    q_[i] = qp;
+                }
+                else
+                {
+                    q_[i] += sign * (q_[i + sign] - q_[i]) / (n_[i + sign] - n_[i]);
+                }
+                n_[i] += sign;
+            }
+        }
+    }
+
+    Real value() const
+    {
+        if (count_ == 0)
+        {
+            return 0.0;
+        }
+        else if (count_ < 5)
+        {
+            Real tmp[5];
+            std::copy(q_, q_ + count_, tmp);
+            std::sort(tmp, tmp + count_);
+            const Real pos(p_ * (count_ - 1));
+            const Integer i(static_cast<Integer>(std::floor(pos)));
+            return (i + 1 < count_
+                ? tmp[i] + (pos - i) * (tmp[i + 1] - tmp[i]) : tmp[i]);
+        }
+        return q_[2];
+    }
+
+protected:
+
+    Real parabolic(const unsigned int i, const Integer d) const
+    {
+        return q_[i] + d / static_cast<Real>(n_[i + 1] - n_[i - 1]) * (
+            (n_[i] - n_[i - 1] + d) * (q_[i + 1] - q_[i]) / (n_[i + 1] - n_[i])
+            + (n_[i + 1] - n_[i] - d) * (q_[i] - q_[i - 1]) / (n_[i] - n_[i - 1]));
+    }
+
+protected:
+
+    Real p_;
+    Integer count_;
+    Real q_[5];
+    Integer n_[5];
+    Real desired_[5];
+};
+
+/**
+ * Run many independent trajectories of the same model and initial state
+ * with a SimulatorFactory, and aggregate the numbers of molecules at
+ * the given time points into the mean, the variance and quantiles.
+ * No trajectory is kept after it is merged into the statistics.
+ *
+ * Trajectories are run on a pool of threads, each of which takes
+ * the next trajectory when it finishes the last one.
+ * The i-th trajectory is seeded with a value generated only from
+ * the given seed and i, whichever thread runs it. The mean and the variance
+ * are thus reproducible up to rounding, although the quantile estimates
+ * depend on the order of trajectories.
+ *
+ * Each trajectory starts from a copy of the given world made by
+ * the copy_world of the factory, which copies the numbers of molecules
+ * in a well-mixed world and the state in each subvolume in a mesoscopic one.
+ * A factory without copy_world is rejected at compile time.
+ * Each world must own its random number generator, i.e. do not give
+ * a generator to the factory.
+ */
+template <typename Tfactory_>
+class EnsembleRunner
+{
+protected:
+
+    template <typename T_>
+    struct has_copy_world
+    {
+        template <typename U_>
+        static char test(decltype(&U_::copy_world));
+        template <typename U_>
+        static long test(...);
+
+        static const bool value = (sizeof(test<T_>(0)) == sizeof(char));
+    };
+
+    static_assert(has_copy_world<Tfactory_>::value,
+        "A factory must copy the whole state of a world with copy_world.");
+
+public:
+
+    typedef Tfactory_ factory_type;
+    typedef typename factory_type::world_type world_type;
+    typedef typename factory_type::simulator_type simulator_type;
+    typedef NumberLogger::data_container_type data_container_type;
+    typedef NumberLogger::species_container_type species_container_type;
+
+public:
+
+    EnsembleRunner(
+        const factory_type& factory, const boost::shared_ptr<Model>& model,
+        const std::vector<Real>& t, const std::vector<std::string>& species,
+        const std::vector<Real>& quantiles = std::vector<Real>())
+        : factory_(factory), model_(model), t_(t), species_(species),
+        quantiles_(quantiles), num_trajectories_(0)
+    {
+        if (t_.size() == 0)
+        {
+            throw std::invalid_argument("No time point is given.");
+        }
+        else if (species_.size() == 0)
+        {
+            throw std::invalid_argument("No species is given.");
+        }
+
+        targets_.reserve(species_.size());
+        for (std::vector<std::string>::const_iterator i(species_.begin());
+            i != species_.end(); ++i)
+        {
+            targets_.push_back(Species(*i));
+        }
+
+        reset();
+    }
+
+    const boost::shared_ptr<Model>& model() const
+    {
+        return model_;
+    }
+
+    const std::vector<Real>& t() const
+    {
+        return t_;
+    }
+
+    const species_container_type& targets() const
+    {
+        return targets_;
+    }
+
+    const std::vector<Real>& quantiles() const
+    {
+        return quantiles_;
+    }
+
+    Integer num_trajectories() const
+    {
+        return num_trajectories_;
+    }
+
+    void reset()
+    {
+        const std::size_t num_cells(t_.size() * targets_.size());
+        num_trajectories_ = 0;
+        mean_.assign(num_cells, 0.0);
+        m2_.assign(num_cells, 0.0);
+        estimators_.clear();
+        estimators_.reserve(num_cells * quantiles_.size());
+        for (std::size_t i(0); i < num_cells; ++i)
+        {
+            for (std::vector<Real>::const_iterator j(quantiles_.begin());
+                j != quantiles_.end(); ++j)
+            {
+                estimators_.push_back(QuantileEstimator(*j));
+            }
+        }
+    }
+
+    /**
+     * run trajectories starting from the state of the given world, and
+     * add them to the statistics. Trajectories are numbered serially
+     * over calls, so that running 100 and then 100 more trajectories
+     * is the same as running 200 at once.
+     * @param world the initial state. This is never modified.
+     * @param num_trajectories the number of trajectories
+     * @param seed the seed from which the seed of each trajectory is made
+     * @param num_threads the number of threads. Use all cores if 0.
+     */
+    void run(
+        const boost::shared_ptr<world_type>& world, const Integer num_trajectories,
+        const Integer seed = 0, Integer num_threads = 0)
+    {
+        if (num_trajectories <= 0)
+        {
+            return;
+        }
+        else if (t_.back() < world->t())
+        {
+            throw std::invalid_argument(
+                "The time points must not be earlier than the world.");
+        }
+
+        if (num_threads <= 0)
+        {
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        num_threads = std::min(num_threads, num_trajectories);
+
+        std::atomic<Integer> next(0);
+        std::exception_ptr error;
+        std::mutex mutex;
+        rng_container_type rngs(1, world->rng().get());
+
+        const Integer offset(num_trajectories_);
+        const auto worker = [&]()
+            {
+                try
+                {
+                    for (Integer i(next++); i < num_trajectories; i = next++)
+                    {
+                        const data_container_type data(
+                            run_trajectory(
+                                *world, trajectory_seed(seed, offset + i), rngs, mutex));
+
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (error)
+                        {
+                            return;
+                        }
+                        merge(data);
+                    }
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!error)
+                    {
+                        error = std::current_exception();
+                    }
+                    next = num_trajectories;
+                }
+            };
+
+        if (num_threads == 1)
+        {
+            worker();
+        }
+        else
+        {
+            std::vector<std::thread> threads;
+            threads.reserve(num_threads);
+            for (Integer i(0); i < num_threads; ++i)
+            {
+                threads.push_back(std::thread(worker));
+            }
+            for (std::vector<std::thread>::iterator i(threads.begin());
+                i != threads.end(); ++i)
+            {
+                (*i).join();
+            }
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+    /**
+     * the mean at each time point in the same layout as NumberObserver,
+     * i.e. each row begins with the time.
+     */
+    data_container_type mean() const
+    {
+        return layout(mean_, 1.0);
+    }
+
+    /**
+     * the unbiased variance at each time point.
+     */
+    data_container_type variance() const
+    {
+        return layout(m2_, num_trajectories_ > 1 ? 1.0 / (num_trajectories_ - 1) : 0.0);
+    }
+
+    /**
+     * the estimate of the given quantile at each time point.
+     * The quantile must be one given at the construction.
+     */
+    data_container_type quantile(const Real p) const
+    {
+        const std::vector<Real>::const_iterator
+            i(std::find(quantiles_.begin(), quantiles_.end(), p));
+        if (i == quantiles_.end())
+        {
+            throw NotFound("The given quantile is not estimated.");
+        }
+
+        const std::size_t idx(i - quantiles_.begin());
+        std::vector<Real> values(mean_.size());
+        for (std::size_t j(0); j < values.size(); ++j)
+        {
+            values[j] = estimators_[j * quantiles_.size() + idx].value();
+        }
+        return layout(values, 1.0);
+    }
+
+protected:
+
+    static Integer trajectory_seed(const Integer seed, const Integer i)
+    {
+        // SplitMix64 decorrelates the seeds of neighboring trajectories.
+        uint64_t z(static_cast<uint64_t>(seed) + (static_cast<uint64_t>(i) + 1) * 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        z = z ^ (z >> 31);
+        return static_cast<Integer>(z >> 1);
+    }
+
+    typedef std::vector<const RandomNumberGenerator*> rng_container_type;
+
+    /**
+     * hold the generator of a world while its trajectory runs. Generators
+     * held at the same time must differ from each other and from that of
+     * the initial world, which is always held.
+     */
+    struct rng_lease
+    {
+        rng_lease(
+            const RandomNumberGenerator* rng, rng_container_type& rngs, std::mutex& mutex)
+            : rng(rng), rngs(rngs), mutex(mutex)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (std::find(rngs.begin(), rngs.end(), rng) != rngs.end())
+            {
+                throw std::invalid_argument(
+                    "The factory must not share a random number generator among worlds.");
+            }
+            rngs.push_back(rng);
+        }
+
+        ~rng_lease()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            rngs.erase(std::find(rngs.begin(), rngs.end(), rng));
+        }
+
+        const RandomNumberGenerator* rng;
+        rng_container_type& rngs;
+        std::mutex& mutex;
+    };
+
+    data_container_type run_trajectory(
+        const world_type& world, const Integer seed,
+        rng_container_type& rngs, std::mutex& mutex) const
+    {
+        boost::shared_ptr<world_type> w(factory_.copy_world(world));
+        const rng_lease lease(w->rng().get(), rngs, mutex);
+        w->rng()->seed(seed);
+        w->bind_to(model_);
+
+        boost::shared_ptr<simulator_type> sim(factory_.simulator(w, model_));
+        boost::shared_ptr<TimingNumberObserver> obs(new TimingNumberObserver(t_, species_));
+        sim->run(t_.back() - w->t(), obs);
+
+        const data_container_type data(obs->data());
+        if (data.size() != t_.size())
+        {
+            throw IllegalState("The number of observations mismatches.");
+        }
+        return data;
+    }
+
+    void merge(const data_container_type& data)
+    {
+        ++num_trajectories_;
+        const std::size_t num_species(targets_.size());
+        for (std::size_t i(0); i < data.size(); ++i)
+        {
+            for (std::size_t j(0); j < num_species; ++j)
+            {
+                const std::size_t idx(i * num_species + j);
+                const Real x(data[i][j + 1]);
+
+                // Welford's online algorithm
+                const Real delta(x - mean_[idx]);
+                mean_[idx] += delta / num_trajectories_;
+                m2_[idx] += delta * (x - mean_[idx]);
+
+                for (std::size_t k(0); k < quantiles_.size(); ++k)
+                {
+                    estimators_[idx * quantiles_.size() + k].add(x);
+                }
+            }
+        }
+    }
+
+    data_container_type layout(const std::vector<Real>& values, const Real factor) const
+    {
+        const std::size_t num_species(targets_.size());
+        data_container_type retval(t_.size());
+        for (std::size_t i(0); i < t_.size(); ++i)
+        {
+            retval[i].reserve(num_species + 1);
+            retval[i].push_back(t_[i]);
+            for (std::size_t j(0); j < num_species; ++j)
+            {
+                retval[i].push_back(values[i * num_species + j] * factor);
+            }
+        }
+        return retval;
+    }
+
+protected:
+
+    factory_type factory_;
+    boost::shared_ptr<Model> model_;
+    std::vector<Real> t_;
+    std::vector<std::string> species_;
+    species_container_type targets_;
+    std::vector<Real> quantiles_;
+
+    Integer num_trajectories_;
+    std::vector<Real> mean_, m2_;
+    std::vector<QuantileEstimator> estimators_;
+};
+
+} // ecell4
+
+#endif /* ECELL4_ENSEMBLE_RUNNER_HPP */
@@ -0,0 +1,376 @@
+#ifndef ECELL4_EVENT_QUEUE_HPP
+#define ECELL4_EVENT_QUEUE_HPP
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "types.hpp"
+#include "CalendarEventQueue.hpp"
+
+
+namespace ecell4
+{
+
+/**
+ * A 4-ary heap of the times of items indexed from zero. The time of each
+ * item is kept next to its index in the heap, so that sifting never
+ * dereferences an item. The indices are dense, and erase gives the last
+ * index to the erased one.
+ */
+class HeapEventQueue
+{
+public:
+
+    typedef std::size_t index_type;
+    typedef std::size_t size_type;
+
+protected:
+
+    struct node_type
+    {
+        Real time;
+        index_type index;
+    };
+
+    static const size_type arity = 4;
+
+public:
+
+    size_type size() const
+    {
+        return positions_.size();
+    }
+
+    void clear()
+    {
+        heap_.clear();
+        positions_.clear();
+    }
+
+    /**
+     * add the time of the next index, size().
+     */
+    void push(const Real time)
+    {
+        const node_type node = {time, positions_.size()};
+        positions_.push_back(heap_.size());
+        heap_.push_back(node);
+        move_up(heap_.size() - 1);
+    }
+
+    /**
+     * remove the time of the index, and give the last index to it.
+     */
+    void erase(const index_type i)
+    {
+        const size_type pos(positions_[i]);
+        const size_type last_pos(heap_.size() - 1);
+        if (pos != last_pos)
+        {
+            heap_[pos] = heap_[last_pos];
+            positions_[heap_[pos].index] = pos;
+        }
+        heap_.pop_back();
+
+        const index_type last(positions_.size() - 1);
+        if (i != last)
+        {
+            positions_[i] = positions_[last];
+            heap_[positions_[i]].index = i;
+        }
+        positions_.pop_back();
+
+        if (pos != last_pos)
+        {
+            move(pos);
+        }
+    }
+
+    void update(const index_type i, const Real time)
+    {
+        const size_type pos(positions_[i]);
+        heap_[pos].time = time;
+        move(pos);
+    }
+
+    /**
+     * set a time without updating the order until rebuild is called.
+     */
+    void assign(const index_type i, const Real time)
+    {
+        heap_[positions_[i]].time = time;
+    }
+
+    /**
+     * restore the order in O(n) after assign.
+     */
+    void rebuild()
+    {
+        if (heap_.size() <= 1)
+        {
+            return;
+        }
+
+        for (size_type pos((heap_.size() - 2) / arity + 1); pos > 0; --pos)
+        {
+            move_down(pos - 1);
+        }
+    }
+
+    index_type top() const
+    {
+        return heap_[0].index;
+    }
+
+    Real top_time() const
+    {
+        return heap_[0].time;
+    }
+
+    index_type second() const
+    {
+        size_type pos(1);
+        for (size_type child(2); child <= arity && child < heap_.size(); ++child)
+        {
+            if (heap_[child].time < heap_[pos].time)
+            {
+                pos = child;
+            }
+        }
+        return heap_[pos].index;
+    }
+
+    Real time(const index_type i) const
+    {
+        return heap_[positions_[i]].time;
+    }
+
+    bool check() const
+    {
+        if (heap_.size() != positions_.size())
+        {
+            return false;
+        }
+
+        for (size_type pos(0); pos < heap_.size(); ++pos)
+        {
+            if (heap_[pos].index >= positions_.size() || positions_[heap_[pos].index] != pos)
+            {
+                return false;
+            }
+            if (pos > 0 && heap_[pos].time < heap_[(pos - 1) / arity].time)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+protected:
+
+    void move(const size_type pos)
+    {
+        if (pos > 0 && heap_[pos].time < heap_[(pos - 1) / arity].time)
+        {
+            move_up(pos);
+        }
+        else
+        {
+            move_down(pos);
+        }
+    }
+
+    void move_up(size_type pos)
+    {
+        const node_type node(heap_[pos]);
+        while (pos > 0)
+        {
+            const size_type parent((pos - 1) / arity);
+            if (!(node.time < heap_[parent].time))
+            {
+                break;
+            }
+            heap_[pos] = heap_[parent];
+            positions_[heap_[pos].index] = pos;
+            pos = parent;
+        }
+        heap_[pos] = node;
+        positions_[node.index] = pos;
+    }
+
+    void move_down(size_type pos)
+    {
+        const node_type node(heap_[pos]);
+        const size_type n(heap_.size());
+        while (true)
+        {
+            const size_type first(pos * arity + 1);
+            if (first >= n)
+            {
+                break;
+            }
+
+            size_type child(first);
+            const size_type last(std::min(first + arity, n));
+            for (size_type j(first + 1); j < last; ++j)
+            {
+                if (heap_[j].time < heap_[child].time)
+                {
+                    child = j;
+                }
+            }
+
+            if (!(heap_[child].time < node.time))
+            {
+                break;
+            }
+            heap_[pos] = heap_[child];
+            positions_[heap_[pos].index] = pos;
+            pos = child;
+        }
+        heap_[pos] = node;
+        positions_[node.index] = pos;
+    }
+
+protected:
+
+    std::vector<node_type> heap_;
+    std::vector<size_type> positions_;
+};
+
+enum EventQueueType
+{
+    HEAP_QUEUE = 0,
+    CALENDAR_QUEUE = 1
+};
+
+/**
+ * HeapEventQueue or CalendarEventQueue chosen at runtime.
+ */
+class SelectableEventQueue
+{
+public:
+
+    typedef std::size_t index_type;
+    typedef std::size_t size_type;
+
+public:
+
+    SelectableEventQueue(const EventQueueType type = HEAP_QUEUE)
+        : type_(type)
+    {
+        ;
+    }
+
+    EventQueueType type() const
+    {
+        return type_;
+    }
+
+    size_type size() const
+    {
+        return (type_ == CALENDAR_QUEUE ? calendar_.size() : heap_.size());
+    }
+
+    void clear()
+    {
+        heap_.clear();
+        calendar_.clear();
+    }
+
+    void push(const Real time)
+    {
+        if (type_ == CALENDAR_QUEUE)
+        {
+            calendar_.push(time);
+        }
+        else
+        {
+            heap_.push(time);
+        }
+    }
+
+    void erase(const index_type i)
+    {
+        if (type_ == CALENDAR_QUEUE)
+        {
+            calendar_.erase(i);
+        }
+        else
+        {
+            heap_.erase(i);
+        }
+    }
+
+    void update(const index_type i, const Real time)
+    {
+        if (type_ == CALENDAR_QUEUE)
+        {
+            calendar_.update(i, time);
+        }
+        else
+        {
+            heap_.update(i, time);
+        }
+    }
+
+    void assign(const index_type i, const Real time)
+    {
+        if (type_ == CALENDAR_QUEUE)
+        {
+            calendar_.assign(i, time);
+        }
+        else
+        {
+            heap_.assign(i, time);
+        }
+    }
+
+    void rebuild()
+    {
+        if (type_ == CALENDAR_QUEUE)
+        {
+            calendar_.rebuild();
+        }
+        else
+        {
+            heap_.rebuild();
+        }
+    }
+
+    index_type top() const
+    {
+        return (type_ == CALENDAR_QUEUE ? calendar_.top() : heap_.top());
+    }
+
+    Real top_time() const
+    {
+        return (type_ == CALENDAR_QUEUE ? calendar_.top_time() : heap_.top_time());
+    }
+
+    index_type second() const
+    {
+        return (type_ == CALENDAR_QUEUE ? calendar_.second() : heap_.second());
+    }
+
+    Real time(const index_type i) const
+    {
+        return (type_ == CALENDAR_QUEUE ? calendar_.time(i) : heap_.time(i));
+    }
+
+    bool check() const
+    {
+        return (type_ == CALENDAR_QUEUE ? calendar_.check() : heap_.check());
+    }
+
+protected:
+
+    EventQueueType type_;
+    HeapEventQueue heap_;
+    CalendarEventQueue calendar_;
+};
+
+} // ecell4
+
+#endif /* ECELL4_EVENT_QUEUE_HPP */
@@ -0,0 +1,259 @@
+#ifndef ECELL4_FLAT_EVENT_SCHEDULER_HPP
+#define ECELL4_FLAT_EVENT_SCHEDULER_HPP
+
+#include <boost/range/iterator_range.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "types.hpp"
+#include "EventScheduler.hpp"
+#include "EventQueue.hpp"
+
+
+namespace ecell4
+{
+
+/**
+ * An event scheduler with the same interface as EventSchedulerBase.
+ * The times of events are ordered by Tqueue_, a 4-ary heap by default,
+ * which holds the time of each event next to its index, so the time of an
+ * event is read only when it is added or updated. An identifier packs a
+ * slot in a flat table, which gives the index of the event, with a
+ * generation counting the reuse of the slot. update(first, last) takes
+ * many events at once, and rebuilds the queue when they are too many to
+ * sift one by one.
+ */
+template <class EventType, class Tqueue_ = HeapEventQueue>
+class FlatEventSchedulerBase
+{
+public:
+
+    typedef Tqueue_ queue_type;
+    typedef std::size_t size_type;
+    typedef unsigned long long identifier_type;
+    typedef std::pair<identifier_type, boost::shared_ptr<EventType> > value_type;
+
+protected:
+
+    typedef std::size_t index_type;
+    typedef std::vector<value_type> value_vector;
+
+public:
+
+    typedef boost::iterator_range<typename value_vector::const_iterator> events_range;
+
+public:
+
+    FlatEventSchedulerBase(const queue_type& queue = queue_type())
+        : queue_(queue), time_(0.0)
+    {
+        ;
+    }
+
+    ~FlatEventSchedulerBase() {}
+
+    Real time() const
+    {
+        return time_;
+    }
+
+    size_type size() const
+    {
+        return items_.size();
+    }
+
+    const queue_type& queue() const
+    {
+        return queue_;
+    }
+
+    value_type const& top() const
+    {
+        return items_[queue_.top()];
+    }
+
+    value_type pop()
+    {
+        if (items_.empty())
+        {
+            throw std::out_of_range("queue is empty");
+        }
+        const index_type i(queue_.top());
+        const value_type top(items_[i]);
+        time_ = queue_.time(i);
+        remove_index(i);
+        return top;
+    }
+
+    value_type const& second() const
+    {
+        if (size() <= 1)
+        {
+            throw std::out_of_range("FlatEventSchedulerBase::second():"
+                                    " item count less than 2.");
+        }
+        return items_[queue_.second()];
+    }
+
+    boost::shared_ptr<EventType> get(identifier_type const& id) const
+    {
+        return items_[index(id)].second;
+    }
+
+    void clear()
+    {
+        time_ = 0.0;
+        items_.clear();
+        queue_.clear();
+        slots_.clear();
+        generations_.clear();
+        free_slots_.clear();
+    }
+
+    identifier_type add(boost::shared_ptr<EventType> const& event)
+    {
+        index_type slot;
+        if (free_slots_.empty())
+        {
+            slot = slots_.size();
+            slots_.push_back(0);
+            generations_.push_back(1);
+        }
+        else
+        {
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+        }
+
+        const identifier_type id(
+            (static_cast<identifier_type>(generations_[slot]) << 32) | slot);
+        slots_[slot] = items_.size();
+        items_.push_back(value_type(id, event));
+        queue_.push(event->time());
+        return id;
+    }
+
+    void remove(identifier_type const& id)
+    {
+        remove_index(index(id));
+    }
+
+    void update(value_type const& pair)
+    {
+        const index_type i(index(pair.first));
+        items_[i].second = pair.second;
+        queue_.update(i, pair.second->time());
+    }
+
+    /**
+     * update a range of pairs, e.g. events(), after changing their times.
+     */
+    template <typename Titer_>
+    void update(Titer_ first, Titer_ last)
+    {
+        // sifting each costs O(k log n), and rebuilding the queue O(n).
+        if (static_cast<size_type>(std::distance(first, last)) * 4 < size())
+        {
+            for (; first != last; ++first)
+            {
+                update(*first);
+            }
+            return;
+        }
+
+        for (; first != last; ++first)
+        {
+            const index_type i(index((*first).first));
+            items_[i].second = (*first).second;
+            queue_.assign(i, (*first).second->time());
+        }
+        queue_.rebuild();
+    }
+
+    bool check() const
+    {
+        if (queue_.size() != items_.size() || !queue_.check())
+        {
+            return false;
+        }
+
+        for (index_type i(0); i < items_.size(); ++i)
+        {
+            if (index(items_[i].first) != i || queue_.time(i) != items_[i].second->time())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    events_range events() const
+    {
+        return boost::make_iterator_range(items_.begin(), items_.end());
+    }
+
+    const Real next_time() const
+    {
+        if (size() > 0)
+        {
+            return queue_.top_time();
+        }
+        else
+        {
+            return inf;
+        }
+    }
+
+protected:
+
+    index_type index(identifier_type const& id) const
+    {
+        const index_type slot(static_cast<index_type>(id & 0xffffffffULL));
+        if (slot >= slots_.size() || generations_[slot] != (id >> 32))
+        {
+            throw std::out_of_range((boost::format("%s: Key not found (%s)")
+                % __FUNCTION__ % boost::lexical_cast<std::string>(id)).str());
+        }
+        return slots_[slot];
+    }
+
+    void remove_index(const index_type i)
+    {
+        // release the slot, invalidating the identifier.
+        const index_type slot(static_cast<index_type>(items_[i].first & 0xffffffffULL));
+        ++generations_[slot];
+        free_slots_.push_back(slot);
+
+        // fill the hole with the last item as the queue does.
+        queue_.erase(i);
+        const index_type last(items_.size() - 1);
+        if (i != last)
+        {
+            items_[i] = items_[last];
+            slots_[items_[i].first & 0xffffffffULL] = i;
+        }
+        items_.pop_back();
+    }
+
+protected:
+
+    value_vector items_;
+    queue_type queue_;
+
+    std::vector<index_type> slots_;
+    std::vector<unsigned int> generations_;
+    std::vector<index_type> free_slots_;
+
+    Real time_;
+};
+
+typedef FlatEventSchedulerBase<Event> FlatEventScheduler;
+
+} // ecell4
+
+#endif /* ECELL4_FLAT_EVENT_SCHEDULER_HPP */
@@ -0,0 +1,106 @@
+#include <limits>
+
+#include "LatticeSpaceCompactImpl.hpp"
+
+namespace ecell4 {
+
+typedef VoxelPoolIndexStorage::key_type key_type;
+
+/**
+ * the index of the location of a pool without one.
+ */
+static const key_type no_location(std::numeric_limits<key_type>::max());
+
+void VoxelPoolIndexStorage::clear()
+{
+    voxels_.clear();
+    pools_.clear();
+    location_indices_.clear();
+    counts_.clear();
+    free_indices_.clear();
+    indices_.clear();
+}
+
+bool VoxelPoolIndexStorage::find(
+    const boost::shared_ptr<VoxelPool>& vp, key_type& key) const
+{
+    utils::get_mapper_mf<const VoxelPool*, key_type>::type::const_iterator
+        itr(indices_.find(vp.get()));
+    if (itr == indices_.end())
+    {
+        return false;
+    }
+
+    key = (*itr).second;
+    return true;
+}
+
+key_type VoxelPoolIndexStorage::index_of(const boost::shared_ptr<VoxelPool>& vp)
+{
+    {
+        key_type key;
+        if (find(vp, key))
+        {
+            return key;
+        }
+    }
+
+    const boost::shared_ptr<VoxelPool> location(vp->location());
+    key_type location_index(no_location);
+    if (location)
+    {
+        location_index = index_of(location);
+        retain(location_index);
+    }
+
+    key_type idx;
+    if (!free_indices_.empty())
+    {
+        idx = free_indices_.back();
+        free_indices_.pop_back();
+        pools_[idx] = vp;
+        location_indices_[idx] = location_index;
+        counts_[idx] = 0;
+    }
+    else
+    {
+        if (pools_.size() >= static_cast<std::size_t>(no_location))
+        {
+            if (location)
+            {
+                release(location_index);
+            }
+            throw NotSupported("Too many voxel pools for LatticeSpaceCompactImpl.");
+        }
+
+        idx = static_cast<key_type>(pools_.size());
+        pools_.push_back(vp);
+        location_indices_.push_back(location_index);
+        counts_.push_back(0);
+    }
+
+    indices_.insert(std::make_pair(vp.get(), idx));
+    return idx;
+}
+
+void VoxelPoolIndexStorage::release(const key_type& key)
+{
+    if (--counts_[key] > 0)
+    {
+        return;
+    }
+
+    const key_type location_index(location_indices_[key]);
+
+    indices_.erase(pools_[key].get());
+    pools_[key].reset();
+    location_indices_[key] = no_location;
+    free_indices_.push_back(key);
+
+    if (location_index != no_location)
+    {
+        release(location_index);
+    }
+}
+
+} // ecell4
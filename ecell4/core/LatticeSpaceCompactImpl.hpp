@@ -0,0 +1,181 @@
+#ifndef ECELL4_LATTICE_SPACE_COMPACT_IMPL_HPP
+#define ECELL4_LATTICE_SPACE_COMPACT_IMPL_HPP
+
+#include <boost/cstdint.hpp>
+
+#include "LatticeSpaceStorageImpl.hpp"
+
+namespace ecell4 {
+
+/**
+ * A storage of LatticeSpaceStorageImpl holding a 16-bit index of the voxel
+ * pool at each voxel. The pools are kept in a side table together with the
+ * indices of their locations. A pool is registered when it is first placed,
+ * and released when no voxel holds it and no registered pool is located on
+ * it, so that its index can be reused. No more than 65535 voxel pools can
+ * be placed at once.
+ */
+class VoxelPoolIndexStorage
+{
+public:
+
+    typedef boost::uint16_t key_type;
+    typedef std::vector<key_type> container_type;
+    typedef VoxelSpaceBase::coordinate_type coordinate_type;
+    typedef std::vector<boost::shared_ptr<VoxelPool> > pool_container_type;
+
+public:
+
+    void clear();
+
+    void reserve(const container_type::size_type size)
+    {
+        voxels_.reserve(size);
+    }
+
+    container_type::size_type size() const
+    {
+        return voxels_.size();
+    }
+
+    void push_back(const key_type& key)
+    {
+        voxels_.push_back(key);
+        retain(key);
+    }
+
+    const key_type& operator[](const coordinate_type& coord) const
+    {
+        return voxels_[coord];
+    }
+
+    const key_type& at(const coordinate_type& coord) const
+    {
+        return voxels_.at(coord);
+    }
+
+    /**
+     * register the given pool, which is never released until clear().
+     */
+    key_type pin(const boost::shared_ptr<VoxelPool>& vp)
+    {
+        const key_type key(index_of(vp));
+        retain(key);
+        return key;
+    }
+
+    bool find(const boost::shared_ptr<VoxelPool>& vp, key_type& key) const;
+
+    const boost::shared_ptr<VoxelPool>& pool(const key_type& key) const
+    {
+        return pools_[key];
+    }
+
+    key_type location(const key_type& key) const
+    {
+        return location_indices_[key];
+    }
+
+    void set(const coordinate_type& coord, const boost::shared_ptr<VoxelPool>& vp)
+    {
+        key_type& voxel(voxels_.at(coord));
+        const key_type key(index_of(vp));
+        retain(key);
+        release(voxel);
+        voxel = key;
+    }
+
+    void swap(const coordinate_type& coord1, const coordinate_type& coord2)
+    {
+        std::swap(voxels_[coord1], voxels_[coord2]);
+    }
+
+    /**
+     * the number of the voxel pools registered in the side table.
+     */
+    std::size_t num_pools() const
+    {
+        return pools_.size() - free_indices_.size();
+    }
+
+protected:
+
+    /**
+     * return the index of the given pool, registering it at the first time.
+     */
+    key_type index_of(const boost::shared_ptr<VoxelPool>& vp);
+
+    void retain(const key_type& key)
+    {
+        ++counts_[key];
+    }
+
+    void release(const key_type& key);
+
+protected:
+
+    container_type voxels_;
+
+    /**
+     * the voxel pools and the indices of their locations.
+     * The location of a pool without one is the largest index, which no pool takes.
+     * counts_ holds the number of voxels and registered pools referring to each pool.
+     */
+    pool_container_type pools_;
+    std::vector<key_type> location_indices_;
+    std::vector<std::size_t> counts_;
+    std::vector<key_type> free_indices_;
+    utils::get_mapper_mf<const VoxelPool*, key_type>::type indices_;
+};
+
+/**
+ * A lattice space holding a 16-bit index of the voxel pool at each voxel.
+ * Moving a molecule thus compares and swaps two indices without touching
+ * any reference count, and a voxel takes 2 bytes instead of the 16 bytes
+ * of a shared_ptr in LatticeSpaceVectorImpl. See VoxelPoolIndexStorage.
+ */
+class LatticeSpaceCompactImpl
+    : public LatticeSpaceStorageImpl<VoxelPoolIndexStorage>
+{
+public:
+
+    typedef LatticeSpaceStorageImpl<VoxelPoolIndexStorage> base_type;
+    typedef VoxelPoolIndexStorage::key_type pool_index_type;
+
+public:
+
+    LatticeSpaceCompactImpl(const Real3& edge_lengths,
+                            const Real& voxel_radius,
+                            const bool is_periodic = true)
+        : base_type(edge_lengths, voxel_radius, is_periodic)
+    {
+        ;
+    }
+
+    /**
+     * the number of the voxel pools registered in the side table.
+     */
+    std::size_t num_pools() const
+    {
+        return voxels_.num_pools();
+    }
+
+#ifdef WITH_HDF5
+    /*
+     * HDF5 Save
+     */
+    void save_hdf5(H5::Group* root) const
+    {
+        save_lattice_space(*this, root, "LatticeSpaceCompactImpl");
+    }
+
+    void load_hdf5(const H5::Group& root)
+    {
+        load_lattice_space(root, this);
+    }
+#endif
+};
+
+} // ecell4
+
+#endif /* ECELL4_LATTICE_SPACE_COMPACT_IMPL_HPP */
@@ -0,0 +1,583 @@
+#ifndef ECELL4_LATTICE_SPACE_STORAGE_IMPL_HPP
+#define ECELL4_LATTICE_SPACE_STORAGE_IMPL_HPP
+
+#include "Context.hpp"
+#include "MoleculePool.hpp"
+#include "VacantType.hpp"
+#include "StructureType.hpp"
+#include "HCPLatticeSpace.hpp"
+
+namespace ecell4 {
+
+/**
+ * A lattice space keeping a key of the voxel pool at each voxel in Tstorage_.
+ * Tstorage_ is a vector-like container of keys which also maps a key to
+ * its pool (pool) and to the key of the location of the pool (location),
+ * registers a pool placed on a voxel (set) and swaps two voxels (swap).
+ * See LatticeSpaceVectorImpl and LatticeSpaceCompactImpl.
+ */
+template <typename Tstorage_>
+class LatticeSpaceStorageImpl
+    : public HCPLatticeSpace
+{
+public:
+
+    typedef HCPLatticeSpace base_type;
+    typedef Tstorage_ voxel_container;
+    typedef typename voxel_container::key_type key_type;
+
+public:
+
+    LatticeSpaceStorageImpl(const Real3& edge_lengths,
+                            const Real& voxel_radius,
+                            const bool is_periodic = true)
+        : base_type(edge_lengths, voxel_radius, is_periodic), is_periodic_(is_periodic)
+    {
+        border_ = boost::shared_ptr<VoxelPool>(
+                new MoleculePool(Species("Border", voxel_radius_, 0), vacant_));
+        periodic_ = boost::shared_ptr<VoxelPool>(
+                new MoleculePool(Species("Periodic", voxel_radius, 0), vacant_));
+
+        initialize_voxels(is_periodic_);
+    }
+
+    virtual ~LatticeSpaceStorageImpl() {}
+
+    /*
+     * Space APIs
+     *
+     * using ParticleID, Species and Posision3
+     */
+
+    Integer num_species() const
+    {
+        return voxel_pools_.size() + molecule_pools_.size();
+    }
+
+    bool remove_voxel(const ParticleID& pid)
+    {
+        for (molecule_pool_map_type::iterator i(molecule_pools_.begin());
+             i != molecule_pools_.end(); ++i)
+        {
+            const boost::shared_ptr<MoleculePool>& vp((*i).second);
+            MoleculePool::const_iterator j(vp->find(pid));
+            if (j != vp->end())
+            {
+                const coordinate_type coord((*j).coordinate);
+                if (!vp->remove_voxel_if_exists(coord))
+                {
+                    return false;
+                }
+
+                const boost::shared_ptr<VoxelPool> location(vp->location());
+                voxels_.set(coord, location);
+                location->add_voxel(coordinate_id_pair_type(ParticleID(), coord));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool remove_voxel(const coordinate_type& coord)
+    {
+        const boost::shared_ptr<VoxelPool> vp(get_voxel_pool_at(coord));
+        if (vp->is_vacant())
+        {
+            return false;
+        }
+        if (vp->remove_voxel_if_exists(coord))
+        {
+            const boost::shared_ptr<VoxelPool> location(vp->location());
+            voxels_.set(coord, location);
+            location->add_voxel(coordinate_id_pair_type(ParticleID(), coord));
+            return true;
+        }
+        return false;
+    }
+
+    bool update_structure(const Particle& p)
+    {
+        //XXX: Particle does not have a location.
+        ParticleVoxel v(p.species(), position2coordinate(p.position()), p.radius(), p.D());
+        return update_voxel(ParticleID(), v);
+    }
+
+    /*
+     * for Simulator
+     *
+     * using Species and coordinate_type
+     */
+
+    std::vector<std::pair<ParticleID, ParticleVoxel> > list_voxels() const
+    {
+        std::vector<std::pair<ParticleID, ParticleVoxel> > retval;
+
+        for (molecule_pool_map_type::const_iterator itr(molecule_pools_.begin());
+             itr != molecule_pools_.end(); ++itr)
+        {
+            const boost::shared_ptr<MoleculePool>& vp((*itr).second);
+
+            const std::string loc(get_location_serial(vp));
+            const Species& sp(vp->species());
+
+            for (MoleculePool::const_iterator i(vp->begin());
+                i != vp->end(); ++i)
+            {
+                retval.push_back(std::make_pair(
+                    (*i).pid,
+                    ParticleVoxel(sp, (*i).coordinate, vp->radius(), vp->D(), loc)));
+            }
+        }
+
+        for (voxel_pool_map_type::const_iterator itr(voxel_pools_.begin());
+             itr != voxel_pools_.end(); ++itr)
+        {
+            push_voxels((*itr).second, (*itr).second->species(), retval);
+        }
+        return retval;
+    }
+
+    std::vector<std::pair<ParticleID, ParticleVoxel> > list_voxels(const Species& sp) const
+    {
+        std::vector<std::pair<ParticleID, ParticleVoxel> > retval;
+        SpeciesExpressionMatcher sexp(sp);
+
+        for (voxel_pool_map_type::const_iterator itr(voxel_pools_.begin());
+             itr != voxel_pools_.end(); ++itr)
+        {
+            if (!sexp.match((*itr).first))
+            {
+                continue;
+            }
+
+            push_voxels((*itr).second, sp, retval);
+        }
+
+        for (molecule_pool_map_type::const_iterator itr(molecule_pools_.begin());
+             itr != molecule_pools_.end(); ++itr)
+        {
+            if (!sexp.match((*itr).first))
+            {
+                continue;
+            }
+
+            const boost::shared_ptr<MoleculePool>& vp((*itr).second);
+            const std::string loc(get_location_serial(vp));
+            for (MoleculePool::const_iterator i(vp->begin());
+                i != vp->end(); ++i)
+            {
+                retval.push_back(std::make_pair(
+                    (*i).pid,
+                    ParticleVoxel(sp, (*i).coordinate, vp->radius(), vp->D(), loc)));
+            }
+        }
+
+        return retval;
+    }
+
+    std::vector<std::pair<ParticleID, ParticleVoxel> > list_voxels_exact(const Species& sp) const
+    {
+        std::vector<std::pair<ParticleID, ParticleVoxel> > retval;
+
+        {
+            voxel_pool_map_type::const_iterator itr(voxel_pools_.find(sp));
+            if (itr != voxel_pools_.end())
+            {
+                push_voxels((*itr).second, sp, retval);
+                return retval;
+            }
+        }
+
+        {
+            molecule_pool_map_type::const_iterator itr(molecule_pools_.find(sp));
+            if (itr != molecule_pools_.end())
+            {
+                const boost::shared_ptr<MoleculePool>& vp((*itr).second);
+                const std::string loc(get_location_serial(vp));
+                for (MoleculePool::const_iterator i(vp->begin());
+                     i != vp->end(); ++i)
+                {
+                    retval.push_back(std::make_pair(
+                        (*i).pid,
+                        ParticleVoxel(sp, (*i).coordinate, vp->radius(), vp->D(), loc)));
+                }
+                return retval;
+            }
+        }
+        return retval; // an empty vector
+    }
+
+    std::pair<ParticleID, ParticleVoxel> get_voxel_at(const coordinate_type& coord) const
+    {
+        const boost::shared_ptr<VoxelPool>& vp(voxels_.pool(voxels_.at(coord)));
+
+        return std::make_pair(
+            vp->get_particle_id(coord),
+            ParticleVoxel(vp->species(),
+                  coord,
+                  vp->radius(),
+                  vp->D(),
+                  get_location_serial(vp)));
+    }
+
+    /*
+     * Change the Species and coordinate of a ParticleVoxel with ParticleID, pid, to
+     * v.species() and v.coordinate() respectively and return false.
+     * If no ParticleVoxel with pid is found, create a new ParticleVoxel at v.coordiante() and return ture.
+     */
+    bool update_voxel(const ParticleID& pid, ParticleVoxel v)
+    {
+        const coordinate_type& to_coord(v.coordinate);
+        if (!is_in_range(to_coord))
+        {
+            throw NotSupported("Out of bounds");
+        }
+
+        boost::shared_ptr<VoxelPool> new_vp(get_voxel_pool(v)); //XXX: need MoleculeInfo
+        boost::shared_ptr<VoxelPool> dest_vp(get_voxel_pool_at(to_coord));
+
+        if (dest_vp != new_vp->location())
+        {
+            throw NotSupported(
+                "Mismatch in the location. Failed to place '"
+                + new_vp->species().serial() + "' to '"
+                + dest_vp->species().serial() + "'.");
+        }
+
+        const coordinate_type
+            from_coord(pid != ParticleID() ? get_coord(pid) : -1);
+        if (from_coord != -1)
+        {
+            // move
+            get_voxel_pool_at(from_coord)->remove_voxel_if_exists(from_coord);
+
+            //XXX: use location?
+            dest_vp->replace_voxel(to_coord, from_coord);
+            voxels_.set(from_coord, dest_vp);
+
+            new_vp->add_voxel(coordinate_id_pair_type(pid, to_coord));
+            voxels_.set(to_coord, new_vp);
+            return false;
+        }
+
+        // new
+        dest_vp->remove_voxel_if_exists(to_coord);
+
+        new_vp->add_voxel(coordinate_id_pair_type(pid, to_coord));
+        voxels_.set(to_coord, new_vp);
+        return true;
+    }
+
+    bool add_voxel(const Species& sp, const ParticleID& pid, const coordinate_type& coord)
+    {
+        boost::shared_ptr<VoxelPool> vpool(find_voxel_pool(sp));
+        boost::shared_ptr<VoxelPool> location(get_voxel_pool_at(coord));
+
+        if (vpool->location() != location)
+            return false;
+
+        location->remove_voxel_if_exists(coord);
+        vpool->add_voxel(coordinate_id_pair_type(pid, coord));
+        voxels_.set(coord, vpool);
+
+        return true;
+    }
+
+    bool add_voxels(const Species& sp,
+                    std::vector<std::pair<ParticleID, coordinate_type> > voxels)
+    {
+        // this function doesn't check location.
+        boost::shared_ptr<VoxelPool> mtb;
+        try
+        {
+            mtb = find_voxel_pool(sp);
+        }
+        catch (NotFound &e)
+        {
+            return false;
+        }
+
+        for (std::vector<std::pair<ParticleID, coordinate_type> >::iterator itr(voxels.begin());
+                itr != voxels.end(); ++itr)
+        {
+            const ParticleID pid((*itr).first);
+            const coordinate_type coord((*itr).second);
+            get_voxel_pool_at(coord)->remove_voxel_if_exists(coord);
+            mtb->add_voxel(coordinate_id_pair_type(pid, coord));
+            voxels_.set(coord, mtb);
+        }
+        return true;
+    }
+
+    const Species& find_species(std::string name) const
+    {
+        for (voxel_pool_map_type::const_iterator itr(voxel_pools_.begin());
+             itr != voxel_pools_.end(); ++itr)
+        {
+            if ((*itr).first.serial() == name)
+            {
+                return (*itr).first;
+            }
+        }
+
+        for (molecule_pool_map_type::const_iterator itr(molecule_pools_.begin());
+             itr != molecule_pools_.end(); ++itr)
+        {
+            if ((*itr).first.serial() == name)
+            {
+                return (*itr).first;
+            }
+        }
+        throw NotFound(name);
+    }
+
+    std::vector<coordinate_type> list_coords(const Species& sp) const
+    {
+        std::vector<coordinate_type> retval;
+        for (molecule_pool_map_type::const_iterator itr(molecule_pools_.begin());
+             itr != molecule_pools_.end(); ++itr)
+        {
+            if (!SpeciesExpressionMatcher(sp).match((*itr).first))
+            {
+                continue;
+            }
+
+            const boost::shared_ptr<MoleculePool>& vp((*itr).second);
+
+            for (MoleculePool::const_iterator vitr(vp->begin());
+                 vitr != vp->end(); ++vitr)
+            {
+                retval.push_back((*vitr).coordinate);
+            }
+        }
+        return retval;
+    }
+
+    std::vector<coordinate_type> list_coords_exact(const Species& sp) const
+    {
+        std::vector<coordinate_type> retval;
+
+        molecule_pool_map_type::const_iterator itr(molecule_pools_.find(sp));
+        if (itr == molecule_pools_.end())
+        {
+            return retval;
+        }
+
+        const boost::shared_ptr<MoleculePool>& vp((*itr).second);
+
+        for (MoleculePool::const_iterator itr(vp->begin()); itr != vp->end(); ++itr)
+        {
+            retval.push_back((*itr).coordinate);
+        }
+        return retval;
+    }
+
+    boost::shared_ptr<VoxelPool> get_voxel_pool_at(const coordinate_type& coord) const
+    {
+        return voxels_.pool(voxels_.at(coord));
+    }
+
+    bool move(const coordinate_type& src,
+              const coordinate_type& dest,
+              const std::size_t candidate=0)
+    {
+        return move_(src, dest, candidate).second;
+    }
+
+    bool can_move(const coordinate_type& src, const coordinate_type& dest) const
+    {
+        if (src == dest)
+            return false;
+
+        const key_type& src_key(voxels_[src]);
+        if (src_key == vacant_key_)
+            return false;
+
+        coordinate_type to(dest);
+
+        if (voxels_[to] == border_key_)
+            return false;
+
+        if (voxels_[to] == periodic_key_)
+            to = apply_boundary_(to);
+
+        return (voxels_[to] == voxels_.location(src_key));
+    }
+
+    coordinate_type
+    get_neighbor(const coordinate_type& coord, const Integer& nrand) const
+    {
+        coordinate_type const dest = get_neighbor_(coord, nrand);
+
+        if (voxels_[dest] != periodic_key_)
+        {
+            return dest;
+        }
+        else
+        {
+            return periodic_transpose(dest);
+        }
+    }
+
+    bool is_periodic() const
+    {
+        return is_periodic_;
+    }
+
+    void reset(const Real3& edge_lengths, const Real& voxel_radius, const bool is_periodic)
+    {
+        base_type::reset(edge_lengths, voxel_radius, is_periodic);
+
+        is_periodic_ = is_periodic;
+        initialize_voxels(is_periodic_);
+    }
+
+    const Particle particle_at(const coordinate_type& coord) const
+    {
+        const boost::shared_ptr<VoxelPool>& vp(voxels_.pool(voxels_.at(coord)));
+
+        return Particle(vp->species(),
+                        coordinate2position(coord),
+                        vp->radius(),
+                        vp->D());
+    }
+
+protected:
+
+    coordinate_type apply_boundary_(const coordinate_type& coord) const
+    {
+        return periodic_transpose(coord);
+    }
+
+    void initialize_voxels(const bool is_periodic)
+    {
+        const coordinate_type voxel_size(col_size_ * row_size_ * layer_size_);
+
+        voxel_pools_.clear();
+        molecule_pools_.clear();
+
+        voxels_.clear();
+        vacant_key_ = voxels_.pin(vacant_);
+        border_key_ = voxels_.pin(border_);
+        periodic_key_ = voxels_.pin(periodic_);
+
+        voxels_.reserve(voxel_size);
+        for (coordinate_type coord(0); coord < voxel_size; ++coord)
+        {
+            if (!is_inside(coord))
+            {
+                if (is_periodic)
+                {
+                    voxels_.push_back(periodic_key_);
+                    periodic_->add_voxel(coordinate_id_pair_type(ParticleID(), coord));
+                }
+                else
+                {
+                    voxels_.push_back(border_key_);
+                    border_->add_voxel(coordinate_id_pair_type(ParticleID(), coord));
+                }
+            }
+            else
+            {
+                voxels_.push_back(vacant_key_);
+                vacant_->add_voxel(coordinate_id_pair_type(ParticleID(), coord));
+            }
+        }
+    }
+
+    std::pair<coordinate_type, bool>
+    move_(coordinate_type from,
+          coordinate_type to,
+          const std::size_t candidate=0)
+    {
+        if (from == to)
+        {
+            return std::pair<coordinate_type, bool>(from, false);
+        }
+
+        const key_type& from_key(voxels_[from]);
+        if (from_key == vacant_key_)
+        {
+            return std::pair<coordinate_type, bool>(from, true);
+        }
+
+        if (voxels_[to] == border_key_)
+        {
+            return std::pair<coordinate_type, bool>(from, false);
+        }
+        else if (voxels_[to] == periodic_key_)
+        {
+            to = apply_boundary_(to);
+        }
+
+        const key_type& to_key(voxels_[to]);
+        if (to_key != voxels_.location(from_key))
+        {
+            return std::pair<coordinate_type, bool>(to, false);
+        }
+
+        voxels_.pool(from_key)->replace_voxel(from, to, candidate);
+        voxels_.pool(to_key)->replace_voxel(to, from);
+        voxels_.swap(from, to);
+
+        return std::pair<coordinate_type, bool>(to, true);
+    }
+
+    coordinate_type get_coord(const ParticleID& pid) const
+    {
+        for (molecule_pool_map_type::const_iterator itr(molecule_pools_.begin());
+             itr != molecule_pools_.end(); ++itr)
+        {
+            const boost::shared_ptr<MoleculePool>& vp((*itr).second);
+            for (MoleculePool::const_iterator vitr(vp->begin());
+                 vitr != vp->end(); ++vitr)
+            {
+                if ((*vitr).pid == pid)
+                {
+                    return (*vitr).coordinate;
+                }
+            }
+        }
+        return -1; //XXX: a bit dirty way
+    }
+
+    /**
+     * append the voxels occupied by the given pool, which keeps no coordinate.
+     * Nothing is appended for a pool which is not placed on the lattice.
+     */
+    void push_voxels(const boost::shared_ptr<VoxelPool>& vp, const Species& sp,
+                     std::vector<std::pair<ParticleID, ParticleVoxel> >& retval) const
+    {
+        key_type key;
+        if (!voxels_.find(vp, key))
+        {
+            return;  // never placed
+        }
+
+        const std::string loc(get_location_serial(vp));
+        for (coordinate_type coord(0); coord < static_cast<coordinate_type>(voxels_.size());
+             ++coord)
+        {
+            if (voxels_[coord] == key)
+            {
+                retval.push_back(std::make_pair(
+                    ParticleID(),
+                    ParticleVoxel(sp, coord, vp->radius(), vp->D(), loc)));
+            }
+        }
+    }
+
+protected:
+
+    bool is_periodic_;
+
+    voxel_container voxels_;
+
+    boost::shared_ptr<VoxelPool> border_;
+    boost::shared_ptr<VoxelPool> periodic_;
+    key_type vacant_key_, border_key_, periodic_key_;
+};
+
+} // ecell4
+
+#endif /* ECELL4_LATTICE_SPACE_STORAGE_IMPL_HPP */
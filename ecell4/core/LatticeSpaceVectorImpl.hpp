@@ -1,142 +1,121 @@
 #ifndef ECELL4_LATTICE_SPACE_VECTOR_IMPL_HPP
 #define ECELL4_LATTICE_SPACE_VECTOR_IMPL_HPP
 
-#include "HCPLatticeSpace.hpp"
+#include "LatticeSpaceStorageImpl.hpp"
 
 namespace ecell4 {
 
-class LatticeSpaceVectorImpl
-    : public HCPLatticeSpace
+/**
+ * A storage of LatticeSpaceStorageImpl holding a shared_ptr of the voxel
+ * pool at each voxel. A pool is its own key.
+ */
+class VoxelPoolPointerStorage
 {
 public:
 
-    typedef HCPLatticeSpace base_type;
-    typedef std::vector<boost::shared_ptr<VoxelPool> > voxel_container;
+    typedef boost::shared_ptr<VoxelPool> key_type;
+    typedef std::vector<key_type> container_type;
+    typedef VoxelSpaceBase::coordinate_type coordinate_type;
 
 public:
 
-    LatticeSpaceVectorImpl(const Real3& edge_lengths,
-                           const Real& voxel_radius,
-                           const bool is_periodic = true);
-    ~LatticeSpaceVectorImpl();
-
-    /*
-     * Space APIs
-     *
-     * using ParticleID, Species and Posision3
-     */
-
-    Integer num_species() const;
-
-    bool remove_voxel(const ParticleID& pid);
-    bool remove_voxel(const coordinate_type& coord);
-
-    bool update_structure(const Particle& p);
-
-    /*
-     * for Simulator
-     *
-     * using Species and coordinate_type
-     */
-    std::vector<std::pair<ParticleID, ParticleVoxel> > list_voxels() const;
-    std::vector<std::pair<ParticleID, ParticleVoxel> > list_voxels(const Species& sp) const;
-    std::vector<std::pair<ParticleID, ParticleVoxel> > list_voxels_exact(const Species& sp) const;
+    void clear()
+    {
+        voxels_.clear();
+    }
 
-    std::pair<ParticleID, ParticleVoxel> get_voxel_at(const coordinate_type& coord) const;
+    void reserve(const container_type::size_type size)
+    {
+        voxels_.reserve(size);
+    }
 
-    bool update_voxel(const ParticleID& pid, ParticleVoxel v);
-    bool add_voxel(const Species& species, const ParticleID& pid, const coordinate_type& coord);
+    container_type::size_type size() const
+    {
+        return voxels_.size();
+    }
 
-    bool add_voxels(const Species& species,
-                    std::vector<std::pair<ParticleID, coordinate_type> > voxels);
+    void push_back(const key_type& key)
+    {
+        voxels_.push_back(key);
+    }
 
-    const Species& find_species(std::string name) const;
-    std::vector<coordinate_type> list_coords(const Species& sp) const;
-    std::vector<coordinate_type> list_coords_exact(const Species& sp) const;
+    const key_type& operator[](const coordinate_type& coord) const
+    {
+        return voxels_[coord];
+    }
 
-    boost::shared_ptr<VoxelPool> get_voxel_pool_at(const coordinate_type& coord) const
+    const key_type& at(const coordinate_type& coord) const
     {
         return voxels_.at(coord);
     }
 
-    bool move(const coordinate_type& src,
-              const coordinate_type& dest,
-              const std::size_t candidate=0);
-    bool can_move(const coordinate_type& src, const coordinate_type& dest) const;
-
-    coordinate_type
-    get_neighbor(const coordinate_type& coord, const Integer& nrand) const
+    key_type pin(const boost::shared_ptr<VoxelPool>& vp)
     {
-        coordinate_type const dest = get_neighbor_(coord, nrand);
-
-        if (voxels_.at(dest) != periodic_)
-        {
-            return dest;
-        }
-        else
-        {
-            return periodic_transpose(dest);
-        }
+        return vp;
     }
 
-    bool is_periodic() const
+    bool find(const boost::shared_ptr<VoxelPool>& vp, key_type& key) const
     {
-        return is_periodic_;
+        key = vp;
+        return true;
     }
 
-#ifdef WITH_HDF5
-    /*
-     * HDF5 Save
-     */
-    void save_hdf5(H5::Group* root) const
+    const boost::shared_ptr<VoxelPool>& pool(const key_type& key) const
     {
-        save_lattice_space(*this, root, "LatticeSpaceVectorImpl");
+        return key;
     }
 
-    void load_hdf5(const H5::Group& root)
+    key_type location(const key_type& key) const
     {
-        load_lattice_space(root, this);
+        return key->location();
     }
-#endif
 
-    void reset(const Real3& edge_lengths, const Real& voxel_radius, const bool is_periodic)
+    void set(const coordinate_type& coord, const boost::shared_ptr<VoxelPool>& vp)
     {
-        base_type::reset(edge_lengths, voxel_radius, is_periodic);
-
-        is_periodic_ = is_periodic;
-        initialize_voxels(is_periodic_);
+        voxels_.at(coord) = vp;
     }
 
-    const Particle particle_at(const coordinate_type& coord) const;
-
-protected:
-
-    coordinate_type apply_boundary_(const coordinate_type& coord) const
+    void swap(const coordinate_type& coord1, const coordinate_type& coord2)
     {
-        return periodic_transpose(coord);
+        voxels_[coord1].swap(voxels_[coord2]);
     }
 
-    void initialize_voxels(const bool is_periodic);
+protected:
 
-    std::pair<coordinate_type, bool>
-    move_(coordinate_type from,
-          coordinate_type to,
-          const std::size_t candidate=0);
+    container_type voxels_;
+};
 
-    std::pair<coordinate_type, bool>
-    move_(coordinate_id_pair_type& info,
-          coordinate_type to);
+class LatticeSpaceVectorImpl
+    : public LatticeSpaceStorageImpl<VoxelPoolPointerStorage>
+{
+public:
 
-    coordinate_type get_coord(const ParticleID& pid) const;
+    typedef LatticeSpaceStorageImpl<VoxelPoolPointerStorage> base_type;
 
-protected:
+public:
 
-    bool is_periodic_;
+    LatticeSpaceVectorImpl(const Real3& edge_lengths,
+                           const Real& voxel_radius,
+                           const bool is_periodic = true)
+        : base_type(edge_lengths, voxel_radius, is_periodic)
+    {
+        ;
+    }
 
-    voxel_container voxels_;
+#ifdef WITH_HDF5
+    /*
+     * HDF5 Save
+     */
+    void save_hdf5(H5::Group* root) const
+    {
+        save_lattice_space(*this, root, "LatticeSpaceVectorImpl");
+    }
 
-    boost::shared_ptr<VoxelPool> border_;
-    boost::shared_ptr<VoxelPool> periodic_;
+    void load_hdf5(const H5::Group& root)
+    {
+        load_lattice_space(root, this);
+    }
+#endif
 };
 
 } // ecell4
@@ -1,4 +1,5 @@
 #include <numeric>
+#include <mutex>
 #include "Mesh.hpp"
 #include "exceptions.hpp"
 
@@ -92,6 +93,43 @@ Real MeshSurface::is_inside(const Real3& pos) const
 #endif
 }
 
+void MeshSurface::batch_is_inside(
+    const std::vector<Real3>& positions, std::vector<Real>& retval) const
+{
+#ifdef HAVE_VTK
+    // VTK filters sharing the output of the reader are not thread-safe.
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    for (std::vector<Real3>::const_iterator i(positions.begin());
+         i != positions.end(); ++i)
+    {
+        double lineP0[3];
+        lineP0[0] = (*i)[0] / ratio_ - shift_[0];
+        lineP0[1] = (*i)[1] / ratio_ - shift_[1];
+        lineP0[2] = (*i)[2] / ratio_ - shift_[2];
+        points->InsertNextPoint(lineP0);
+    }
+
+    vtkSmartPointer<vtkPolyData> pointsPolydata = vtkSmartPointer<vtkPolyData>::New();
+    pointsPolydata->SetPoints(points);
+    vtkSmartPointer<vtkSelectEnclosedPoints> selectEnclosedPoints
+        = vtkSmartPointer<vtkSelectEnclosedPoints>::New();
+    selectEnclosedPoints->SetInput(pointsPolydata);
+    selectEnclosedPoints->SetSurface(reader_->GetOutput());
+    selectEnclosedPoints->Update();
+
+    retval.resize(positions.size());
+    for (std::size_t i(0); i < positions.size(); ++i)
+    {
+        retval[i] = (selectEnclosedPoints->IsInside(i) ? 0.0 : inf);
+    }
+#else
+    throw NotImplemented("not implemented yet.");
+#endif
+}
+
 Real3 MeshSurface::draw_position(boost::shared_ptr<RandomNumberGenerator>& rng) const
 {
 #ifdef HAVE_VTK
@@ -42,6 +42,8 @@ public:
     }
 
     virtual Real is_inside(const Real3& pos) const;
+    virtual void batch_is_inside(
+        const std::vector<Real3>& positions, std::vector<Real>& retval) const;
     virtual Real3 draw_position(
         boost::shared_ptr<RandomNumberGenerator>& rng) const;
     virtual bool test_AABB(const Real3& l, const Real3& u) const;
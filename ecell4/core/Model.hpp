@@ -4,6 +4,7 @@
 #include "types.hpp"
 #include "Species.hpp"
 #include "ReactionRule.hpp"
+#include "ReactionRuleView.hpp"
 #include "exceptions.hpp"
 
 
@@ -45,6 +46,32 @@ public:
     virtual std::vector<ReactionRule> query_reaction_rules(
         const Species& sp1, const Species& sp2) const = 0;
 
+    /**
+     * query unimolecular reaction rules without copying them.
+     * the view is valid until the model is modified.
+     * the default implementation holds a copy of query_reaction_rules.
+     * @param species Species of a reactant
+     * @return the view of ReactionRule(s)
+     */
+    virtual ReactionRuleView query_reaction_rules_view(const Species& sp) const
+    {
+        return ReactionRuleView(query_reaction_rules(sp));
+    }
+
+    /**
+     * query bimolecular reaction rules without copying them.
+     * the view is valid until the model is modified.
+     * the default implementation holds a copy of query_reaction_rules.
+     * @param species1 Species of the first reactant
+     * @param species2 Species of the second reactant
+     * @return the view of ReactionRule(s)
+     */
+    virtual ReactionRuleView query_reaction_rules_view(
+        const Species& sp1, const Species& sp2) const
+    {
+        return ReactionRuleView(query_reaction_rules(sp1, sp2));
+    }
+
     virtual Integer apply(const Species& pttrn, const Species& sp) const = 0;
     virtual std::vector<ReactionRule> apply(
         const ReactionRule& rr,
@@ -21,7 +21,7 @@ public:
     MoleculePool(
         const Species& species, boost::weak_ptr<VoxelPool> location,
         const Real& radius=0.0, const Real& D=0.0)
-        : base_type(species, location, radius, D)
+        : base_type(species, location, radius, D), sweep_size_(0)
     {
         ;
     }
@@ -83,10 +83,49 @@ public:
     void remove_voxel(const container_type::iterator& position)
     {
         // voxels_.erase(position);
-        (*position) = voxels_.back();
+        if (static_cast<std::size_t>(position - voxels_.begin()) < sweep_size_)
+        {
+            // keep the voxels not swept yet at the front
+            --sweep_size_;
+            (*position) = voxels_[sweep_size_];
+            voxels_[sweep_size_] = voxels_.back();
+        }
+        else
+        {
+            (*position) = voxels_.back();
+        }
         voxels_.pop_back();
     }
 
+    /**
+     * Sweep the voxels once in place from the back.
+     * The voxels not swept yet are kept in [0, sweep_size()) even when
+     * any voxel is removed during the sweep, and a voxel added during
+     * the sweep is never swept.
+     */
+    void begin_sweep()
+    {
+        sweep_size_ = voxels_.size();
+    }
+
+    std::size_t sweep_size() const
+    {
+        return sweep_size_;
+    }
+
+    /**
+     * return the index of the next voxel to be swept.
+     */
+    std::size_t next_in_sweep()
+    {
+        return --sweep_size_;
+    }
+
+    void end_sweep()
+    {
+        sweep_size_ = 0;
+    }
+
     coordinate_id_pair_type pop(const coordinate_type& coord)
     {
         container_type::iterator position(this->find(coord));
@@ -240,6 +279,7 @@ protected:
 protected:
 
     container_type voxels_;
+    std::size_t sweep_size_;
 };
 
 } // ecell4
@@ -1,14 +1,51 @@
 #include <algorithm>
+#include <chrono>
+#include <thread>
 
 #include "exceptions.hpp"
+#include "parallel.hpp"
 #include "NetfreeModel.hpp"
 
 
 namespace ecell4
 {
 
+void NetfreeModel::clear_cache() const
+{
+    std::lock_guard<std::mutex> lock(cache_.mutex);
+    cache_.clear();
+}
+
+Integer NetfreeModel::num_cache_hits() const
+{
+    std::lock_guard<std::mutex> lock(cache_.mutex);
+    return cache_.hits;
+}
+
+Integer NetfreeModel::num_cache_misses() const
+{
+    std::lock_guard<std::mutex> lock(cache_.mutex);
+    return cache_.misses;
+}
+
+bool NetfreeModel::reserve_cache_entry() const
+{
+    if (max_cache_size_ == 0)
+    {
+        return false;
+    }
+    else if (cache_.size >= max_cache_size_)
+    {
+        cache_.clear();
+    }
+    ++cache_.size;
+    return true;
+}
+
 bool NetfreeModel::update_species_attribute(const Species& sp)
 {
+    clear_cache();
+
     species_container_type::iterator i(std::find(species_attributes_.begin(), species_attributes_.end(), sp));
     if (i == species_attributes_.end())
     {
@@ -39,6 +76,7 @@ void NetfreeModel::add_species_attribute(const Species& sp)
         throw AlreadyExists("species already exists");
     }
     species_attributes_.push_back(sp);
+    clear_cache();
 }
 
 void NetfreeModel::remove_species_attribute(const Species& sp)
@@ -51,6 +89,7 @@ void NetfreeModel::remove_species_attribute(const Species& sp)
         throw NotFound(message.str()); // use boost::format if it's allowed
     }
     species_attributes_.erase(i, species_attributes_.end());
+    clear_cache();
 }
 
 bool NetfreeModel::has_species_attribute(const Species& sp) const
@@ -67,55 +106,176 @@ bool NetfreeModel::has_species_attribute_exact(const Species& sp) const
 
 Species NetfreeModel::apply_species_attributes(const Species& sp) const
 {
-    for (species_container_type::const_iterator
-        i(species_attributes_.begin()); i != species_attributes_.end(); ++i)
+    Integer idx(-1);
+    bool found(false);
+
+    {
+        std::lock_guard<std::mutex> lock(cache_.mutex);
+        match_cache_type::coefficient_map_type::const_iterator
+            i(cache_.attributes.find(sp));
+        if (i != cache_.attributes.end())
+        {
+            ++cache_.hits;
+            idx = (*i).second;
+            found = true;
+        }
+        else
+        {
+            ++cache_.misses;
+        }
+    }
+
+    if (!found)
     {
-        if (SpeciesExpressionMatcher(*i).match(sp))
+        for (species_container_type::size_type i(0); i < species_attributes_.size(); ++i)
         {
-            Species ret(sp);
-            ret.set_attributes(*i);
-            return ret;
+            if (SpeciesExpressionMatcher(species_attributes_[i]).match(sp))
+            {
+                idx = static_cast<Integer>(i);
+                break;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(cache_.mutex);
+        if (reserve_cache_entry())
+        {
+            cache_.attributes[sp] = idx;
         }
     }
-    return sp;
+
+    if (idx < 0)
+    {
+        return sp;
+    }
+
+    Species ret(sp);
+    ret.set_attributes(species_attributes_[idx]);
+    return ret;
 }
 
 Integer NetfreeModel::apply(const Species& pttrn, const Species& sp) const
 {
-    return SpeciesExpressionMatcher(pttrn).count(sp);
+    {
+        std::lock_guard<std::mutex> lock(cache_.mutex);
+        match_cache_type::pattern_map_type::const_iterator
+            i(cache_.coefficients.find(pttrn));
+        if (i != cache_.coefficients.end())
+        {
+            match_cache_type::coefficient_map_type::const_iterator
+                j((*i).second.find(sp));
+            if (j != (*i).second.end())
+            {
+                ++cache_.hits;
+                return (*j).second;
+            }
+        }
+        ++cache_.misses;
+    }
+
+    const Integer retval(SpeciesExpressionMatcher(pttrn).count(sp));
+
+    {
+        std::lock_guard<std::mutex> lock(cache_.mutex);
+        if (reserve_cache_entry())
+        {
+            cache_.coefficients[pttrn][sp] = retval;
+        }
+    }
+    return retval;
+}
+
+void NetfreeModel::match_reaction_rule(
+    matched_rule_container_type& matched,
+    const reaction_rule_container_type::size_type idx,
+    const ReactionRule::reactant_container_type& reactants,
+    const bool swapped) const
+{
+    const std::vector<ReactionRule> generated = reaction_rules_[idx].generate(reactants);
+    matched.reserve(matched.size() + generated.size());
+    for (std::vector<ReactionRule>::const_iterator i(generated.begin());
+        i != generated.end(); ++i)
+    {
+        matched_rule_type m;
+        m.rule = idx;
+        m.swapped = swapped;
+        m.products.reserve((*i).products().size());
+        for (ReactionRule::product_container_type::const_iterator
+            j((*i).products().begin()); j != (*i).products().end(); ++j)
+        {
+            m.products.push_back(format_species(*j));
+        }
+        matched.push_back(m);
+    }
 }
 
-std::vector<ReactionRule> NetfreeModel::query_reaction_rules(
-    const Species& sp) const
+std::vector<ReactionRule> NetfreeModel::build_reaction_rules(
+    const matched_rule_container_type& matched,
+    const ReactionRule::reactant_container_type& reactants) const
 {
-    ReactionRule::reactant_container_type reactants(1, sp);
+    ReactionRule::reactant_container_type formatted;
+    formatted.reserve(reactants.size());
+    for (ReactionRule::reactant_container_type::const_iterator i(reactants.begin());
+        i != reactants.end(); ++i)
+    {
+        formatted.push_back(format_species(*i));
+    }
+    ReactionRule::reactant_container_type swapped(formatted.rbegin(), formatted.rend());
+
     std::vector<ReactionRule> retval;
-    for (reaction_rule_container_type::const_iterator i(reaction_rules_.begin());
-        i != reaction_rules_.end(); ++i)
-    {
-        const std::vector<ReactionRule> generated = (*i).generate(reactants);
-        // retval.insert(retval.end(), generated.begin(), generated.end());
-        retval.reserve(retval.size() + generated.size());
-        for (std::vector<ReactionRule>::const_iterator j(generated.begin());
-            j != generated.end(); ++j)
+    retval.reserve(matched.size());
+    for (matched_rule_container_type::const_iterator i(matched.begin());
+        i != matched.end(); ++i)
+    {
+        const ReactionRule rr(
+            ((*i).swapped ? swapped : formatted), (*i).products,
+            reaction_rules_[(*i).rule].k());
+        std::vector<ReactionRule>::iterator
+            it = std::find(retval.begin(), retval.end(), rr);
+        if (it == retval.end())
         {
-            // const ReactionRule rr = create_reaction_rule_formatted(*j);
-            const ReactionRule rr = format_reaction_rule_with_nosort(*j);
-            std::vector<ReactionRule>::iterator
-                it = std::find(retval.begin(), retval.end(), rr);
-            if (it == retval.end())
-            {
-                retval.push_back(rr);
-            }
-            else
-            {
-                (*it).set_k((*it).k() + rr.k());
-            }
+            retval.push_back(rr);
+        }
+        else
+        {
+            (*it).set_k((*it).k() + rr.k());
         }
     }
     return retval;
 }
 
+std::vector<ReactionRule> NetfreeModel::query_reaction_rules(
+    const Species& sp) const
+{
+    const ReactionRule::reactant_container_type reactants(1, sp);
+
+    {
+        std::lock_guard<std::mutex> lock(cache_.mutex);
+        match_cache_type::first_order_map_type::const_iterator
+            i(cache_.first_order.find(sp.serial()));
+        if (i != cache_.first_order.end())
+        {
+            ++cache_.hits;
+            return build_reaction_rules((*i).second, reactants);
+        }
+        ++cache_.misses;
+    }
+
+    matched_rule_container_type matched;
+    for (reaction_rule_container_type::size_type i(0); i < reaction_rules_.size(); ++i)
+    {
+        match_reaction_rule(matched, i, reactants, false);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(cache_.mutex);
+        if (reserve_cache_entry())
+        {
+            cache_.first_order[sp.serial()] = matched;
+        }
+    }
+    return build_reaction_rules(matched, reactants);
+}
+
 struct reaction_rule_product_unary_predicator
 {
     typedef ReactionRule element_type;
@@ -162,31 +322,65 @@ std::vector<ReactionRule> generate_reaction_rules(
 std::vector<ReactionRule> NetfreeModel::query_reaction_rules(
     const Species& sp1, const Species& sp2) const
 {
-    std::vector<ReactionRule> retval;
-    for (reaction_rule_container_type::const_iterator i(reaction_rules_.begin());
-        i != reaction_rules_.end(); ++i)
-    {
-        const std::vector<ReactionRule> generated = generate_reaction_rules(*i, sp1, sp2);
-        // retval.insert(retval.end(), generated.begin(), generated.end());
-        retval.reserve(retval.size() + generated.size());
-        for (std::vector<ReactionRule>::const_iterator j(generated.begin());
-            j != generated.end(); ++j)
+    ReactionRule::reactant_container_type reactants(2);
+    reactants[0] = sp1;
+    reactants[1] = sp2;
+
+    matched_rule_container_type matched;
+    bool found(false);
+
+    {
+        std::lock_guard<std::mutex> lock(cache_.mutex);
+        match_cache_type::second_order_map_type::const_iterator
+            i(cache_.second_order.find(sp1.serial()));
+        if (i != cache_.second_order.end())
         {
-            // const ReactionRule rr = create_reaction_rule_formatted(*j);
-            const ReactionRule rr = format_reaction_rule_with_nosort(*j);
-            std::vector<ReactionRule>::iterator
-                it = std::find(retval.begin(), retval.end(), rr);
-            if (it == retval.end())
+            match_cache_type::first_order_map_type::const_iterator
+                j((*i).second.find(sp2.serial()));
+            if (j != (*i).second.end())
             {
-                retval.push_back(rr);
+                matched = (*j).second;
+                found = true;
             }
-            else
+        }
+        if (found)
+        {
+            ++cache_.hits;
+        }
+        else
+        {
+            ++cache_.misses;
+        }
+    }
+
+    if (!found)
+    {
+        const ReactionRule::reactant_container_type swapped(
+            reactants.rbegin(), reactants.rend());
+        for (reaction_rule_container_type::size_type i(0); i < reaction_rules_.size(); ++i)
+        {
+            const ReactionRule& org(reaction_rules_[i]);
+            if (org.reactants().size() != 2)
+            {
+                continue;
+            }
+
+            match_reaction_rule(matched, i, reactants, false);
+            if (org.reactants()[0] != org.reactants()[1])
             {
-                (*it).set_k((*it).k() + rr.k());
+                match_reaction_rule(matched, i, swapped, true);
             }
         }
+
+        std::lock_guard<std::mutex> lock(cache_.mutex);
+        if (reserve_cache_entry())
+        {
+            cache_.second_order[sp1.serial()][sp2.serial()] = matched;
+        }
     }
 
+    std::vector<ReactionRule> retval(build_reaction_rules(matched, reactants));
+
     if (effective_)
     {
         for (std::vector<ReactionRule>::iterator i(retval.begin()); i != retval.end(); ++i)
@@ -210,6 +404,7 @@ std::vector<ReactionRule> NetfreeModel::apply(
 void NetfreeModel::add_reaction_rule(const ReactionRule& rr)
 {
     reaction_rules_.push_back(rr);
+    clear_cache();
 }
 
 void NetfreeModel::remove_reaction_rule(const ReactionRule& rr)
@@ -220,6 +415,7 @@ void NetfreeModel::remove_reaction_rule(const ReactionRule& rr)
         throw NotFound("The given reaction rule was not found.");
     }
     reaction_rules_.erase(i, reaction_rules_.end());
+    clear_cache();
 }
 
 bool NetfreeModel::has_reaction_rule(const ReactionRule& rr) const
@@ -245,6 +441,14 @@ boost::shared_ptr<Model> NetfreeModel::expand(
         *this, sp, max_itr).first;
 }
 
+boost::shared_ptr<Model> NetfreeModel::expand(
+    const std::vector<Species>& sp, const Integer max_itr,
+    const std::map<Species, Integer>& max_stoich, const Integer num_threads) const
+{
+    return extras::generate_network_from_netfree_model(
+        *this, sp, max_itr, max_stoich, num_threads).first;
+}
+
 boost::shared_ptr<Model> NetfreeModel::expand(
     const std::vector<Species>& sp) const
 {
@@ -292,10 +496,21 @@ bool check_stoichiometry(const ReactionRule& rr,
     return true;
 }
 
+/**
+ * the reactions generated from a pair of a rule and its reactants, and the
+ * canonical forms of their products in order.
+ */
+struct generated_reactions_type
+{
+    std::vector<ReactionRule> reactions;
+    std::vector<Species> products;
+};
+
+typedef utils::get_mapper_mf<Species, Integer>::type species_index_type;
+
 void __add_reaction_rules(
     const std::vector<ReactionRule>& reaction_rules,
-    std::vector<ReactionRule>& reactions, std::vector<Species>& newseeds,
-    const std::vector<Species>& seeds,
+    generated_reactions_type& generated,
     const std::map<Species, Integer>& max_stoich)
 {
     for (std::vector<ReactionRule>::const_iterator i(reaction_rules.begin());
@@ -307,31 +522,39 @@ void __add_reaction_rules(
             continue;
         }
 
-        reactions.push_back(rr);
+        generated.reactions.push_back(rr);
 
         for (ReactionRule::product_container_type::const_iterator
             j(rr.products().begin()); j != rr.products().end(); ++j)
         {
-            const Species sp(format_species(*j));
-            if (std::find(newseeds.begin(), newseeds.end(), sp)
-                == newseeds.end()
-                && std::find(seeds.begin(), seeds.end(), sp)
-                == seeds.end())
-            {
-                newseeds.push_back(sp);
-            }
+            generated.products.push_back(format_species(*j));
         }
     }
 }
 
+bool __add_species(
+    const Species& sp, const Integer iteration,
+    species_index_type& known, std::vector<Species>& newseeds)
+{
+    if (!known.insert(std::make_pair(sp, iteration)).second)
+    {
+        return false;
+    }
+    newseeds.push_back(sp);
+    return true;
+}
+
 void __generate_recurse(
     const NetfreeModel& nfm, std::vector<ReactionRule>& reactions,
     std::vector<Species>& seeds1, std::vector<Species>& seeds2,
-    const std::map<Species, Integer>& max_stoich)
+    species_index_type& known, const std::map<Species, Integer>& max_stoich,
+    const Integer num_threads, NetworkGenerationStats& stats)
 {
-    std::vector<Species> newseeds;
     seeds2.insert(seeds2.begin(), seeds1.begin(), seeds1.end());
 
+    // a task applies a rule to a seed, paired with each of the species
+    // after it in seeds2 for a second order rule.
+    std::vector<std::pair<const ReactionRule*, std::size_t> > tasks;
     for (NetfreeModel::reaction_rule_container_type::const_iterator
         i(nfm.reaction_rules().begin()); i != nfm.reaction_rules().end(); ++i)
     {
@@ -342,30 +565,17 @@ void __generate_recurse(
         case 0:
             continue;
         case 1:
-            for (std::vector<Species>::const_iterator j(seeds1.begin());
-                j != seeds1.end(); ++j)
+            for (std::size_t j(0); j < seeds1.size(); ++j)
             {
-                ReactionRule::reactant_container_type reactants(1);
-                reactants[0] = *j;
-                __add_reaction_rules(
-                    rr.generate(reactants), reactions, newseeds, seeds2, max_stoich);
+                tasks.push_back(std::make_pair(&rr, j));
             }
+            stats.num_applications += seeds1.size();
             break;
         case 2:
-            for (std::vector<Species>::const_iterator j(seeds1.begin());
-                j != seeds1.end(); ++j)
+            for (std::size_t j(0); j < seeds1.size(); ++j)
             {
-                const std::vector<Species>::const_iterator start(
-                    seeds2.begin()
-                    + std::distance<std::vector<Species>::const_iterator>(
-                        seeds1.begin(), j));
-                for (std::vector<Species>::const_iterator
-                    k(start); k != seeds2.end(); ++k)
-                {
-                    __add_reaction_rules(
-                        generate_reaction_rules(rr, *j, *k),
-                        reactions, newseeds, seeds2, max_stoich);
-                }
+                tasks.push_back(std::make_pair(&rr, j));
+                stats.num_applications += seeds2.size() - j;
             }
             break;
         default:
@@ -374,26 +584,71 @@ void __generate_recurse(
         }
     }
 
+    std::vector<generated_reactions_type> results(tasks.size());
+    std::vector<std::size_t> items(tasks.size());
+    for (std::size_t i(0); i < items.size(); ++i)
+    {
+        items[i] = i;
+    }
+
+    parallel_for_each(num_threads, items,
+        [&](const std::size_t i)
+        {
+            const ReactionRule& rr(*tasks[i].first);
+            const std::size_t j(tasks[i].second);
+            if (rr.reactants().size() == 1)
+            {
+                ReactionRule::reactant_container_type reactants(1);
+                reactants[0] = seeds1[j];
+                __add_reaction_rules(rr.generate(reactants), results[i], max_stoich);
+            }
+            else
+            {
+                for (std::size_t k(j); k < seeds2.size(); ++k)
+                {
+                    __add_reaction_rules(
+                        generate_reaction_rules(rr, seeds1[j], seeds2[k]),
+                        results[i], max_stoich);
+                }
+            }
+        });
+
+    // merge the results in the serial order.
+    std::vector<Species> newseeds;
+    for (std::vector<generated_reactions_type>::const_iterator i(results.begin());
+        i != results.end(); ++i)
+    {
+        reactions.insert(reactions.end(), (*i).reactions.begin(), (*i).reactions.end());
+        stats.num_reactions += (*i).reactions.size();
+        for (std::vector<Species>::const_iterator j((*i).products.begin());
+            j != (*i).products.end(); ++j)
+        {
+            __add_species(*j, stats.iteration, known, newseeds);
+        }
+    }
+
     seeds1.swap(newseeds);
 }
 
 std::pair<boost::shared_ptr<NetworkModel>, bool> generate_network_from_netfree_model(
     const NetfreeModel& nfm, const std::vector<Species>& seeds, const Integer max_itr,
-    const std::map<Species, Integer>& max_stoich)
+    const std::map<Species, Integer>& max_stoich, Integer num_threads,
+    const network_generation_callback& progress)
 {
+    if (num_threads <= 0)
+    {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
     std::vector<ReactionRule> reactions;
     std::vector<Species> seeds1;
     std::vector<Species> seeds2;
+    species_index_type known;
 
     for (std::vector<Species>::const_iterator i(seeds.begin());
         i != seeds.end(); ++i)
     {
-        const Species sp(format_species(*i));
-        if (std::find(seeds1.begin(), seeds1.end(), sp)
-            == seeds1.end())
-        {
-            seeds1.push_back(sp);
-        }
+        __add_species(format_species(*i), 0, known, seeds1);
     }
 
     for (NetfreeModel::reaction_rule_container_type::const_iterator
@@ -406,12 +661,7 @@ std::pair<boost::shared_ptr<NetworkModel>, bool> generate_network_from_netfree_m
             for (ReactionRule::product_container_type::const_iterator
                 j(rr.products().begin()); j != rr.products().end(); ++j)
             {
-                const Species sp(format_species(*j));
-                if (std::find(seeds1.begin(), seeds1.end(), sp)
-                    == seeds1.end())
-                {
-                    seeds1.push_back(sp);
-                }
+                __add_species(format_species(*j), 0, known, seeds1);
             }
         }
     }
@@ -419,8 +669,24 @@ std::pair<boost::shared_ptr<NetworkModel>, bool> generate_network_from_netfree_m
     Integer cnt(0);
     while (seeds1.size() > 0 && cnt < max_itr)
     {
-        __generate_recurse(nfm, reactions, seeds1, seeds2, max_stoich);
+        const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+
+        NetworkGenerationStats stats = {};
+        stats.iteration = cnt + 1;
+        stats.num_seeds = seeds1.size();
+        __generate_recurse(
+            nfm, reactions, seeds1, seeds2, known, max_stoich, num_threads, stats);
         cnt += 1;
+
+        stats.num_new_species = seeds1.size();
+        stats.total_species = seeds2.size() + seeds1.size();
+        stats.total_reactions = reactions.size();
+        stats.elapsed = std::chrono::duration<Real>(
+            std::chrono::steady_clock::now() - start).count();
+        if (progress)
+        {
+            progress(stats);
+        }
     }
 
     bool is_completed;
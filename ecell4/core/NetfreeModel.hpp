@@ -6,10 +6,13 @@
 #include <map>
 #include <set>
 #include <algorithm>
+#include <functional>
 #include <iterator>
+#include <mutex>
 #include <boost/shared_ptr.hpp>
 
 #include "types.hpp"
+#include "get_mapper_mf.hpp"
 #include "Species.hpp"
 #include "ReactionRule.hpp"
 #include "Model.hpp"
@@ -33,7 +36,8 @@ public:
 public:
 
     NetfreeModel()
-        : base_type(), species_attributes_(), reaction_rules_(), effective_(false)
+        : base_type(), species_attributes_(), reaction_rules_(), effective_(false),
+        max_cache_size_(default_max_cache_size()), cache_()
     {
         ;
     }
@@ -96,9 +100,18 @@ public:
         const std::vector<Species>& sp, const Integer max_itr) const;
     boost::shared_ptr<Model> expand(const std::vector<Species>& sp) const;
 
+    /**
+     * expand the model with the given number of threads. Use all cores if 0.
+     * The result does not depend on the number of threads.
+     */
+    boost::shared_ptr<Model> expand(
+        const std::vector<Species>& sp, const Integer max_itr,
+        const std::map<Species, Integer>& max_stoich, const Integer num_threads) const;
+
     void set_effective(const bool effective)
     {
         effective_ = effective;
+        clear_cache();
     }
 
     const bool effective() const
@@ -106,20 +119,161 @@ public:
         return effective_;
     }
 
+    /**
+     * The results of pattern matching in apply, apply_species_attributes and
+     * query_reaction_rules are memoized until the model is modified.
+     * When the number of memoized entries reaches max_cache_size,
+     * the cache is cleared. Zero disables the cache.
+     * An entry is keyed by the serials of reactants, as matching only reads
+     * serials. query_reaction_rules only memoizes the indices of matched
+     * rules and their products, and rebuilds the reactants from the given
+     * species. Thus, the results never depend on the cache.
+     */
+    static inline const std::size_t default_max_cache_size()
+    {
+        return 100000;
+    }
+
+    void set_max_cache_size(const std::size_t size)
+    {
+        max_cache_size_ = size;
+        clear_cache();
+    }
+
+    const std::size_t max_cache_size() const
+    {
+        return max_cache_size_;
+    }
+
+    void clear_cache() const;
+    Integer num_cache_hits() const;
+    Integer num_cache_misses() const;
+
+protected:
+
+    /**
+     * a reaction generated from the rule at the given index in reaction_rules_.
+     * swapped is true if the reactants were matched in the reverse order.
+     */
+    struct matched_rule_type
+    {
+        reaction_rule_container_type::size_type rule;
+        bool swapped;
+        ReactionRule::product_container_type products;
+    };
+
+    typedef std::vector<matched_rule_type> matched_rule_container_type;
+
+    struct match_cache_type
+    {
+        typedef utils::get_mapper_mf<Species, Integer>::type
+            coefficient_map_type;
+        typedef utils::get_mapper_mf<Species, coefficient_map_type>::type
+            pattern_map_type;
+        typedef utils::get_mapper_mf<
+            Species::serial_type, matched_rule_container_type>::type
+                first_order_map_type;
+        typedef utils::get_mapper_mf<
+            Species::serial_type, first_order_map_type>::type
+                second_order_map_type;
+
+        match_cache_type()
+            : size(0), hits(0), misses(0)
+        {
+            ;
+        }
+
+        match_cache_type(const match_cache_type& another)
+            : size(0), hits(0), misses(0)
+        {
+            ; // a cache is never shared
+        }
+
+        match_cache_type& operator=(const match_cache_type& another)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            clear();
+            return *this;
+        }
+
+        void clear()
+        {
+            coefficients.clear();
+            attributes.clear();
+            first_order.clear();
+            second_order.clear();
+            size = 0;
+        }
+
+        pattern_map_type coefficients;
+        coefficient_map_type attributes;  // the index in species_attributes_ or -1
+        first_order_map_type first_order;
+        second_order_map_type second_order;
+
+        std::size_t size;
+        Integer hits, misses;
+        std::mutex mutex;
+    };
+
+    /**
+     * make room for a new entry. The lock of cache_ must be held.
+     */
+    bool reserve_cache_entry() const;
+
+    void match_reaction_rule(
+        matched_rule_container_type& matched,
+        const reaction_rule_container_type::size_type idx,
+        const ReactionRule::reactant_container_type& reactants,
+        const bool swapped) const;
+
+    /**
+     * build reaction rules from the matched ones with the given reactants.
+     */
+    std::vector<ReactionRule> build_reaction_rules(
+        const matched_rule_container_type& matched,
+        const ReactionRule::reactant_container_type& reactants) const;
+
 protected:
 
     species_container_type species_attributes_;
     reaction_rule_container_type reaction_rules_;
 
     bool effective_;
+
+    std::size_t max_cache_size_;
+    mutable match_cache_type cache_;
 };
 
 namespace extras
 {
 
+/**
+ * statistics of an iteration of generate_network_from_netfree_model.
+ */
+struct NetworkGenerationStats
+{
+    Integer iteration;
+    Integer num_seeds;  // species found in the last iteration
+    Integer num_applications;  // pairs of a rule and its reactants tried
+    Integer num_reactions;  // reactions generated in this iteration
+    Integer num_new_species;
+    Integer total_species;
+    Integer total_reactions;  // before merging the same reactions
+    Real elapsed;  // wall-clock seconds for this iteration
+};
+
+typedef std::function<void (const NetworkGenerationStats&)> network_generation_callback;
+
+/**
+ * Species are indexed by a hash of their canonical form by format_species.
+ * The rules are applied to the species of each iteration on num_threads
+ * threads (all cores if 0), and their results are merged in the serial
+ * order. progress, if any, is called at the end of each iteration.
+ */
 std::pair<boost::shared_ptr<NetworkModel>, bool> generate_network_from_netfree_model(
     const NetfreeModel& nfm, const std::vector<Species>& seeds, const Integer max_itr,
-    const std::map<Species, Integer>& max_stoich);
+    const std::map<Species, Integer>& max_stoich, Integer num_threads = 1,
+    const network_generation_callback& progress = network_generation_callback());
 
 inline std::pair<boost::shared_ptr<NetworkModel>, bool> generate_network_from_netfree_model(
     const NetfreeModel& nfm, const std::vector<Species>& seeds, const Integer max_itr)
@@ -80,46 +80,58 @@ Integer NetworkModel::apply(const Species& pttrn, const Species& sp) const
     return (pttrn == sp ? 1 : 0);
 }
 
-std::vector<ReactionRule> NetworkModel::query_reaction_rules(
+ReactionRuleView NetworkModel::make_view(
+    const first_order_reaction_rules_map_type::mapped_type& indices) const
+{
+    if (indices.empty())
+    {
+        return ReactionRuleView();
+    }
+    return ReactionRuleView(
+        &reaction_rules_[0], &indices[0], &indices[0] + indices.size());
+}
+
+ReactionRuleView NetworkModel::query_reaction_rules_view(
     const Species& sp) const
 {
     first_order_reaction_rules_map_type::const_iterator
-        i(first_order_reaction_rules_map_.find(sp.serial()));
-
-    std::vector<ReactionRule> retval;
-    if (i != first_order_reaction_rules_map_.end())
+        i(first_order_reaction_rules_map_.find(sp));
+    if (i == first_order_reaction_rules_map_.end())
     {
-        retval.reserve((*i).second.size());
-        for (first_order_reaction_rules_map_type::mapped_type::const_iterator
-                 j((*i).second.begin()); j != (*i).second.end(); ++j)
-        {
-            retval.push_back(reaction_rules_[*j]);
-        }
+        return ReactionRuleView();
     }
-    return retval;
+    return make_view((*i).second);
 }
 
-std::vector<ReactionRule> NetworkModel::query_reaction_rules(
+ReactionRuleView NetworkModel::query_reaction_rules_view(
     const Species& sp1, const Species& sp2) const
 {
-    std::vector<ReactionRule> retval;
-    const std::pair<Species::serial_type, Species::serial_type>
-        key(sp1.serial() < sp2.serial()?
-            std::make_pair(sp1.serial(), sp2.serial()):
-            std::make_pair(sp2.serial(), sp1.serial()));
-
     second_order_reaction_rules_map_type::const_iterator
-        i(second_order_reaction_rules_map_.find(key));
-    if (i != second_order_reaction_rules_map_.end())
+        i(second_order_reaction_rules_map_.find(sp1));
+    if (i == second_order_reaction_rules_map_.end())
     {
-        retval.reserve((*i).second.size());
-        for (second_order_reaction_rules_map_type::mapped_type::const_iterator
-                 j((*i).second.begin()); j != (*i).second.end(); ++j)
-        {
-            retval.push_back(reaction_rules_[*j]);
-        }
+        return ReactionRuleView();
     }
-    return retval;
+
+    first_order_reaction_rules_map_type::const_iterator
+        j((*i).second.find(sp2));
+    if (j == (*i).second.end())
+    {
+        return ReactionRuleView();
+    }
+    return make_view((*j).second);
+}
+
+std::vector<ReactionRule> NetworkModel::query_reaction_rules(
+    const Species& sp) const
+{
+    return query_reaction_rules_view(sp).as_vector();
+}
+
+std::vector<ReactionRule> NetworkModel::query_reaction_rules(
+    const Species& sp1, const Species& sp2) const
+{
+    return query_reaction_rules_view(sp1, sp2).as_vector();
 }
 
 std::vector<ReactionRule> NetworkModel::apply(
@@ -162,27 +174,66 @@ void NetworkModel::add_reaction_rule(const ReactionRule& rr)
 
     const reaction_rule_container_type::size_type idx(reaction_rules_.size());
     reaction_rules_.push_back(rr);
+    add_index(rr, idx);
+}
 
-    if (rr.reactants().size() == 1)
+void NetworkModel::add_index(
+    const ReactionRule& rr, const reaction_rule_container_type::size_type idx)
+{
+    if (rr.has_descriptor())
+    {
+        ; // do nothing
+    }
+    else if (rr.reactants().size() == 1)
     {
-        const Species::serial_type key = rr.reactants()[0].serial();
-        first_order_reaction_rules_map_[key].push_back(idx);
+        const Species sp(rr.reactants()[0].serial());
+        first_order_reaction_rules_map_[sp].push_back(idx);
     }
     else if (rr.reactants().size() == 2)
     {
-        const Species::serial_type
-            serial1(rr.reactants()[0].serial()),
-            serial2(rr.reactants()[1].serial());
-        const std::pair<Species::serial_type, Species::serial_type>
-            key(serial1 < serial2?
-                std::make_pair(serial1, serial2):
-                std::make_pair(serial2, serial1));
-        second_order_reaction_rules_map_[key].push_back(idx);
+        const Species sp1(rr.reactants()[0].serial()), sp2(rr.reactants()[1].serial());
+        second_order_reaction_rules_map_[sp1][sp2].push_back(idx);
+        if (sp1 != sp2)
+        {
+            second_order_reaction_rules_map_[sp2][sp1].push_back(idx);
+        }
     }
-    else
+}
+
+inline void remove_index_from(
+    std::vector<NetworkModel::reaction_rule_container_type::size_type>& indices,
+    const NetworkModel::reaction_rule_container_type::size_type idx)
+{
+    std::vector<NetworkModel::reaction_rule_container_type::size_type>::iterator
+        k(std::remove(indices.begin(), indices.end(), idx));
+    assert(k != indices.end());
+    indices.erase(k, indices.end());
+}
+
+void NetworkModel::remove_index(
+    const ReactionRule& rr, const reaction_rule_container_type::size_type idx)
+{
+    if (rr.has_descriptor())
     {
         ; // do nothing
     }
+    else if (rr.reactants().size() == 1)
+    {
+        first_order_reaction_rules_map_type::iterator
+            j(first_order_reaction_rules_map_.find(rr.reactants()[0]));
+        assert(j != first_order_reaction_rules_map_.end());
+        remove_index_from((*j).second, idx);
+    }
+    else if (rr.reactants().size() == 2)
+    {
+        const Species& sp1(rr.reactants()[0]);
+        const Species& sp2(rr.reactants()[1]);
+        remove_index_from(second_order_reaction_rules_map_[sp1][sp2], idx);
+        if (sp1 != sp2)
+        {
+            remove_index_from(second_order_reaction_rules_map_[sp2][sp1], idx);
+        }
+    }
 }
 
 void NetworkModel::remove_reaction_rule(const ReactionRule& rr)
@@ -213,79 +264,15 @@ void NetworkModel::remove_reaction_rule(const NetworkModel::reaction_rule_contai
     assert(idx < reaction_rules_.size());
     const reaction_rule_container_type::size_type last_idx(reaction_rules_.size() - 1);
 
-    {
-        const ReactionRule& rr = reaction_rules_[idx];
-
-        if (rr.has_descriptor())
-        {
-            ; // do nothing
-        }
-        else if (rr.reactants().size() == 1)
-        {
-            first_order_reaction_rules_map_type::iterator
-                j(first_order_reaction_rules_map_.find(rr.reactants()[0].serial()));
-            assert(j != first_order_reaction_rules_map_.end());
-
-            first_order_reaction_rules_map_type::mapped_type::iterator
-                k(std::remove((*j).second.begin(), (*j).second.end(), idx));
-            assert(k != (*j).second.end());
-
-            (*j).second.erase(k, (*j).second.end());
-        }
-        else if (rr.reactants().size() == 2)
-        {
-            second_order_reaction_rules_map_type::iterator
-                j(second_order_reaction_rules_map_.find(std::make_pair(
-                    rr.reactants()[0].serial(), rr.reactants()[1].serial())));
-            assert(j != second_order_reaction_rules_map_.end());
-
-            second_order_reaction_rules_map_type::mapped_type::iterator
-                k(std::remove((*j).second.begin(), (*j).second.end(), idx));
-            assert(k != (*j).second.end());
-
-            (*j).second.erase(k, (*j).second.end());
-        }
-    }
+    remove_index(reaction_rules_[idx], idx);
 
     if (idx < last_idx)
     {
         reaction_rule_container_type::value_type const
             rrlast(reaction_rules_[last_idx]);
         (*i) = rrlast;
-
-        if (rrlast.has_descriptor())
-        {
-            ; // do nothing
-        }
-        else if (rrlast.reactants().size() == 1)
-        {
-            first_order_reaction_rules_map_type::iterator
-                j(first_order_reaction_rules_map_.find(
-                    rrlast.reactants()[0].serial()));
-            assert(j != first_order_reaction_rules_map_.end());
-
-            first_order_reaction_rules_map_type::mapped_type::iterator
-                k(std::remove((*j).second.begin(), (*j).second.end(), last_idx));
-            assert(k != (*j).second.end());
-
-            (*j).second.erase(k, (*j).second.end());
-            (*j).second.push_back(idx);
-        }
-        else if (rrlast.reactants().size() == 2)
-        {
-            second_order_reaction_rules_map_type::iterator
-                j(second_order_reaction_rules_map_.find(std::make_pair(
-                    rrlast.reactants()[0].serial(),
-                    rrlast.reactants()[1].serial())));
-            assert(j != second_order_reaction_rules_map_.end());
-
-            second_order_reaction_rules_map_type::mapped_type::iterator
-                k(std::remove((*j).second.begin(), (*j).second.end(), last_idx));
-            assert(k != (*j).second.end());
-
-            (*j).second.erase(k, (*j).second.end());
-            (*j).second.push_back(idx);
-        }
+        remove_index(rrlast, last_idx);
+        add_index(rrlast, idx);
     }
 
     reaction_rules_.pop_back();
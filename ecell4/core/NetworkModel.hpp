@@ -1,8 +1,6 @@
 #ifndef ECELL4_NETWORK_MODEL_HPP
 #define ECELL4_NETWORK_MODEL_HPP
 
-// #include "get_mapper_mf.hpp"
-
 #include <map>
 #include <set>
 #include <algorithm>
@@ -10,6 +8,7 @@
 #include <boost/shared_ptr.hpp>
 
 #include "types.hpp"
+#include "get_mapper_mf.hpp"
 #include "Species.hpp"
 #include "ReactionRule.hpp"
 #include "Model.hpp"
@@ -31,11 +30,16 @@ public:
 
 protected:
 
-    typedef std::map<Species::serial_type,
-                     std::vector<reaction_rule_container_type::size_type> >
+    /**
+     * indices of reaction rules keyed by reactants. Species are hashed
+     * with their cached hash. A pair of different reactants is registered
+     * in both orders, so a query needs no ordering of the pair.
+     */
+    typedef utils::get_mapper_mf<
+        Species, std::vector<reaction_rule_container_type::size_type> >::type
         first_order_reaction_rules_map_type;
-    typedef std::map<std::pair<Species::serial_type, Species::serial_type>,
-                     std::vector<reaction_rule_container_type::size_type> >
+    typedef utils::get_mapper_mf<
+        Species, first_order_reaction_rules_map_type>::type
         second_order_reaction_rules_map_type;
 
 public:
@@ -58,6 +62,10 @@ public:
     std::vector<ReactionRule> query_reaction_rules(
         const Species& sp1, const Species& sp2) const;
 
+    ReactionRuleView query_reaction_rules_view(const Species& sp) const;
+    ReactionRuleView query_reaction_rules_view(
+        const Species& sp1, const Species& sp2) const;
+
     Integer apply(const Species& pttrn, const Species& sp) const;
     std::vector<ReactionRule> apply(
         const ReactionRule& rr,
@@ -115,6 +123,11 @@ protected:
 
     void remove_reaction_rule(const reaction_rule_container_type::iterator i);
 
+    ReactionRuleView make_view(
+        const first_order_reaction_rules_map_type::mapped_type& indices) const;
+    void add_index(const ReactionRule& rr, const reaction_rule_container_type::size_type idx);
+    void remove_index(const ReactionRule& rr, const reaction_rule_container_type::size_type idx);
+
 protected:
 
     species_container_type species_attributes_;
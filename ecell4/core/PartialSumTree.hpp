@@ -0,0 +1,159 @@
+#ifndef ECELL4_PARTIAL_SUM_TREE_HPP
+#define ECELL4_PARTIAL_SUM_TREE_HPP
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include "types.hpp"
+
+
+namespace ecell4
+{
+
+/**
+ * A complete binary tree holding non-negative weights at its leaves and
+ * the partial sums of its subtrees at the inner nodes.
+ * Updating a weight and drawing an index with the probability proportional
+ * to its weight are both O(log N).
+ * Each inner node is recalculated from its children, not by adding
+ * a difference, so that no rounding error accumulates during a long run.
+ */
+template <typename T = Real>
+class PartialSumTree
+{
+public:
+
+    typedef T value_type;
+    typedef std::vector<value_type> container_type;
+    typedef typename container_type::size_type size_type;
+
+public:
+
+    PartialSumTree()
+        : size_(0), capacity_(1), nodes_(2, value_type(0))
+    {
+        ;
+    }
+
+    explicit PartialSumTree(const size_type size)
+        : size_(0), capacity_(1), nodes_(2, value_type(0))
+    {
+        resize(size);
+    }
+
+    size_type size() const
+    {
+        return size_;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    /**
+     * resize the tree. All the weights are reset to zero.
+     */
+    void resize(const size_type size)
+    {
+        size_ = size;
+        capacity_ = 1;
+        while (capacity_ < size_)
+        {
+            capacity_ <<= 1;
+        }
+        nodes_.assign(2 * capacity_, value_type(0));
+    }
+
+    void clear()
+    {
+        resize(0);
+    }
+
+    /**
+     * reset all the weights at once in O(N).
+     */
+    void assign(const container_type& weights)
+    {
+        resize(weights.size());
+        std::copy(weights.begin(), weights.end(), nodes_.begin() + capacity_);
+        for (size_type i(capacity_ - 1); i > 0; --i)
+        {
+            nodes_[i] = nodes_[2 * i] + nodes_[2 * i + 1];
+        }
+    }
+
+    const value_type& get(const size_type i) const
+    {
+        return nodes_[capacity_ + i];
+    }
+
+    const value_type& operator[](const size_type i) const
+    {
+        return get(i);
+    }
+
+    void set(const size_type i, const value_type& weight)
+    {
+        if (i >= size_)
+        {
+            throw std::out_of_range("The index is out of range.");
+        }
+
+        size_type node(capacity_ + i);
+        nodes_[node] = weight;
+        while (node > 1)
+        {
+            node >>= 1;
+            nodes_[node] = nodes_[2 * node] + nodes_[2 * node + 1];
+        }
+    }
+
+    /**
+     * the sum of all the weights.
+     */
+    const value_type& total() const
+    {
+        return nodes_[1];
+    }
+
+    /**
+     * find the first index at which the cumulative sum of weights reaches
+     * the given value, i.e. the index i with
+     * sum_{j<i} w_j < value <= sum_{j<=i} w_j.
+     * A leaf with zero weight is never selected as long as total() > 0.
+     */
+    size_type find(value_type value) const
+    {
+        if (size_ == 0)
+        {
+            throw std::out_of_range("The tree is empty.");
+        }
+
+        size_type node(1);
+        while (node < capacity_)
+        {
+            const value_type& left(nodes_[2 * node]);
+            if ((value <= left && left > 0) || !(nodes_[2 * node + 1] > 0))
+            {
+                node = 2 * node;
+            }
+            else
+            {
+                value -= left;
+                node = 2 * node + 1;
+            }
+        }
+        return node - capacity_;
+    }
+
+protected:
+
+    size_type size_, capacity_;
+    container_type nodes_;
+};
+
+} // ecell4
+
+#endif /* ECELL4_PARTIAL_SUM_TREE_HPP */
@@ -0,0 +1,429 @@
+#include "ParticleSpaceSoAImpl.hpp"
+#include "Context.hpp"
+#include "comparators.hpp"
+
+
+namespace ecell4
+{
+
+void ParticleSpaceSoAImpl::reset(const Real3& edge_lengths)
+{
+    base_type::t_ = 0.0;
+
+    for (Real3::size_type dim(0); dim < 3; ++dim)
+    {
+        if (edge_lengths[dim] <= 0)
+        {
+            throw std::invalid_argument("the edge length must be positive.");
+        }
+        if (matrix_sizes_[dim] <= 0)
+        {
+            throw std::invalid_argument("the matrix size must be positive.");
+        }
+    }
+
+    edge_lengths_ = edge_lengths;
+    for (Real3::size_type dim(0); dim < 3; ++dim)
+    {
+        shape_[dim] = matrix_sizes_[dim];
+        cell_sizes_[dim] = edge_lengths_[dim] / shape_[dim];
+    }
+
+    pids_.clear();
+    xs_.clear();
+    ys_.clear();
+    zs_.clear();
+    radii_.clear();
+    Ds_.clear();
+    species_ids_.clear();
+    rmap_.clear();
+
+    cells_.clear();
+    cells_.resize(shape_[0] * shape_[1] * shape_[2]);
+    cells_of_.clear();
+    slots_.clear();
+
+    species_.clear();
+    species_counts_.clear();
+    species_map_.clear();
+
+    particles_.clear();
+    particles_dirty_ = false;
+}
+
+ParticleSpaceSoAImpl::species_id_type
+ParticleSpaceSoAImpl::register_species(const Species& sp)
+{
+    species_map_type::const_iterator i(species_map_.find(sp.serial()));
+    if (i != species_map_.end())
+    {
+        return (*i).second;
+    }
+
+    const species_id_type id(species_.size());
+    species_.push_back(sp);
+    species_counts_.push_back(0);
+    species_map_.insert(std::make_pair(sp.serial(), id));
+    return id;
+}
+
+Integer ParticleSpaceSoAImpl::num_species() const
+{
+    Integer retval(0);
+    for (std::vector<Integer>::const_iterator i(species_counts_.begin());
+         i != species_counts_.end(); ++i)
+    {
+        if (*i > 0)
+        {
+            ++retval;
+        }
+    }
+    return retval;
+}
+
+bool ParticleSpaceSoAImpl::has_species(const Species& sp) const
+{
+    return (num_particles_exact(sp) > 0);
+}
+
+std::vector<Species> ParticleSpaceSoAImpl::list_species() const
+{
+    std::vector<Species> retval;
+    for (species_id_type id(0); id < species_.size(); ++id)
+    {
+        if (species_counts_[id] > 0)
+        {
+            retval.push_back(species_[id]);
+        }
+    }
+    return retval;
+}
+
+bool ParticleSpaceSoAImpl::update_particle(
+    const ParticleID& pid, const Particle& p)
+{
+    particles_dirty_ = true;
+
+    const species_id_type id(register_species(p.species()));
+    const Real3& pos(p.position());
+
+    particle_map_type::const_iterator itr(rmap_.find(pid));
+    if (itr != rmap_.end())
+    {
+        const index_type i((*itr).second);
+        if (species_ids_[i] != id)
+        {
+            --species_counts_[species_ids_[i]];
+            ++species_counts_[id];
+            species_ids_[i] = id;
+        }
+        radii_[i] = p.radius();
+        Ds_[i] = p.D();
+        update_position(i, pos);
+        return false;
+    }
+
+    const index_type i(pids_.size());
+    pids_.push_back(pid);
+    xs_.push_back(pos[0]);
+    ys_.push_back(pos[1]);
+    zs_.push_back(pos[2]);
+    radii_.push_back(p.radius());
+    Ds_.push_back(p.D());
+    species_ids_.push_back(id);
+    ++species_counts_[id];
+    rmap_.insert(std::make_pair(pid, i));
+
+    cells_of_.push_back(0);
+    slots_.push_back(0);
+    push_into_cell(cell_id(pos), i);
+    return true;
+}
+
+void ParticleSpaceSoAImpl::update_position(const index_type i, const Real3& pos)
+{
+    particles_dirty_ = true;
+
+    xs_[i] = pos[0];
+    ys_[i] = pos[1];
+    zs_[i] = pos[2];
+
+    const std::size_t c(cell_id(pos));
+    if (c != cells_of_[i])
+    {
+        erase_from_cell(i);
+        push_into_cell(c, i);
+    }
+}
+
+std::pair<ParticleID, Particle> ParticleSpaceSoAImpl::get_particle(
+    const ParticleID& pid) const
+{
+    const index_type i(index(pid));
+    return std::make_pair(pid, particle_at(i));
+}
+
+bool ParticleSpaceSoAImpl::has_particle(const ParticleID& pid) const
+{
+    return (rmap_.find(pid) != rmap_.end());
+}
+
+void ParticleSpaceSoAImpl::remove_particle(const ParticleID& pid)
+{
+    const index_type i(index(pid)); //XXX: may raise an error.
+    particles_dirty_ = true;
+
+    erase_from_cell(i);
+    --species_counts_[species_ids_[i]];
+    rmap_.erase(pid);
+
+    const index_type last(pids_.size() - 1);
+    if (i != last)
+    {
+        // move the last particle into the hole.
+        pids_[i] = pids_[last];
+        xs_[i] = xs_[last];
+        ys_[i] = ys_[last];
+        zs_[i] = zs_[last];
+        radii_[i] = radii_[last];
+        Ds_[i] = Ds_[last];
+        species_ids_[i] = species_ids_[last];
+        cells_of_[i] = cells_of_[last];
+        slots_[i] = slots_[last];
+        cells_[cells_of_[i]][slots_[i]] = i;
+        rmap_[pids_[i]] = i;
+    }
+
+    pids_.pop_back();
+    xs_.pop_back();
+    ys_.pop_back();
+    zs_.pop_back();
+    radii_.pop_back();
+    Ds_.pop_back();
+    species_ids_.pop_back();
+    cells_of_.pop_back();
+    slots_.pop_back();
+}
+
+void ParticleSpaceSoAImpl::sort_by_cell()
+{
+    const index_type num_particles(pids_.size());
+
+    // counting sort keeping the order in each cell.
+    std::vector<index_type> order;
+    order.reserve(num_particles);
+    for (std::vector<cell_type>::const_iterator c(cells_.begin()); c != cells_.end(); ++c)
+    {
+        const std::size_t offset(order.size());
+        order.insert(order.end(), (*c).begin(), (*c).end());
+        std::sort(order.begin() + offset, order.end());
+    }
+
+    std::vector<ParticleID> pids(num_particles);
+    std::vector<Real> xs(num_particles), ys(num_particles), zs(num_particles),
+        radii(num_particles), Ds(num_particles);
+    std::vector<species_id_type> species_ids(num_particles);
+    for (index_type j(0); j < num_particles; ++j)
+    {
+        const index_type i(order[j]);
+        pids[j] = pids_[i];
+        xs[j] = xs_[i];
+        ys[j] = ys_[i];
+        zs[j] = zs_[i];
+        radii[j] = radii_[i];
+        Ds[j] = Ds_[i];
+        species_ids[j] = species_ids_[i];
+    }
+    pids_.swap(pids);
+    xs_.swap(xs);
+    ys_.swap(ys);
+    zs_.swap(zs);
+    radii_.swap(radii);
+    Ds_.swap(Ds);
+    species_ids_.swap(species_ids);
+
+    index_type j(0);
+    for (std::size_t c(0); c < cells_.size(); ++c)
+    {
+        for (std::size_t k(0); k < cells_[c].size(); ++k, ++j)
+        {
+            cells_[c][k] = j;
+            cells_of_[j] = c;
+            slots_[j] = k;
+            rmap_[pids_[j]] = j;
+        }
+    }
+
+    particles_dirty_ = true;
+}
+
+Integer ParticleSpaceSoAImpl::num_particles() const
+{
+    return pids_.size();
+}
+
+Integer ParticleSpaceSoAImpl::num_particles(const Species& sp) const
+{
+    Integer retval(0);
+    SpeciesExpressionMatcher sexp(sp);
+    for (species_id_type id(0); id < species_.size(); ++id)
+    {
+        if (species_counts_[id] > 0 && sexp.match(species_[id]))
+        {
+            retval += species_counts_[id];
+        }
+    }
+    return retval;
+}
+
+Integer ParticleSpaceSoAImpl::num_particles_exact(const Species& sp) const
+{
+    species_map_type::const_iterator i(species_map_.find(sp.serial()));
+    if (i == species_map_.end())
+    {
+        return 0;
+    }
+    return species_counts_[(*i).second];
+}
+
+Integer ParticleSpaceSoAImpl::num_molecules(const Species& sp) const
+{
+    Integer retval(0);
+    SpeciesExpressionMatcher sexp(sp);
+    for (species_id_type id(0); id < species_.size(); ++id)
+    {
+        if (species_counts_[id] > 0)
+        {
+            retval += sexp.count(species_[id]) * species_counts_[id];
+        }
+    }
+    return retval;
+}
+
+Integer ParticleSpaceSoAImpl::num_molecules_exact(const Species& sp) const
+{
+    return num_particles_exact(sp);
+}
+
+const ParticleSpaceSoAImpl::particle_container_type&
+    ParticleSpaceSoAImpl::particles() const
+{
+    if (particles_dirty_)
+    {
+        particles_.clear();
+        particles_.reserve(pids_.size());
+        for (index_type i(0); i < pids_.size(); ++i)
+        {
+            particles_.push_back(std::make_pair(pids_[i], particle_at(i)));
+        }
+        particles_dirty_ = false;
+    }
+    return particles_;
+}
+
+std::vector<std::pair<ParticleID, Particle> >
+    ParticleSpaceSoAImpl::list_particles() const
+{
+    return particles();
+}
+
+std::vector<std::pair<ParticleID, Particle> >
+    ParticleSpaceSoAImpl::list_particles(const Species& sp) const
+{
+    SpeciesExpressionMatcher sexp(sp);
+    std::vector<bool> matched(species_.size());
+    for (species_id_type id(0); id < species_.size(); ++id)
+    {
+        matched[id] = (species_counts_[id] > 0 && sexp.match(species_[id]));
+    }
+
+    std::vector<std::pair<ParticleID, Particle> > retval;
+    for (index_type i(0); i < pids_.size(); ++i)
+    {
+        if (matched[species_ids_[i]])
+        {
+            retval.push_back(std::make_pair(pids_[i], particle_at(i)));
+        }
+    }
+    return retval;
+}
+
+std::vector<std::pair<ParticleID, Particle> >
+    ParticleSpaceSoAImpl::list_particles_exact(const Species& sp) const
+{
+    std::vector<std::pair<ParticleID, Particle> > retval;
+
+    species_map_type::const_iterator itr(species_map_.find(sp.serial()));
+    if (itr == species_map_.end())
+    {
+        return retval;
+    }
+
+    const species_id_type id((*itr).second);
+    retval.reserve(species_counts_[id]);
+    for (index_type i(0); i < pids_.size(); ++i)
+    {
+        if (species_ids_[i] == id)
+        {
+            retval.push_back(std::make_pair(pids_[i], particle_at(i)));
+        }
+    }
+    return retval;
+}
+
+template <typename Tfilter_>
+std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
+    ParticleSpaceSoAImpl::collect_particles_within_radius(
+        const Real3& pos, const Real& radius, Tfilter_ filter) const
+{
+    std::vector<std::pair<index_type, Real> > found;
+    for_each_particle_within_radius(pos, radius,
+        [&](const index_type i, const Real dist)
+        {
+            if (filter(pids_[i]))
+            {
+                found.push_back(std::make_pair(i, dist));
+            }
+        });
+
+    std::vector<std::pair<std::pair<ParticleID, Particle>, Real> > retval;
+    retval.reserve(found.size());
+    for (std::vector<std::pair<index_type, Real> >::const_iterator i(found.begin());
+         i != found.end(); ++i)
+    {
+        retval.push_back(std::make_pair(
+            std::make_pair(pids_[(*i).first], particle_at((*i).first)), (*i).second));
+    }
+
+    std::sort(retval.begin(), retval.end(),
+        utils::pair_second_element_comparator<std::pair<ParticleID, Particle>, Real>());
+    return retval;
+}
+
+std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
+    ParticleSpaceSoAImpl::list_particles_within_radius(
+        const Real3& pos, const Real& radius) const
+{
+    return collect_particles_within_radius(pos, radius,
+        [](const ParticleID&) { return true; });
+}
+
+std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
+    ParticleSpaceSoAImpl::list_particles_within_radius(
+        const Real3& pos, const Real& radius,
+        const ParticleID& ignore) const
+{
+    return collect_particles_within_radius(pos, radius,
+        [&](const ParticleID& pid) { return pid != ignore; });
+}
+
+std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
+    ParticleSpaceSoAImpl::list_particles_within_radius(
+        const Real3& pos, const Real& radius,
+        const ParticleID& ignore1, const ParticleID& ignore2) const
+{
+    return collect_particles_within_radius(pos, radius,
+        [&](const ParticleID& pid) { return pid != ignore1 && pid != ignore2; });
+}
+
+} // ecell4
@@ -0,0 +1,372 @@
+#ifndef ECELL4_PARTICLE_SPACE_SOA_IMPL_HPP
+#define ECELL4_PARTICLE_SPACE_SOA_IMPL_HPP
+
+#include <atomic>
+#include <vector>
+
+#include "ParticleSpace.hpp"
+
+#ifdef WITH_HDF5
+#include "ParticleSpaceHDF5Writer.hpp"
+#endif
+
+#include "Integer3.hpp"
+
+
+namespace ecell4
+{
+
+/**
+ * A particle space keeping the attributes of particles in separate arrays.
+ * A species is registered once in a table, and a particle holds its index
+ * instead of a copy of Species. Particles are bucketed into a cell list,
+ * and sort_by_cell places the particles of the same cell next to each other.
+ * for_each_particle_within_radius visits the indices of the neighbors
+ * without copying any Particle. The location of a particle is not kept.
+ */
+class ParticleSpaceSoAImpl
+    : public ParticleSpace
+{
+public:
+
+    typedef ParticleSpace base_type;
+    typedef ParticleSpace::particle_container_type particle_container_type;
+
+    typedef std::size_t index_type;
+    typedef unsigned int species_id_type;
+
+protected:
+
+    typedef utils::get_mapper_mf<ParticleID, index_type>::type particle_map_type;
+    typedef utils::get_mapper_mf<Species::serial_type, species_id_type>::type
+        species_map_type;
+    typedef std::vector<index_type> cell_type;
+
+public:
+
+    ParticleSpaceSoAImpl(const Real3& edge_lengths)
+        : base_type(), matrix_sizes_(3, 3, 3)
+    {
+        reset(edge_lengths);
+    }
+
+    ParticleSpaceSoAImpl(const Real3& edge_lengths, const Integer3& matrix_sizes)
+        : base_type(), matrix_sizes_(matrix_sizes)
+    {
+        reset(edge_lengths);
+    }
+
+    // Space
+
+    virtual Integer num_species() const;
+    virtual bool has_species(const Species& sp) const;
+    virtual std::vector<Species> list_species() const;
+
+    // ParticleSpaceTraits
+
+    const Real3& edge_lengths() const
+    {
+        return edge_lengths_;
+    }
+
+    const Real3& cell_sizes() const
+    {
+        return cell_sizes_;
+    }
+
+    const Integer3 matrix_sizes() const
+    {
+        return matrix_sizes_;
+    }
+
+    void reset(const Real3& edge_lengths);
+
+    bool update_particle(const ParticleID& pid, const Particle& p);
+    std::pair<ParticleID, Particle> get_particle(const ParticleID& pid) const;
+    bool has_particle(const ParticleID& pid) const;
+    void remove_particle(const ParticleID& pid);
+
+    Integer num_particles() const;
+    Integer num_particles(const Species& sp) const;
+    Integer num_particles_exact(const Species& sp) const;
+    Integer num_molecules(const Species& sp) const;
+    Integer num_molecules_exact(const Species& sp) const;
+
+    std::vector<std::pair<ParticleID, Particle> >
+        list_particles() const;
+    std::vector<std::pair<ParticleID, Particle> >
+        list_particles(const Species& sp) const;
+    std::vector<std::pair<ParticleID, Particle> >
+        list_particles_exact(const Species& sp) const;
+
+    std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
+        list_particles_within_radius(
+            const Real3& pos, const Real& radius) const;
+    std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
+        list_particles_within_radius(
+            const Real3& pos, const Real& radius,
+            const ParticleID& ignore) const;
+    std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
+        list_particles_within_radius(
+            const Real3& pos, const Real& radius,
+            const ParticleID& ignore1, const ParticleID& ignore2) const;
+
+    /**
+     * the particles gathered into pairs. This is rebuilt at every call
+     * after a modification, and should be avoided in a loop.
+     */
+    const particle_container_type& particles() const;
+
+    virtual void save(const std::string& filename) const
+    {
+        throw NotSupported(
+            "save(const std::string) is not supported by this space class");
+    }
+
+#ifdef WITH_HDF5
+    void save_hdf5(H5::Group* root) const
+    {
+        save_particle_space(*this, root);
+    }
+
+    void load_hdf5(const H5::Group& root)
+    {
+        load_particle_space(root, this);
+    }
+#endif
+
+    // Structure of arrays
+
+    /**
+     * the number of particles, and the end of the indices.
+     * An index is valid until the next modification of the space.
+     */
+    index_type size() const
+    {
+        return pids_.size();
+    }
+
+    /**
+     * return the index of a particle. Throws NotFound if no such particle.
+     */
+    index_type index(const ParticleID& pid) const
+    {
+        particle_map_type::const_iterator i(rmap_.find(pid));
+        if (i == rmap_.end())
+        {
+            throw NotFound("No such particle.");
+        }
+        return (*i).second;
+    }
+
+    const ParticleID& pid_at(const index_type i) const
+    {
+        return pids_[i];
+    }
+
+    const Real3 position_at(const index_type i) const
+    {
+        return Real3(xs_[i], ys_[i], zs_[i]);
+    }
+
+    const Real& radius_at(const index_type i) const
+    {
+        return radii_[i];
+    }
+
+    const Real& D_at(const index_type i) const
+    {
+        return Ds_[i];
+    }
+
+    const species_id_type& species_id_at(const index_type i) const
+    {
+        return species_ids_[i];
+    }
+
+    const Particle particle_at(const index_type i) const
+    {
+        return Particle(
+            species_[species_ids_[i]], position_at(i), radii_[i], Ds_[i]);
+    }
+
+    /**
+     * the species registered with the given id. Ids are never reused
+     * until reset.
+     */
+    const Species& species_at(const species_id_type id) const
+    {
+        return species_[id];
+    }
+
+    /**
+     * move a particle keeping the other attributes.
+     * Threads may move particles at the same time as long as none of them
+     * reads or writes the cells, before and after the move, of the others.
+     */
+    void update_position(const index_type i, const Real3& pos);
+
+    /**
+     * call fn(index, distance) for each particle overlapping with the sphere.
+     * The distance is the one between the surfaces. The space must not be
+     * modified in fn.
+     */
+    template <typename Tfn_>
+    void for_each_particle_within_radius(
+        const Real3& pos, const Real& radius, Tfn_ fn) const
+    {
+        if (pids_.empty())
+        {
+            return;
+        }
+
+        const boost::array<std::size_t, 3> center(cell_index(pos));
+        boost::array<std::size_t, 3> idx;
+        Real3 stride;
+
+        for (int o2(-1); o2 <= 1; ++o2)
+        {
+            stride[2] = offset_cyclic(center, o2, 2, idx);
+            for (int o1(-1); o1 <= 1; ++o1)
+            {
+                stride[1] = offset_cyclic(center, o1, 1, idx);
+                for (int o0(-1); o0 <= 1; ++o0)
+                {
+                    stride[0] = offset_cyclic(center, o0, 0, idx);
+
+                    const Real x(pos[0] - stride[0]),
+                               y(pos[1] - stride[1]),
+                               z(pos[2] - stride[2]);
+                    const cell_type& c(cells_[cell_id(idx)]);
+                    for (cell_type::const_iterator j(c.begin()); j != c.end(); ++j)
+                    {
+                        const index_type i(*j);
+                        const Real dx(xs_[i] - x), dy(ys_[i] - y), dz(zs_[i] - z);
+                        const Real dist(std::sqrt(dx * dx + dy * dy + dz * dz) - radii_[i]);
+                        if (dist < radius)
+                        {
+                            fn(i, dist);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * the position of the cell including the given point in the matrix.
+     */
+    const Integer3 position2cell(const Real3& pos) const
+    {
+        const boost::array<std::size_t, 3> idx(cell_index(pos));
+        return Integer3(idx[0], idx[1], idx[2]);
+    }
+
+    /**
+     * reorder the arrays for the particles in the same cell to be contiguous.
+     * This invalidates the indices.
+     */
+    void sort_by_cell();
+
+protected:
+
+    species_id_type register_species(const Species& sp);
+
+    boost::array<std::size_t, 3> cell_index(const Real3& pos) const
+    {
+        const boost::array<std::size_t, 3> retval = {{
+            static_cast<std::size_t>(pos[0] / cell_sizes_[0]) % shape_[0],
+            static_cast<std::size_t>(pos[1] / cell_sizes_[1]) % shape_[1],
+            static_cast<std::size_t>(pos[2] / cell_sizes_[2]) % shape_[2]
+            }};
+        return retval;
+    }
+
+    std::size_t cell_id(const boost::array<std::size_t, 3>& idx) const
+    {
+        return (idx[0] * shape_[1] + idx[1]) * shape_[2] + idx[2];
+    }
+
+    std::size_t cell_id(const Real3& pos) const
+    {
+        return cell_id(cell_index(pos));
+    }
+
+    /**
+     * shift the dim-th index by the offset across the periodic boundary,
+     * and return the shift of positions in the shifted cell.
+     */
+    Real offset_cyclic(
+        const boost::array<std::size_t, 3>& center, const int offset,
+        const std::size_t dim, boost::array<std::size_t, 3>& idx) const
+    {
+        const Integer n(shape_[dim]);
+        const Integer i(static_cast<Integer>(center[dim]) + offset);
+        if (i < 0)
+        {
+            idx[dim] = i + n;
+            return -edge_lengths_[dim];
+        }
+        else if (i >= n)
+        {
+            idx[dim] = i - n;
+            return edge_lengths_[dim];
+        }
+        idx[dim] = i;
+        return 0.0;
+    }
+
+    void push_into_cell(const std::size_t c, const index_type i)
+    {
+        cells_of_[i] = c;
+        slots_[i] = cells_[c].size();
+        cells_[c].push_back(i);
+    }
+
+    void erase_from_cell(const index_type i)
+    {
+        cell_type& c(cells_[cells_of_[i]]);
+        const index_type last(c.back());
+        c[slots_[i]] = last;
+        slots_[last] = slots_[i];
+        c.pop_back();
+    }
+
+    /**
+     * collect the neighbors into pairs sorted by the distance.
+     */
+    template <typename Tfilter_>
+    std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
+    collect_particles_within_radius(
+        const Real3& pos, const Real& radius, Tfilter_ filter) const;
+
+protected:
+
+    Real3 edge_lengths_;
+    Integer3 matrix_sizes_;
+    boost::array<std::size_t, 3> shape_;
+    Real3 cell_sizes_;
+
+    std::vector<ParticleID> pids_;
+    std::vector<Real> xs_, ys_, zs_, radii_, Ds_;
+    std::vector<species_id_type> species_ids_;
+    particle_map_type rmap_;
+
+    std::vector<cell_type> cells_;
+    std::vector<std::size_t> cells_of_, slots_;
+
+    std::vector<Species> species_;
+    std::vector<Integer> species_counts_;
+    species_map_type species_map_;
+
+    mutable particle_container_type particles_;
+    /**
+     * atomic as update_position may be called for particles in distant cells
+     * at the same time.
+     */
+    mutable std::atomic<bool> particles_dirty_;
+};
+
+} // ecell4
+
+#endif /* ECELL4_PARTICLE_SPACE_SOA_IMPL_HPP */
@@ -46,38 +46,29 @@ bool PlanarSurface::test_AABB(const Real3& lower, const Real3& upper) const
 void PlanarSurface::bounding_box(
     const Real3& edge_lengths, Real3& lower, Real3& upper) const
 {
-    if (n_[0] > epsilon)
+    // the box of the points in [0, edge_lengths] with dot_product(n_, p) >= d_.
+    // maxima[i] is the largest value of n_[i] * p[i] in the range.
+    Real3 maxima;
+    for (std::size_t i(0); i < 3; ++i)
     {
-        lower[0] = std::max(
-            (d_ - n_[1] * edge_lengths[1] - n_[2] * edge_lengths[2]) / n_[0], 0.0);
-        upper[0] = std::min(d_ / n_[0], edge_lengths[0]);
+        maxima[i] = std::max(n_[i] * edge_lengths[i], 0.0);
     }
-    else
-    {
-        lower[0] = 0.0;
-        upper[0] = edge_lengths[0];
-    }
-    if (n_[1] > epsilon)
-    {
-        lower[1] = std::max(
-            (d_ - n_[0] * edge_lengths[0] - n_[2] * edge_lengths[2]) / n_[1], 0.0);
-        upper[1] = std::min(d_ / n_[1], edge_lengths[1]);
-    }
-    else
-    {
-        lower[1] = 0.0;
-        upper[1] = edge_lengths[1];
-    }
-    if (n_[2] > epsilon)
-    {
-        lower[2] = std::max(
-            (d_ - n_[1] * edge_lengths[1] - n_[0] * edge_lengths[0]) / n_[2], 0.0);
-        upper[2] = std::min(d_ / n_[2], edge_lengths[2]);
-    }
-    else
+    const Real total(maxima[0] + maxima[1] + maxima[2]);
+
+    for (std::size_t i(0); i < 3; ++i)
     {
-        lower[2] = 0.0;
-        upper[2] = edge_lengths[2];
+        lower[i] = 0.0;
+        upper[i] = edge_lengths[i];
+
+        const Real rest(d_ - (total - maxima[i]));
+        if (n_[i] > epsilon)
+        {
+            lower[i] = std::max(rest / n_[i], 0.0);
+        }
+        else if (n_[i] < -epsilon)
+        {
+            upper[i] = std::min(rest / n_[i], edge_lengths[i]);
+        }
     }
 }
 
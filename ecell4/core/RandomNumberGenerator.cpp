@@ -1,5 +1,7 @@
 #include <boost/scoped_ptr.hpp>
 #include <gsl/gsl_rng.h>
+#include <gsl/gsl_math.h>
+#include <cmath>
 #include <sstream>
 
 #include "RandomNumberGenerator.hpp"
@@ -51,6 +53,29 @@ void GSLRandomNumberGenerator::load(const std::string& filename)
         fin(new H5::H5File(filename.c_str(), H5F_ACC_RDONLY));
     this->load(*fin);
 }
+
+void PhiloxRandomNumberGenerator::save(H5::H5Location* root) const
+{
+    using namespace H5;
+
+    boost::scoped_ptr<DataType> optype(new DataType(H5T_OPAQUE, 1));
+    hsize_t bufsize(sizeof(state_type));
+    DataSpace dataspace(1, &bufsize);
+    optype->setTag("PhiloxRandomNumberGenerator state type");
+    boost::scoped_ptr<DataSet> dataset(
+        new DataSet(root->createDataSet("rng", *optype, dataspace)));
+    dataset->write((const unsigned char*)(&state()), *optype);
+}
+
+void PhiloxRandomNumberGenerator::load(const H5::H5Location& root)
+{
+    using namespace H5;
+
+    const DataSet dataset(DataSet(root.openDataSet("rng")));
+    boost::scoped_ptr<DataType> optype(new DataType(H5T_OPAQUE, 1));
+    optype->setTag("PhiloxRandomNumberGenerator state type");
+    dataset.read((unsigned char*)(&state()), *optype);
+}
 #endif
 
 Real GSLRandomNumberGenerator::random()
@@ -101,6 +126,11 @@ Integer GSLRandomNumberGenerator::binomial(Real p, Integer n)
     return gsl_ran_binomial(rng_.get(), p, n);
 }
 
+Integer GSLRandomNumberGenerator::poisson(Real mean)
+{
+    return gsl_ran_poisson(rng_.get(), mean);
+}
+
 Real3 GSLRandomNumberGenerator::direction3d(Real length)
 {
     double x, y, z;
@@ -118,4 +148,213 @@ void GSLRandomNumberGenerator::seed()
     gsl_rng_set(rng_.get(), unsigned(std::time(0)));
 }
 
+void GSLRandomNumberGenerator::fill_uniform(Real* first, Real* last)
+{
+    gsl_rng* const rng(rng_.get());
+    for (; first != last; ++first)
+    {
+        *first = gsl_rng_uniform(rng);
+    }
+}
+
+void GSLRandomNumberGenerator::fill_gaussian(Real* first, Real* last, Real sigma)
+{
+    gsl_rng* const rng(rng_.get());
+    for (; first != last; ++first)
+    {
+        *first = gsl_ran_gaussian(rng, sigma);
+    }
+}
+
+void GSLRandomNumberGenerator::fill_direction3d(Real3* first, Real3* last, Real length)
+{
+    gsl_rng* const rng(rng_.get());
+    double x, y, z;
+    for (; first != last; ++first)
+    {
+        gsl_ran_dir_3d(rng, &x, &y, &z);
+        *first = Real3(x * length, y * length, z * length);
+    }
+}
+
+namespace
+{
+
+typedef PhiloxRandomNumberGenerator::state_type philox_state_type;
+
+const Real philox_unit(1.0 / 4294967296.0);
+
+inline boost::uint32_t mulhilo(
+    const boost::uint32_t a, const boost::uint32_t b, boost::uint32_t& hi)
+{
+    const boost::uint64_t product(static_cast<boost::uint64_t>(a) * b);
+    hi = static_cast<boost::uint32_t>(product >> 32);
+    return static_cast<boost::uint32_t>(product);
+}
+
+/**
+ * the ten rounds of Philox4x32 on the block at the given counter.
+ */
+inline void philox_block(
+    const philox_state_type& state, const boost::uint64_t counter,
+    boost::uint32_t (&out)[4])
+{
+    boost::uint32_t c0(static_cast<boost::uint32_t>(counter)),
+        c1(static_cast<boost::uint32_t>(counter >> 32)),
+        c2(static_cast<boost::uint32_t>(state.stream)),
+        c3(static_cast<boost::uint32_t>(state.stream >> 32));
+    boost::uint32_t k0(state.key[0]), k1(state.key[1]);
+
+    for (unsigned int round(0); round < 10; ++round)
+    {
+        boost::uint32_t hi0, hi1;
+        const boost::uint32_t lo0(mulhilo(0xD2511F53u, c0, hi0));
+        const boost::uint32_t lo1(mulhilo(0xCD9E8D57u, c2, hi1));
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+void philox_set(void* vstate, unsigned long int seed)
+{
+    philox_state_type& state(*static_cast<philox_state_type*>(vstate));
+    const boost::uint64_t key(seed);
+    state.key[0] = static_cast<boost::uint32_t>(key);
+    state.key[1] = static_cast<boost::uint32_t>(key >> 32);
+    state.counter = 0;
+    state.position = 4;
+    // the stream is kept. gsl_rng_alloc leaves it undefined.
+}
+
+unsigned long int philox_get(void* vstate)
+{
+    philox_state_type& state(*static_cast<philox_state_type*>(vstate));
+    if (state.position == 4)
+    {
+        philox_block(state, state.counter++, state.buffer);
+        state.position = 0;
+    }
+    return state.buffer[state.position++];
+}
+
+double philox_get_double(void* vstate)
+{
+    return philox_get(vstate) * philox_unit;
+}
+
+const gsl_rng_type philox_type = {
+    "philox4x32", 0xffffffffUL, 0, sizeof(philox_state_type),
+    &philox_set, &philox_get, &philox_get_double};
+
+} // anonymous
+
+PhiloxRandomNumberGenerator::PhiloxRandomNumberGenerator(
+    const Integer myseed, const Integer stream)
+    : base_type(&philox_type, myseed)
+{
+    set_stream(stream);
+}
+
+PhiloxRandomNumberGenerator::PhiloxRandomNumberGenerator(const std::string& filename)
+    : base_type(&philox_type, 0)
+{
+    set_stream(0);
+    load(filename);
+}
+
+Integer PhiloxRandomNumberGenerator::stream() const
+{
+    return state().stream;
+}
+
+void PhiloxRandomNumberGenerator::set_stream(const Integer stream)
+{
+    state_type& s(state());
+    s.stream = stream;
+    s.counter = 0;
+    s.position = 4;
+}
+
+void PhiloxRandomNumberGenerator::fill_uniform(Real* first, Real* last)
+{
+    state_type& s(state());
+
+    for (; first != last && s.position < 4; ++first)
+    {
+        *first = s.buffer[s.position++] * philox_unit;
+    }
+
+    const std::size_t num_blocks((last - first) / 4);
+    for (std::size_t i(0); i < num_blocks; ++i)
+    {
+        boost::uint32_t out[4];
+        philox_block(s, s.counter + i, out);
+        first[4 * i] = out[0] * philox_unit;
+        first[4 * i + 1] = out[1] * philox_unit;
+        first[4 * i + 2] = out[2] * philox_unit;
+        first[4 * i + 3] = out[3] * philox_unit;
+    }
+    s.counter += num_blocks;
+    first += 4 * num_blocks;
+
+    if (first != last)
+    {
+        philox_block(s, s.counter++, s.buffer);
+        s.position = 0;
+        for (; first != last; ++first)
+        {
+            *first = s.buffer[s.position++] * philox_unit;
+        }
+    }
+}
+
+/**
+ * the Box-Muller transform of the uniform numbers filled in place.
+ * This gives a sequence different from gaussian, which is gsl_ran_gaussian.
+ */
+void PhiloxRandomNumberGenerator::fill_gaussian(Real* first, Real* last, Real sigma)
+{
+    fill_uniform(first, last);
+
+    const std::size_t num_pairs((last - first) / 2);
+    for (std::size_t i(0); i < num_pairs; ++i)
+    {
+        const Real r(sigma * std::sqrt(-2.0 * std::log(1.0 - first[2 * i])));
+        const Real theta(2.0 * M_PI * first[2 * i + 1]);
+        first[2 * i] = r * std::cos(theta);
+        first[2 * i + 1] = r * std::sin(theta);
+    }
+
+    if ((last - first) % 2 != 0)
+    {
+        Real u[2];
+        fill_uniform(u, u + 2);
+        *(last - 1) = sigma * std::sqrt(-2.0 * std::log(1.0 - u[0]))
+            * std::cos(2.0 * M_PI * u[1]);
+    }
+}
+
+void PhiloxRandomNumberGenerator::fill_direction3d(
+    Real3* first, Real3* last, Real length)
+{
+    std::vector<Real> xyz(3 * (last - first));
+    fill_gaussian(xyz.data(), xyz.data() + xyz.size(), 1.0);
+
+    for (std::size_t i(0); first != last; ++first, ++i)
+    {
+        const Real3 v(xyz[3 * i], xyz[3 * i + 1], xyz[3 * i + 2]);
+        const Real norm(std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]));
+        *first = (norm > 0 ? v * (length / norm) : direction3d(length));
+    }
+}
+
 } // ecell4
@@ -4,6 +4,7 @@
 #include <ctime>
 #include <vector>
 #include <boost/shared_ptr.hpp>
+#include <boost/cstdint.hpp>
 #include <gsl/gsl_rng.h>
 #include <gsl/gsl_randist.h>
 
@@ -33,11 +34,42 @@ public:
     virtual Integer uniform_int(Integer min, Integer max) = 0;
     virtual Real gaussian(Real sigma, Real mean = 0.0) = 0;
     virtual Integer binomial(Real p, Integer n) = 0;
+    virtual Integer poisson(Real mean) = 0;
     virtual Real3 direction3d(Real length = 1.0) = 0;
 
     virtual void seed(Integer val) = 0;
     virtual void seed() = 0;
 
+    /**
+     * fill the range with numbers uniformly distributed in [0, 1).
+     * These bulk methods draw the same distributions as calling random(),
+     * gaussian(sigma) and direction3d(length) for each, and implementations
+     * may override them with a loop free from the virtual calls.
+     */
+    virtual void fill_uniform(Real* first, Real* last)
+    {
+        for (; first != last; ++first)
+        {
+            *first = random();
+        }
+    }
+
+    virtual void fill_gaussian(Real* first, Real* last, Real sigma)
+    {
+        for (; first != last; ++first)
+        {
+            *first = gaussian(sigma);
+        }
+    }
+
+    virtual void fill_direction3d(Real3* first, Real3* last, Real length = 1.0)
+    {
+        for (; first != last; ++first)
+        {
+            *first = direction3d(length);
+        }
+    }
+
 #ifdef WITH_HDF5
     virtual void save(H5::H5Location* root) const = 0;
     virtual void load(const H5::H5Location& root) = 0;
@@ -86,10 +118,15 @@ public:
     Integer uniform_int(Integer min, Integer max);
     Real gaussian(Real sigma, Real mean = 0.0);
     Integer binomial(Real p, Integer n);
+    Integer poisson(Real mean);
     Real3 direction3d(Real length);
     void seed(Integer val);
     void seed();
 
+    void fill_uniform(Real* first, Real* last);
+    void fill_gaussian(Real* first, Real* last, Real sigma);
+    void fill_direction3d(Real3* first, Real3* last, Real length = 1.0);
+
 #ifdef WITH_HDF5
     void save(H5::H5Location* root) const;
     void load(const H5::H5Location& root);
@@ -127,11 +164,77 @@ public:
     //     ;
     // }
 
+protected:
+
+    GSLRandomNumberGenerator(const gsl_rng_type* type, const Integer myseed)
+        : rng_(gsl_rng_alloc(type), &gsl_rng_free)
+    {
+        seed(myseed);
+    }
+
 protected:
 
     rng_handle rng_;
 };
 
+/**
+ * A counter-based generator, Philox4x32-10 (Salmon et al., SC11), running
+ * as a gsl_rng. The n-th number of a stream is a function of the seed, the
+ * stream and n alone. Generators with the same seed on different streams
+ * are independent, e.g. one for each thread, and the fill methods compute
+ * blocks of four numbers in a loop without any dependency between blocks.
+ */
+class PhiloxRandomNumberGenerator
+    : public GSLRandomNumberGenerator
+{
+public:
+
+    typedef GSLRandomNumberGenerator base_type;
+
+    struct state_type
+    {
+        boost::uint32_t key[2];
+        boost::uint64_t counter, stream;
+        boost::uint32_t buffer[4];
+        boost::uint32_t position;
+    };
+
+public:
+
+    PhiloxRandomNumberGenerator(const Integer myseed = 0, const Integer stream = 0);
+    PhiloxRandomNumberGenerator(const std::string& filename);
+
+    /**
+     * the stream to draw numbers from. Setting a stream restarts it
+     * from the beginning keeping the seed.
+     */
+    Integer stream() const;
+    void set_stream(const Integer stream);
+
+    void fill_uniform(Real* first, Real* last);
+    void fill_gaussian(Real* first, Real* last, Real sigma);
+    void fill_direction3d(Real3* first, Real3* last, Real length = 1.0);
+
+#ifdef WITH_HDF5
+    using base_type::save;
+    using base_type::load;
+    void save(H5::H5Location* root) const;
+    void load(const H5::H5Location& root);
+#endif
+
+protected:
+
+    state_type& state()
+    {
+        return *static_cast<state_type*>(gsl_rng_state(rng_.get()));
+    }
+
+    const state_type& state() const
+    {
+        return *static_cast<const state_type*>(gsl_rng_state(rng_.get()));
+    }
+};
+
 } // ecell4
 
 #endif /* ECELL4_RANDOM_NUMBER_GENERATOR_HPP */
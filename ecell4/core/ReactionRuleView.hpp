@@ -0,0 +1,119 @@
+#ifndef ECELL4_REACTION_RULE_VIEW_HPP
+#define ECELL4_REACTION_RULE_VIEW_HPP
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/iterator/permutation_iterator.hpp>
+
+#include "ReactionRule.hpp"
+
+
+namespace ecell4
+{
+
+/**
+ * a read-only range of reaction rules, given as indices into an array of
+ * rules owned by a model. A view never copies the rules it refers to,
+ * and is valid until the model is modified.
+ * A view can also own a copy of rules for models without stable storage.
+ */
+class ReactionRuleView
+{
+public:
+
+    typedef std::vector<ReactionRule>::size_type size_type;
+    typedef size_type index_type;
+    typedef ReactionRule value_type;
+    typedef boost::permutation_iterator<const ReactionRule*, const index_type*>
+        const_iterator;
+    typedef const_iterator iterator;
+
+public:
+
+    ReactionRuleView()
+        : rules_(NULL), first_(NULL), last_(NULL), owned_()
+    {
+        ;
+    }
+
+    ReactionRuleView(
+        const ReactionRule* rules, const index_type* first, const index_type* last)
+        : rules_(rules), first_(first), last_(last), owned_()
+    {
+        ;
+    }
+
+    /**
+     * make a view owning a copy of the given rules.
+     */
+    explicit ReactionRuleView(const std::vector<ReactionRule>& rules)
+        : rules_(NULL), first_(NULL), last_(NULL), owned_()
+    {
+        if (rules.empty())
+        {
+            return;
+        }
+
+        boost::shared_ptr<owned_type> owned(new owned_type());
+        owned->rules = rules;
+        owned->indices.reserve(rules.size());
+        for (index_type i(0); i < rules.size(); ++i)
+        {
+            owned->indices.push_back(i);
+        }
+
+        rules_ = &owned->rules[0];
+        first_ = &owned->indices[0];
+        last_ = first_ + owned->indices.size();
+        owned_ = owned;
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(rules_, first_);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(rules_, last_);
+    }
+
+    size_type size() const
+    {
+        return static_cast<size_type>(last_ - first_);
+    }
+
+    bool empty() const
+    {
+        return first_ == last_;
+    }
+
+    const ReactionRule& operator[](const size_type i) const
+    {
+        return rules_[first_[i]];
+    }
+
+    std::vector<ReactionRule> as_vector() const
+    {
+        return std::vector<ReactionRule>(begin(), end());
+    }
+
+protected:
+
+    struct owned_type
+    {
+        std::vector<ReactionRule> rules;
+        std::vector<index_type> indices;
+    };
+
+protected:
+
+    const ReactionRule* rules_;
+    const index_type* first_;
+    const index_type* last_;
+    boost::shared_ptr<const owned_type> owned_;
+};
+
+} // ecell4
+
+#endif /* ECELL4_REACTION_RULE_VIEW_HPP */
@@ -113,6 +113,14 @@ bool Rod::test_AABB(const Real3& lower, const Real3& upper) const
         Sphere(p0, radius_), d, AABB(lower, upper), t);
 }
 
+void Rod::bounding_box(
+    const Real3& edge_lengths, Real3& lower, Real3& upper) const
+{
+    const Real3 r(length_ * 0.5 + radius_, radius_, radius_); //XXX: along the x-axis
+    lower = origin_ - r;
+    upper = origin_ + r;
+}
+
 RodSurface::RodSurface()
     : length_(0.5e-6), radius_(2.0e-6), origin_()
 {
@@ -221,4 +229,12 @@ bool RodSurface::test_AABB(const Real3& lower, const Real3& upper) const
     }
 }
 
+void RodSurface::bounding_box(
+    const Real3& edge_lengths, Real3& lower, Real3& upper) const
+{
+    const Real3 r(length_ * 0.5 + radius_, radius_, radius_); //XXX: along the x-axis
+    lower = origin_ - r;
+    upper = origin_ + r;
+}
+
 } // ecell4
@@ -28,6 +28,8 @@ public:
     Real3 draw_position(boost::shared_ptr<RandomNumberGenerator>& rng) const;
     RodSurface surface() const;
     bool test_AABB(const Real3& l, const Real3& u) const;
+    void bounding_box(
+        const Real3& edge_lengths, Real3& lower, Real3& upper) const;
 
     const Real half_length() const
     {
@@ -69,6 +71,8 @@ public:
     Real3 draw_position(boost::shared_ptr<RandomNumberGenerator>& rng) const;
     Rod inside() const;
     bool test_AABB(const Real3& l, const Real3& u) const;
+    void bounding_box(
+        const Real3& edge_lengths, Real3& lower, Real3& upper) const;
 
     dimension_kind dimension() const
     {
@@ -1,6 +1,8 @@
 #ifndef ECELL4_SHAPE_HPP
 #define ECELL4_SHAPE_HPP
 
+#include <vector>
+
 #include "Real3.hpp"
 #include "RandomNumberGenerator.hpp"
 
@@ -34,12 +36,32 @@ struct Shape
         boost::shared_ptr<RandomNumberGenerator>& rng) const = 0;
     virtual bool test_AABB(const Real3& l, const Real3& u) const = 0;
 
+    /**
+     * return a box enclosing all the points where is_inside is not positive.
+     * The box may exceed [0, edge_lengths], or be empty (lower > upper).
+     */
     virtual void bounding_box(
         const Real3& edge_lengths, Real3& lower, Real3& upper) const
     {
         lower = Real3(0.0, 0.0, 0.0);
         upper = edge_lengths;
     }
+
+    /**
+     * evaluate is_inside at each of the given positions into retval.
+     * A caller may run this from multiple threads at once only when it
+     * is asked to, e.g. SpatiocyteWorld::add_structure with num_threads
+     * more than one. A shape written in Python takes the GIL in each call.
+     */
+    virtual void batch_is_inside(
+        const std::vector<Real3>& positions, std::vector<Real>& retval) const
+    {
+        retval.resize(positions.size());
+        for (std::size_t i(0); i < positions.size(); ++i)
+        {
+            retval[i] = is_inside(positions[i]);
+        }
+    }
 };
 
 } // ecell4
@@ -71,6 +71,25 @@ public:
 
 protected:
 
+    /**
+     * create a world with the time and the numbers of molecules of the given
+     * one, which is the whole state of a well-mixed world. A factory of
+     * such a world defines copy_world with this. A spatial world needs
+     * its own, as this never copies the state in space.
+     */
+    world_type* copy_compartment_world(const world_type& w) const
+    {
+        world_type* retval(create_world(w.edge_lengths()));
+        retval->set_t(w.t());
+        const std::vector<Species> splist(w.list_species());
+        for (std::vector<Species>::const_iterator i(splist.begin());
+            i != splist.end(); ++i)
+        {
+            retval->add_molecules(*i, w.num_molecules_exact(*i));
+        }
+        return retval;
+    }
+
     virtual world_type* create_world(const Real3& edge_lengths) const
     {
         return new world_type(edge_lengths);
@@ -7,19 +7,20 @@ namespace ecell4
 {
 
 Species::Species()
-    : serial_(""), attributes_()
+    : serial_(""), hash_(hash_serial(serial_)), formatted_(false), attributes_()
 {
     ; // do nothing
 }
 
 Species::Species(const serial_type& name)
-    : serial_(name), attributes_()
+    : serial_(name), hash_(hash_serial(serial_)), formatted_(false), attributes_()
 {
     ;
 }
 
 Species::Species(const Species& another)
-    : serial_(another.serial()), attributes_(another.attributes_)
+    : serial_(another.serial_), hash_(another.hash_), formatted_(another.formatted_),
+      attributes_(another.attributes_)
 {
     ;
 }
@@ -27,6 +28,8 @@ Species::Species(const Species& another)
 Species& Species::operator=(const Species& another)
 {
     serial_ = another.serial_;
+    hash_ = another.hash_;
+    formatted_ = another.formatted_;
     attributes_ = another.attributes_;
     return *this;
 }
@@ -34,7 +37,7 @@ Species& Species::operator=(const Species& another)
 Species::Species(
     const serial_type& name, const Real& radius, const Real& D,
     const std::string location, const Integer& dimension)
-    : serial_(name), attributes_()
+    : serial_(name), hash_(hash_serial(serial_)), formatted_(false), attributes_()
 {
     set_attribute("radius", radius);
     set_attribute("D", D);
@@ -45,7 +48,7 @@ Species::Species(
 Species::Species(
     const serial_type& name, const Quantity<Real>& radius, const Quantity<Real>& D,
     const std::string location, const Integer& dimension)
-    : serial_(name), attributes_()
+    : serial_(name), hash_(hash_serial(serial_)), formatted_(false), attributes_()
 {
     set_attribute("radius", radius);
     set_attribute("D", D);
@@ -53,29 +56,26 @@ Species::Species(
     set_attribute("dimension", dimension);
 }
 
-const Species::serial_type Species::serial() const
+Species::hash_type Species::hash_serial(const serial_type& serial)
 {
-    return serial_;
-}
-
-bool Species::operator==(const Species& rhs) const
-{
-    return (serial() == rhs.serial());
-}
-
-bool Species::operator!=(const Species& rhs) const
-{
-    return (serial() != rhs.serial());
+    // FNV-1a
+    hash_type h(14695981039346656037ULL);
+    for (serial_type::const_iterator i(serial.begin()); i != serial.end(); ++i)
+    {
+        h ^= static_cast<unsigned char>(*i);
+        h *= 1099511628211ULL;
+    }
+    return h;
 }
 
 bool Species::operator<(const Species& rhs) const
 {
-    return (serial() < rhs.serial());
+    return (serial_ < rhs.serial_);
 }
 
 bool Species::operator>(const Species& rhs) const
 {
-    return (serial() > rhs.serial());
+    return (serial_ > rhs.serial_);
 }
 
 Integer Species::count(const Species& sp) const
@@ -114,6 +114,8 @@ void Species::add_unit(const UnitSpecies& usp)
     {
         serial_ = usp.serial();
     }
+    hash_ = hash_serial(serial_);
+    formatted_ = false;
 }
 
 Species::attribute_type Species::get_attribute(const std::string& key) const
@@ -9,6 +9,7 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/variant.hpp>
 #include <boost/container/flat_map.hpp>
+#include <boost/cstdint.hpp>
 // #include <boost/container/small_vector.hpp>
 
 #include <ecell4/core/config.h>
@@ -26,12 +27,20 @@
 namespace ecell4
 {
 
+class Species;
+
+namespace context
+{
+Species format_species(const Species& sp);
+} // context
+
 class Species
 {
 public:
 
     typedef UnitSpecies::serial_type serial_type; //XXX: std::string
     typedef std::vector<UnitSpecies> container_type;
+    typedef boost::uint64_t hash_type;
 
 public:
 
@@ -48,7 +57,29 @@ public:
     Species(const serial_type& name, const Quantity<Real>& radius, const Quantity<Real>& D,
             const std::string location = "", const Integer& dimension = 0);
 
-    const serial_type serial() const;
+    const serial_type& serial() const
+    {
+        return serial_;
+    }
+
+    /**
+     * a 64-bit hash of the serial as it is spelled, which is kept with the
+     * serial. Species are hashed and compared with this first. Two spellings
+     * of the same complex differ here; compare the results of format_species.
+     */
+    hash_type hash() const
+    {
+        return hash_;
+    }
+
+    /**
+     * true if this was returned by format_species and no unit has been
+     * added since. format_species returns such a Species as it is.
+     */
+    bool is_formatted() const
+    {
+        return formatted_;
+    }
 
     void add_unit(const UnitSpecies& usp);
     const std::vector<UnitSpecies> units() const;
@@ -76,8 +107,16 @@ public:
     bool has_attribute(const std::string& key) const;
     void overwrite_attributes(const Species& sp);
 
-    bool operator==(const Species& rhs) const;
-    bool operator!=(const Species& rhs) const;
+    bool operator==(const Species& rhs) const
+    {
+        return (hash_ == rhs.hash_ && serial_ == rhs.serial_);
+    }
+
+    bool operator!=(const Species& rhs) const
+    {
+        return !(*this == rhs);
+    }
+
     bool operator<(const Species& rhs) const;
     bool operator>(const Species& rhs) const;
 
@@ -99,9 +138,17 @@ public:
      */
     serial_type name() const;
 
+protected:
+
+    static hash_type hash_serial(const serial_type& serial);
+
+    friend Species context::format_species(const Species& sp);
+
 protected:
 
     serial_type serial_;
+    hash_type hash_;
+    bool formatted_;
     Attribute attributes_;
 };
 
@@ -123,7 +170,7 @@ struct hash<ecell4::Species>
 {
     std::size_t operator()(const ecell4::Species& val) const
     {
-        return hash<ecell4::Species::serial_type>()(val.serial());
+        return static_cast<std::size_t>(val.hash());
     }
 };
 
@@ -1,3 +1,5 @@
+#include <cmath>
+
 #include "Sphere.hpp"
 #include "collision.hpp"
 
@@ -77,6 +79,30 @@ bool Sphere::test_AABB(const Real3& l, const Real3& u) const
     return collision::test_sphere_AABB(*this, l, u);
 }
 
+void Sphere::bounding_box(
+    const Real3& edge_lengths, Real3& lower, Real3& upper) const
+{
+    const Real3 r(radius_, radius_, radius_);
+    lower = center_ - r;
+    upper = center_ + r;
+}
+
+void Sphere::batch_is_inside(
+    const std::vector<Real3>& positions, std::vector<Real>& retval) const
+{
+    // the same as distance, but written out for the compiler to vectorize.
+    const std::size_t num_positions(positions.size());
+    retval.resize(num_positions);
+    const Real cx(center_[0]), cy(center_[1]), cz(center_[2]);
+    for (std::size_t i(0); i < num_positions; ++i)
+    {
+        const Real dx(positions[i][0] - cx),
+                   dy(positions[i][1] - cy),
+                   dz(positions[i][2] - cz);
+        retval[i] = std::sqrt(dx * dx + dy * dy + dz * dz) - radius_;
+    }
+}
+
 SphericalSurface::SphericalSurface()
     : center_(), radius_()
 {
@@ -136,4 +162,28 @@ bool SphericalSurface::test_AABB(const Real3& l, const Real3& u) const
     return collision::test_shell_AABB(*this, l, u);
 }
 
+void SphericalSurface::bounding_box(
+    const Real3& edge_lengths, Real3& lower, Real3& upper) const
+{
+    const Real3 r(radius_, radius_, radius_);
+    lower = center_ - r;
+    upper = center_ + r;
+}
+
+void SphericalSurface::batch_is_inside(
+    const std::vector<Real3>& positions, std::vector<Real>& retval) const
+{
+    // the same as distance, but written out for the compiler to vectorize.
+    const std::size_t num_positions(positions.size());
+    retval.resize(num_positions);
+    const Real cx(center_[0]), cy(center_[1]), cz(center_[2]);
+    for (std::size_t i(0); i < num_positions; ++i)
+    {
+        const Real dx(positions[i][0] - cx),
+                   dy(positions[i][1] - cy),
+                   dz(positions[i][2] - cz);
+        retval[i] = std::sqrt(dx * dx + dy * dy + dz * dz) - radius_;
+    }
+}
+
 } // ecell4
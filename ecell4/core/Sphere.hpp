@@ -33,6 +33,10 @@ public:
     Real3 draw_position(
         boost::shared_ptr<RandomNumberGenerator>& rng) const;
     bool test_AABB(const Real3& l, const Real3& u) const;
+    void bounding_box(
+        const Real3& edge_lengths, Real3& lower, Real3& upper) const;
+    void batch_is_inside(
+        const std::vector<Real3>& positions, std::vector<Real>& retval) const;
 
     inline const Real3& position() const
     {
@@ -79,6 +83,10 @@ struct SphericalSurface
     Real3 draw_position(
         boost::shared_ptr<RandomNumberGenerator>& rng) const;
     bool test_AABB(const Real3& l, const Real3& u) const;
+    void bounding_box(
+        const Real3& edge_lengths, Real3& lower, Real3& upper) const;
+    void batch_is_inside(
+        const std::vector<Real3>& positions, std::vector<Real>& retval) const;
 
     dimension_kind dimension() const
     {
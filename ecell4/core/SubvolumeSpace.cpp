@@ -91,9 +91,10 @@ SubvolumeSpaceVectorImpl::reserve_pool(
         throw AlreadyExists("Species already exists");
     }
     // matrix_.insert(std::make_pair(sp, std::vector<Integer>(num_subvolumes())));
-    const boost::shared_ptr<PoolBase> pool(new Pool(sp, D, loc, num_subvolumes()));
+    const boost::shared_ptr<PoolBase> pool(create_pool(sp, D, loc));
     matrix_.insert(std::make_pair(sp, pool));
     species_.push_back(sp);
+    pools_.push_back(pool);
     return pool;
 }
 
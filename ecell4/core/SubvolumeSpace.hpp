@@ -9,6 +9,9 @@
 #include "Integer3.hpp"
 #include "Shape.hpp"
 #include <numeric>
+#include <algorithm>
+#include <sstream>
+#include <boost/cstdint.hpp>
 
 #ifdef WITH_HDF5
 #include "SubvolumeSpaceHDF5Writer.hpp"
@@ -25,6 +28,59 @@ public:
 
     typedef Integer coordinate_type;
 
+    /**
+     * the index of a species in species(), i.e. a column of molecule counts.
+     */
+    typedef std::vector<Species>::size_type column_type;
+
+    /**
+     * the numbers of molecules of all species in a subvolume, indexed by
+     * column. A subvolume-major space gives its contiguous row, and
+     * the others read each count through num_molecules_in_column.
+     */
+    class row_type
+    {
+    public:
+
+        row_type(const SubvolumeSpace* space, const coordinate_type& c)
+            : space_(space), c_(c), data64_(NULL), data32_(NULL)
+        {
+            ;
+        }
+
+        explicit row_type(const Integer* data)
+            : space_(NULL), c_(0), data64_(data), data32_(NULL)
+        {
+            ;
+        }
+
+        explicit row_type(const boost::int32_t* data)
+            : space_(NULL), c_(0), data64_(NULL), data32_(data)
+        {
+            ;
+        }
+
+        inline Integer operator[](const column_type& col) const
+        {
+            if (data64_ != NULL)
+            {
+                return data64_[col];
+            }
+            else if (data32_ != NULL)
+            {
+                return data32_[col];
+            }
+            return space_->num_molecules_in_column(col, c_);
+        }
+
+    protected:
+
+        const SubvolumeSpace* space_;
+        coordinate_type c_;
+        const Integer* data64_;
+        const boost::int32_t* data32_;
+    };
+
 public:
 
     class PoolBase
@@ -242,6 +298,39 @@ public:
 
     virtual std::vector<Integer> get_data(const Species& sp) const = 0;
 
+    /**
+     * return the column of the given species, i.e. its index in species().
+     * a column is fixed until the space is reset.
+     */
+    virtual column_type column(const Species& sp) const
+    {
+        const std::vector<Species>& species_list(species());
+        const std::vector<Species>::const_iterator
+            i(std::find(species_list.begin(), species_list.end(), sp));
+        if (i == species_list.end())
+        {
+            std::ostringstream message;
+            message << "Species [" << sp.serial() << "] not found";
+            throw NotFound(message.str());
+        }
+        return static_cast<column_type>(i - species_list.begin());
+    }
+
+    virtual Integer num_molecules_in_column(
+        const column_type& col, const coordinate_type& c) const
+    {
+        return get_pool(species()[col])->num_molecules(c);
+    }
+
+    /**
+     * return the numbers of molecules of all species in the given subvolume.
+     * This is valid until a species is added.
+     */
+    virtual row_type num_molecules_in_row(const coordinate_type& c) const
+    {
+        return row_type(this, c);
+    }
+
 protected:
 
     double t_;
@@ -509,6 +598,12 @@ public:
         return matrix_.find(sp) != matrix_.end();
     }
 
+    Integer num_molecules_in_column(
+        const column_type& col, const coordinate_type& c) const
+    {
+        return pools_[col]->num_molecules(c);
+    }
+
     const std::vector<Species>& species() const
     {
         return species_;
@@ -547,6 +642,7 @@ public:
         base_type::t_ = 0.0;
         matrix_.clear();
         species_.clear();
+        pools_.clear();
 
         for (Real3::size_type dim(0); dim < 3; ++dim)
         {
@@ -574,6 +670,15 @@ public:
 
 protected:
 
+    /**
+     * make a pool for the species at the column species_.size().
+     */
+    virtual boost::shared_ptr<PoolBase> create_pool(
+        const Species& sp, const Real D, const Species::serial_type& loc)
+    {
+        return boost::shared_ptr<PoolBase>(new Pool(sp, D, loc, num_subvolumes()));
+    }
+
     void add_structure3(const Species& sp, const boost::shared_ptr<const Shape>& shape);
     void add_structure2(const Species& sp, const boost::shared_ptr<const Shape>& shape);
     bool is_surface_subvolume(const coordinate_type& c, const boost::shared_ptr<const Shape>& shape);
@@ -584,6 +689,7 @@ protected:
     boost::array<Integer, 3> matrix_sizes_;
     matrix_type matrix_;
     std::vector<Species> species_;
+    std::vector<boost::shared_ptr<PoolBase> > pools_;  // in the order of species_
 
     // structure_container_type structures_;
     structure_matrix_type structure_matrix_;
@@ -0,0 +1,214 @@
+#ifndef ECELL4_SUBVOLUME_SPACE_DENSE_IMPL_HPP
+#define ECELL4_SUBVOLUME_SPACE_DENSE_IMPL_HPP
+
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <boost/cstdint.hpp>
+#include "SubvolumeSpace.hpp"
+
+
+namespace ecell4
+{
+
+/**
+ * a SubvolumeSpace keeping the numbers of molecules in one dense array of
+ * num_subvolumes x num_species, subvolume-major. The counts of all species
+ * in a subvolume are contiguous, and a species is addressed by its column.
+ * Tcount_ is the type of a count, e.g. boost::int32_t to halve the array,
+ * and add_molecules throws NotSupported rather than overflowing it.
+ * The array is laid out again whenever a species is added.
+ */
+template <typename Tcount_>
+class SubvolumeSpaceDenseImpl
+    : public SubvolumeSpaceVectorImpl
+{
+public:
+
+    typedef SubvolumeSpaceVectorImpl base_type;
+    typedef base_type::coordinate_type coordinate_type;
+    typedef base_type::column_type column_type;
+    typedef base_type::row_type row_type;
+    typedef base_type::PoolBase PoolBase;
+    typedef Tcount_ count_type;
+    typedef std::vector<count_type> data_container_type;
+
+public:
+
+    class DensePool
+        : public PoolBase
+    {
+    public:
+
+        typedef PoolBase base_type;
+
+    public:
+
+        DensePool(const Species& sp, const Real D, const Species::serial_type& loc,
+                  SubvolumeSpaceDenseImpl* space, const column_type col)
+            : base_type(sp, D, loc), space_(space), col_(col)
+        {
+            ;
+        }
+
+        coordinate_type size() const
+        {
+            return space_->num_subvolumes();
+        }
+
+        Integer num_molecules() const
+        {
+            Integer retval(0);
+            for (coordinate_type i(0); i < size(); ++i)
+            {
+                retval += space_->at(col_, i);
+            }
+            return retval;
+        }
+
+        Integer num_molecules(const coordinate_type& i) const
+        {
+            return space_->at(col_, i);
+        }
+
+        void add_molecules(const Integer num, const coordinate_type& i)
+        {
+            count_type& count(space_->at(col_, i));
+            if (num > static_cast<Integer>(std::numeric_limits<count_type>::max() - count))
+            {
+                throw NotSupported(
+                    "Too many molecules in a subvolume for the type of a count.");
+            }
+            count += static_cast<count_type>(num);
+        }
+
+        void remove_molecules(const Integer num, const coordinate_type& i)
+        {
+            count_type& count(space_->at(col_, i));
+            if (num > static_cast<Integer>(count))
+            {
+                std::ostringstream message;
+                message << "The number of molecules cannot be negative. ["
+                    << species().serial() << "]";
+                throw std::invalid_argument(message.str());
+            }
+            count -= static_cast<count_type>(num);
+        }
+
+        std::vector<coordinate_type> list_coordinates() const
+        {
+            std::vector<coordinate_type> coords;
+            for (coordinate_type i(0); i < size(); ++i)
+            {
+                const Integer num(space_->at(col_, i));
+                if (num > 0)
+                {
+                    coords.resize(coords.size() + num, i);
+                }
+            }
+            return coords;
+        }
+
+        const std::vector<Integer> get_data() const
+        {
+            std::vector<Integer> data(size());
+            for (coordinate_type i(0); i < size(); ++i)
+            {
+                data[i] = space_->at(col_, i);
+            }
+            return data;
+        }
+
+    protected:
+
+        SubvolumeSpaceDenseImpl* space_;
+        column_type col_;
+    };
+
+public:
+
+    SubvolumeSpaceDenseImpl(
+        const Real3& edge_lengths, const Integer3 matrix_sizes)
+        : base_type(edge_lengths, matrix_sizes), data_(), num_columns_(0)
+    {
+        ;
+    }
+
+    virtual ~SubvolumeSpaceDenseImpl()
+    {
+        ;
+    }
+
+    using base_type::reset;
+
+    void reset(const Real3& edge_lengths, const Integer3& matrix_sizes)
+    {
+        base_type::reset(edge_lengths, matrix_sizes);
+        data_.clear();
+        num_columns_ = 0;
+    }
+
+    Integer num_molecules_in_column(
+        const column_type& col, const coordinate_type& c) const
+    {
+        return at(col, c);
+    }
+
+    /**
+     * return the counts of all species in the given subvolume,
+     * in the order of species().
+     */
+    const count_type* row(const coordinate_type& c) const
+    {
+        return &data_[c * num_columns_];
+    }
+
+    row_type num_molecules_in_row(const coordinate_type& c) const
+    {
+        return (num_columns_ > 0 ? row_type(row(c)) : base_type::num_molecules_in_row(c));
+    }
+
+    inline count_type& at(const column_type& col, const coordinate_type& c)
+    {
+        return data_[c * num_columns_ + col];
+    }
+
+    inline const count_type& at(const column_type& col, const coordinate_type& c) const
+    {
+        return data_[c * num_columns_ + col];
+    }
+
+protected:
+
+    boost::shared_ptr<PoolBase> create_pool(
+        const Species& sp, const Real D, const Species::serial_type& loc)
+    {
+        const column_type col(num_columns_);
+        const coordinate_type n(num_subvolumes());
+
+        data_container_type data(n * (num_columns_ + 1), 0);
+        for (coordinate_type c(0); c < n; ++c)
+        {
+            std::copy(
+                data_.begin() + c * num_columns_,
+                data_.begin() + (c + 1) * num_columns_,
+                data.begin() + c * (num_columns_ + 1));
+        }
+        data_.swap(data);
+        ++num_columns_;
+
+        return boost::shared_ptr<PoolBase>(new DensePool(sp, D, loc, this, col));
+    }
+
+protected:
+
+    data_container_type data_;
+    column_type num_columns_;
+};
+
+typedef SubvolumeSpaceDenseImpl<Integer> SubvolumeSpaceDenseIntegerImpl;
+typedef SubvolumeSpaceDenseImpl<boost::int32_t> SubvolumeSpaceDenseInt32Impl;
+
+} // ecell4
+
+#endif /* ECELL4_SUBVOLUME_SPACE_DENSE_IMPL_HPP */
@@ -0,0 +1,64 @@
+#ifndef ECELL4_PARALLEL_HPP
+#define ECELL4_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+
+namespace ecell4
+{
+
+/**
+ * call fn for each of the items with the given number of threads.
+ * An exception thrown in a thread is rethrown here.
+ */
+template <typename Tfn_>
+void parallel_for_each(
+    const std::size_t num_threads, const std::vector<std::size_t>& items, Tfn_ fn)
+{
+    std::atomic<std::size_t> next(0);
+    std::exception_ptr error;
+    std::atomic<bool> failed(false);
+
+    const auto worker = [&]()
+    {
+        for (std::size_t i(next++); i < items.size(); i = next++)
+        {
+            try
+            {
+                fn(items[i]);
+            }
+            catch (...)
+            {
+                if (!failed.exchange(true))
+                {
+                    error = std::current_exception();
+                }
+                return;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t i(1); i < std::min(num_threads, items.size()); ++i)
+    {
+        threads.push_back(std::thread(worker));
+    }
+    worker();
+    for (std::vector<std::thread>::iterator i(threads.begin()); i != threads.end(); ++i)
+    {
+        (*i).join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+} // ecell4
+
+#endif /* ECELL4_PARALLEL_HPP */
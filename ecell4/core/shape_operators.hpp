@@ -304,9 +304,10 @@ public:
     virtual void bounding_box(
         const Real3& edge_lengths, Real3& lower, Real3& upper) const
     {
-        root_->bounding_box(edge_lengths, lower, upper);
-        map(lower);
-        map(upper);
+        // mapping two corners of the box of the root does not bound a rotated
+        // shape, and the box of the root is clipped in its own frame.
+        lower = Real3(0.0, 0.0, 0.0);
+        upper = edge_lengths;
     }
 
     void translate(const Real3& b)
@@ -66,3 +66,26 @@ BOOST_AUTO_TEST_CASE(CompartmentSpace_test_species)
 {
     CompartmentSpace_test_species_template<CompartmentSpaceVectorImpl>();
 }
+
+BOOST_AUTO_TEST_CASE(CompartmentSpace_test_get_species_id)
+{
+    const Real L(1e-6);
+    const Real3 edge_lengths(L, L, L);
+    CompartmentSpaceVectorImpl target(edge_lengths);
+
+    Species sp1("A"), sp2("B"), sp3("C");
+    target.add_molecules(sp2, 10);
+    target.add_molecules(sp1, 20);
+
+    BOOST_CHECK_EQUAL(target.get_species_id(sp2), 0);
+    BOOST_CHECK_EQUAL(target.get_species_id(sp1), 1);
+    BOOST_CHECK_THROW(target.get_species_id(sp3), NotFound);
+
+    BOOST_CHECK_EQUAL(target.get_species(1), sp1);
+    BOOST_CHECK_EQUAL(target.num_molecules_by_id(0), 10);
+    BOOST_CHECK_EQUAL(target.num_molecules_by_id(1), 20);
+
+    target.remove_molecules(sp1, 20);
+    BOOST_CHECK_EQUAL(target.get_species_id(sp1), 1);
+    BOOST_CHECK_EQUAL(target.num_molecules_by_id(1), 0);
+}
@@ -10,6 +10,7 @@
 #include <boost/test/floating_point_comparison.hpp>
 
 #include <ecell4/core/EventScheduler.hpp>
+#include <ecell4/core/FlatEventScheduler.hpp>
 
 using namespace ecell4;
 
@@ -17,3 +18,145 @@ BOOST_AUTO_TEST_CASE(EventScheduler_test_constructor)
 {
     EventScheduler scheduler;
 }
+
+struct DummyEvent
+    : public Event
+{
+    DummyEvent(Real const& time) : Event(time) {}
+
+    void set_time(Real const& time)
+    {
+        time_ = time;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(FlatEventScheduler_test_add_and_pop)
+{
+    FlatEventScheduler scheduler;
+    BOOST_CHECK_EQUAL(scheduler.next_time(), inf);
+
+    const Real times[] = {5.0, 3.0, 8.0, 1.0, 9.0, 2.0, 7.0};
+    std::vector<FlatEventScheduler::identifier_type> ids;
+    for (std::size_t i(0); i < 7; ++i)
+    {
+        ids.push_back(scheduler.add(
+            boost::shared_ptr<Event>(new DummyEvent(times[i]))));
+    }
+    BOOST_CHECK(scheduler.check());
+    BOOST_CHECK_EQUAL(scheduler.size(), 7);
+    BOOST_CHECK_EQUAL(scheduler.top().first, ids[3]);
+    BOOST_CHECK_EQUAL(scheduler.second().first, ids[5]);
+
+    scheduler.remove(ids[5]);
+    BOOST_CHECK(scheduler.check());
+    BOOST_CHECK_THROW(scheduler.get(ids[5]), std::out_of_range);
+
+    const Real expected[] = {1.0, 3.0, 5.0, 7.0, 8.0, 9.0};
+    for (std::size_t i(0); i < 6; ++i)
+    {
+        const FlatEventScheduler::value_type top(scheduler.pop());
+        BOOST_CHECK_EQUAL(top.second->time(), expected[i]);
+        BOOST_CHECK_EQUAL(scheduler.time(), expected[i]);
+        BOOST_CHECK(scheduler.check());
+    }
+    BOOST_CHECK_EQUAL(scheduler.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(FlatEventScheduler_test_update)
+{
+    FlatEventScheduler scheduler;
+    std::vector<boost::shared_ptr<DummyEvent> > events;
+    std::vector<FlatEventScheduler::identifier_type> ids;
+    for (std::size_t i(0); i < 100; ++i)
+    {
+        events.push_back(boost::shared_ptr<DummyEvent>(
+            new DummyEvent(static_cast<Real>((i * 37) % 101))));
+        ids.push_back(scheduler.add(events.back()));
+    }
+
+    // a single event
+    events[10]->set_time(-1.0);
+    scheduler.update(std::make_pair(ids[10], scheduler.get(ids[10])));
+    BOOST_CHECK(scheduler.check());
+    BOOST_CHECK_EQUAL(scheduler.top().first, ids[10]);
+
+    // a few events sifted one by one
+    std::vector<FlatEventScheduler::value_type> pairs;
+    for (std::size_t i(0); i < 100; i += 20)
+    {
+        events[i]->set_time(200.0 - i);
+        pairs.push_back(std::make_pair(ids[i], scheduler.get(ids[i])));
+    }
+    scheduler.update(pairs.begin(), pairs.end());
+    BOOST_CHECK(scheduler.check());
+
+    // all the events rebuilding the heap
+    for (std::size_t i(0); i < 100; ++i)
+    {
+        events[i]->set_time(static_cast<Real>((i * 53) % 100));
+    }
+    FlatEventScheduler::events_range range(scheduler.events());
+    scheduler.update(range.begin(), range.end());
+    BOOST_CHECK(scheduler.check());
+
+    Real last(-inf);
+    while (scheduler.size() > 0)
+    {
+        const Real t(scheduler.pop().second->time());
+        BOOST_CHECK(last <= t);
+        last = t;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(FlatEventScheduler_test_reuse_slot)
+{
+    FlatEventScheduler scheduler;
+    const FlatEventScheduler::identifier_type id1(
+        scheduler.add(boost::shared_ptr<Event>(new DummyEvent(1.0))));
+    scheduler.remove(id1);
+    const FlatEventScheduler::identifier_type id2(
+        scheduler.add(boost::shared_ptr<Event>(new DummyEvent(2.0))));
+
+    BOOST_CHECK(id1 != id2);
+    BOOST_CHECK_THROW(scheduler.remove(id1), std::out_of_range);
+    BOOST_CHECK_EQUAL(scheduler.get(id2)->time(), 2.0);
+}
+
+BOOST_AUTO_TEST_CASE(FlatEventScheduler_test_calendar_queue)
+{
+    typedef FlatEventSchedulerBase<Event, SelectableEventQueue> scheduler_type;
+    FlatEventScheduler heap;
+    const SelectableEventQueue queue(CALENDAR_QUEUE);
+    scheduler_type calendar(queue);
+    BOOST_CHECK_EQUAL(calendar.queue().type(), CALENDAR_QUEUE);
+
+    // the same events must come out in the same order of times from both queues.
+    std::vector<boost::shared_ptr<DummyEvent> > events;
+    std::vector<FlatEventScheduler::identifier_type> ids;
+    for (std::size_t i(0); i < 200; ++i)
+    {
+        events.push_back(boost::shared_ptr<DummyEvent>(new DummyEvent(
+            i % 17 == 0 ? inf : 0.01 * static_cast<Real>((i * 7919) % 997))));
+        ids.push_back(heap.add(events.back()));
+        BOOST_CHECK_EQUAL(calendar.add(events.back()), ids.back());
+    }
+    BOOST_CHECK(calendar.check());
+
+    for (std::size_t step(0); step < 2000; ++step)
+    {
+        BOOST_CHECK_EQUAL(calendar.top().second->time(), heap.top().second->time());
+        const FlatEventScheduler::identifier_type id(heap.top().first);
+        const boost::shared_ptr<DummyEvent> ev(events[id & 0xffffffffULL]);
+        ev->set_time(ev->time() + 0.001 * static_cast<Real>((step * 104729) % 1009 + 1));
+        heap.update(std::make_pair(id, heap.get(id)));
+        calendar.update(std::make_pair(id, calendar.get(id)));
+    }
+    BOOST_CHECK(calendar.check());
+
+    while (heap.size() > 0)
+    {
+        BOOST_CHECK_EQUAL(calendar.pop().second->time(), heap.pop().second->time());
+    }
+    BOOST_CHECK(calendar.check());
+    BOOST_CHECK_EQUAL(calendar.size(), 0);
+}
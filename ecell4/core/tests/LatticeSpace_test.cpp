@@ -12,6 +12,7 @@
 #include <ecell4/core/MoleculePool.hpp>
 #include <ecell4/core/VacantType.hpp>
 #include <ecell4/core/LatticeSpaceVectorImpl.hpp>
+#include <ecell4/core/LatticeSpaceCompactImpl.hpp>
 #include <ecell4/core/SerialIDGenerator.hpp>
 
 using namespace ecell4;
@@ -334,6 +335,47 @@ BOOST_AUTO_TEST_CASE(LatticeSpace_test_neighbor)
     }
 }
 
+BOOST_AUTO_TEST_CASE(LatticeSpace_test_molecule_pool_sweep)
+{
+    MoleculePool pool(sp, boost::weak_ptr<VoxelPool>());
+    for (Integer coord(0); coord < 6; ++coord)
+    {
+        pool.add_voxel(VoxelPool::coordinate_id_pair_type(sidgen(), coord));
+    }
+
+    std::vector<VoxelSpaceBase::coordinate_type> swept;
+    pool.begin_sweep();
+    while (pool.sweep_size() > 0)
+    {
+        const std::size_t idx(pool.next_in_sweep());
+        const VoxelSpaceBase::coordinate_type coord(pool[idx].coordinate);
+        swept.push_back(coord);
+
+        if (coord == 5)
+        {
+            // remove one not swept yet, and the current one
+            BOOST_CHECK(pool.remove_voxel_if_exists(1));
+            BOOST_CHECK(pool.remove_voxel_if_exists(5));
+            pool.add_voxel(VoxelPool::coordinate_id_pair_type(sidgen(), 6));
+        }
+        else if (coord == 2)
+        {
+            // remove one already swept
+            BOOST_CHECK(pool.remove_voxel_if_exists(3));
+        }
+    }
+    pool.end_sweep();
+
+    BOOST_CHECK_EQUAL(pool.size(), 4);
+    std::sort(swept.begin(), swept.end());
+    BOOST_REQUIRE_EQUAL(swept.size(), 5);
+    BOOST_CHECK_EQUAL(swept[0], 0);
+    BOOST_CHECK_EQUAL(swept[1], 2);
+    BOOST_CHECK_EQUAL(swept[2], 3);
+    BOOST_CHECK_EQUAL(swept[3], 4);
+    BOOST_CHECK_EQUAL(swept[4], 5);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 struct PeriodicFixture
@@ -658,3 +700,158 @@ BOOST_AUTO_TEST_CASE(LatticeSpace_test_save_and_load)
 #endif
 
 BOOST_AUTO_TEST_SUITE_END()
+
+struct CompactFixture
+{
+    const Real3 edge_lengths;
+    const Real voxel_radius;
+    LatticeSpaceCompactImpl space;
+    SerialIDGenerator<ParticleID> sidgen;
+    const Real D, radius;
+    const Species structure, sp, sp_on_structure;
+    CompactFixture() :
+        edge_lengths(2.5e-8, 2.5e-8, 2.5e-8),
+        voxel_radius(2.5e-9),
+        space(edge_lengths, voxel_radius, false),
+        sidgen(), D(1e-12), radius(2.5e-9),
+        structure("Structure", 2.5e-9, 0),
+        sp("A", 2.5e-9, 1e-12),
+        sp_on_structure("B", 2.5e-9, 1e-12, "Structure")
+    {
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(compact_suite, CompactFixture)
+
+BOOST_AUTO_TEST_CASE(LatticeSpaceCompactImpl_test_add_remove_molecule)
+{
+    const VoxelSpaceBase::coordinate_type coord(
+            space.global2coordinate(Integer3(3,4,5)));
+    ParticleID pid(sidgen());
+    BOOST_CHECK(space.update_voxel(
+        pid, ParticleVoxel(sp, coord, radius, D)));
+    BOOST_CHECK_EQUAL(space.num_particles(sp), 1);
+    BOOST_CHECK_EQUAL(space.list_voxels().size(), 1);
+
+    boost::shared_ptr<const VoxelPool> mt(space.get_voxel_pool_at(coord));
+    BOOST_CHECK(!mt->is_vacant());
+    BOOST_CHECK_EQUAL(space.get_voxel_at(coord).first, pid);
+
+    BOOST_CHECK(space.remove_voxel(coord));
+    BOOST_CHECK(space.get_voxel_pool_at(coord)->is_vacant());
+    BOOST_CHECK_EQUAL(space.num_particles(sp), 0);
+}
+
+BOOST_AUTO_TEST_CASE(LatticeSpaceCompactImpl_test_move)
+{
+    const VoxelSpaceBase::coordinate_type
+        coord(space.global2coordinate(Integer3(2,3,4))),
+        to_coord(space.global2coordinate(Integer3(2,4,4)));
+
+    ParticleID pid(sidgen());
+    BOOST_CHECK(space.update_voxel(
+        pid, ParticleVoxel(sp, coord, radius, D)));
+
+    BOOST_CHECK(space.can_move(coord, to_coord));
+    BOOST_CHECK(space.move(coord, to_coord));
+    BOOST_CHECK(space.get_voxel_pool_at(coord)->is_vacant());
+    BOOST_CHECK_EQUAL(space.get_voxel_at(to_coord).first, pid);
+
+    BOOST_CHECK(space.update_voxel(
+        sidgen(), ParticleVoxel(sp, coord, radius, D)));
+    BOOST_CHECK(!space.can_move(coord, to_coord));
+    BOOST_CHECK(!space.move(coord, to_coord));
+    BOOST_CHECK_EQUAL(space.num_particles(sp), 2);
+}
+
+BOOST_AUTO_TEST_CASE(LatticeSpaceCompactImpl_test_structure_move)
+{
+    const Real3 pos1(2.7e-9, 1.3e-8, 2.0e-8);
+    const Real3 pos2(1.2e-8, 1.5e-8, 1.8e-8);
+    BOOST_CHECK(space.update_structure(Particle(structure, pos1, radius, D)));
+    BOOST_CHECK(space.update_structure(Particle(structure, pos2, radius, D)));
+    BOOST_CHECK_EQUAL(space.list_particles(structure).size(), 2);
+
+    const VoxelSpaceBase::coordinate_type
+        coord1(space.position2coordinate(pos1)),
+        coord2(space.position2coordinate(pos2)),
+        vacant_coord(space.global2coordinate(Integer3(3,4,5)));
+
+    ParticleID pid(sidgen());
+    BOOST_CHECK(space.update_voxel(
+        pid, ParticleVoxel(sp_on_structure, coord1, radius, D, structure.serial())));
+    BOOST_CHECK_EQUAL(space.list_particles(structure).size(), 1);
+
+    BOOST_CHECK(!space.can_move(coord1, vacant_coord));
+    BOOST_CHECK(space.move(coord1, coord2));
+    BOOST_CHECK_EQUAL(space.list_particles(sp_on_structure).size(), 1);
+    BOOST_CHECK_EQUAL(space.list_particles(structure).size(), 1);
+    BOOST_CHECK_EQUAL(space.get_voxel_pool_at(coord1)->species(), structure);
+
+    BOOST_CHECK(space.remove_voxel(pid));
+    BOOST_CHECK_EQUAL(space.list_particles(structure).size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(LatticeSpaceCompactImpl_test_release_pool)
+{
+    const std::size_t num_pools(space.num_pools());
+    const VoxelSpaceBase::coordinate_type
+        coord(space.global2coordinate(Integer3(3,4,5)));
+
+    ParticleID pid(sidgen());
+    BOOST_CHECK(space.update_voxel(
+        pid, ParticleVoxel(sp, coord, radius, D)));
+    BOOST_CHECK_EQUAL(space.num_pools(), num_pools + 1);
+
+    BOOST_CHECK(space.remove_voxel(pid));
+    BOOST_CHECK_EQUAL(space.num_pools(), num_pools);
+
+    const Species other("C", 2.5e-9, 1e-12);
+    BOOST_CHECK(space.update_voxel(
+        sidgen(), ParticleVoxel(other, coord, radius, D)));
+    BOOST_CHECK_EQUAL(space.num_pools(), num_pools + 1);
+    BOOST_CHECK_EQUAL(space.get_voxel_pool_at(coord)->species(), other);
+    BOOST_CHECK_EQUAL(space.list_voxels(sp).size(), 0);
+    BOOST_CHECK_EQUAL(space.list_voxels(other).size(), 1);
+
+    BOOST_CHECK(space.update_structure(Particle(structure, Real3(1.2e-8, 1.5e-8, 1.8e-8), radius, D)));
+    const VoxelSpaceBase::coordinate_type
+        structure_coord(space.position2coordinate(Real3(1.2e-8, 1.5e-8, 1.8e-8)));
+    ParticleID pid_on_structure(sidgen());
+    BOOST_CHECK(space.update_voxel(
+        pid_on_structure, ParticleVoxel(sp_on_structure, structure_coord, radius, D, structure.serial())));
+    BOOST_CHECK_EQUAL(space.num_pools(), num_pools + 3);
+
+    // the structure is kept while a molecule is located on it
+    BOOST_CHECK(space.remove_voxel(pid_on_structure));
+    BOOST_CHECK_EQUAL(space.num_pools(), num_pools + 2);
+    BOOST_CHECK(space.remove_voxel(structure_coord));
+    BOOST_CHECK_EQUAL(space.num_pools(), num_pools + 1);
+    BOOST_CHECK_EQUAL(space.list_voxels(structure).size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(LatticeSpaceCompactImpl_test_periodic_neighbor)
+{
+    LatticeSpaceCompactImpl periodic_space(edge_lengths, voxel_radius, true);
+    const VoxelSpaceBase::coordinate_type
+        coord(periodic_space.global2coordinate(Integer3(0,0,0)));
+
+    ParticleID pid(sidgen());
+    BOOST_CHECK(periodic_space.update_voxel(
+        pid, ParticleVoxel(sp, coord, radius, D)));
+
+    for (Integer i(0); i < periodic_space.num_neighbors(coord); ++i)
+    {
+        const VoxelSpaceBase::coordinate_type
+            neighbor(periodic_space.get_neighbor(coord, i));
+        BOOST_CHECK(periodic_space.is_inside(neighbor));
+    }
+
+    const VoxelSpaceBase::coordinate_type
+        neighbor(periodic_space.get_neighbor(coord, 0));
+    BOOST_CHECK(periodic_space.move(coord, neighbor));
+    BOOST_CHECK_EQUAL(periodic_space.num_particles(sp), 1);
+    BOOST_CHECK_EQUAL(periodic_space.get_voxel_at(neighbor).first, pid);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -204,6 +204,47 @@ BOOST_AUTO_TEST_CASE(NetfreeModel_generation2)
     BOOST_CHECK_EQUAL((*nwm).reaction_rules().size(), 13);
 }
 
+BOOST_AUTO_TEST_CASE(NetfreeModel_generation_num_threads)
+{
+    NetfreeModel nfm;
+    nfm.add_reaction_rule(
+        create_synthesis_reaction_rule(Species("X(l,r)"), 1.0));
+    nfm.add_reaction_rule(
+        create_binding_reaction_rule(
+            Species("X(r)"), Species("X(l)"), Species("X(r^1).X(l^1)"), 1.0));
+    nfm.add_reaction_rule(
+        create_unbinding_reaction_rule(
+             Species("X(r^1).X(l^1)"),Species("X(r)"), Species("X(l)"), 1.0));
+
+    std::vector<Species> seeds(0);
+    std::map<Species, Integer> max_stoich;
+    max_stoich[Species("X")] = 6;
+
+    std::vector<extras::NetworkGenerationStats> stats;
+    const std::pair<boost::shared_ptr<NetworkModel>, bool> serial(
+        extras::generate_network_from_netfree_model(nfm, seeds, 10, max_stoich));
+    const std::pair<boost::shared_ptr<NetworkModel>, bool> parallel(
+        extras::generate_network_from_netfree_model(
+            nfm, seeds, 10, max_stoich, 4,
+            [&stats](const extras::NetworkGenerationStats& s) { stats.push_back(s); }));
+
+    // the species and the reactions must come in the same order.
+    BOOST_CHECK(serial.second);
+    BOOST_CHECK(parallel.second);
+    BOOST_CHECK(serial.first->species_attributes() == parallel.first->species_attributes());
+    BOOST_CHECK(serial.first->reaction_rules() == parallel.first->reaction_rules());
+
+    BOOST_CHECK(stats.size() > 0);
+    BOOST_CHECK_EQUAL(stats.back().num_new_species, 0);
+    BOOST_CHECK_EQUAL(stats.back().total_species, serial.first->species_attributes().size());
+    BOOST_CHECK(stats.back().total_reactions >= static_cast<Integer>(serial.first->reaction_rules().size()));
+    for (std::size_t i(0); i < stats.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(stats[i].iteration, i + 1);
+        BOOST_CHECK(stats[i].num_applications >= stats[i].num_seeds);
+    }
+}
+
 // BOOST_AUTO_TEST_CASE(NetfreeModel_query_reaction_rules3)
 // {
 // }
@@ -292,3 +333,89 @@ BOOST_AUTO_TEST_CASE(NetfreeModel_generation3)
         BOOST_CHECK_EQUAL((*i).k(), 1.0);
     }
 }
+
+BOOST_AUTO_TEST_CASE(NetfreeModel_test_cache)
+{
+    NetfreeModel nfm;
+    nfm.add_reaction_rule(
+        create_unimolecular_reaction_rule(Species("A(b)"), Species("B"), 1.0));
+
+    BOOST_CHECK_EQUAL(nfm.apply(Species("A"), Species("A(b=u).A(b=p)")), 2);
+    BOOST_CHECK_EQUAL(nfm.num_cache_misses(), 1);
+    BOOST_CHECK_EQUAL(nfm.num_cache_hits(), 0);
+    BOOST_CHECK_EQUAL(nfm.apply(Species("A"), Species("A(b=u).A(b=p)")), 2);
+    BOOST_CHECK_EQUAL(nfm.num_cache_hits(), 1);
+
+    BOOST_CHECK_EQUAL(nfm.query_reaction_rules(Species("A(b=u)")).size(), 1);
+    BOOST_CHECK_EQUAL(nfm.query_reaction_rules(Species("A(b=u)")).size(), 1);
+    BOOST_CHECK_EQUAL(nfm.num_cache_misses(), 2);
+    BOOST_CHECK_EQUAL(nfm.num_cache_hits(), 2);
+
+    // The cache is invalidated when the model is modified.
+    nfm.add_reaction_rule(
+        create_unimolecular_reaction_rule(Species("A(b=u)"), Species("C"), 1.0));
+    BOOST_CHECK_EQUAL(nfm.query_reaction_rules(Species("A(b=u)")).size(), 2);
+    BOOST_CHECK_EQUAL(nfm.num_cache_misses(), 3);
+
+    nfm.set_max_cache_size(0);
+    BOOST_CHECK_EQUAL(nfm.query_reaction_rules(Species("A(b=u)")).size(), 2);
+    BOOST_CHECK_EQUAL(nfm.query_reaction_rules(Species("A(b=u)")).size(), 2);
+    BOOST_CHECK_EQUAL(nfm.num_cache_misses(), 5);
+}
+
+BOOST_AUTO_TEST_CASE(NetfreeModel_test_cache_with_attributes)
+{
+    NetfreeModel cached, uncached;
+    uncached.set_max_cache_size(0);
+    const ReactionRule rr1(
+        create_unimolecular_reaction_rule(Species("A(b)"), Species("B"), 1.0));
+    const ReactionRule rr2(
+        create_binding_reaction_rule(Species("A(b)"), Species("C"), Species("D"), 2.0));
+    cached.add_reaction_rule(rr1);
+    cached.add_reaction_rule(rr2);
+    uncached.add_reaction_rule(rr1);
+    uncached.add_reaction_rule(rr2);
+
+    Species sp1("A(b=u)"), sp2("A(b=u)"), sp3("C");
+    sp2.set_attribute("radius", 0.005);
+    sp2.set_attribute("D", "1");
+
+    // The first query fills the cache with sp1.
+    cached.query_reaction_rules(sp1);
+    cached.query_reaction_rules(sp1, sp3);
+
+    const std::vector<ReactionRule> retval1(cached.query_reaction_rules(sp2));
+    const std::vector<ReactionRule> expected1(uncached.query_reaction_rules(sp2));
+    BOOST_CHECK_EQUAL(cached.num_cache_hits(), 1);
+    BOOST_CHECK_EQUAL(retval1.size(), 1);
+    BOOST_CHECK_EQUAL(retval1.size(), expected1.size());
+    for (std::size_t i(0); i < retval1.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(retval1[i].as_string(), expected1[i].as_string());
+        BOOST_CHECK(retval1[i].reactants()[0].attributes().values()
+                    == expected1[i].reactants()[0].attributes().values());
+    }
+
+    const std::vector<ReactionRule> retval2(cached.query_reaction_rules(sp3, sp2));
+    const std::vector<ReactionRule> expected2(uncached.query_reaction_rules(sp3, sp2));
+    const std::vector<ReactionRule> retval3(cached.query_reaction_rules(sp2, sp3));
+    const std::vector<ReactionRule> expected3(uncached.query_reaction_rules(sp2, sp3));
+    BOOST_CHECK_EQUAL(cached.num_cache_hits(), 2);
+    BOOST_CHECK_EQUAL(retval2.size(), 1);
+    BOOST_CHECK_EQUAL(retval2.size(), expected2.size());
+    BOOST_CHECK_EQUAL(retval3.size(), expected3.size());
+    for (std::size_t i(0); i < retval2.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(retval2[i].as_string(), expected2[i].as_string());
+        BOOST_CHECK_EQUAL(retval2[i].k(), expected2[i].k());
+    }
+    for (std::size_t i(0); i < retval3.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(retval3[i].as_string(), expected3[i].as_string());
+        for (std::size_t j(0); j < 2; ++j)
+        {
+            BOOST_CHECK(retval3[i].reactants()[j].attributes().values()
+                        == expected3[i].reactants()[j].attributes().values());
+        }
+    }
+}
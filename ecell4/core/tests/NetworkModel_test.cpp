@@ -139,3 +139,45 @@ BOOST_AUTO_TEST_CASE(NetworkModel_test_query_reaction_rules2)
     BOOST_CHECK_EQUAL(model.query_reaction_rules(sp1, sp2).size(), 1);
     BOOST_CHECK_EQUAL(model.query_reaction_rules(sp2, sp1).size(), 1);
 }
+
+BOOST_AUTO_TEST_CASE(NetworkModel_test_query_reaction_rules_view)
+{
+    Species sp1("A"), sp2("B"), sp3("C");
+
+    ReactionRule rr1, rr2, rr3, rr4;
+    rr1.add_reactant(sp1);
+    rr1.add_reactant(sp2);
+    rr1.add_product(sp3);
+    rr2.add_reactant(sp3);
+    rr2.add_product(sp1);
+    rr3.add_reactant(sp1);
+    rr3.add_product(sp2);
+    rr4.add_reactant(sp1);
+    rr4.add_product(sp3);
+
+    NetworkModel model;
+    model.add_reaction_rule(rr1);
+    model.add_reaction_rule(rr2);
+    model.add_reaction_rule(rr3);
+    model.add_reaction_rule(rr4);
+
+    const Model& base(model);
+    BOOST_CHECK_EQUAL(base.query_reaction_rules_view(sp1).size(), 2);
+    BOOST_CHECK(base.query_reaction_rules_view(sp1)[0] == rr3);
+    BOOST_CHECK(base.query_reaction_rules_view(sp2).empty());
+    BOOST_CHECK_EQUAL(base.query_reaction_rules_view(sp2, sp1).size(), 1);
+    BOOST_CHECK(*(base.query_reaction_rules_view(sp2, sp1).begin()) == rr1);
+    BOOST_CHECK(base.query_reaction_rules_view(sp1, sp1).empty());
+
+    // the rules are not copied.
+    BOOST_CHECK_EQUAL(
+        &(base.query_reaction_rules_view(sp1, sp2)[0]), &(model.reaction_rules()[0]));
+
+    // the last rule is moved into the place of a removed one.
+    model.remove_reaction_rule(rr1);
+    BOOST_CHECK(model.query_reaction_rules_view(sp1, sp2).empty());
+    BOOST_CHECK_EQUAL(model.query_reaction_rules_view(sp1).size(), 2);
+    BOOST_CHECK_EQUAL(model.query_reaction_rules(sp1).size(), 2);
+    BOOST_CHECK_EQUAL(model.query_reaction_rules_view(sp3).size(), 1);
+    BOOST_CHECK(model.query_reaction_rules_view(sp3)[0] == rr2);
+}
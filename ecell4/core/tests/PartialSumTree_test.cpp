@@ -0,0 +1,57 @@
+#define BOOST_TEST_MODULE "PartialSumTree_test"
+
+#ifdef UNITTEST_FRAMEWORK_LIBRARY_EXIST
+#   include <boost/test/unit_test.hpp>
+#else
+#   define BOOST_TEST_NO_LIB
+#   include <boost/test/included/unit_test.hpp>
+#endif
+
+#include <boost/test/floating_point_comparison.hpp>
+
+#include <ecell4/core/PartialSumTree.hpp>
+
+using namespace ecell4;
+
+BOOST_AUTO_TEST_CASE(PartialSumTree_test_constructor)
+{
+    PartialSumTree<Real> tree(5);
+    BOOST_CHECK_EQUAL(tree.size(), 5);
+    BOOST_CHECK_EQUAL(tree.total(), 0.0);
+}
+
+BOOST_AUTO_TEST_CASE(PartialSumTree_test_set)
+{
+    PartialSumTree<Real> tree(5);
+    tree.set(0, 1.0);
+    tree.set(3, 2.5);
+    tree.set(4, 0.5);
+    BOOST_CHECK_CLOSE(tree.total(), 4.0, 1e-12);
+
+    tree.set(3, 0.0);
+    BOOST_CHECK_CLOSE(tree.total(), 1.5, 1e-12);
+    BOOST_CHECK_EQUAL(tree.get(4), 0.5);
+
+    BOOST_CHECK_THROW(tree.set(5, 1.0), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(PartialSumTree_test_find)
+{
+    std::vector<Real> weights(6, 0.0);
+    weights[1] = 1.0;
+    weights[2] = 2.0;
+    weights[4] = 3.0;
+
+    PartialSumTree<Real> tree;
+    tree.assign(weights);
+    BOOST_CHECK_CLOSE(tree.total(), 6.0, 1e-12);
+
+    BOOST_CHECK_EQUAL(tree.find(0.0), 1);
+    BOOST_CHECK_EQUAL(tree.find(0.5), 1);
+    BOOST_CHECK_EQUAL(tree.find(1.0), 1);
+    BOOST_CHECK_EQUAL(tree.find(1.5), 2);
+    BOOST_CHECK_EQUAL(tree.find(3.0), 2);
+    BOOST_CHECK_EQUAL(tree.find(3.5), 4);
+    BOOST_CHECK_EQUAL(tree.find(6.0), 4);
+    BOOST_CHECK_EQUAL(tree.find(7.0), 4);
+}
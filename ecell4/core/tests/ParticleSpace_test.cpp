@@ -10,7 +10,9 @@
 #include <boost/test/floating_point_comparison.hpp>
 
 #include <ecell4/core/ParticleSpaceCellListImpl.hpp>
+#include <ecell4/core/ParticleSpaceSoAImpl.hpp>
 #include <ecell4/core/SerialIDGenerator.hpp>
+#include <ecell4/core/RandomNumberGenerator.hpp>
 
 using namespace ecell4;
 
@@ -148,3 +150,102 @@ BOOST_AUTO_TEST_CASE(ParticleSpaceCellListImpl_test_constructor)
 }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+struct SoAFixture
+{
+    const Real3 edge_lengths;
+    const Integer3 matrix_sizes;
+    const Real radius;
+
+    SoAFixture() :
+        edge_lengths(1, 1, 1),
+        matrix_sizes(5, 5, 5),
+        radius(0.005)
+    {}
+};
+
+BOOST_FIXTURE_TEST_SUITE(soa_suite, SoAFixture)
+
+BOOST_AUTO_TEST_CASE(ParticleSpaceSoAImpl_test_update_remove)
+{
+    ParticleSpaceSoAImpl space(edge_lengths, matrix_sizes);
+    SerialIDGenerator<ParticleID> pidgen;
+
+    const ParticleID pid1 = pidgen();
+    const ParticleID pid2 = pidgen();
+    const Species sp1 = Species("A");
+    const Species sp2 = Species("B");
+
+    BOOST_CHECK(space.update_particle(pid1, Particle(sp1, edge_lengths * 0.5, radius, 0)));
+    BOOST_CHECK(space.update_particle(pid2, Particle(sp1, edge_lengths * 0.25, radius, 0)));
+    BOOST_CHECK_EQUAL(space.num_particles(sp1), 2);
+    BOOST_CHECK_EQUAL(space.list_species().size(), 1);
+
+    BOOST_CHECK(!space.update_particle(pid1, Particle(sp2, edge_lengths * 0.1, radius, 0)));
+    BOOST_CHECK_EQUAL(space.num_particles(sp1), 1);
+    BOOST_CHECK_EQUAL(space.num_particles(sp2), 1);
+    BOOST_CHECK_EQUAL(space.get_particle(pid1).second.species(), sp2);
+    BOOST_CHECK_EQUAL(space.get_particle(pid1).second.position(), edge_lengths * 0.1);
+
+    space.remove_particle(pid1);
+    BOOST_CHECK_EQUAL(space.num_particles(), 1);
+    BOOST_CHECK_EQUAL(space.num_particles(sp2), 0);
+    BOOST_CHECK_EQUAL(space.get_particle(pid2).second.position(), edge_lengths * 0.25);
+    BOOST_CHECK_THROW(space.remove_particle(pid1), NotFound);
+}
+
+BOOST_AUTO_TEST_CASE(ParticleSpaceSoAImpl_test_same_neighbors)
+{
+    ParticleSpaceCellListImpl reference(edge_lengths, matrix_sizes);
+    ParticleSpaceSoAImpl space(edge_lengths, matrix_sizes);
+    SerialIDGenerator<ParticleID> pidgen;
+    GSLRandomNumberGenerator rng;
+    rng.seed(0);
+
+    const Species sp1 = Species("A");
+    std::vector<ParticleID> pids;
+    for (Integer i(0); i < 300; ++i)
+    {
+        const ParticleID pid(pidgen());
+        const Particle p(sp1, Real3(rng.uniform(0, 1), rng.uniform(0, 1), rng.uniform(0, 1)), radius, 0);
+        reference.update_particle(pid, p);
+        space.update_particle(pid, p);
+        pids.push_back(pid);
+    }
+    for (Integer i(0); i < 100; ++i)
+    {
+        const Particle p(sp1, Real3(rng.uniform(0, 1), rng.uniform(0, 1), rng.uniform(0, 1)), radius, 0);
+        reference.update_particle(pids[i], p);
+        space.update_particle(pids[i], p);
+    }
+    for (Integer i(100); i < 150; ++i)
+    {
+        reference.remove_particle(pids[i]);
+        space.remove_particle(pids[i]);
+    }
+    space.sort_by_cell();
+
+    for (Integer i(0); i < 50; ++i)
+    {
+        // near the corner to see the periodic images.
+        const Real3 pos(rng.uniform(-0.1, 0.1) + (i % 2), rng.uniform(0, 1), rng.uniform(0, 0.1));
+        const Real3 center(space.apply_boundary(pos));
+        const std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
+            expected(reference.list_particles_within_radius(center, 0.15)),
+            retval(space.list_particles_within_radius(center, 0.15));
+        BOOST_REQUIRE_EQUAL(retval.size(), expected.size());
+        for (std::size_t j(0); j < retval.size(); ++j)
+        {
+            BOOST_CHECK_EQUAL(retval[j].first.first, expected[j].first.first);
+            BOOST_CHECK_CLOSE(retval[j].second, expected[j].second, 1e-6);
+        }
+    }
+
+    for (ParticleSpaceSoAImpl::index_type i(0); i < space.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(space.index(space.pid_at(i)), i);
+        BOOST_CHECK_EQUAL(space.position_at(i), reference.get_particle(space.pid_at(i)).second.position());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,49 +1,119 @@
-#include <cppunit/TestCase.h>
-#include <cppunit/extensions/HelperMacros.h>
-#include <cppunit/ui/text/TestRunner.h>
+#define BOOST_TEST_MODULE "RandomNumberGenerator_test"
+
+#ifdef UNITTEST_FRAMEWORK_LIBRARY_EXIST
+#   include <boost/test/unit_test.hpp>
+#else
+#   define BOOST_TEST_NO_LIB
+#   include <boost/test/included/unit_test.hpp>
+#endif
+
+#include <cmath>
+#include <vector>
 
 #include <ecell4/core/RandomNumberGenerator.hpp>
 
 using namespace ecell4;
 
 
-template<typename Timpl_>
-class RandomNumberGeneratorTest
-    : public CppUnit::TestFixture
+BOOST_AUTO_TEST_CASE(RandomNumberGenerator_test_seed)
 {
-public:
-
-    typedef Timpl_ implementation_type;
-
-    CPPUNIT_TEST_SUITE(RandomNumberGeneratorTest);
-    CPPUNIT_TEST(test_seed);
-    CPPUNIT_TEST_SUITE_END();
-
-public:
+    GSLRandomNumberGenerator rng1(0), rng2;
+    rng2.seed(0);
+    for (Integer i(0); i < 10; ++i)
+    {
+        BOOST_CHECK_EQUAL(rng1.random(), rng2.random());
+    }
+}
 
-    void setUp()
+BOOST_AUTO_TEST_CASE(RandomNumberGenerator_test_fill_uniform)
+{
+    GSLRandomNumberGenerator rng1(1), rng2(1);
+    std::vector<Real> values(11);
+    rng1.fill_uniform(values.data(), values.data() + values.size());
+    for (std::vector<Real>::const_iterator i(values.begin()); i != values.end(); ++i)
     {
-        target = new implementation_type();
+        BOOST_CHECK_EQUAL(*i, rng2.random());
     }
+}
 
-    void tearDown()
+BOOST_AUTO_TEST_CASE(PhiloxRandomNumberGenerator_test_fill_uniform)
+{
+    // the blocks filled at once must give the same sequence as the scalar calls.
+    PhiloxRandomNumberGenerator rng1(1), rng2(1);
+    std::vector<Real> values(3 + 16 + 2);
+    rng1.fill_uniform(values.data(), values.data() + 3);
+    rng1.fill_uniform(values.data() + 3, values.data() + values.size());
+    for (std::vector<Real>::const_iterator i(values.begin()); i != values.end(); ++i)
     {
-        delete target;
+        BOOST_CHECK(0.0 <= *i && *i < 1.0);
+        BOOST_CHECK_EQUAL(*i, rng2.random());
     }
+    BOOST_CHECK_EQUAL(rng1.random(), rng2.random());
+}
 
-    void test_seed();
+BOOST_AUTO_TEST_CASE(PhiloxRandomNumberGenerator_test_stream)
+{
+    PhiloxRandomNumberGenerator rng1(1, 0), rng2(1, 1), rng3(1, 0);
+    BOOST_CHECK_EQUAL(rng2.stream(), 1);
 
-private:
+    const Real x1(rng1.random()), x2(rng2.random());
+    BOOST_CHECK(x1 != x2);
 
-    RandomNumberGenerator *target;
-};
+    rng2.set_stream(0);
+    BOOST_CHECK_EQUAL(rng2.random(), x1);
+    BOOST_CHECK_EQUAL(rng3.random(), x1);
 
-CPPUNIT_TEST_SUITE_REGISTRATION(
-    RandomNumberGeneratorTest<GSLRandomNumberGenerator>);
+    rng3.seed(1);
+    BOOST_CHECK_EQUAL(rng3.stream(), 0);
+    BOOST_CHECK_EQUAL(rng3.random(), x1);
+}
 
-template<typename Timpl_>
-void RandomNumberGeneratorTest<Timpl_>::test_seed()
+BOOST_AUTO_TEST_CASE(PhiloxRandomNumberGenerator_test_fill_gaussian)
 {
-    target->seed(0);
-    // CPPUNIT_ASSERT_EQUAL(1, 2);
+    PhiloxRandomNumberGenerator rng(2);
+    const Real sigma(3.0);
+    std::vector<Real> values(100001);
+    rng.fill_gaussian(values.data(), values.data() + values.size(), sigma);
+
+    Real mean(0.0), var(0.0);
+    for (std::vector<Real>::const_iterator i(values.begin()); i != values.end(); ++i)
+    {
+        mean += *i;
+        var += (*i) * (*i);
+    }
+    mean /= values.size();
+    var = var / values.size() - mean * mean;
+    BOOST_CHECK(std::abs(mean) < 0.05);
+    BOOST_CHECK_CLOSE(var, sigma * sigma, 2.0);
+}
+
+BOOST_AUTO_TEST_CASE(PhiloxRandomNumberGenerator_test_fill_direction3d)
+{
+    PhiloxRandomNumberGenerator rng(3);
+    std::vector<Real3> values(1000);
+    rng.fill_direction3d(values.data(), values.data() + values.size(), 2.0);
+
+    Real3 sum(0.0, 0.0, 0.0);
+    for (std::vector<Real3>::const_iterator i(values.begin()); i != values.end(); ++i)
+    {
+        BOOST_CHECK_CLOSE(length(*i), 2.0, 1e-10);
+        sum += *i;
+    }
+    BOOST_CHECK(length(sum) / values.size() < 0.2);
+}
+
+#ifdef WITH_HDF5
+BOOST_AUTO_TEST_CASE(PhiloxRandomNumberGenerator_test_save_and_load)
+{
+    PhiloxRandomNumberGenerator rng1(4, 5);
+    rng1.random();
+    rng1.save("PhiloxRandomNumberGenerator_test.h5");
+
+    PhiloxRandomNumberGenerator rng2("PhiloxRandomNumberGenerator_test.h5");
+    BOOST_CHECK_EQUAL(rng2.stream(), 5);
+    for (Integer i(0); i < 10; ++i)
+    {
+        BOOST_CHECK_EQUAL(rng1.random(), rng2.random());
+    }
 }
+#endif
@@ -32,6 +32,65 @@ BOOST_AUTO_TEST_CASE(Species_test_name)
     // BOOST_CHECK_EQUAL(sp2.serial(), "test");
 }
 
+BOOST_AUTO_TEST_CASE(Species_test_hash)
+{
+    Species sp1("A(a^1).B(b^1)"), sp2, sp3("A(a^1)");
+    BOOST_CHECK(sp1 != sp2);
+    BOOST_CHECK(sp1.hash() != sp2.hash());
+
+    sp2 = sp1;
+    BOOST_CHECK(sp1 == sp2);
+    BOOST_CHECK_EQUAL(sp1.hash(), sp2.hash());
+
+    // the hash follows the serial.
+    UnitSpecies usp("B");
+    usp.add_site("b", "", "1");
+    sp3.add_unit(usp);
+    BOOST_CHECK_EQUAL(sp3.serial(), sp1.serial());
+    BOOST_CHECK(sp1 == sp3);
+    BOOST_CHECK_EQUAL(sp1.hash(), sp3.hash());
+    BOOST_CHECK_EQUAL(Species(sp1.serial(), 1.0, 1.0).hash(), sp1.hash());
+
+    BOOST_CHECK_EQUAL(format_species(Species("A_1", 1.0, 1.0)).serial(), "A_1");
+    BOOST_CHECK(format_species(Species("A_1")) == Species("A_1"));
+
+    // the result of format_species is marked as formatted.
+    const Species sp4("X(a^3,b^1).X(a^1,b^3)");
+    BOOST_CHECK(!sp4.is_formatted());
+    const Species sp5(format_species(sp4));
+    BOOST_CHECK(sp5.is_formatted());
+    BOOST_CHECK_EQUAL(format_species(sp5).serial(), sp5.serial());
+    Species sp6(sp5);
+    BOOST_CHECK(sp6.is_formatted());
+    sp6.add_unit(UnitSpecies("Y"));
+    BOOST_CHECK(!sp6.is_formatted());
+}
+
+BOOST_AUTO_TEST_CASE(Species_test_format_species)
+{
+    // two spellings of the same complex
+    const Species sp1("A(b^1).B(a^1,c^2).C(b^2)"), sp2("C(b^3).B(c^3,a^4).A(b^4)");
+    BOOST_CHECK(sp1 != sp2);
+
+    const Species sp3(format_species(sp1)), sp4(format_species(sp2));
+    BOOST_CHECK_EQUAL(sp3.serial(), sp4.serial());
+    BOOST_CHECK(sp3 == sp4);
+    BOOST_CHECK_EQUAL(sp3.hash(), sp4.hash());
+
+    // format_species is idempotent, with or without the mark.
+    BOOST_CHECK_EQUAL(format_species(sp3).serial(), sp3.serial());
+    BOOST_CHECK_EQUAL(format_species(Species(sp3.serial())).serial(), sp3.serial());
+
+    // the mark does not survive add_unit, and the result is formatted again.
+    Species sp5(sp3), sp6(sp4);
+    sp5.add_unit(UnitSpecies("D"));
+    sp6.add_unit(UnitSpecies("D"));
+    BOOST_CHECK(!sp5.is_formatted());
+    BOOST_CHECK_EQUAL(format_species(sp5).serial(), format_species(sp6).serial());
+    BOOST_CHECK_EQUAL(
+        format_species(format_species(sp5)).serial(), format_species(sp5).serial());
+}
+
 BOOST_AUTO_TEST_CASE(Species_test_attributes)
 {
     Species sp("test");
@@ -11,6 +11,7 @@
 
 #include <ecell4/core/types.hpp>
 #include <ecell4/core/SubvolumeSpace.hpp>
+#include <ecell4/core/SubvolumeSpaceDenseImpl.hpp>
 
 using namespace ecell4;
 
@@ -37,6 +38,7 @@ void SubvolumeSpace_test_volume_template()
 BOOST_AUTO_TEST_CASE(SubvolumeSpace_test_volume)
 {
     SubvolumeSpace_test_volume_template<SubvolumeSpaceVectorImpl>();
+    SubvolumeSpace_test_volume_template<SubvolumeSpaceDenseIntegerImpl>();
 }
 
 template<typename Timpl_>
@@ -69,4 +71,86 @@ void SubvolumeSpace_test_num_molecules_template()
 BOOST_AUTO_TEST_CASE(SubvolumeSpace_test_num_molecules)
 {
     SubvolumeSpace_test_num_molecules_template<SubvolumeSpaceVectorImpl>();
+    SubvolumeSpace_test_num_molecules_template<SubvolumeSpaceDenseIntegerImpl>();
+    SubvolumeSpace_test_num_molecules_template<SubvolumeSpaceDenseInt32Impl>();
+}
+
+template<typename Timpl_>
+void SubvolumeSpace_test_num_molecules_in_row_template()
+{
+    const Real L(1e-6);
+    const Real3 edge_lengths(L, L, L);
+    const Integer3 matrix_sizes(2, 3, 4);
+    Timpl_ target(edge_lengths, matrix_sizes);
+
+    const Species sp1("A"), sp2("B");
+    target.reserve_pool(sp1, 0.0, "");
+    target.reserve_pool(sp2, 0.0, "");
+    target.add_molecules(sp1, 10, 5);
+    target.add_molecules(sp2, 20, 5);
+    target.add_molecules(sp2, 30, 23);
+
+    const SubvolumeSpace::row_type row5(target.num_molecules_in_row(5));
+    BOOST_CHECK_EQUAL(row5[0], 10);
+    BOOST_CHECK_EQUAL(row5[1], 20);
+    const SubvolumeSpace::row_type row23(target.num_molecules_in_row(23));
+    BOOST_CHECK_EQUAL(row23[0], 0);
+    BOOST_CHECK_EQUAL(row23[1], 30);
+}
+
+BOOST_AUTO_TEST_CASE(SubvolumeSpace_test_num_molecules_in_row)
+{
+    SubvolumeSpace_test_num_molecules_in_row_template<SubvolumeSpaceVectorImpl>();
+    SubvolumeSpace_test_num_molecules_in_row_template<SubvolumeSpaceDenseIntegerImpl>();
+    SubvolumeSpace_test_num_molecules_in_row_template<SubvolumeSpaceDenseInt32Impl>();
+}
+
+BOOST_AUTO_TEST_CASE(SubvolumeSpace_test_dense_columns)
+{
+    const Real L(1e-6);
+    const Real3 edge_lengths(L, L, L);
+    const Integer3 matrix_sizes(2, 3, 4);
+    SubvolumeSpaceDenseInt32Impl target(edge_lengths, matrix_sizes);
+
+    const Species sp1("A"), sp2("B"), sp3("C");
+    target.reserve_pool(sp1, 0.0, "");
+    target.add_molecules(sp1, 10, 5);
+    target.reserve_pool(sp2, 0.0, "");
+    target.add_molecules(sp2, 20, 5);
+    target.add_molecules(sp1, 30, 23);
+
+    // the counts are kept as a species is added.
+    target.reserve_pool(sp3, 0.0, "");
+    target.add_molecules(sp3, 40, 5);
+
+    BOOST_CHECK_EQUAL(target.column(sp1), 0);
+    BOOST_CHECK_EQUAL(target.column(sp3), 2);
+    BOOST_CHECK_THROW(target.column(Species("D")), NotFound);
+
+    const boost::int32_t* row(target.row(5));
+    BOOST_CHECK_EQUAL(row[0], 10);
+    BOOST_CHECK_EQUAL(row[1], 20);
+    BOOST_CHECK_EQUAL(row[2], 40);
+    BOOST_CHECK_EQUAL(target.num_molecules_in_column(0, 23), 30);
+    BOOST_CHECK_EQUAL(target.num_molecules_exact(sp1), 40);
+    BOOST_CHECK_EQUAL(target.get_pool(sp1)->get_data()[23], 30);
+    BOOST_CHECK_EQUAL(target.list_coordinates_exact(sp2).size(), 20);
+
+    // a count never exceeds the range of 32 bits.
+    BOOST_CHECK_THROW(target.add_molecules(sp1, 2147483647, 5), NotSupported);
+    BOOST_CHECK_EQUAL(target.num_molecules_exact(sp1, 5), 10);
+    target.add_molecules(sp1, 2147483637, 5);
+    BOOST_CHECK_EQUAL(target.num_molecules_exact(sp1, 5), 2147483647);
+
+    // nor becomes negative.
+    BOOST_CHECK_THROW(target.get_pool(sp2)->remove_molecules(21, 5), std::invalid_argument);
+    BOOST_CHECK_THROW(target.remove_molecules(sp2, 21, 5), std::invalid_argument);
+    BOOST_CHECK_EQUAL(target.num_molecules_exact(sp2, 5), 20);
+    target.get_pool(sp2)->remove_molecules(20, 5);
+    BOOST_CHECK_EQUAL(target.num_molecules_exact(sp2, 5), 0);
+
+    target.reset(edge_lengths);
+    BOOST_CHECK_EQUAL(target.species().size(), 0);
+    target.reserve_pool(sp2, 0.0, "");
+    BOOST_CHECK_EQUAL(target.num_molecules_in_column(0, 5), 0);
 }
@@ -56,13 +56,13 @@ public:
             i(first_order_cache_.find(r1));
         if (i == this->first_order_cache_.end())
         {
-            ecell4::Model::reaction_rule_container_type
+            const ecell4::ReactionRuleView
                 reaction_rules_at_ecell4(
-                    model_->query_reaction_rules(ecell4::Species(r1)));
+                    model_->query_reaction_rules_view(ecell4::Species(r1)));
 
             std::pair<typename first_order_reaction_rule_vector_map::iterator, bool>
                 x(first_order_cache_.insert(std::make_pair(r1, reaction_rule_vector())));
-            for (std::vector<ecell4::ReactionRule>::const_iterator
+            for (ecell4::ReactionRuleView::const_iterator
                 it(reaction_rules_at_ecell4.begin());
                 it != reaction_rules_at_ecell4.end(); it++)
             {
@@ -27,8 +27,8 @@ public:
 
 public:
 
-    GillespieFactory()
-        : base_type(), rng_()
+    GillespieFactory(const GillespieSolverType solver_type = default_solver_type())
+        : base_type(), rng_(), solver_type_(solver_type)
     {
         ; // do nothing
     }
@@ -38,6 +38,11 @@ public:
         ; // do nothing
     }
 
+    static inline const GillespieSolverType default_solver_type()
+    {
+        return DIRECT_METHOD;
+    }
+
     this_type& rng(const boost::shared_ptr<RandomNumberGenerator>& rng)
     {
         rng_ = rng;
@@ -49,6 +54,14 @@ public:
         return &(this->rng(rng));  //XXX: == this
     }
 
+    /**
+     * create a world with the time and the numbers of molecules of the given one.
+     */
+    world_type* copy_world(const world_type& w) const
+    {
+        return copy_compartment_world(w);
+    }
+
 protected:
 
     virtual world_type* create_world(const Real3& edge_lengths) const
@@ -63,9 +76,16 @@ protected:
         }
     }
 
+    virtual simulator_type* create_simulator(
+        const boost::shared_ptr<world_type>& w, const boost::shared_ptr<Model>& m) const
+    {
+        return new simulator_type(w, m, solver_type_);
+    }
+
 protected:
 
     boost::shared_ptr<RandomNumberGenerator> rng_;
+    GillespieSolverType solver_type_;
 };
 
 } // gillespie
@@ -21,10 +21,15 @@ void GillespieSimulator::increment_molecules(const Species& sp)
 {
     world_->add_molecules(sp, 1);
 
-    for (boost::ptr_vector<ReactionRuleEvent>::iterator i(events_.begin());
-        i != events_.end(); ++i)
+    const dependency_container_type& deps(dependencies(world_->get_species_id(sp)));
+    for (dependency_container_type::const_iterator i(deps.begin());
+        i != deps.end(); ++i)
     {
-        (*i).inc(sp);
+        events_[(*i).first].inc((*i).second, +1);
+        if (solver_type_ == PARTIAL_SUM_TREE)
+        {
+            propensities_.set((*i).first, events_[(*i).first].propensity());
+        }
     }
 }
 
@@ -33,14 +38,49 @@ void GillespieSimulator::decrement_molecules(const Species& sp)
 {
     world_->remove_molecules(sp, 1);
 
-    for (boost::ptr_vector<ReactionRuleEvent>::iterator i(events_.begin());
-        i != events_.end(); ++i)
+    const dependency_container_type& deps(dependencies(world_->get_species_id(sp)));
+    for (dependency_container_type::const_iterator i(deps.begin());
+        i != deps.end(); ++i)
     {
-        (*i).dec(sp);
+        events_[(*i).first].inc((*i).second, -1);
+        if (solver_type_ == PARTIAL_SUM_TREE)
+        {
+            propensities_.set((*i).first, events_[(*i).first].propensity());
+        }
     }
 }
 
-bool GillespieSimulator::__draw_next_reaction(void)
+const GillespieSimulator::dependency_container_type&
+    GillespieSimulator::dependencies(const species_id_type& id)
+{
+    // Species IDs are dense and given in the order of appearance.
+    // Pattern matching is only done here, once for each new species.
+    while (dependencies_.size() <= id)
+    {
+        const species_id_type newid(dependencies_.size());
+        const Species& sp(world_->get_species(newid));
+
+        dependency_container_type deps;
+        for (std::size_t i(0); i < events_.size(); ++i)
+        {
+            const coefficient_container_type coefs(events_[i].get_coefs(sp));
+            for (coefficient_container_type::const_iterator j(coefs.begin());
+                j != coefs.end(); ++j)
+            {
+                if ((*j) > 0)
+                {
+                    deps.push_back(std::make_pair(i, coefs));
+                    events_[i].add_candidate(newid, coefs);
+                    break;
+                }
+            }
+        }
+        dependencies_.push_back(deps);
+    }
+    return dependencies_[id];
+}
+
+bool GillespieSimulator::__select_reaction_directly(Real& dt, std::size_t& idx)
 {
     std::vector<double> a(events_.size());
     for (unsigned int i(0); i < events_.size(); ++i)
@@ -54,13 +94,9 @@ bool GillespieSimulator::__draw_next_reaction(void)
     if (atot == 0.0)
     {
         // no reaction occurs
-        this->dt_ = inf;
-        return true;
+        return false;
     }
 
-    double dt = 0.0;
-    unsigned int idx = 0;
-
     if (atot == std::numeric_limits<double>::infinity())
     {
         std::vector<unsigned int> selected;
@@ -93,6 +129,68 @@ bool GillespieSimulator::__draw_next_reaction(void)
             }
         }
     }
+    return true;
+}
+
+bool GillespieSimulator::__select_reaction_from_tree(Real& dt, std::size_t& idx)
+{
+    // A rate law given by a descriptor may depend on the time.
+    for (std::vector<std::size_t>::const_iterator i(time_dependent_events_.begin());
+        i != time_dependent_events_.end(); ++i)
+    {
+        propensities_.set(*i, events_[*i].propensity());
+    }
+
+    const double atot(propensities_.total());
+
+    if (atot == 0.0)
+    {
+        // no reaction occurs
+        return false;
+    }
+
+    if (atot == std::numeric_limits<double>::infinity())
+    {
+        // This is rare. Fall back to the linear scan.
+        std::vector<std::size_t> selected;
+        for (std::size_t i(0); i < propensities_.size(); ++i)
+        {
+            if (propensities_[i] == std::numeric_limits<double>::infinity())
+            {
+                selected.push_back(i);
+            }
+        }
+
+        dt = 0.0;
+        idx = selected[(selected.size() == 1 ? 0 : rng()->uniform_int(0, selected.size() - 1))];
+    }
+    else
+    {
+        const double rnd1(rng()->uniform(0, 1));
+        const double rnd2(rng()->uniform(0, atot));
+
+        dt = gsl_sf_log(1.0 / rnd1) / double(atot);
+        idx = propensities_.find(rnd2);
+    }
+    return true;
+}
+
+bool GillespieSimulator::__draw_next_reaction(void)
+{
+    Real dt(0.0);
+    std::size_t idx(0);
+
+    const bool occurs(
+        solver_type_ == PARTIAL_SUM_TREE
+            ? __select_reaction_from_tree(dt, idx)
+            : __select_reaction_directly(dt, idx));
+
+    if (!occurs)
+    {
+        // no reaction occurs
+        this->dt_ = inf;
+        return true;
+    }
 
     next_reaction_rule_ = events_[idx].reaction_rule();
     boost::optional<ReactionRule> r = events_[idx].draw();
@@ -308,7 +406,37 @@ void GillespieSimulator::initialize(void)
             throw IllegalState("Never get here");
         }
 
-        events_.back().initialize();
+    }
+
+    dependencies_.clear();
+    {
+        const std::vector<Species>::size_type num_species(world_->list_species().size());
+        if (num_species > 0)
+        {
+            dependencies(num_species - 1);
+        }
+    }
+
+    for (boost::ptr_vector<ReactionRuleEvent>::iterator i(events_.begin());
+        i != events_.end(); ++i)
+    {
+        (*i).initialize();
+    }
+
+    time_dependent_events_.clear();
+    propensities_.clear();
+    if (solver_type_ == PARTIAL_SUM_TREE)
+    {
+        std::vector<Real> a(events_.size());
+        for (std::size_t i(0); i < events_.size(); ++i)
+        {
+            a[i] = events_[i].propensity();
+            if (events_[i].is_time_dependent())
+            {
+                time_dependent_events_.push_back(i);
+            }
+        }
+        propensities_.assign(a);
     }
 
     this->draw_next_reaction();
@@ -11,6 +11,7 @@
 #include <ecell4/core/Model.hpp>
 #include <ecell4/core/NetworkModel.hpp>
 #include <ecell4/core/SimulatorBase.hpp>
+#include <ecell4/core/PartialSumTree.hpp>
 
 #include "GillespieWorld.hpp"
 
@@ -21,6 +22,17 @@ namespace ecell4
 namespace gillespie
 {
 
+/**
+ * How the next reaction is selected.
+ * DIRECT_METHOD scans the propensities of all the reactions at every step.
+ * PARTIAL_SUM_TREE keeps them in a binary tree of partial sums, and only
+ * refreshes the reactions whose reactants changed, i.e. O(log R) per step.
+ */
+enum GillespieSolverType {
+    DIRECT_METHOD = 0,
+    PARTIAL_SUM_TREE = 1,
+};
+
 class ReactionInfo
 {
 public:
@@ -84,16 +96,23 @@ protected:
 
     class ReactionRuleEvent
     {
+    public:
+
+        typedef std::vector<Integer> coefficient_container_type;
+        typedef GillespieWorld::species_id_type species_id_type;
+        typedef std::vector<std::pair<species_id_type, coefficient_container_type> >
+            candidate_container_type;
+
     public:
 
         ReactionRuleEvent()
-            : sim_(), rr_()
+            : sim_(), rr_(), candidates_()
         {
             ;
         }
 
         ReactionRuleEvent(GillespieSimulator* sim, const ReactionRule& rr)
-            : sim_(sim), rr_(rr)
+            : sim_(sim), rr_(rr), candidates_()
         {
             ;
         }
@@ -120,12 +139,36 @@ protected:
         }
 
         virtual void initialize() = 0;
-        virtual void inc(const Species& sp, const Integer val = +1) = 0;
         virtual const Real propensity() const = 0;
 
-        inline void dec(const Species& sp)
+        /**
+         * return the coefficients of the given species for each pattern
+         * counted by this event. All zero if this event does not depend on it.
+         */
+        virtual coefficient_container_type get_coefs(const Species& sp) const = 0;
+
+        /**
+         * update the number of reactants with the coefficients
+         * given by get_coefs.
+         */
+        virtual void inc(const coefficient_container_type& coefs, const Integer val = +1) = 0;
+
+        /**
+         * register a species this event depends on with its coefficients.
+         * initialize and __draw only scan the registered species by their IDs.
+         */
+        void add_candidate(const species_id_type& id, const coefficient_container_type& coefs)
         {
-            inc(sp, -1);
+            candidates_.push_back(std::make_pair(id, coefs));
+        }
+
+        /**
+         * return true if the propensity depends on the time,
+         * and must be recalculated at every step.
+         */
+        virtual bool is_time_dependent() const
+        {
+            return false;
         }
 
         boost::optional<ReactionRule> draw()
@@ -183,6 +226,7 @@ protected:
 
         GillespieSimulator* sim_;
         ReactionRule rr_;
+        candidate_container_type candidates_;
     };
 
     class ZerothOrderReactionRuleEvent
@@ -204,7 +248,12 @@ protected:
             ;
         }
 
-        void inc(const Species& sp, const Integer val = +1)
+        coefficient_container_type get_coefs(const Species& sp) const
+        {
+            return coefficient_container_type();
+        }
+
+        void inc(const coefficient_container_type& coefs, const Integer val = +1)
         {
             ; // do nothing
         }
@@ -244,52 +293,48 @@ protected:
             ;
         }
 
-        void inc(const Species& sp, const Integer val = +1)
+        coefficient_container_type get_coefs(const Species& sp) const
         {
             const ReactionRule::reactant_container_type& reactants(rr_.reactants());
-            const Integer coef(get_coef(reactants[0], sp));
-            if (coef > 0)
-            {
-                num_tot1_ += coef * val;
-            }
+            return coefficient_container_type(1, get_coef(reactants[0], sp));
         }
 
-        void initialize()
+        void inc(const coefficient_container_type& coefs, const Integer val = +1)
         {
-            const std::vector<Species>& species(world().list_species());
-            const ReactionRule::reactant_container_type& reactants(rr_.reactants());
+            num_tot1_ += coefs[0] * val;
+        }
 
+        void initialize()
+        {
             num_tot1_ = 0;
-            for (std::vector<Species>::const_iterator i(species.begin());
-                i != species.end(); ++i)
+            for (candidate_container_type::const_iterator i(candidates_.begin());
+                i != candidates_.end(); ++i)
             {
-                const Integer coef(get_coef(reactants[0], *i));
+                const Integer coef((*i).second[0]);
                 if (coef > 0)
                 {
-                    num_tot1_ += coef * world().num_molecules_exact(*i);
+                    num_tot1_ += coef * world().num_molecules_by_id((*i).first);
                 }
             }
         }
 
         std::pair<ReactionRule::reactant_container_type, Integer> __draw()
         {
-            const std::vector<Species>& species(world().list_species());
-            const ReactionRule::reactant_container_type& reactants(rr_.reactants());
-
             const Real rnd1(rng()->uniform(0.0, num_tot1_));
 
             Integer num_tot(0);
-            for (std::vector<Species>::const_iterator i(species.begin());
-                i != species.end(); ++i)
+            for (candidate_container_type::const_iterator i(candidates_.begin());
+                i != candidates_.end(); ++i)
             {
-                const Integer coef(get_coef(reactants[0], *i));
+                const Integer coef((*i).second[0]);
                 if (coef > 0)
                 {
-                    num_tot += coef * world().num_molecules_exact(*i);
+                    num_tot += coef * world().num_molecules_by_id((*i).first);
                     if (num_tot >= rnd1)
                     {
                         return std::make_pair(
-                            ReactionRule::reactant_container_type(1, *i), coef);
+                            ReactionRule::reactant_container_type(
+                                1, world().get_species((*i).first)), coef);
                     }
                 }
             }
@@ -326,36 +371,36 @@ protected:
             ;
         }
 
-        void inc(const Species& sp, const Integer val = +1)
+        coefficient_container_type get_coefs(const Species& sp) const
         {
             const ReactionRule::reactant_container_type& reactants(rr_.reactants());
-            const Integer coef1(get_coef(reactants[0], sp));
-            const Integer coef2(get_coef(reactants[1], sp));
-            if (coef1 > 0 || coef2 > 0)
-            {
-                const Integer tmp(coef1 * val);
-                num_tot1_ += tmp;
-                num_tot2_ += coef2 * val;
-                num_tot12_ += coef2 * tmp;
-            }
+            coefficient_container_type coefs(2);
+            coefs[0] = get_coef(reactants[0], sp);
+            coefs[1] = get_coef(reactants[1], sp);
+            return coefs;
         }
 
-        void initialize()
+        void inc(const coefficient_container_type& coefs, const Integer val = +1)
         {
-            const std::vector<Species>& species(world().list_species());
-            const ReactionRule::reactant_container_type& reactants(rr_.reactants());
+            const Integer tmp(coefs[0] * val);
+            num_tot1_ += tmp;
+            num_tot2_ += coefs[1] * val;
+            num_tot12_ += coefs[1] * tmp;
+        }
 
+        void initialize()
+        {
             num_tot1_ = 0;
             num_tot2_ = 0;
             num_tot12_ = 0;
-            for (std::vector<Species>::const_iterator i(species.begin());
-                i != species.end(); ++i)
+            for (candidate_container_type::const_iterator i(candidates_.begin());
+                i != candidates_.end(); ++i)
             {
-                const Integer coef1(get_coef(reactants[0], *i));
-                const Integer coef2(get_coef(reactants[1], *i));
+                const Integer coef1((*i).second[0]);
+                const Integer coef2((*i).second[1]);
                 if (coef1 > 0 || coef2 > 0)
                 {
-                    const Integer num(world().num_molecules_exact(*i));
+                    const Integer num(world().num_molecules_by_id((*i).first));
                     const Integer tmp(coef1 * num);
                     num_tot1_ += tmp;
                     num_tot2_ += coef2 * num;
@@ -366,19 +411,16 @@ protected:
 
         std::pair<ReactionRule::reactant_container_type, Integer> __draw()
         {
-            const std::vector<Species>& species(world().list_species());
-            const ReactionRule::reactant_container_type& reactants(rr_.reactants());
-
             const Real rnd1(rng()->uniform(0.0, num_tot1_));
 
             Integer num_tot(0), coef1(0);
-            std::vector<Species>::const_iterator itr1(species.begin());
-            for (; itr1 != species.end(); ++itr1)
+            candidate_container_type::const_iterator itr1(candidates_.begin());
+            for (; itr1 != candidates_.end(); ++itr1)
             {
-                const Integer coef(get_coef(reactants[0], *itr1));
+                const Integer coef((*itr1).second[0]);
                 if (coef > 0)
                 {
-                    num_tot += coef * world().num_molecules_exact(*itr1);
+                    num_tot += coef * world().num_molecules_by_id((*itr1).first);
                     if (num_tot >= rnd1)
                     {
                         coef1 = coef;
@@ -387,23 +429,27 @@ protected:
                 }
             }
 
-            const Real rnd2(
-                rng()->uniform(0.0, num_tot2_ - get_coef(reactants[0], *itr1)));
+            if (itr1 == candidates_.end())
+            {
+                return std::make_pair(ReactionRule::reactant_container_type(), 0);
+            }
+
+            const Real rnd2(rng()->uniform(0.0, num_tot2_ - coef1));
 
             num_tot = 0;
-            for (std::vector<Species>::const_iterator i(species.begin());
-                i != species.end(); ++i)
+            for (candidate_container_type::const_iterator i(candidates_.begin());
+                i != candidates_.end(); ++i)
             {
-                const Integer coef(get_coef(reactants[1], *i));
+                const Integer coef((*i).second[1]);
                 if (coef > 0)
                 {
-                    const Integer num(world().num_molecules_exact(*i));
+                    const Integer num(world().num_molecules_by_id((*i).first));
                     num_tot += coef * (i == itr1 ? num - 1 : num);
                     if (num_tot >= rnd2)
                     {
                         ReactionRule::reactant_container_type exact_reactants(2);
-                        exact_reactants[0] = *itr1;
-                        exact_reactants[1] = *i;
+                        exact_reactants[0] = world().get_species((*itr1).first);
+                        exact_reactants[1] = world().get_species((*i).first);
                         return std::make_pair(exact_reactants, coef1 * coef);
                     }
                 }
@@ -443,59 +489,68 @@ protected:
             ;
         }
 
-        void inc(const Species& sp, const Integer val = +1)
+        coefficient_container_type get_coefs(const Species& sp) const
         {
             const ReactionRule::reactant_container_type& reactants(rr_.reactants());
+            const ReactionRule::product_container_type& products(rr_.products());
+            coefficient_container_type coefs(reactants.size() + products.size());
             for (std::size_t i = 0; i < reactants.size(); ++i)
             {
-                const Integer coef(get_coef(reactants[i], sp));
-                if (coef > 0)
-                {
-                    num_reactants_[i] += coef * val;
-                }
+                coefs[i] = get_coef(reactants[i], sp);
             }
-
-            const ReactionRule::product_container_type& products(rr_.products());
             for (std::size_t i = 0; i < products.size(); ++i)
             {
-                const Integer coef(get_coef(products[i], sp));
-                if (coef > 0)
-                {
-                    num_products_[i] += coef * val;
-                }
+                coefs[reactants.size() + i] = get_coef(products[i], sp);
             }
+            return coefs;
         }
 
-        void initialize()
+        void inc(const coefficient_container_type& coefs, const Integer val = +1)
         {
-            const std::vector<Species>& species(world().list_species());
+            const std::size_t num_reactants(num_reactants_.size());
+            for (std::size_t i = 0; i < num_reactants; ++i)
+            {
+                num_reactants_[i] += coefs[i] * val;
+            }
+            for (std::size_t i = 0; i < num_products_.size(); ++i)
+            {
+                num_products_[i] += coefs[num_reactants + i] * val;
+            }
+        }
 
+        bool is_time_dependent() const
+        {
+            return true;
+        }
+
+        void initialize()
+        {
             const ReactionRule::reactant_container_type& reactants(rr_.reactants());
             std::fill(num_reactants_.begin(), num_reactants_.end(), 0);
             num_reactants_.resize(reactants.size(), 0);
             const ReactionRule::product_container_type& products(rr_.products());
             std::fill(num_products_.begin(), num_products_.end(), 0);
             num_products_.resize(products.size(), 0);
-            for (std::vector<Species>::const_iterator it(species.begin());
-                it != species.end(); ++it)
+            for (candidate_container_type::const_iterator it(candidates_.begin());
+                it != candidates_.end(); ++it)
             {
-                const Species& sp(*it);
+                const coefficient_container_type& coefs((*it).second);
+                const Integer num(world().num_molecules_by_id((*it).first));
 
                 for (std::size_t i = 0; i < reactants.size(); ++i)
                 {
-                    const Integer coef(get_coef(reactants[i], sp));
-                    if (coef > 0)
+                    if (coefs[i] > 0)
                     {
-                        num_reactants_[i] += coef * world().num_molecules_exact(sp);
+                        num_reactants_[i] += coefs[i] * num;
                     }
                 }
 
                 for (std::size_t i = 0; i < products.size(); ++i)
                 {
-                    const Integer coef(get_coef(products[i], sp));
+                    const Integer coef(coefs[reactants.size() + i]);
                     if (coef > 0)
                     {
-                        num_products_[i] += coef * world().num_molecules_exact(sp);
+                        num_products_[i] += coef * num;
                     }
                 }
             }
@@ -503,7 +558,6 @@ protected:
 
         std::pair<ReactionRule::reactant_container_type, Integer> __draw()
         {
-            const std::vector<Species>& species(world().list_species());
             const ReactionRule::reactant_container_type& reactants(rr_.reactants());
 
             std::pair<ReactionRule::reactant_container_type, Integer> ret;
@@ -514,17 +568,16 @@ protected:
                 assert(num_reactants_[i] > 0);
                 const Real rnd(rng()->uniform(0.0, num_reactants_[i]));
                 Integer num_tot(0);
-                for (std::vector<Species>::const_iterator it(species.begin());
-                    it != species.end(); ++it)
+                for (candidate_container_type::const_iterator it(candidates_.begin());
+                    it != candidates_.end(); ++it)
                 {
-                    const Species& sp(*it);
-                    const Integer coef(get_coef(reactants[i], sp));
+                    const Integer coef((*it).second[i]);
                     if (coef > 0)
                     {
-                        num_tot += coef * world().num_molecules_exact(sp);
+                        num_tot += coef * world().num_molecules_by_id((*it).first);
                         if (num_tot >= rnd)
                         {
-                            ret.first.push_back(sp);
+                            ret.first.push_back(world().get_species((*it).first));
                             ret.second *= coef;
                             break;
                         }
@@ -554,14 +607,17 @@ public:
 
     GillespieSimulator(
         boost::shared_ptr<GillespieWorld> world,
-        boost::shared_ptr<Model> model)
-        : base_type(world, model)
+        boost::shared_ptr<Model> model,
+        const GillespieSolverType solver_type = DIRECT_METHOD)
+        : base_type(world, model), solver_type_(solver_type)
     {
         initialize();
     }
 
-    GillespieSimulator(boost::shared_ptr<GillespieWorld> world)
-        : base_type(world)
+    GillespieSimulator(
+        boost::shared_ptr<GillespieWorld> world,
+        const GillespieSolverType solver_type = DIRECT_METHOD)
+        : base_type(world), solver_type_(solver_type)
     {
         initialize();
     }
@@ -594,8 +650,22 @@ public:
         return (*world_).rng();
     }
 
+    const GillespieSolverType solver_type() const
+    {
+        return solver_type_;
+    }
+
 protected:
 
+    typedef ReactionRuleEvent::coefficient_container_type coefficient_container_type;
+    typedef std::vector<std::pair<std::size_t, coefficient_container_type> >
+        dependency_container_type;
+    typedef GillespieWorld::species_id_type species_id_type;
+
+    const dependency_container_type& dependencies(const species_id_type& id);
+
+    bool __select_reaction_directly(Real& dt, std::size_t& idx);
+    bool __select_reaction_from_tree(Real& dt, std::size_t& idx);
     bool __draw_next_reaction(void);
     void draw_next_reaction(void);
     void increment_molecules(const Species& sp);
@@ -609,6 +679,16 @@ protected:
     std::vector<std::pair<ReactionRule, reaction_info_type> > last_reactions_;
 
     boost::ptr_vector<ReactionRuleEvent> events_;
+
+    /**
+     * a cache from a species ID to the events depending on it and
+     * the coefficients. A new entry is added when a species appears.
+     */
+    std::vector<dependency_container_type> dependencies_;
+
+    GillespieSolverType solver_type_;
+    PartialSumTree<Real> propensities_;
+    std::vector<std::size_t> time_dependent_events_;
 };
 
 }
@@ -30,6 +30,10 @@ namespace gillespie
 class GillespieWorld
     : public WorldInterface
 {
+public:
+
+    typedef CompartmentSpaceVectorImpl::species_id_type species_id_type;
+
 public:
 
     GillespieWorld(const Real3& edge_lengths,
@@ -81,6 +85,21 @@ public:
     std::vector<Species> list_species() const;
     bool has_species(const Species& sp) const;
 
+    species_id_type get_species_id(const Species& sp) const
+    {
+        return cs_->get_species_id(sp);
+    }
+
+    const Species& get_species(const species_id_type& id) const
+    {
+        return cs_->get_species(id);
+    }
+
+    Integer num_molecules_by_id(const species_id_type& id) const
+    {
+        return cs_->num_molecules_by_id(id);
+    }
+
     void set_volume(const Real& volume)
     {
         (*cs_).set_volume(volume);
@@ -186,7 +205,7 @@ public:
 
 private:
 
-    boost::scoped_ptr<CompartmentSpace> cs_;
+    boost::scoped_ptr<CompartmentSpaceVectorImpl> cs_;
     boost::shared_ptr<RandomNumberGenerator> rng_;
 
     boost::weak_ptr<Model> model_;
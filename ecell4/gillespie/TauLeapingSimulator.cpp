@@ -0,0 +1,566 @@
+#include "TauLeapingSimulator.hpp"
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <gsl/gsl_sf_log.h>
+
+
+namespace ecell4
+{
+
+namespace gillespie
+{
+
+TauLeapingSimulator::species_id_type
+    TauLeapingSimulator::get_species_id(const Species& sp)
+{
+    if (!world_->has_species(sp))
+    {
+        world_->add_molecules(sp, 0);
+    }
+    return world_->get_species_id(sp);
+}
+
+Real TauLeapingSimulator::propensity(const reaction_type& r) const
+{
+    if (r.rr.has_descriptor())
+    {
+        ReactionRuleDescriptor::state_container_type
+            num_reactants(r.reactants.size()), num_products(r.products.size());
+        for (std::size_t i(0); i < r.reactants.size(); ++i)
+        {
+            num_reactants[i] = world_->num_molecules_by_id(r.reactants[i]);
+        }
+        for (std::size_t i(0); i < r.products.size(); ++i)
+        {
+            num_products[i] = world_->num_molecules_by_id(r.products[i]);
+        }
+        return r.rr.get_descriptor()->propensity(
+            num_reactants, num_products, world_->volume(), world_->t());
+    }
+
+    // The mass action, i.e. k * V for 0th order, k * x for 1st order,
+    // and k * x * y / V or k * x * (x - 1) / V for 2nd order.
+    Real a(r.rr.k() * world_->volume());
+    for (std::size_t i(0); i < r.reactants.size(); ++i)
+    {
+        Integer num(world_->num_molecules_by_id(r.reactants[i]));
+        for (std::size_t j(0); j < i; ++j)
+        {
+            if (r.reactants[j] == r.reactants[i])
+            {
+                --num;
+            }
+        }
+
+        if (num <= 0)
+        {
+            return 0.0;
+        }
+        a *= num / world_->volume();
+    }
+    return a;
+}
+
+Integer TauLeapingSimulator::max_firings(const reaction_type& r) const
+{
+    Integer retval(std::numeric_limits<Integer>::max());
+    for (std::vector<std::pair<species_id_type, Integer> >::const_iterator
+        i(r.changes.begin()); i != r.changes.end(); ++i)
+    {
+        if ((*i).second < 0)
+        {
+            retval = std::min(
+                retval, world_->num_molecules_by_id((*i).first) / (-(*i).second));
+        }
+    }
+    return retval;
+}
+
+Real TauLeapingSimulator::leap_size() const
+{
+    // The expected change and the variance of each species in a unit time
+    // by non-critical reactions.
+    std::vector<Real> mu(highest_orders_.size(), 0.0), sigma2(highest_orders_.size(), 0.0);
+    for (std::size_t j(0); j < reactions_.size(); ++j)
+    {
+        if (max_firings_[j] < critical_threshold_ || propensities_[j] <= 0.0)
+        {
+            continue;
+        }
+
+        const reaction_type& r(reactions_[j]);
+        for (std::vector<std::pair<species_id_type, Integer> >::const_iterator
+            i(r.changes.begin()); i != r.changes.end(); ++i)
+        {
+            const Real v((*i).second);
+            mu[(*i).first] += v * propensities_[j];
+            sigma2[(*i).first] += v * v * propensities_[j];
+        }
+    }
+
+    Real tau(inf);
+    for (species_id_type i(0); i < highest_orders_.size(); ++i)
+    {
+        const Integer order(highest_orders_[i].first);
+        if (order == 0 || (mu[i] == 0.0 && sigma2[i] == 0.0))
+        {
+            continue;
+        }
+
+        // The factor g_i in Cao et al. (2006), e.g. 2 + 1 / (x - 1)
+        // for a species consumed as a dimer in a 2nd order reaction.
+        const Integer num(world_->num_molecules_by_id(i));
+        const Integer coef(highest_orders_[i].second);
+        Real g(coef);
+        for (Integer k(1); k < coef; ++k)
+        {
+            if (num > k)
+            {
+                g += static_cast<Real>(k) / (num - k);
+            }
+        }
+        g *= static_cast<Real>(order) / coef;
+
+        const Real bound(std::max(epsilon_ * num / g, 1.0));
+        if (mu[i] != 0.0)
+        {
+            tau = std::min(tau, bound / std::abs(mu[i]));
+        }
+        if (sigma2[i] > 0.0)
+        {
+            tau = std::min(tau, bound * bound / sigma2[i]);
+        }
+    }
+    return tau;
+}
+
+void TauLeapingSimulator::draw_next_step(void)
+{
+    leaping_ = false;
+    fires_critical_ = false;
+
+    propensities_.resize(reactions_.size());
+    max_firings_.resize(reactions_.size());
+
+    Real atot(0.0), atot_critical(0.0);
+    for (std::size_t j(0); j < reactions_.size(); ++j)
+    {
+        propensities_[j] = propensity(reactions_[j]);
+        max_firings_[j] = max_firings(reactions_[j]);
+        atot += propensities_[j];
+        if (max_firings_[j] < critical_threshold_)
+        {
+            atot_critical += propensities_[j];
+        }
+    }
+
+    if (atot == 0.0)
+    {
+        // no reaction occurs
+        dt_ = inf;
+        return;
+    }
+
+    if (atot == std::numeric_limits<Real>::infinity())
+    {
+        std::vector<std::size_t> selected;
+        for (std::size_t j(0); j < propensities_.size(); ++j)
+        {
+            if (propensities_[j] == std::numeric_limits<Real>::infinity())
+            {
+                selected.push_back(j);
+            }
+        }
+
+        dt_ = 0.0;
+        next_reaction_ = selected[(selected.size() == 1 ? 0 : rng()->uniform_int(0, selected.size() - 1))];
+        return;
+    }
+
+    const Real tau1(leap_size());
+    if (tau1 == inf || tau1 < ssa_threshold_ / atot)
+    {
+        // A leap is too short to gain anything. Take an exact step instead.
+        const Real rnd1(rng()->uniform(0, 1));
+        const Real rnd2(rng()->uniform(0, atot));
+
+        dt_ = gsl_sf_log(1.0 / rnd1) / atot;
+
+        Real acc(0.0);
+        for (next_reaction_ = 0; next_reaction_ < propensities_.size() - 1; ++next_reaction_)
+        {
+            acc += propensities_[next_reaction_];
+            if (acc >= rnd2)
+            {
+                break;
+            }
+        }
+        return;
+    }
+
+    leaping_ = true;
+
+    const Real tau2(
+        atot_critical > 0.0
+            ? gsl_sf_log(1.0 / rng()->uniform(0, 1)) / atot_critical
+            : inf);
+
+    if (tau1 < tau2)
+    {
+        dt_ = tau1;
+        return;
+    }
+
+    // One of the critical reactions occurs at the end of the leap.
+    dt_ = tau2;
+    fires_critical_ = true;
+
+    const Real rnd(rng()->uniform(0, atot_critical));
+    Real acc(0.0);
+    for (std::size_t j(0); j < reactions_.size(); ++j)
+    {
+        if (max_firings_[j] < critical_threshold_ && propensities_[j] > 0.0)
+        {
+            next_reaction_ = j;
+            acc += propensities_[j];
+            if (acc >= rnd)
+            {
+                break;
+            }
+        }
+    }
+}
+
+bool TauLeapingSimulator::leap(const Real tau, const bool fires_critical)
+{
+    changes_.assign(highest_orders_.size(), 0);
+
+    bool reacted(false);
+    for (std::size_t j(0); j < reactions_.size(); ++j)
+    {
+        if (max_firings_[j] < critical_threshold_ || propensities_[j] <= 0.0)
+        {
+            continue;
+        }
+
+        const Real mean(propensities_[j] * tau);
+        const Integer num_firings(
+            max_firings_[j] == std::numeric_limits<Integer>::max()
+                ? rng()->poisson(mean)
+                : rng()->binomial(std::min(1.0, mean / max_firings_[j]), max_firings_[j]));
+
+        if (num_firings == 0)
+        {
+            continue;
+        }
+
+        reacted = true;
+        const reaction_type& r(reactions_[j]);
+        for (std::vector<std::pair<species_id_type, Integer> >::const_iterator
+            i(r.changes.begin()); i != r.changes.end(); ++i)
+        {
+            changes_[(*i).first] += (*i).second * num_firings;
+        }
+    }
+
+    if (fires_critical)
+    {
+        reacted = true;
+        const reaction_type& r(reactions_[next_reaction_]);
+        for (std::vector<std::pair<species_id_type, Integer> >::const_iterator
+            i(r.changes.begin()); i != r.changes.end(); ++i)
+        {
+            changes_[(*i).first] += (*i).second;
+        }
+    }
+
+    for (species_id_type i(0); i < changes_.size(); ++i)
+    {
+        if (changes_[i] < 0 && world_->num_molecules_by_id(i) + changes_[i] < 0)
+        {
+            // Rejected. The leap is too long.
+            return false;
+        }
+    }
+
+    for (species_id_type i(0); i < changes_.size(); ++i)
+    {
+        if (changes_[i] > 0)
+        {
+            world_->add_molecules(world_->get_species(i), changes_[i]);
+        }
+        else if (changes_[i] < 0)
+        {
+            world_->remove_molecules(world_->get_species(i), -changes_[i]);
+        }
+    }
+
+    reacted_ = reacted;
+    return true;
+}
+
+Real TauLeapingSimulator::__step(Real tau, bool fires_critical)
+{
+    // Halve the leap until no population goes negative.
+    while (!leap(tau, fires_critical))
+    {
+        tau *= 0.5;
+        fires_critical = false;
+    }
+    return tau;
+}
+
+void TauLeapingSimulator::step(void)
+{
+    reacted_ = false;
+
+    if (dt_ == inf)
+    {
+        // No reaction occurs.
+        return;
+    }
+
+    const Real t0(t());
+    Real tau(dt_);
+
+    if (leaping_)
+    {
+        tau = __step(dt_, fires_critical_);
+    }
+    else
+    {
+        const reaction_type& r(reactions_[next_reaction_]);
+        for (std::vector<std::pair<species_id_type, Integer> >::const_iterator
+            i(r.changes.begin()); i != r.changes.end(); ++i)
+        {
+            if ((*i).second > 0)
+            {
+                world_->add_molecules(world_->get_species((*i).first), (*i).second);
+            }
+            else
+            {
+                world_->remove_molecules(world_->get_species((*i).first), -(*i).second);
+            }
+        }
+        reacted_ = true;
+    }
+
+    set_t(t0 + tau);
+    num_steps_++;
+
+    draw_next_step();
+}
+
+bool TauLeapingSimulator::step(const Real& upto)
+{
+    if (upto <= t())
+    {
+        return false;
+    }
+
+    if (upto >= next_time())
+    {
+        step();
+        return true;
+    }
+
+    reacted_ = false;
+
+    if (!leaping_)
+    {
+        // No reaction occurs.
+        set_t(upto);
+        draw_next_step();
+        return false;
+    }
+
+    // Any leap shorter than the planned one is also acceptable.
+    // No critical reaction occurs before upto.
+    const Real t0(t()), tau(upto - t0);
+    const Real taken(__step(tau, false));
+    num_steps_++;
+
+    if (taken < tau)
+    {
+        set_t(t0 + taken);
+        draw_next_step();
+        return true;
+    }
+
+    set_t(upto);
+    draw_next_step();
+    return false;
+}
+
+void TauLeapingSimulator::check_model(void)
+{
+    if (!model_->is_static())
+    {
+        throw NotSupported(
+            "TauLeapingSimulator only supports a static model. Expand the model first.");
+    }
+
+    const Model::reaction_rule_container_type&
+        reaction_rules(model_->reaction_rules());
+
+    for (Model::reaction_rule_container_type::const_iterator
+        i(reaction_rules.begin()); i != reaction_rules.end(); ++i)
+    {
+        const ReactionRule& rr(*i);
+
+        if (!rr.has_descriptor())
+        {
+            continue;
+        }
+
+        const boost::shared_ptr<ReactionRuleDescriptor>& desc = rr.get_descriptor();
+
+        if (!desc->is_available())
+        {
+            throw NotSupported(
+                "The given reaction rule descriptor is not available.");
+        }
+        else if ((rr.reactants().size() != desc->reactant_coefficients().size())
+                || (rr.products().size() != desc->product_coefficients().size()))
+        {
+            throw NotSupported(
+                "Mismatch between the number of stoichiometry coefficients and of reactants.");
+        }
+
+        for (ReactionRuleDescriptor::coefficient_container_type::const_iterator
+            it(desc->reactant_coefficients().begin());
+            it != desc->reactant_coefficients().end(); ++it)
+        {
+            if ((*it) < 0)
+            {
+                throw NotSupported("A stoichiometric coefficient must be non-negative.");
+            }
+            else if (std::abs((*it) - round(*it)) > 1e-10 * (*it))
+            {
+                throw NotSupported("A stoichiometric coefficient must be an integer.");
+            }
+        }
+    }
+}
+
+static inline bool is_zero_change(const std::pair<GillespieWorld::species_id_type, Integer>& change)
+{
+    return change.second == 0;
+}
+
+void TauLeapingSimulator::initialize(void)
+{
+    check_model();
+
+    const Model::reaction_rule_container_type&
+        reaction_rules(model_->reaction_rules());
+
+    reactions_.clear();
+    reactions_.reserve(reaction_rules.size());
+    for (Model::reaction_rule_container_type::const_iterator
+        i(reaction_rules.begin()); i != reaction_rules.end(); ++i)
+    {
+        const ReactionRule& rr(*i);
+
+        reaction_type r;
+        r.rr = rr;
+
+        for (ReactionRule::reactant_container_type::const_iterator
+            j(rr.reactants().begin()); j != rr.reactants().end(); ++j)
+        {
+            r.reactants.push_back(get_species_id(*j));
+        }
+        for (ReactionRule::product_container_type::const_iterator
+            j(rr.products().begin()); j != rr.products().end(); ++j)
+        {
+            r.products.push_back(get_species_id(*j));
+        }
+
+        if (rr.has_descriptor())
+        {
+            const boost::shared_ptr<ReactionRuleDescriptor>& desc = rr.get_descriptor();
+            for (std::size_t j(0); j < r.reactants.size(); ++j)
+            {
+                r.reactant_coefficients.push_back(
+                    static_cast<Integer>(round(desc->reactant_coefficients()[j])));
+            }
+            for (std::size_t j(0); j < r.products.size(); ++j)
+            {
+                r.product_coefficients.push_back(
+                    static_cast<Integer>(round(desc->product_coefficients()[j])));
+            }
+        }
+        else
+        {
+            r.reactant_coefficients.resize(r.reactants.size(), 1);
+            r.product_coefficients.resize(r.products.size(), 1);
+        }
+
+        std::vector<std::pair<species_id_type, Integer> > changes;
+        for (std::size_t j(0); j < r.reactants.size(); ++j)
+        {
+            changes.push_back(std::make_pair(r.reactants[j], -r.reactant_coefficients[j]));
+        }
+        for (std::size_t j(0); j < r.products.size(); ++j)
+        {
+            changes.push_back(std::make_pair(r.products[j], +r.product_coefficients[j]));
+        }
+        std::sort(changes.begin(), changes.end());
+        for (std::vector<std::pair<species_id_type, Integer> >::const_iterator
+            j(changes.begin()); j != changes.end(); ++j)
+        {
+            if (r.changes.size() > 0 && r.changes.back().first == (*j).first)
+            {
+                r.changes.back().second += (*j).second;
+            }
+            else
+            {
+                r.changes.push_back(*j);
+            }
+        }
+        r.changes.erase(
+            std::remove_if(r.changes.begin(), r.changes.end(), is_zero_change),
+            r.changes.end());
+
+        reactions_.push_back(r);
+    }
+
+    highest_orders_.assign(world_->list_species().size(), std::make_pair(0, 0));
+    for (std::vector<reaction_type>::const_iterator i(reactions_.begin());
+        i != reactions_.end(); ++i)
+    {
+        const reaction_type& r(*i);
+
+        Integer order(0);
+        for (std::size_t j(0); j < r.reactants.size(); ++j)
+        {
+            order += r.reactant_coefficients[j];
+        }
+
+        for (std::size_t j(0); j < r.reactants.size(); ++j)
+        {
+            Integer coef(0);
+            for (std::size_t k(0); k < r.reactants.size(); ++k)
+            {
+                if (r.reactants[k] == r.reactants[j])
+                {
+                    coef += r.reactant_coefficients[k];
+                }
+            }
+
+            std::pair<Integer, Integer>& hor(highest_orders_[r.reactants[j]]);
+            if (order > hor.first || (order == hor.first && coef > hor.second))
+            {
+                hor = std::make_pair(order, coef);
+            }
+        }
+    }
+
+    reacted_ = false;
+    draw_next_step();
+}
+
+} // gillespie
+
+} // ecell4
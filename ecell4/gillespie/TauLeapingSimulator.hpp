@@ -0,0 +1,185 @@
+#ifndef ECELL4_GILLESPIE_TAU_LEAPING_SIMULATOR_HPP
+#define ECELL4_GILLESPIE_TAU_LEAPING_SIMULATOR_HPP
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+#include <ecell4/core/types.hpp>
+#include <ecell4/core/Model.hpp>
+#include <ecell4/core/SimulatorBase.hpp>
+
+#include "GillespieWorld.hpp"
+
+
+namespace ecell4
+{
+
+namespace gillespie
+{
+
+/**
+ * An explicit tau-leaping simulator on GillespieWorld.
+ * The leap size is chosen as in Cao, Gillespie and Petzold (2006) so that
+ * no propensity is expected to change by more than epsilon relatively.
+ * In a leap, each non-critical reaction fires as many times as drawn
+ * from a binomial distribution bounded by its reactants, or from
+ * a Poisson distribution when it has no reactant.
+ * A reaction is critical when its reactants allow it to fire fewer than
+ * critical_threshold times. At most one critical reaction occurs in a leap.
+ * When the leap would be shorter than ssa_threshold exact steps on average,
+ * an exact step of the direct method is taken instead.
+ * Only a static model like NetworkModel is supported.
+ *
+ * A leap is computed on a single thread. Its work grows only with
+ * the number of reactions, which is too little to pay for starting
+ * threads in each leap. Run independent trajectories in parallel with
+ * EnsembleRunner<TauLeapingFactory> instead.
+ */
+class TauLeapingSimulator
+    : public SimulatorBase<GillespieWorld>
+{
+public:
+
+    typedef SimulatorBase<GillespieWorld> base_type;
+    typedef GillespieWorld::species_id_type species_id_type;
+
+protected:
+
+    struct reaction_type
+    {
+        ReactionRule rr;
+        std::vector<species_id_type> reactants, products;
+        std::vector<Integer> reactant_coefficients, product_coefficients;
+
+        /**
+         * the net change of each species when the reaction fires once.
+         */
+        std::vector<std::pair<species_id_type, Integer> > changes;
+    };
+
+public:
+
+    TauLeapingSimulator(
+        boost::shared_ptr<GillespieWorld> world,
+        boost::shared_ptr<Model> model,
+        const Real epsilon = 0.03)
+        : base_type(world, model), epsilon_(epsilon),
+          ssa_threshold_(10.0), critical_threshold_(10)
+    {
+        initialize();
+    }
+
+    TauLeapingSimulator(
+        boost::shared_ptr<GillespieWorld> world,
+        const Real epsilon = 0.03)
+        : base_type(world), epsilon_(epsilon),
+          ssa_threshold_(10.0), critical_threshold_(10)
+    {
+        initialize();
+    }
+
+    // SimulatorTraits
+    Real dt(void) const
+    {
+        return dt_;
+    }
+
+    void step(void);
+    bool step(const Real& upto);
+
+    /**
+     * convert the reaction rules and draw the next step.
+     * Call this again after changing the world from outside.
+     */
+    void initialize();
+
+    virtual bool check_reaction() const
+    {
+        return reacted_;
+    }
+
+    /**
+     * return true if the next step is a leap, and false if it is
+     * an exact step of the direct method.
+     */
+    bool is_leaping() const
+    {
+        return leaping_;
+    }
+
+    inline boost::shared_ptr<RandomNumberGenerator> rng()
+    {
+        return (*world_).rng();
+    }
+
+    const Real epsilon() const
+    {
+        return epsilon_;
+    }
+
+    void set_epsilon(const Real epsilon)
+    {
+        epsilon_ = epsilon;
+        draw_next_step();
+    }
+
+    const Real ssa_threshold() const
+    {
+        return ssa_threshold_;
+    }
+
+    void set_ssa_threshold(const Real threshold)
+    {
+        ssa_threshold_ = threshold;
+        draw_next_step();
+    }
+
+    const Integer critical_threshold() const
+    {
+        return critical_threshold_;
+    }
+
+    void set_critical_threshold(const Integer threshold)
+    {
+        critical_threshold_ = threshold;
+        draw_next_step();
+    }
+
+protected:
+
+    species_id_type get_species_id(const Species& sp);
+    Real propensity(const reaction_type& r) const;
+    Integer max_firings(const reaction_type& r) const;
+    Real leap_size() const;
+    void draw_next_step(void);
+    bool leap(const Real tau, const bool fires_critical);
+    Real __step(Real tau, bool fires_critical);
+    void check_model(void);
+
+protected:
+
+    Real dt_;
+    Real epsilon_, ssa_threshold_;
+    Integer critical_threshold_;
+
+    std::vector<reaction_type> reactions_;
+
+    /**
+     * the highest order of the reactions consuming each species,
+     * and the largest coefficient of the species among them.
+     */
+    std::vector<std::pair<Integer, Integer> > highest_orders_;
+
+    std::vector<Real> propensities_;
+    std::vector<Integer> max_firings_;
+    std::vector<Integer> changes_;
+
+    bool leaping_, fires_critical_, reacted_;
+    std::size_t next_reaction_;
+};
+
+} // gillespie
+
+} // ecell4
+
+#endif /* ECELL4_GILLESPIE_TAU_LEAPING_SIMULATOR_HPP */
@@ -0,0 +1,125 @@
+#define BOOST_TEST_MODULE "EnsembleRunner_test"
+
+#ifdef UNITTEST_FRAMEWORK_LIBRARY_EXIST
+#   include <boost/test/unit_test.hpp>
+#else
+#   define BOOST_TEST_NO_LIB
+#   include <boost/test/included/unit_test.hpp>
+#endif
+
+#include <boost/test/floating_point_comparison.hpp>
+
+#include <ecell4/core/RandomNumberGenerator.hpp>
+#include <ecell4/core/NetworkModel.hpp>
+#include <ecell4/core/EnsembleRunner.hpp>
+
+#include <ecell4/gillespie/GillespieFactory.hpp>
+
+using namespace ecell4;
+using namespace ecell4::gillespie;
+
+BOOST_AUTO_TEST_CASE(QuantileEstimator_test)
+{
+    GSLRandomNumberGenerator rng(0);
+    QuantileEstimator median(0.5), upper(0.9);
+    for (unsigned int i(0); i < 10000; ++i)
+    {
+        const Real x(rng.uniform(0.0, 1.0));
+        median.add(x);
+        upper.add(x);
+    }
+    BOOST_CHECK_EQUAL(median.count(), 10000);
+    BOOST_CHECK_CLOSE(median.value(), 0.5, 5.0);
+    BOOST_CHECK_CLOSE(upper.value(), 0.9, 5.0);
+
+    QuantileEstimator few(0.5);
+    few.add(3.0);
+    few.add(1.0);
+    few.add(2.0);
+    BOOST_CHECK_EQUAL(few.value(), 2.0);
+}
+
+static boost::shared_ptr<NetworkModel> create_decay_model()
+{
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    ReactionRule rr1;
+    rr1.set_k(1.0);
+    rr1.add_reactant(Species("A"));
+    model->add_reaction_rule(rr1);
+    return model;
+}
+
+BOOST_AUTO_TEST_CASE(EnsembleRunner_test_run)
+{
+    const boost::shared_ptr<NetworkModel> model(create_decay_model());
+
+    GillespieFactory factory;
+    boost::shared_ptr<GillespieWorld> world(factory.world(Real3(1.0, 1.0, 1.0)));
+    world->add_molecules(Species("A"), 100);
+
+    std::vector<Real> t;
+    t.push_back(0.0);
+    t.push_back(0.5);
+    t.push_back(1.0);
+    std::vector<std::string> species(1, "A");
+    std::vector<Real> quantiles(1, 0.5);
+
+    EnsembleRunner<GillespieFactory> runner(factory, model, t, species, quantiles);
+    runner.run(world, 200, 1, 2);
+    BOOST_CHECK_EQUAL(runner.num_trajectories(), 200);
+
+    // The initial world is left as it is.
+    BOOST_CHECK_EQUAL(world->num_molecules(Species("A")), 100);
+    BOOST_CHECK_EQUAL(world->t(), 0.0);
+
+    const EnsembleRunner<GillespieFactory>::data_container_type
+        mean(runner.mean()), variance(runner.variance()), median(runner.quantile(0.5));
+    BOOST_CHECK_EQUAL(mean.size(), 3);
+    BOOST_CHECK_EQUAL(mean[0].size(), 2);
+
+    // A decays with the probability 1 - exp(-t) independently.
+    BOOST_CHECK_EQUAL(mean[0][0], 0.0);
+    BOOST_CHECK_EQUAL(mean[0][1], 100.0);
+    BOOST_CHECK_EQUAL(variance[0][1], 0.0);
+    BOOST_CHECK_EQUAL(mean[2][0], 1.0);
+    BOOST_CHECK_CLOSE(mean[2][1], 100 * std::exp(-1.0), 5.0);
+    BOOST_CHECK_CLOSE(variance[2][1], 100 * std::exp(-1.0) * (1 - std::exp(-1.0)), 30.0);
+    BOOST_CHECK_CLOSE(median[2][1], 100 * std::exp(-1.0), 10.0);
+
+    BOOST_CHECK_THROW(runner.quantile(0.9), NotFound);
+}
+
+BOOST_AUTO_TEST_CASE(EnsembleRunner_test_reproducibility)
+{
+    const boost::shared_ptr<NetworkModel> model(create_decay_model());
+
+    GillespieFactory factory;
+    boost::shared_ptr<GillespieWorld> world(factory.world(Real3(1.0, 1.0, 1.0)));
+    world->add_molecules(Species("A"), 50);
+
+    std::vector<Real> t(1, 1.0);
+    std::vector<std::string> species(1, "A");
+
+    EnsembleRunner<GillespieFactory> runner1(factory, model, t, species);
+    runner1.run(world, 20, 3, 1);
+
+    EnsembleRunner<GillespieFactory> runner2(factory, model, t, species);
+    runner2.run(world, 10, 3, 2);
+    runner2.run(world, 10, 3, 3);
+
+    BOOST_CHECK_CLOSE(runner1.mean()[0][1], runner2.mean()[0][1], 1e-8);
+    BOOST_CHECK_CLOSE(runner1.variance()[0][1], runner2.variance()[0][1], 1e-8);
+}
+
+BOOST_AUTO_TEST_CASE(EnsembleRunner_test_shared_rng)
+{
+    const boost::shared_ptr<NetworkModel> model(create_decay_model());
+
+    GillespieFactory factory;
+    factory.rng(boost::shared_ptr<RandomNumberGenerator>(new GSLRandomNumberGenerator()));
+    boost::shared_ptr<GillespieWorld> world(factory.world(Real3(1.0, 1.0, 1.0)));
+
+    EnsembleRunner<GillespieFactory> runner(
+        factory, model, std::vector<Real>(1, 1.0), std::vector<std::string>(1, "A"));
+    BOOST_CHECK_THROW(runner.run(world, 10), std::invalid_argument);
+}
@@ -47,3 +47,138 @@ BOOST_AUTO_TEST_CASE(GillespieSimulator_test_step)
     BOOST_CHECK(world->num_molecules(sp1) == 9);
 
 }
+
+BOOST_AUTO_TEST_CASE(GillespieSimulator_test_partial_sum_tree)
+{
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A");
+    Species sp2("B");
+    Species sp3("C");
+    ReactionRule rr1, rr2;
+    rr1.set_k(5.0);
+    rr1.add_reactant(sp1);
+    rr1.add_product(sp2);
+    rr2.set_k(1.0);
+    rr2.add_reactant(sp1);
+    rr2.add_reactant(sp2);
+    rr2.add_product(sp3);
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+    model->add_reaction_rule(rr1);
+    model->add_reaction_rule(rr2);
+
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    boost::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+    boost::shared_ptr<GillespieWorld> world(new GillespieWorld(edge_lengths, rng));
+
+    world->add_molecules(sp1, 100);
+
+    GillespieSimulator sim(world, model, PARTIAL_SUM_TREE);
+    BOOST_CHECK_EQUAL(sim.solver_type(), PARTIAL_SUM_TREE);
+
+    sim.set_t(0.0);
+    while (sim.step(10.0))
+    {
+        BOOST_CHECK_EQUAL(
+            world->num_molecules(sp1) + world->num_molecules(sp2)
+                + 2 * world->num_molecules(sp3), 100);
+    }
+
+    BOOST_CHECK_EQUAL(world->num_molecules(sp1), 0);
+    BOOST_CHECK_EQUAL(sim.num_steps(), 100);
+}
+
+class GillespieSimulatorProbe
+    : public GillespieSimulator
+{
+public:
+
+    GillespieSimulatorProbe(
+        boost::shared_ptr<GillespieWorld> world, boost::shared_ptr<Model> model)
+        : GillespieSimulator(world, model)
+    {
+        ;
+    }
+
+    std::vector<Real> propensities() const
+    {
+        std::vector<Real> retval;
+        for (boost::ptr_vector<ReactionRuleEvent>::const_iterator i(events_.begin());
+            i != events_.end(); ++i)
+        {
+            retval.push_back((*i).propensity());
+        }
+        return retval;
+    }
+};
+
+/**
+ * check the propensities updated through the dependency cache against those
+ * of a simulator initialized with a copy of the world. They decide a draw,
+ * so the trajectory is the same as that of recounting at every step.
+ */
+void check_propensities(
+    const GillespieSimulatorProbe& sim, const GillespieWorld& world,
+    const boost::shared_ptr<Model>& model)
+{
+    boost::shared_ptr<GillespieWorld> copied(
+        new GillespieWorld(world.edge_lengths(),
+            boost::shared_ptr<RandomNumberGenerator>(new GSLRandomNumberGenerator(0))));
+    const std::vector<Species> species(world.list_species());
+    for (std::vector<Species>::const_iterator i(species.begin()); i != species.end(); ++i)
+    {
+        copied->add_molecules(*i, world.num_molecules_exact(*i));
+    }
+
+    const std::vector<Real> expected(GillespieSimulatorProbe(copied, model).propensities());
+    const std::vector<Real> propensities(sim.propensities());
+    BOOST_CHECK_EQUAL_COLLECTIONS(
+        propensities.begin(), propensities.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(GillespieSimulator_test_dependencies)
+{
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    const Species sp1("A"), sp2("B"), sp3("C"), sp4("D");
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 1.0));
+    model->add_reaction_rule(create_binding_reaction_rule(sp1, sp2, sp3, 0.1));
+    model->add_reaction_rule(create_unbinding_reaction_rule(sp3, sp1, sp1, 0.5));
+
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    boost::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator(1));
+    boost::shared_ptr<GillespieWorld> world(new GillespieWorld(edge_lengths, rng));
+    world->add_molecules(sp1, 100);
+
+    GillespieSimulatorProbe sim(world, model);
+    for (Integer i(0); i < 50; ++i)
+    {
+        sim.step();
+        check_propensities(sim, *world, model);
+    }
+
+    // the cache is rebuilt at initialize after the world changed.
+    world->add_molecules(sp2, 30);
+    world->add_molecules(sp4, 20);
+    sim.initialize();
+    check_propensities(sim, *world, model);
+    for (Integer i(0); i < 50; ++i)
+    {
+        sim.step();
+        check_propensities(sim, *world, model);
+    }
+
+    // and after the model changed.
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp4, sp1, 2.0));
+    model->add_reaction_rule(create_binding_reaction_rule(sp4, sp4, sp3, 0.2));
+    sim.initialize();
+    check_propensities(sim, *world, model);
+    for (Integer i(0); i < 50; ++i)
+    {
+        sim.step();
+        check_propensities(sim, *world, model);
+    }
+    BOOST_CHECK_EQUAL(sim.num_steps(), 150);
+}
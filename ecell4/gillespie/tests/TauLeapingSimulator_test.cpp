@@ -0,0 +1,174 @@
+#define BOOST_TEST_MODULE "TauLeapingSimulator_test"
+
+#ifdef UNITTEST_FRAMEWORK_LIBRARY_EXIST
+#   include <boost/test/unit_test.hpp>
+#else
+#   define BOOST_TEST_NO_LIB
+#   include <boost/test/included/unit_test.hpp>
+#endif
+
+#include <boost/test/floating_point_comparison.hpp>
+
+#include <ecell4/core/RandomNumberGenerator.hpp>
+#include <ecell4/core/Model.hpp>
+#include <ecell4/core/NetworkModel.hpp>
+#include <ecell4/core/NetfreeModel.hpp>
+
+#include <ecell4/gillespie/GillespieWorld.hpp>
+#include <ecell4/gillespie/TauLeapingSimulator.hpp>
+#include <ecell4/gillespie/TauLeapingFactory.hpp>
+
+using namespace ecell4;
+using namespace ecell4::gillespie;
+
+BOOST_AUTO_TEST_CASE(TauLeapingSimulator_test_step)
+{
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A");
+    Species sp2("B");
+    ReactionRule rr1;
+    rr1.set_k(1.0);
+    rr1.add_reactant(sp1);
+    rr1.add_product(sp2);
+    model->add_reaction_rule(rr1);
+
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    boost::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+    boost::shared_ptr<GillespieWorld> world(new GillespieWorld(edge_lengths, rng));
+
+    world->add_molecules(sp1, 100000);
+
+    TauLeapingSimulator sim(world, model);
+    BOOST_CHECK(sim.is_leaping());
+
+    sim.step();
+    BOOST_CHECK(0 < sim.t());
+    BOOST_CHECK(sim.check_reaction());
+    BOOST_CHECK(world->num_molecules(sp1) < 100000);
+    BOOST_CHECK_EQUAL(world->num_molecules(sp1) + world->num_molecules(sp2), 100000);
+
+    // A leap takes many reactions at once.
+    BOOST_CHECK(world->num_molecules(sp2) > 1);
+}
+
+BOOST_AUTO_TEST_CASE(TauLeapingSimulator_test_exact_step)
+{
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A");
+    Species sp2("B");
+    ReactionRule rr1;
+    rr1.set_k(1.0);
+    rr1.add_reactant(sp1);
+    rr1.add_product(sp2);
+    model->add_reaction_rule(rr1);
+
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    boost::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+    boost::shared_ptr<GillespieWorld> world(new GillespieWorld(edge_lengths, rng));
+
+    world->add_molecules(sp1, 5);
+
+    TauLeapingSimulator sim(world, model);
+    BOOST_CHECK(!sim.is_leaping());
+
+    sim.step();
+    BOOST_CHECK_EQUAL(world->num_molecules(sp1), 4);
+    BOOST_CHECK_EQUAL(world->num_molecules(sp2), 1);
+
+    while (sim.step(100.0))
+    {
+        ; // do nothing
+    }
+    BOOST_CHECK_EQUAL(world->num_molecules(sp1), 0);
+    BOOST_CHECK_EQUAL(world->num_molecules(sp2), 5);
+}
+
+BOOST_AUTO_TEST_CASE(TauLeapingSimulator_test_decay)
+{
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A");
+    ReactionRule rr1;
+    rr1.set_k(1.0);
+    rr1.add_reactant(sp1);
+    model->add_reaction_rule(rr1);
+
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    boost::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator(0));
+    boost::shared_ptr<GillespieWorld> world(new GillespieWorld(edge_lengths, rng));
+
+    const Integer N(100000);
+    world->add_molecules(sp1, N);
+
+    TauLeapingSimulator sim(world, model);
+    while (sim.step(1.0))
+    {
+        ; // do nothing
+    }
+
+    BOOST_CHECK_CLOSE(sim.t(), 1.0, 1e-6);
+    BOOST_CHECK_CLOSE(
+        static_cast<Real>(world->num_molecules(sp1)), N * std::exp(-1.0), 3.0);
+    BOOST_CHECK(sim.num_steps() < N / 100);
+}
+
+BOOST_AUTO_TEST_CASE(TauLeapingSimulator_test_second_order)
+{
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A");
+    Species sp2("B");
+    Species sp3("C");
+    ReactionRule rr1, rr2;
+    rr1.set_k(1e-4);
+    rr1.add_reactant(sp1);
+    rr1.add_reactant(sp2);
+    rr1.add_product(sp3);
+    rr2.set_k(100.0);
+    rr2.add_product(sp1);
+    model->add_reaction_rule(rr1);
+    model->add_reaction_rule(rr2);
+
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    boost::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+    boost::shared_ptr<GillespieWorld> world(new GillespieWorld(edge_lengths, rng));
+
+    world->add_molecules(sp1, 10000);
+    world->add_molecules(sp2, 10000);
+
+    TauLeapingSimulator sim(world, model);
+    while (sim.step(10.0))
+    {
+        BOOST_CHECK(world->num_molecules(sp1) >= 0);
+        BOOST_CHECK(world->num_molecules(sp2) >= 0);
+    }
+
+    BOOST_CHECK_EQUAL(world->num_molecules(sp2) + world->num_molecules(sp3), 10000);
+}
+
+BOOST_AUTO_TEST_CASE(TauLeapingSimulator_test_netfree_model)
+{
+    boost::shared_ptr<NetfreeModel> model(new NetfreeModel());
+    Species sp1("A");
+    ReactionRule rr1;
+    rr1.set_k(1.0);
+    rr1.add_reactant(sp1);
+    model->add_reaction_rule(rr1);
+
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    boost::shared_ptr<GillespieWorld> world(new GillespieWorld(edge_lengths));
+
+    BOOST_CHECK_THROW(TauLeapingSimulator(world, model), NotSupported);
+}
+
+BOOST_AUTO_TEST_CASE(TauLeapingFactory_test)
+{
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    TauLeapingFactory factory(0.01);
+    boost::shared_ptr<GillespieWorld> world(factory.world(Real3(1.0, 1.0, 1.0)));
+    boost::shared_ptr<TauLeapingSimulator> sim(factory.simulator(world, model));
+    BOOST_CHECK_EQUAL(sim->epsilon(), 0.01);
+}
@@ -29,8 +29,12 @@ public:
 
     MesoscopicFactory(
         const Integer3& matrix_sizes = default_matrix_sizes(),
-        const Real subvolume_length = default_subvolume_length())
-        : base_type(), rng_(), matrix_sizes_(matrix_sizes), subvolume_length_(subvolume_length)
+        const Real subvolume_length = default_subvolume_length(),
+        const EventQueueType queue_type = default_queue_type(),
+        const SubvolumeSpaceType space_type = default_space_type(),
+        const Integer num_threads = default_num_threads())
+        : base_type(), rng_(), matrix_sizes_(matrix_sizes), subvolume_length_(subvolume_length),
+          queue_type_(queue_type), space_type_(space_type), num_threads_(num_threads)
     {
         ; // do nothing
     }
@@ -50,6 +54,21 @@ public:
         return 0.0;
     }
 
+    static inline const EventQueueType default_queue_type()
+    {
+        return HEAP_QUEUE;
+    }
+
+    static inline const SubvolumeSpaceType default_space_type()
+    {
+        return VECTOR_SUBVOLUME;
+    }
+
+    static inline const Integer default_num_threads()
+    {
+        return 1;
+    }
+
     this_type& rng(const boost::shared_ptr<RandomNumberGenerator>& rng)
     {
         rng_ = rng;
@@ -61,10 +80,38 @@ public:
         return &(this->rng(rng));  //XXX: == this
     }
 
+    /**
+     * create a world with the matrix sizes, structures and numbers of
+     * molecules in each subvolume of the given one, in the space type
+     * of this factory.
+     */
+    world_type* copy_world(const world_type& w) const
+    {
+        world_type* retval(create_mesoscopic_world(
+            w.edge_lengths(), w.matrix_sizes(), (rng_ ? rng_ : create_rng()), space_type_));
+        retval->copy_state(w);
+        return retval;
+    }
+
 protected:
 
     virtual world_type* create_world(const Real3& edge_lengths) const
     {
+        if (space_type_ != VECTOR_SUBVOLUME)
+        {
+            Integer3 matrix_sizes(matrix_sizes_);
+            if (matrix_sizes_ == default_matrix_sizes()
+                && subvolume_length_ != default_subvolume_length())
+            {
+                matrix_sizes = Integer3(
+                    round(edge_lengths[0] / subvolume_length_),
+                    round(edge_lengths[1] / subvolume_length_),
+                    round(edge_lengths[2] / subvolume_length_));
+            }
+            return create_mesoscopic_world(
+                edge_lengths, matrix_sizes, (rng_ ? rng_ : create_rng()), space_type_);
+        }
+
         if (rng_)
         {
             if (matrix_sizes_ != default_matrix_sizes())
@@ -92,11 +139,32 @@ protected:
         return new world_type(edge_lengths);
     }
 
+    virtual simulator_type* create_simulator(
+        const boost::shared_ptr<world_type>& w, const boost::shared_ptr<Model>& m) const
+    {
+        simulator_type* sim(new simulator_type(w, m, queue_type_));
+        if (num_threads_ != 1)
+        {
+            sim->set_num_threads(num_threads_);
+        }
+        return sim;
+    }
+
+    static boost::shared_ptr<RandomNumberGenerator> create_rng()
+    {
+        boost::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+        rng->seed();
+        return rng;
+    }
+
 protected:
 
     boost::shared_ptr<RandomNumberGenerator> rng_;
     Integer3 matrix_sizes_;
     Real subvolume_length_;
+    EventQueueType queue_type_;
+    SubvolumeSpaceType space_type_;
+    Integer num_threads_;
 };
 
 } // meso
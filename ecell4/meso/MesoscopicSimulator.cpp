@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <numeric>
 #include <vector>
 #include <gsl/gsl_sf_log.h>
@@ -9,6 +10,8 @@
 
 #include <boost/scoped_array.hpp>
 
+#include <ecell4/core/parallel.hpp>
+
 #include "MesoscopicSimulator.hpp"
 
 
@@ -22,22 +25,18 @@ void MesoscopicSimulator::increment(const boost::shared_ptr<MesoscopicWorld::Poo
 {
     pool->add_molecules(1, c);
 
-    for (boost::ptr_vector<ReactionRuleProxyBase>::iterator i(proxies_.begin());
-        i != proxies_.end(); ++i)
-    {
-        (*i).inc(pool->species(), c);
-    }
+    DiffusionProxy* proxy(get_diffusion_proxy(pool->species()));
+    proxy->inc_dependencies(c, +1);
+    update_propensities(*proxy, c);
 }
 
 void MesoscopicSimulator::decrement(const boost::shared_ptr<MesoscopicWorld::PoolBase>& pool, const coordinate_type& c)
 {
     pool->remove_molecules(1, c);
 
-    for (boost::ptr_vector<ReactionRuleProxyBase>::iterator i(proxies_.begin());
-        i != proxies_.end(); ++i)
-    {
-        (*i).dec(pool->species(), c);
-    }
+    DiffusionProxy* proxy(get_diffusion_proxy(pool->species()));
+    proxy->inc_dependencies(c, -1);
+    update_propensities(*proxy, c);
 }
 
 void MesoscopicSimulator::increment_molecules(const Species& sp, const coordinate_type& c)
@@ -48,9 +47,30 @@ void MesoscopicSimulator::increment_molecules(const Species& sp, const coordinat
         {
             return; // do nothing
         }
+        else if (domains_.size() > 1)
+        {
+            // a pool cannot be reserved while the domains run in threads.
+            std::ostringstream message;
+            message << "A new species [" << sp.serial()
+                << "] cannot be produced with more than one thread.";
+            throw NotSupported(message.str());
+        }
 
         const boost::shared_ptr<MesoscopicWorld::PoolBase> pool = world_->reserve_pool(sp);
         proxies_.push_back(create_diffusion_proxy(sp));
+
+        // The new proxy has no molecule in any subvolume yet.
+        for (std::vector<propensity_tree_type>::iterator i(propensities_.begin());
+            i != propensities_.end(); ++i)
+        {
+            std::vector<Real> a((*i).size() + 1, 0.0);
+            for (propensity_tree_type::size_type j(0); j < (*i).size(); ++j)
+            {
+                a[j] = (*i).get(j);
+            }
+            (*i).assign(a);
+        }
+
         increment(pool, c);
     }
     else
@@ -74,13 +94,14 @@ void MesoscopicSimulator::decrement_molecules(const Species& sp, const coordinat
 std::pair<Real, MesoscopicSimulator::ReactionRuleProxyBase*>
 MesoscopicSimulator::draw_next_reaction(const coordinate_type& c)
 {
-    std::vector<double> a(proxies_.size());
-    for (unsigned int idx(0); idx < proxies_.size(); ++idx)
+    propensity_tree_type& a(propensities_[c]);
+    for (std::vector<std::size_t>::const_iterator i(time_dependent_proxies_.begin());
+        i != time_dependent_proxies_.end(); ++i)
     {
-        a[idx] = proxies_[idx].propensity(c);
+        a.set(*i, proxies_[*i].propensity(c));
     }
 
-    const double atot(std::accumulate(a.begin(), a.end(), double(0.0)));
+    const double atot(a.total());
     if (atot == 0.0)
     {
         return std::make_pair(inf, (ReactionRuleProxyBase*)NULL);
@@ -97,39 +118,147 @@ MesoscopicSimulator::draw_next_reaction(const coordinate_type& c)
             }
         }
 
-        const unsigned int idx = selected[(selected.size() == 1 ? 0 : rng()->uniform_int(0, selected.size() - 1))];
+        const unsigned int idx = selected[(selected.size() == 1 ? 0 : rng(c)->uniform_int(0, selected.size() - 1))];
         return std::make_pair(0.0, &proxies_[idx]);
     }
 
-    const double rnd1(rng()->uniform(0, 1));
+    const double rnd1(rng(c)->uniform(0, 1));
     const double dt(gsl_sf_log(1.0 / rnd1) / double(atot));
-    const double rnd2(rng()->uniform(0, atot));
+    const double rnd2(rng(c)->uniform(0, atot));
+    return std::make_pair(dt, &proxies_[a.find(rnd2)]);
+}
 
-    int u(-1);
-    double acc(0.0);
-    const int len_a(a.size());
-    do
+void MesoscopicSimulator::reset_propensities()
+{
+    time_dependent_proxies_.clear();
+    for (std::size_t i(0); i < diffusion_proxy_offset_; ++i)
     {
-        u++;
-        acc += a[u];
-    } while (acc < rnd2 && u < len_a - 1);
+        if (dynamic_cast<const DescriptorReactionRuleProxy*>(&proxies_[i]) != NULL)
+        {
+            time_dependent_proxies_.push_back(i);
+        }
+    }
 
-    if (len_a == u)
+    propensities_.resize(world_->num_subvolumes());
+    std::vector<Real> a(proxies_.size());
+    for (coordinate_type c(0); c < world_->num_subvolumes(); ++c)
     {
-        return std::make_pair(inf, (ReactionRuleProxyBase*)NULL);
+        for (std::size_t i(0); i < proxies_.size(); ++i)
+        {
+            a[i] = proxies_[i].propensity(c);
+        }
+        propensities_[c].assign(a);
     }
-
-    return std::make_pair(dt, &proxies_[u]);
 }
 
 void MesoscopicSimulator::interrupt_all(const Real& t)
 {
-    EventScheduler::events_range events(scheduler_.events());
-    for (EventScheduler::events_range::iterator itr(events.begin());
-            itr != events.end(); ++itr)
+    for (boost::ptr_vector<Domain>::iterator i(domains_.begin());
+        i != domains_.end(); ++i)
     {
-        (*itr).second->interrupt(t);
-        scheduler_.update(*itr);
+        scheduler_type& scheduler((*i).scheduler);
+        scheduler_type::events_range events(scheduler.events());
+        for (scheduler_type::events_range::iterator itr(events.begin());
+                itr != events.end(); ++itr)
+        {
+            (*itr).second->interrupt(t);
+        }
+        scheduler.update(events.begin(), events.end());
+    }
+}
+
+/**
+ * fire the events of a domain up to the given time. This touches only
+ * the subvolumes of the domain, and runs in a thread.
+ */
+void MesoscopicSimulator::fire_events(Domain& domain, const Real upto)
+{
+    scheduler_type& scheduler(domain.scheduler);
+    while (scheduler.next_time() <= upto)
+    {
+        domain.interrupted = event_ids_.size();
+        scheduler_type::value_type const& top(scheduler.top());
+        const Real tnext(top.second->time());
+        top.second->fire(); // top.second->time_ is updated in fire()
+        scheduler.update(top);
+
+        if (domain.interrupted < static_cast<coordinate_type>(event_ids_.size()))
+        {
+            scheduler_type::identifier_type evid(event_ids_[domain.interrupted]);
+            boost::shared_ptr<Event> ev(scheduler.get(evid));
+            ev->interrupt(tnext);
+            scheduler.update(std::make_pair(evid, ev));
+        }
+    }
+}
+
+/**
+ * fire the events of all the domains in a time window up to the given time,
+ * and then move the molecules diffused over the boundaries of domains.
+ * If an event throws, the molecules which already left their domains
+ * still arrive before the exception is rethrown.
+ */
+void MesoscopicSimulator::step_in_domains(const Real upto)
+{
+    std::vector<std::size_t> items(domains_.size());
+    for (std::size_t i(0); i < domains_.size(); ++i)
+    {
+        domains_[i].last_reactions.clear();
+        domains_[i].arrivals.clear();
+        items[i] = i;
+    }
+
+    try
+    {
+        parallel_for_each(num_threads_, items,
+            [&](const std::size_t i)
+            {
+                fire_events(domains_[i], upto);
+            });
+    }
+    catch (...)
+    {
+        deliver_arrivals(upto);
+        throw;
+    }
+
+    deliver_arrivals(upto);
+
+    this->set_t(upto);
+    num_steps_++;
+}
+
+/**
+ * put the molecules diffused over the boundaries of domains into their
+ * destinations, and reschedule the events of these subvolumes at upto.
+ */
+void MesoscopicSimulator::deliver_arrivals(const Real upto)
+{
+    // the molecules arrive in the order of domains, which keeps
+    // a trajectory independent of the scheduling of threads.
+    std::vector<coordinate_type> arrived;
+    for (boost::ptr_vector<Domain>::iterator i(domains_.begin());
+        i != domains_.end(); ++i)
+    {
+        for (Domain::arrival_container_type::const_iterator j((*i).arrivals.begin());
+            j != (*i).arrivals.end(); ++j)
+        {
+            (*j).first->arrive((*j).second);
+            arrived.push_back((*j).second);
+        }
+        (*i).arrivals.clear();
+    }
+
+    std::sort(arrived.begin(), arrived.end());
+    arrived.erase(std::unique(arrived.begin(), arrived.end()), arrived.end());
+    for (std::vector<coordinate_type>::const_iterator i(arrived.begin());
+        i != arrived.end(); ++i)
+    {
+        scheduler_type& scheduler(domains_[domain_of(*i)].scheduler);
+        scheduler_type::identifier_type evid(event_ids_[*i]);
+        boost::shared_ptr<Event> ev(scheduler.get(evid));
+        ev->interrupt(upto);
+        scheduler.update(std::make_pair(evid, ev));
     }
 }
 
@@ -141,19 +270,27 @@ void MesoscopicSimulator::step(void)
         return;
     }
 
-    interrupted_ = event_ids_.size();
-    EventScheduler::value_type const& top(scheduler_.top());
+    if (domains_.size() > 1)
+    {
+        step_in_domains(next_time());
+        return;
+    }
+
+    scheduler_type& scheduler(domains_[0].scheduler);
+    reset_last_reactions();
+    domains_[0].interrupted = event_ids_.size();
+    scheduler_type::value_type const& top(scheduler.top());
     const Real tnext(top.second->time());
     top.second->fire(); // top.second->time_ is updated in fire()
     this->set_t(tnext);
-    scheduler_.update(top);
+    scheduler.update(top);
 
-    if (interrupted_ < static_cast<coordinate_type>(event_ids_.size()))
+    if (domains_[0].interrupted < static_cast<coordinate_type>(event_ids_.size()))
     {
-        EventScheduler::identifier_type evid(event_ids_[interrupted_]);
-        boost::shared_ptr<Event> ev(scheduler_.get(evid));
+        scheduler_type::identifier_type evid(event_ids_[domains_[0].interrupted]);
+        boost::shared_ptr<Event> ev(scheduler.get(evid));
         ev->interrupt(t());
-        scheduler_.update(std::make_pair(evid, ev));
+        scheduler.update(std::make_pair(evid, ev));
     }
 
     // EventScheduler::value_type top(scheduler_.pop());
@@ -179,6 +316,14 @@ bool MesoscopicSimulator::step(const Real &upto)
         return false;
     }
 
+    if (domains_.size() > 1 && this->dt() != inf)
+    {
+        // the window ends at upto, if earlier.
+        const Real tnext(next_time());
+        step_in_domains(std::min(tnext, upto));
+        return (tnext <= upto);
+    }
+
     if (upto >= next_time())
     {
         step();
@@ -189,7 +334,7 @@ bool MesoscopicSimulator::step(const Real &upto)
         // nothing happens
         // set_dt(next_time() - upto);
         set_t(upto);
-        last_reactions_.clear();
+        reset_last_reactions();
         // interrupt_all(upto);  //XXX: Is this really needed?
         return false;
     }
@@ -198,17 +343,86 @@ bool MesoscopicSimulator::step(const Real &upto)
 MesoscopicSimulator::DiffusionProxy*
 MesoscopicSimulator::create_diffusion_proxy(const Species& sp)
 {
-    DiffusionProxy* proxy = new DiffusionProxy(this, sp);
+    DiffusionProxy* proxy = new DiffusionProxy(this, sp, proxies_.size());
     proxy->initialize();
     for (boost::ptr_vector<ReactionRuleProxyBase>::size_type i = 0;
          i < diffusion_proxy_offset_; ++i)
     {
         proxy->set_dependency(
-            dynamic_cast<ReactionRuleProxy*>(&proxies_[i]));
+            dynamic_cast<ReactionRuleProxy*>(&proxies_[i]), i);
     }
+    diffusion_proxies_[sp] = proxy;
     return proxy;
 }
 
+MesoscopicSimulator::DiffusionProxy*
+MesoscopicSimulator::get_diffusion_proxy(const Species& sp) const
+{
+    // find never modifies the map, and is safe in threads unlike operator[].
+    utils::get_mapper_mf<Species, DiffusionProxy*>::type::const_iterator
+        i(diffusion_proxies_.find(sp));
+    assert(i != diffusion_proxies_.end());
+    return (*i).second;
+}
+
+/**
+ * divide the layers of subvolumes into domains. A single domain shares
+ * the random number generator of the world, and is stepped event by event.
+ */
+void MesoscopicSimulator::initialize_domains()
+{
+    const Integer3 matrix_sizes(world_->matrix_sizes());
+    const std::size_t num_layers(matrix_sizes[2]);
+    const std::size_t num_domains(
+        std::min(static_cast<std::size_t>(num_threads_), num_layers));
+
+    layer_size_ = matrix_sizes[0] * matrix_sizes[1];
+    layer_domains_.resize(num_layers);
+    for (std::size_t layer(0); layer < num_layers; ++layer)
+    {
+        layer_domains_[layer] = layer * num_domains / num_layers;
+    }
+
+    domains_.clear();
+    if (num_domains == 1)
+    {
+        domains_.push_back(new Domain(queue_type_, world_->rng()));
+        return;
+    }
+
+    // the streams of one seed are independent, and cheap to make.
+    const Integer seed(world_->rng()->uniform_int(0, std::numeric_limits<int>::max()));
+    for (std::size_t i(0); i < num_domains; ++i)
+    {
+        domains_.push_back(new Domain(queue_type_,
+            boost::shared_ptr<RandomNumberGenerator>(
+                new PhiloxRandomNumberGenerator(seed, i))));
+    }
+}
+
+/**
+ * reserve the pools of all the products in advance, because no pool can be
+ * reserved while the domains run in threads. Only a static model knows them.
+ */
+void MesoscopicSimulator::reserve_products()
+{
+    const Model::reaction_rule_container_type&
+        reaction_rules(model_->reaction_rules());
+    for (Model::reaction_rule_container_type::const_iterator
+        i(reaction_rules.begin()); i != reaction_rules.end(); ++i)
+    {
+        const ReactionRule::product_container_type& products((*i).products());
+        for (ReactionRule::product_container_type::const_iterator
+            j(products.begin()); j != products.end(); ++j)
+        {
+            if (!world_->has_species(*j) && !world_->has_structure(*j))
+            {
+                world_->reserve_pool(*j);
+            }
+        }
+    }
+}
+
 void MesoscopicSimulator::check_model(void)
 {
     const Model::reaction_rule_container_type&
@@ -265,7 +479,19 @@ void MesoscopicSimulator::initialize(void)
 
     check_model();
 
+    initialize_domains();
+    if (domains_.size() > 1)
+    {
+        if (!model_->is_static())
+        {
+            throw NotSupported(
+                "A non-static model is not supported with more than one thread.");
+        }
+        reserve_products();
+    }
+
     proxies_.clear();
+    diffusion_proxies_.clear();
     for (Model::reaction_rule_container_type::const_iterator
         i(reaction_rules.begin()); i != reaction_rules.end(); ++i)
     {
@@ -273,6 +499,11 @@ void MesoscopicSimulator::initialize(void)
 
         if (rr.has_descriptor())
         {
+            if (domains_.size() > 1)
+            {
+                throw NotSupported(
+                    "A reaction rule descriptor is not supported with more than one thread.");
+            }
             proxies_.push_back(new DescriptorReactionRuleProxy(this, rr));
         }
         else if (rr.reactants().size() == 0)
@@ -320,12 +551,13 @@ void MesoscopicSimulator::initialize(void)
         proxies_.push_back(create_diffusion_proxy(*i));
     }
 
-    scheduler_.clear();
+    reset_propensities();
+
     event_ids_.resize(world_->num_subvolumes());
     for (Integer i(0); i < world_->num_subvolumes(); ++i)
     {
         event_ids_[i] =
-            scheduler_.add(boost::shared_ptr<Event>(
+            domains_[domain_of(i)].scheduler.add(boost::shared_ptr<Event>(
                 new SubvolumeEvent(this, i, t())));
     }
 }
@@ -335,9 +567,40 @@ Real MesoscopicSimulator::dt(void) const
     return next_time() - t();
 }
 
+/**
+ * return the time when the next step ends. In parallel, it is the end of
+ * the time window opening at the earliest event.
+ */
 Real MesoscopicSimulator::next_time(void) const
 {
-    return scheduler_.next_time();
+    Real tnext(inf);
+    for (boost::ptr_vector<Domain>::const_iterator i(domains_.begin());
+        i != domains_.end(); ++i)
+    {
+        tnext = std::min(tnext, (*i).scheduler.next_time());
+    }
+
+    if (domains_.size() > 1 && tnext != inf)
+    {
+        tnext += window();
+    }
+    return tnext;
+}
+
+Real MesoscopicSimulator::window() const
+{
+    if (window_ > 0)
+    {
+        return window_;
+    }
+
+    Real kmax(0.0);
+    for (utils::get_mapper_mf<Species, DiffusionProxy*>::type::const_iterator
+        i(diffusion_proxies_.begin()); i != diffusion_proxies_.end(); ++i)
+    {
+        kmax = std::max(kmax, (*i).second->k());
+    }
+    return (kmax > 0 ? 1.0 / kmax : 0.0);
 }
 
 } // meso
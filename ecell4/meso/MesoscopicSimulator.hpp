@@ -6,7 +6,9 @@
 #include <ecell4/core/types.hpp>
 #include <ecell4/core/Model.hpp>
 #include <ecell4/core/SimulatorBase.hpp>
-#include <ecell4/core/EventScheduler.hpp>
+#include <ecell4/core/FlatEventScheduler.hpp>
+#include <ecell4/core/PartialSumTree.hpp>
+#include <ecell4/core/get_mapper_mf.hpp>
 
 #include "MesoscopicWorld.hpp"
 
@@ -84,7 +86,10 @@ public:
 
     typedef SimulatorBase<MesoscopicWorld> base_type;
     typedef SubvolumeSpace::coordinate_type coordinate_type;
+    typedef SubvolumeSpace::column_type column_type;
+    typedef SubvolumeSpace::row_type row_type;
     typedef ReactionInfo reaction_info_type;
+    typedef FlatEventSchedulerBase<Event, SelectableEventQueue> scheduler_type;
 
 protected:
 
@@ -114,6 +119,23 @@ protected:
             return sim_->model()->apply(pttrn, sp);
         }
 
+        typedef std::vector<std::pair<column_type, Integer> > coef_container_type;
+
+        /**
+         * sum up the numbers of molecules in a row weighted by the given
+         * (column, coefficient) pairs.
+         */
+        static inline Integer sum_in_row(const row_type& row, const coef_container_type& coefs)
+        {
+            Integer retval(0);
+            for (coef_container_type::const_iterator i(coefs.begin());
+                i != coefs.end(); ++i)
+            {
+                retval += (*i).second * row[(*i).first];
+            }
+            return retval;
+        }
+
         virtual void initialize() = 0;
         virtual const Real propensity(const coordinate_type& c) const = 0;
         virtual void fire(const Real t, const coordinate_type& src) = 0;
@@ -128,9 +150,13 @@ protected:
 
     protected:
 
-        inline const boost::shared_ptr<RandomNumberGenerator>& rng() const
+        /**
+         * the random number generator of the domain owning the subvolume c.
+         */
+        inline const boost::shared_ptr<RandomNumberGenerator>& rng(
+            const coordinate_type& c) const
         {
-            return sim_->world()->rng();
+            return sim_->rng(c);
         }
 
         inline const MesoscopicWorld& world() const
@@ -213,7 +239,7 @@ protected:
             {
                 const std::vector<ReactionRule>::size_type
                     rnd2(static_cast<std::vector<ReactionRule>::size_type>(
-                        rng()->uniform_int(0, retval.second - 1)));
+                        rng(c)->uniform_int(0, retval.second - 1)));
                 if (rnd2 >= reactions.size())
                 {
                     return std::make_pair(ReactionRule(), c);
@@ -355,30 +381,34 @@ protected:
 
         void initialize()
         {
-            const std::vector<Species>& species(world().list_species());
+            const std::vector<Species>& species(world().species());
             const ReactionRule::reactant_container_type& reactants(rr_.reactants());
 
-            std::fill(num_tot1_.begin(), num_tot1_.end(), 0);
+            coef_container_type coefs;
             for (std::vector<Species>::const_iterator i(species.begin());
                 i != species.end(); ++i)
             {
                 const Integer coef(get_coef(reactants[0], *i));
                 if (coef > 0)
                 {
-                    for (Integer j(0); j < world().num_subvolumes(); ++j)
-                    {
-                        num_tot1_[j] += coef * world().num_molecules_exact(*i, j);
-                    }
+                    coefs.push_back(std::make_pair(i - species.begin(), coef));
                 }
             }
+
+            std::fill(num_tot1_.begin(), num_tot1_.end(), 0);
+            for (Integer j(0); j < world().num_subvolumes(); ++j)
+            {
+                num_tot1_[j] += sum_in_row(world().num_molecules_in_row(j), coefs);
+            }
         }
 
         std::pair<ReactionRule::reactant_container_type, Integer> __draw(const coordinate_type& c)
         {
-            const std::vector<Species>& species(world().list_species());
+            const std::vector<Species>& species(world().species());
             const ReactionRule::reactant_container_type& reactants(rr_.reactants());
 
-            const Real rnd1(rng()->uniform(0.0, num_tot1_[c]));
+            const Real rnd1(rng(c)->uniform(0.0, num_tot1_[c]));
+            const row_type row(world().num_molecules_in_row(c));
 
             Integer num_tot(0);
             for (std::vector<Species>::const_iterator i(species.begin());
@@ -387,7 +417,7 @@ protected:
                 const Integer coef(get_coef(reactants[0], *i));
                 if (coef > 0)
                 {
-                    num_tot += coef * world().num_molecules_exact(*i, c);
+                    num_tot += coef * row[i - species.begin()];
                     if (num_tot >= rnd1)
                     {
                         return std::make_pair(
@@ -455,12 +485,11 @@ protected:
 
         void initialize()
         {
-            const std::vector<Species>& species(world().list_species());
+            const std::vector<Species>& species(world().species());
             const ReactionRule::reactant_container_type& reactants(rr_.reactants());
 
-            std::fill(num_tot1_.begin(), num_tot1_.end(), 0);
-            std::fill(num_tot2_.begin(), num_tot2_.end(), 0);
-            std::fill(num_tot12_.begin(), num_tot12_.end(), 0);
+            std::vector<column_type> columns;
+            std::vector<std::pair<Integer, Integer> > coefs;
             for (std::vector<Species>::const_iterator i(species.begin());
                 i != species.end(); ++i)
             {
@@ -468,24 +497,35 @@ protected:
                 const Integer coef2(get_coef(reactants[1], *i));
                 if (coef1 > 0 || coef2 > 0)
                 {
-                    for (Integer j(0); j < world().num_subvolumes(); ++j)
-                    {
-                        const Integer num(world().num_molecules_exact(*i, j));
-                        const Integer tmp(coef1 * num);
-                        num_tot1_[j] += tmp;
-                        num_tot2_[j] += coef2 * num;
-                        num_tot12_[j] += coef2 * tmp;
-                    }
+                    columns.push_back(i - species.begin());
+                    coefs.push_back(std::make_pair(coef1, coef2));
+                }
+            }
+
+            std::fill(num_tot1_.begin(), num_tot1_.end(), 0);
+            std::fill(num_tot2_.begin(), num_tot2_.end(), 0);
+            std::fill(num_tot12_.begin(), num_tot12_.end(), 0);
+            for (Integer j(0); j < world().num_subvolumes(); ++j)
+            {
+                const row_type row(world().num_molecules_in_row(j));
+                for (std::vector<column_type>::size_type k(0); k < columns.size(); ++k)
+                {
+                    const Integer num(row[columns[k]]);
+                    const Integer tmp(coefs[k].first * num);
+                    num_tot1_[j] += tmp;
+                    num_tot2_[j] += coefs[k].second * num;
+                    num_tot12_[j] += coefs[k].second * tmp;
                 }
             }
         }
 
         std::pair<ReactionRule::reactant_container_type, Integer> __draw(const coordinate_type& c)
         {
-            const std::vector<Species>& species(world().list_species());
+            const std::vector<Species>& species(world().species());
             const ReactionRule::reactant_container_type& reactants(rr_.reactants());
 
-            const Real rnd1(rng()->uniform(0.0, num_tot1_[c]));
+            const Real rnd1(rng(c)->uniform(0.0, num_tot1_[c]));
+            const row_type row(world().num_molecules_in_row(c));
 
             Integer num_tot(0), coef1(0);
             std::vector<Species>::const_iterator itr1(species.begin());
@@ -494,7 +534,7 @@ protected:
                 const Integer coef(get_coef(reactants[0], *itr1));
                 if (coef > 0)
                 {
-                    num_tot += coef * world().num_molecules_exact(*itr1, c);
+                    num_tot += coef * row[itr1 - species.begin()];
                     if (num_tot >= rnd1)
                     {
                         coef1 = coef;
@@ -504,7 +544,7 @@ protected:
             }
 
             const Real rnd2(
-                rng()->uniform(0.0, num_tot2_[c] - get_coef(reactants[0], *itr1)));
+                rng(c)->uniform(0.0, num_tot2_[c] - get_coef(reactants[0], *itr1)));
 
             num_tot = 0;
             for (std::vector<Species>::const_iterator i(species.begin());
@@ -513,7 +553,7 @@ protected:
                 const Integer coef(get_coef(reactants[1], *i));
                 if (coef > 0)
                 {
-                    const Integer num(world().num_molecules_exact(*i, c));
+                    const Integer num(row[i - species.begin()]);
                     num_tot += coef * (i == itr1 ? num - 1 : num);
                     if (num_tot >= rnd2)
                     {
@@ -593,28 +633,32 @@ protected:
                     "A second order reaction between structures has no mean.");
             }
 
-            const std::vector<Species>& species(world().list_species());
-            std::fill(num_tot_.begin(), num_tot_.end(), 0);
+            const std::vector<Species>& species(world().species());
+            coef_container_type coefs;
             for (std::vector<Species>::const_iterator i(species.begin());
                 i != species.end(); ++i)
             {
                 const Integer coef(get_coef(reactants[spidx_], *i));
                 if (coef > 0)
                 {
-                    for (Integer j(0); j < world().num_subvolumes(); ++j)
-                    {
-                        num_tot_[j] += coef * world().num_molecules_exact(*i, j);
-                    }
+                    coefs.push_back(std::make_pair(i - species.begin(), coef));
                 }
             }
+
+            std::fill(num_tot_.begin(), num_tot_.end(), 0);
+            for (Integer j(0); j < world().num_subvolumes(); ++j)
+            {
+                num_tot_[j] += sum_in_row(world().num_molecules_in_row(j), coefs);
+            }
         }
 
         std::pair<ReactionRule::reactant_container_type, Integer> __draw(const coordinate_type& c)
         {
-            const std::vector<Species>& species(world().list_species());
+            const std::vector<Species>& species(world().species());
             const ReactionRule::reactant_container_type& reactants(rr_.reactants());
 
-            const Real rnd1(rng()->uniform(0.0, num_tot_[c]));
+            const Real rnd1(rng(c)->uniform(0.0, num_tot_[c]));
+            const row_type row(world().num_molecules_in_row(c));
 
             Integer tot(0);
             for (std::vector<Species>::const_iterator i(species.begin());
@@ -623,7 +667,7 @@ protected:
                 const Integer coef(get_coef(reactants[spidx_], *i));
                 if (coef > 0)
                 {
-                    tot += coef * world().num_molecules_exact(*i, c);
+                    tot += coef * row[i - species.begin()];
                     if (tot >= rnd1)
                     {
                         ReactionRule::reactant_container_type retval(2);
@@ -726,7 +770,7 @@ protected:
 
         void initialize()
         {
-            const std::vector<Species>& species(world().list_species());
+            const std::vector<Species>& species(world().species());
             const std::size_t n_subvolumes = static_cast<std::size_t>(world().num_subvolumes());
 
             const ReactionRule::reactant_container_type& reactants(rr_.reactants());
@@ -745,6 +789,9 @@ protected:
                 num_products_[i].resize(products.size(), 0);
             }
 
+            // (column, coefficient) pairs of the species matching each reactant and product
+            std::vector<coef_container_type>
+                reactant_coefs(reactants.size()), product_coefs(products.size());
             for (std::vector<Species>::const_iterator it(species.begin());
                 it != species.end(); ++it)
             {
@@ -755,10 +802,7 @@ protected:
                     const Integer coef(get_coef(reactants[i], sp));
                     if (coef > 0)
                     {
-                        for (std::size_t j = 0; j < n_subvolumes; ++j)
-                        {
-                            num_reactants_[j][i] += coef * world().num_molecules_exact(sp, j);
-                        }
+                        reactant_coefs[i].push_back(std::make_pair(it - species.begin(), coef));
                     }
                 }
 
@@ -767,27 +811,39 @@ protected:
                     const Integer coef(get_coef(products[i], sp));
                     if (coef > 0)
                     {
-                        for (std::size_t j = 0; j < n_subvolumes; ++j)
-                        {
-                            num_products_[j][i] += coef * world().num_molecules_exact(sp, j);
-                        }
+                        product_coefs[i].push_back(std::make_pair(it - species.begin(), coef));
                     }
                 }
             }
+
+            for (std::size_t j = 0; j < n_subvolumes; ++j)
+            {
+                const row_type row(world().num_molecules_in_row(j));
+                for (std::size_t i = 0; i < reactants.size(); ++i)
+                {
+                    num_reactants_[j][i] += sum_in_row(row, reactant_coefs[i]);
+                }
+                for (std::size_t i = 0; i < products.size(); ++i)
+                {
+                    num_products_[j][i] += sum_in_row(row, product_coefs[i]);
+                }
+            }
         }
 
         std::pair<ReactionRule::reactant_container_type, Integer> __draw(const coordinate_type& c)
         {
-            const std::vector<Species>& species(world().list_species());
+            const std::vector<Species>& species(world().species());
             const ReactionRule::reactant_container_type& reactants(rr_.reactants());
 
+            const row_type row(world().num_molecules_in_row(c));
+
             std::pair<ReactionRule::reactant_container_type, Integer> ret;
             ret.second = 1;
 
             for (std::size_t i = 0; i < reactants.size(); ++i)
             {
                 assert(num_reactants_[c][i] > 0);
-                const Real rnd(rng()->uniform(0.0, num_reactants_[c][i]));
+                const Real rnd(rng(c)->uniform(0.0, num_reactants_[c][i]));
                 Integer num_tot(0);
                 for (std::vector<Species>::const_iterator it(species.begin());
                     it != species.end(); ++it)
@@ -796,7 +852,7 @@ protected:
                     const Integer coef(get_coef(reactants[i], sp));
                     if (coef > 0)
                     {
-                        num_tot += coef * world().num_molecules_exact(sp, c);
+                        num_tot += coef * row[it - species.begin()];
                         if (num_tot >= rnd)
                         {
                             ret.first.push_back(sp);
@@ -896,13 +952,13 @@ protected:
     public:
 
         DiffusionProxy()
-            : base_type(), pool_(), dependencies_()
+            : base_type(), pool_(), index_(0), dependencies_()
         {
             ;
         }
 
-        DiffusionProxy(MesoscopicSimulator* sim, const Species& sp)
-            : base_type(sim), pool_(sim->world()->get_pool(sp)), dependencies_()
+        DiffusionProxy(MesoscopicSimulator* sim, const Species& sp, const std::size_t index)
+            : base_type(sim), pool_(sim->world()->get_pool(sp)), index_(index), dependencies_()
         {
             ;
         }
@@ -919,7 +975,7 @@ protected:
                 py(1.0 / (lengths[1] * lengths[1])),
                 pz(1.0 / (lengths[2] * lengths[2]));
 
-            const Real rnd1(sim_->world()->rng()->uniform(0.0, px + py + pz));
+            const Real rnd1(sim_->rng(c)->uniform(0.0, px + py + pz));
 
             if (rnd1 < px * 0.5)
             {
@@ -959,6 +1015,14 @@ protected:
             return k_ * pool_->num_molecules(c);
         }
 
+        /**
+         * the rate for a molecule to hop to one of the neighbors.
+         */
+        Real k() const
+        {
+            return k_;
+        }
+
         void inc(const Species& sp, const coordinate_type& c, const Integer val = +1)
         {
             ; // do nothing
@@ -980,39 +1044,80 @@ protected:
                 return;
             }
 
-            {
-                // sim_->decrement(pool_, src);
-                // sim_->increment(pool_, dst);
-
-                pool_->remove_molecules(1, src);
-                pool_->add_molecules(1, dst);
+            // sim_->decrement(pool_, src);
+            pool_->remove_molecules(1, src);
+            inc_dependencies(src, -1);
+            sim_->update_propensities(*this, src);
 
-                for (dependency_container_type::const_iterator i(dependencies_.begin());
-                     i != dependencies_.end(); ++i)
-                {
-                    (*i).first->inc_with_coefs((*i).second, src, -1);
-                    (*i).first->inc_with_coefs((*i).second, dst, +1);
-                }
+            if (!sim_->in_same_domain(src, dst))
+            {
+                // the molecule arrives at the end of the time window.
+                sim_->defer_arrival(this, src, dst);
+                return;
             }
 
+            arrive(dst);
             sim_->interrupt(dst);
         }
 
-        void set_dependency(ReactionRuleProxy* proxy)
+        /**
+         * put a molecule diffused from a neighbor into the subvolume c.
+         */
+        void arrive(const coordinate_type& c)
+        {
+            // sim_->increment(pool_, c);
+            pool_->add_molecules(1, c);
+            inc_dependencies(c, +1);
+            sim_->update_propensities(*this, c);
+        }
+
+        /**
+         * tell the reactions depending on this species that the number of
+         * molecules changed by val in the subvolume c.
+         */
+        void inc_dependencies(const coordinate_type& c, const Integer val)
+        {
+            for (dependency_container_type::const_iterator i(dependencies_.begin());
+                 i != dependencies_.end(); ++i)
+            {
+                (*i).first->inc_with_coefs((*i).second, c, val);
+            }
+        }
+
+        void set_dependency(ReactionRuleProxy* proxy, const std::size_t index)
         {
             const std::vector<Integer> coefs = proxy->check_dependency(pool_->species());
             if (std::count(coefs.begin(), coefs.end(), 0) < std::distance(coefs.begin(), coefs.end()))
             {
                 dependencies_.push_back(std::make_pair(proxy, coefs));
+                dependent_indices_.push_back(index);
             }
         }
 
+        /**
+         * the index of this proxy in the simulator.
+         */
+        std::size_t index() const
+        {
+            return index_;
+        }
+
+        /**
+         * the indices of the reactions depending on this species.
+         */
+        const std::vector<std::size_t>& dependent_indices() const
+        {
+            return dependent_indices_;
+        }
+
     protected:
 
         const boost::shared_ptr<MesoscopicWorld::PoolBase> pool_;
         Real k_;
+        std::size_t index_;
 
         dependency_container_type dependencies_;
+        std::vector<std::size_t> dependent_indices_;
     };
 
     struct SubvolumeEvent
@@ -1034,7 +1139,6 @@ protected:
         virtual void fire()
         {
             assert(proxy_ != NULL);
-            sim_->reset_last_reactions();
             proxy_->fire(time_, coord_);
             update();
         }
@@ -1061,18 +1165,54 @@ protected:
         ReactionRuleProxyBase* proxy_;
     };
 
+    /**
+     * a slab of layers of subvolumes. A domain has its own scheduler and
+     * stream of random numbers, and is simulated by one thread through
+     * a time window independently of the others.
+     */
+    struct Domain
+    {
+        typedef std::vector<std::pair<DiffusionProxy*, coordinate_type> >
+            arrival_container_type;
+
+        Domain(const EventQueueType queue_type,
+               const boost::shared_ptr<RandomNumberGenerator>& rng)
+            : scheduler(scheduler_type::queue_type(queue_type)), rng(rng),
+              last_reactions(), interrupted(0), arrivals()
+        {
+            ;
+        }
+
+        scheduler_type scheduler;
+        boost::shared_ptr<RandomNumberGenerator> rng;
+        std::vector<std::pair<ReactionRule, reaction_info_type> > last_reactions;
+        coordinate_type interrupted;
+
+        /**
+         * the molecules diffusing to the other domains in a time window.
+         */
+        arrival_container_type arrivals;
+    };
+
 public:
 
+    /**
+     * queue_type chooses how to order the events of subvolumes. A calendar
+     * queue updates an event in O(1), and suits a large number of subvolumes.
+     */
     MesoscopicSimulator(
         boost::shared_ptr<MesoscopicWorld> world,
-        boost::shared_ptr<Model> model)
-        : base_type(world, model)
+        boost::shared_ptr<Model> model,
+        const EventQueueType queue_type = HEAP_QUEUE)
+        : base_type(world, model), queue_type_(queue_type), num_threads_(1), window_(0.0)
     {
         initialize();
     }
 
-    MesoscopicSimulator(boost::shared_ptr<MesoscopicWorld> world)
-        : base_type(world)
+    MesoscopicSimulator(
+        boost::shared_ptr<MesoscopicWorld> world,
+        const EventQueueType queue_type = HEAP_QUEUE)
+        : base_type(world), queue_type_(queue_type), num_threads_(1), window_(0.0)
     {
         initialize();
     }
@@ -1085,24 +1225,99 @@ public:
     bool step(const Real & upto);
 
     // Optional members
+    EventQueueType queue_type() const
+    {
+        return queue_type_;
+    }
+
+    /**
+     * set the number of threads. With more than one thread, the layers of
+     * subvolumes are divided into as many domains as threads (at most one
+     * layer each), and a step fires all the events of the domains in a time
+     * window in parallel. A molecule diffusing to another domain arrives
+     * at the end of the window. A trajectory then depends on the number
+     * of domains. Neither a rate law given as a descriptor nor a non-static
+     * model is supported. The pools of all the products in the model are
+     * reserved in the world beforehand, so the world lists them even with
+     * no molecule. This reinitializes the simulator.
+     */
+    void set_num_threads(const Integer num_threads)
+    {
+        if (num_threads < 1)
+        {
+            throw std::invalid_argument("The number of threads must be positive.");
+        }
+        num_threads_ = num_threads;
+        initialize();
+    }
+
+    Integer num_threads() const
+    {
+        return num_threads_;
+    }
+
+    Integer num_domains() const
+    {
+        return static_cast<Integer>(domains_.size());
+    }
+
+    /**
+     * set the length of a time window in parallel. Zero, the default, makes
+     * it the mean time for a molecule of the fastest species to hop.
+     */
+    void set_window(const Real window)
+    {
+        if (window < 0)
+        {
+            throw std::invalid_argument("The time window must be non-negative.");
+        }
+        window_ = window;
+    }
+
+    Real window() const;
+
+    /**
+     * return true if any reaction occurred in the last step,
+     * which is a time window in parallel.
+     */
     virtual bool check_reaction() const
     {
-        return last_reactions_.size() > 0;
+        for (boost::ptr_vector<Domain>::const_iterator i(domains_.begin());
+            i != domains_.end(); ++i)
+        {
+            if ((*i).last_reactions.size() > 0)
+            {
+                return true;
+            }
+        }
+        return false;
     }
 
     std::vector<std::pair<ReactionRule, reaction_info_type> > last_reactions() const
     {
-        return last_reactions_;
+        std::vector<std::pair<ReactionRule, reaction_info_type> > retval;
+        for (boost::ptr_vector<Domain>::const_iterator i(domains_.begin());
+            i != domains_.end(); ++i)
+        {
+            retval.insert(retval.end(),
+                (*i).last_reactions.begin(), (*i).last_reactions.end());
+        }
+        return retval;
     }
 
     void add_last_reaction(const ReactionRule& rr, const reaction_info_type& ri)
     {
-        last_reactions_.push_back(std::make_pair(rr, ri));
+        domains_[domain_of(ri.coordinate())].last_reactions.push_back(
+            std::make_pair(rr, ri));
     }
 
     void reset_last_reactions()
     {
-        last_reactions_.clear();
+        for (boost::ptr_vector<Domain>::iterator i(domains_.begin());
+            i != domains_.end(); ++i)
+        {
+            (*i).last_reactions.clear();
+        }
     }
 
     /**
@@ -1117,12 +1332,59 @@ public:
 
     void interrupt(const coordinate_type& coord)
     {
-        interrupted_ = coord;
+        domains_[domain_of(coord)].interrupted = coord;
     }
 
 protected:
 
+    typedef PartialSumTree<Real> propensity_tree_type;
+
     DiffusionProxy* create_diffusion_proxy(const Species& sp);
+    DiffusionProxy* get_diffusion_proxy(const Species& sp) const;
+
+    inline std::size_t domain_of(const coordinate_type& c) const
+    {
+        return layer_domains_[c / layer_size_];
+    }
+
+    inline bool in_same_domain(const coordinate_type& c1, const coordinate_type& c2) const
+    {
+        return domain_of(c1) == domain_of(c2);
+    }
+
+    inline const boost::shared_ptr<RandomNumberGenerator>& rng(const coordinate_type& c) const
+    {
+        return domains_[domain_of(c)].rng;
+    }
+
+    void defer_arrival(
+        DiffusionProxy* proxy, const coordinate_type& src, const coordinate_type& dst)
+    {
+        domains_[domain_of(src)].arrivals.push_back(std::make_pair(proxy, dst));
+    }
+
+    void initialize_domains();
+    void reserve_products();
+    void fire_events(Domain& domain, const Real upto);
+    void step_in_domains(const Real upto);
+    void deliver_arrivals(const Real upto);
+
+    /**
+     * update the propensities of the diffusion of a species and
+     * of the reactions depending on it in the subvolume c.
+     */
+    void update_propensities(const DiffusionProxy& proxy, const coordinate_type& c)
+    {
+        propensity_tree_type& a(propensities_[c]);
+        a.set(proxy.index(), proxy.propensity(c));
+        for (std::vector<std::size_t>::const_iterator i(proxy.dependent_indices().begin());
+            i != proxy.dependent_indices().end(); ++i)
+        {
+            a.set(*i, proxies_[*i].propensity(c));
+        }
+    }
+
+    void reset_propensities();
 
     void interrupt_all(const Real& t);
     std::pair<Real, ReactionRuleProxyBase*>
@@ -1136,14 +1398,31 @@ protected:
 
 protected:
 
-    std::vector<std::pair<ReactionRule, reaction_info_type> > last_reactions_;
+    EventQueueType queue_type_;
+    Integer num_threads_;
+    Real window_;
 
     boost::ptr_vector<ReactionRuleProxyBase> proxies_;
     boost::ptr_vector<ReactionRuleProxyBase>::size_type diffusion_proxy_offset_;
+    utils::get_mapper_mf<Species, DiffusionProxy*>::type diffusion_proxies_;
 
-    EventScheduler scheduler_;
-    std::vector<EventScheduler::identifier_type> event_ids_;
-    coordinate_type interrupted_;
+    /**
+     * the propensities of all the proxies in each subvolume. They are
+     * updated only for the proxies depending on the species changed.
+     * A rate law given as a descriptor may depend on the time, and
+     * such proxies are recalculated every time a subvolume draws.
+     */
+    std::vector<propensity_tree_type> propensities_;
+    std::vector<std::size_t> time_dependent_proxies_;
+
+    /**
+     * the domains of subvolumes, each of which owns the events of its
+     * layers. event_ids_ are given by the scheduler of the owner.
+     */
+    boost::ptr_vector<Domain> domains_;
+    std::vector<std::size_t> layer_domains_;
+    coordinate_type layer_size_;
+    std::vector<scheduler_type::identifier_type> event_ids_;
 };
 
 } // meso
@@ -206,6 +206,51 @@ void MesoscopicWorld::set_t(const Real& t)
     cs_->set_t(t);
 }
 
+void MesoscopicWorld::copy_state(const MesoscopicWorld& other)
+{
+    if (other.matrix_sizes() != matrix_sizes())
+    {
+        throw IllegalArgument("The matrix sizes of the given world differ.");
+    }
+
+    set_t(other.t());
+
+    const std::vector<Species::serial_type> structures(other.cs_->list_structures());
+    for (std::vector<Species::serial_type>::const_iterator i(structures.begin());
+        i != structures.end(); ++i)
+    {
+        for (coordinate_type c(0); c < num_subvolumes(); ++c)
+        {
+            cs_->update_structure(*i, c, other.cs_->get_occupancy(*i, c));
+        }
+    }
+
+    const std::vector<Species>& splist(other.species());
+    for (std::vector<Species>::const_iterator i(splist.begin());
+        i != splist.end(); ++i)
+    {
+        const boost::shared_ptr<PoolBase>& src = other.get_pool(*i);
+        if (!has_species(*i))
+        {
+            cs_->reserve_pool(*i, src->D(), src->loc());
+        }
+
+        const boost::shared_ptr<PoolBase>& dst = get_pool(*i);
+        for (coordinate_type c(0); c < num_subvolumes(); ++c)
+        {
+            const Integer num = src->num_molecules(c) - dst->num_molecules(c);
+            if (num > 0)
+            {
+                dst->add_molecules(num, c);
+            }
+            else if (num < 0)
+            {
+                dst->remove_molecules(-num, c);
+            }
+        }
+    }
+}
+
 void MesoscopicWorld::set_value(const Species& sp, const Real value)
 {
     const Integer num1 = static_cast<Integer>(value);
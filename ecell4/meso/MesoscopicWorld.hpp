@@ -9,6 +9,7 @@
 
 #include <ecell4/core/RandomNumberGenerator.hpp>
 #include <ecell4/core/SubvolumeSpace.hpp>
+#include <ecell4/core/SubvolumeSpaceDenseImpl.hpp>
 #include <ecell4/core/Model.hpp>
 #include <ecell4/core/Shape.hpp>
 #include <ecell4/core/extras.hpp>
@@ -20,6 +21,19 @@ namespace ecell4
 namespace meso
 {
 
+/**
+ * the implementation of the SubvolumeSpace of a world.
+ * DENSE_SUBVOLUME keeps the counts in a subvolume-major array
+ * (SubvolumeSpaceDenseImpl), and DENSE32_SUBVOLUME does it in 32-bit,
+ * which holds no more than 2147483647 molecules of a species in a subvolume.
+ */
+enum SubvolumeSpaceType
+{
+    VECTOR_SUBVOLUME = 0,
+    DENSE_SUBVOLUME = 1,
+    DENSE32_SUBVOLUME = 2
+};
+
 struct MoleculeInfo
 {
     const Real D;
@@ -32,6 +46,8 @@ class MesoscopicWorld
 public:
 
     typedef SubvolumeSpace::coordinate_type coordinate_type;
+    typedef SubvolumeSpace::column_type column_type;
+    typedef SubvolumeSpace::row_type row_type;
     typedef MoleculeInfo molecule_info_type;
 
     typedef SubvolumeSpace::PoolBase PoolBase;
@@ -69,6 +85,12 @@ public:
         ;
     }
 
+    MesoscopicWorld(SubvolumeSpace* space, boost::shared_ptr<RandomNumberGenerator> rng)
+        : cs_(space), rng_(rng)
+    {
+        ;
+    }
+
     MesoscopicWorld(const Real3& edge_lengths, const Real subvolume_length);
     MesoscopicWorld(
         const Real3& edge_lengths, const Real subvolume_length,
@@ -141,6 +163,14 @@ public:
 #endif
     }
 
+    /**
+     * copy the time, structures and numbers of molecules in each subvolume
+     * from the given world, which must have the same matrix sizes.
+     * The random number generator and the model are left as they are.
+     * @param other a world to copy the state from
+     */
+    void copy_state(const MesoscopicWorld& other);
+
     boost::shared_ptr<Model> lock_model() const
     {
         return model_.lock();
@@ -201,6 +231,25 @@ public:
         return cs_->num_molecules_exact(sp, g);
     }
 
+    column_type column(const Species& sp) const
+    {
+        return cs_->column(sp);
+    }
+
+    /**
+     * return the number of molecules of the species at the given column
+     * of species() in the subvolume.
+     */
+    Integer num_molecules_in_column(const column_type& col, const coordinate_type& c) const
+    {
+        return cs_->num_molecules_in_column(col, c);
+    }
+
+    row_type num_molecules_in_row(const coordinate_type& c) const
+    {
+        return cs_->num_molecules_in_row(c);
+    }
+
     void add_molecules(const Species& sp, const Integer& num, const Integer3& g)
     {
         add_molecules(sp, num, global2coord(g));
@@ -418,6 +467,28 @@ private:
     boost::weak_ptr<Model> model_;
 };
 
+inline
+MesoscopicWorld*
+create_mesoscopic_world(
+        const Real3& edge_lengths,
+        const Integer3& matrix_sizes,
+        const boost::shared_ptr<RandomNumberGenerator>& rng,
+        const SubvolumeSpaceType space_type)
+{
+    switch (space_type)
+    {
+    case DENSE_SUBVOLUME:
+        return new MesoscopicWorld(
+            new SubvolumeSpaceDenseIntegerImpl(edge_lengths, matrix_sizes), rng);
+    case DENSE32_SUBVOLUME:
+        return new MesoscopicWorld(
+            new SubvolumeSpaceDenseInt32Impl(edge_lengths, matrix_sizes), rng);
+    case VECTOR_SUBVOLUME:
+        break;
+    }
+    return new MesoscopicWorld(edge_lengths, matrix_sizes, rng);
+}
+
 } // meso
 
 } // ecell4
@@ -10,9 +10,12 @@
 #include <ecell4/core/RandomNumberGenerator.hpp>
 #include <ecell4/core/Model.hpp>
 #include <ecell4/core/NetworkModel.hpp>
+#include <ecell4/core/NetfreeModel.hpp>
+#include <ecell4/core/AABB.hpp>
 
 #include <ecell4/meso/MesoscopicWorld.cpp>
 #include <ecell4/meso/MesoscopicSimulator.hpp>
+#include <ecell4/meso/MesoscopicFactory.hpp>
 
 using namespace ecell4;
 using namespace ecell4::meso;
@@ -49,3 +52,280 @@ BOOST_AUTO_TEST_CASE(MesoscopicSimulator_test_step)
     BOOST_CHECK(world->num_molecules(sp1, 0) == 9);
     BOOST_CHECK(world->num_molecules(sp2, 0) == 1);
 }
+
+BOOST_AUTO_TEST_CASE(MesoscopicSimulator_test_propensities)
+{
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A", 0.0025, 1.0), sp2("B", 0.0025, 1.0), sp3("C", 0.0025, 0.5);
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+    model->add_reaction_rule(create_binding_reaction_rule(sp1, sp2, sp3, 0.5));
+    model->add_reaction_rule(create_unbinding_reaction_rule(sp3, sp1, sp2, 2.0));
+
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    boost::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+    boost::shared_ptr<MesoscopicWorld> world(
+        new MesoscopicWorld(edge_lengths, Integer3(3, 3, 3), rng));
+
+    world->add_molecules(sp1, 30, 0);
+    world->add_molecules(sp2, 20, 13);
+
+    MesoscopicSimulator sim(world, model);
+
+    // The reactions and the diffusion keep updating the propensities
+    // of both the source and the destination of a molecule.
+    Integer num_reactions(0);
+    for (Integer i(0); i < 2000; ++i)
+    {
+        sim.step();
+        if (sim.check_reaction())
+        {
+            ++num_reactions;
+        }
+        BOOST_CHECK_EQUAL(world->num_molecules_exact(sp1) + world->num_molecules_exact(sp3), 30);
+        BOOST_CHECK_EQUAL(world->num_molecules_exact(sp2) + world->num_molecules_exact(sp3), 20);
+    }
+    BOOST_CHECK(num_reactions > 0);
+    BOOST_CHECK(sim.t() < inf);
+}
+
+BOOST_AUTO_TEST_CASE(MesoscopicSimulator_test_queue_type)
+{
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A", 0.0025, 1.0), sp2("B", 0.0025, 1.0);
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 0.5));
+
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    boost::shared_ptr<RandomNumberGenerator> rng1(new GSLRandomNumberGenerator(1));
+    boost::shared_ptr<RandomNumberGenerator> rng2(new GSLRandomNumberGenerator(1));
+    boost::shared_ptr<MesoscopicWorld> world1(
+        new MesoscopicWorld(edge_lengths, Integer3(4, 4, 4), rng1));
+    boost::shared_ptr<MesoscopicWorld> world2(
+        new MesoscopicWorld(edge_lengths, Integer3(4, 4, 4), rng2));
+    world1->add_molecules(sp1, 100, 0);
+    world2->add_molecules(sp1, 100, 0);
+
+    MesoscopicSimulator sim1(world1, model, HEAP_QUEUE);
+    MesoscopicSimulator sim2(world2, model, CALENDAR_QUEUE);
+    BOOST_CHECK_EQUAL(sim2.queue_type(), CALENDAR_QUEUE);
+
+    // no two events share a time, so both queues give the same trajectory.
+    for (Integer i(0); i < 1000; ++i)
+    {
+        sim1.step();
+        sim2.step();
+        BOOST_CHECK_EQUAL(sim1.t(), sim2.t());
+    }
+    for (Integer i(0); i < world1->num_subvolumes(); ++i)
+    {
+        BOOST_CHECK_EQUAL(world1->num_molecules_exact(sp1, i), world2->num_molecules_exact(sp1, i));
+        BOOST_CHECK_EQUAL(world1->num_molecules_exact(sp2, i), world2->num_molecules_exact(sp2, i));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(MesoscopicSimulator_test_space_type)
+{
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A", 0.0025, 1.0), sp2("B", 0.0025, 1.0), sp3("C", 0.0025, 0.5);
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+    model->add_reaction_rule(create_binding_reaction_rule(sp1, sp2, sp3, 0.5));
+    model->add_reaction_rule(create_unbinding_reaction_rule(sp3, sp1, sp2, 2.0));
+
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    boost::shared_ptr<RandomNumberGenerator> rng1(new GSLRandomNumberGenerator(1));
+    boost::shared_ptr<RandomNumberGenerator> rng2(new GSLRandomNumberGenerator(1));
+    boost::shared_ptr<MesoscopicWorld> world1(
+        create_mesoscopic_world(edge_lengths, Integer3(3, 3, 3), rng1, VECTOR_SUBVOLUME));
+    boost::shared_ptr<MesoscopicWorld> world2(
+        create_mesoscopic_world(edge_lengths, Integer3(3, 3, 3), rng2, DENSE32_SUBVOLUME));
+    world1->add_molecules(sp1, 30, 0);
+    world1->add_molecules(sp2, 20, 13);
+    world2->add_molecules(sp1, 30, 0);
+    world2->add_molecules(sp2, 20, 13);
+
+    MesoscopicSimulator sim1(world1, model);
+    MesoscopicSimulator sim2(world2, model);
+
+    // the layout of the counts does not change the trajectory.
+    for (Integer i(0); i < 1000; ++i)
+    {
+        sim1.step();
+        sim2.step();
+        BOOST_CHECK_EQUAL(sim1.t(), sim2.t());
+    }
+    for (Integer i(0); i < world1->num_subvolumes(); ++i)
+    {
+        BOOST_CHECK_EQUAL(world1->num_molecules_exact(sp1, i), world2->num_molecules_exact(sp1, i));
+        BOOST_CHECK_EQUAL(world1->num_molecules_exact(sp3, i), world2->num_molecules_exact(sp3, i));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(MesoscopicSimulator_test_num_threads)
+{
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A", 0.0025, 1.0), sp2("B", 0.0025, 1.0), sp3("C", 0.0025, 0.5);
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+    model->add_reaction_rule(create_binding_reaction_rule(sp1, sp2, sp3, 0.5));
+    model->add_reaction_rule(create_unbinding_reaction_rule(sp3, sp1, sp2, 2.0));
+
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    boost::shared_ptr<RandomNumberGenerator> rng1(new GSLRandomNumberGenerator(1));
+    boost::shared_ptr<RandomNumberGenerator> rng2(new GSLRandomNumberGenerator(1));
+    boost::shared_ptr<MesoscopicWorld> world1(
+        create_mesoscopic_world(edge_lengths, Integer3(3, 3, 4), rng1, DENSE32_SUBVOLUME));
+    boost::shared_ptr<MesoscopicWorld> world2(
+        create_mesoscopic_world(edge_lengths, Integer3(3, 3, 4), rng2, DENSE32_SUBVOLUME));
+    world1->add_molecules(sp1, 30, 0);
+    world1->add_molecules(sp2, 20, 13);
+    world2->add_molecules(sp1, 30, 0);
+    world2->add_molecules(sp2, 20, 13);
+
+    MesoscopicSimulator sim1(world1, model);
+    MesoscopicSimulator sim2(world2, model);
+    sim1.set_num_threads(2);
+    sim2.set_num_threads(8);
+    BOOST_CHECK_EQUAL(sim1.num_domains(), 2);
+    BOOST_CHECK_EQUAL(sim2.num_domains(), 4);
+    BOOST_CHECK(sim1.window() > 0);
+
+    // a step fires the events in a time window, and conserves molecules.
+    for (Integer i(0); i < 200; ++i)
+    {
+        sim1.step();
+        BOOST_CHECK(sim1.t() < inf);
+        BOOST_CHECK_EQUAL(world1->num_molecules_exact(sp1) + world1->num_molecules_exact(sp3), 30);
+        BOOST_CHECK_EQUAL(world1->num_molecules_exact(sp2) + world1->num_molecules_exact(sp3), 20);
+    }
+
+    // the molecules diffuse over the boundary of the domains.
+    Integer num_in_upper_layers(0);
+    for (Integer i(18); i < world1->num_subvolumes(); ++i)
+    {
+        num_in_upper_layers += world1->num_molecules_exact(sp1, i);
+    }
+    BOOST_CHECK(num_in_upper_layers > 0);
+
+    // a window ends at the time given.
+    const Real upto(sim1.t() + 1.0);
+    sim1.run(1.0, false);
+    BOOST_CHECK_EQUAL(sim1.t(), upto);
+    BOOST_CHECK_EQUAL(world1->num_molecules_exact(sp1) + world1->num_molecules_exact(sp3), 30);
+
+    sim2.run(2.0, false);
+    BOOST_CHECK_EQUAL(sim2.t(), 2.0);
+    BOOST_CHECK_EQUAL(world2->num_molecules_exact(sp2) + world2->num_molecules_exact(sp3), 20);
+}
+
+BOOST_AUTO_TEST_CASE(MesoscopicSimulator_test_num_threads_reproducible)
+{
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A", 0.0025, 1.0), sp2("B", 0.0025, 1.0);
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 0.5));
+
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    boost::shared_ptr<RandomNumberGenerator> rng1(new GSLRandomNumberGenerator(1));
+    boost::shared_ptr<RandomNumberGenerator> rng2(new GSLRandomNumberGenerator(1));
+    boost::shared_ptr<MesoscopicWorld> world1(
+        new MesoscopicWorld(edge_lengths, Integer3(4, 4, 4), rng1));
+    boost::shared_ptr<MesoscopicWorld> world2(
+        new MesoscopicWorld(edge_lengths, Integer3(4, 4, 4), rng2));
+    world1->add_molecules(sp1, 100);
+    world2->add_molecules(sp1, 100);
+
+    MesoscopicSimulator sim1(world1, model);
+    MesoscopicSimulator sim2(world2, model);
+    sim1.set_num_threads(4);
+    sim2.set_num_threads(4);
+
+    // a trajectory does not depend on the scheduling of threads.
+    for (Integer i(0); i < 100; ++i)
+    {
+        sim1.step();
+        sim2.step();
+        BOOST_CHECK_EQUAL(sim1.t(), sim2.t());
+    }
+    for (Integer i(0); i < world1->num_subvolumes(); ++i)
+    {
+        BOOST_CHECK_EQUAL(world1->num_molecules_exact(sp1, i), world2->num_molecules_exact(sp1, i));
+        BOOST_CHECK_EQUAL(world1->num_molecules_exact(sp2, i), world2->num_molecules_exact(sp2, i));
+    }
+    BOOST_CHECK_EQUAL(world1->num_molecules_exact(sp1) + world1->num_molecules_exact(sp2), 100);
+}
+
+BOOST_AUTO_TEST_CASE(MesoscopicSimulator_test_domains_model)
+{
+    Species sp1("A", 0.0025, 1.0), sp2("B", 0.0025, 1.0);
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    boost::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator(1));
+
+    // the products of a non-static model are unknown in advance.
+    boost::shared_ptr<NetfreeModel> netfree_model(new NetfreeModel());
+    netfree_model->add_species_attribute(sp1);
+    netfree_model->add_species_attribute(sp2);
+    netfree_model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 0.5));
+    MesoscopicSimulator netfree_sim(
+        boost::shared_ptr<MesoscopicWorld>(
+            new MesoscopicWorld(edge_lengths, Integer3(4, 4, 4), rng)),
+        netfree_model);
+    BOOST_CHECK_THROW(netfree_sim.set_num_threads(2), NotSupported);
+
+    // those of a static model are reserved in the world.
+    boost::shared_ptr<MesoscopicWorld> world(
+        new MesoscopicWorld(edge_lengths, Integer3(4, 4, 4), rng));
+    world->add_molecules(sp1, 100);
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 0.5));
+    MesoscopicSimulator sim(world, model);
+    BOOST_CHECK(!world->has_species(sp2));
+    sim.set_num_threads(2);
+    BOOST_CHECK(world->has_species(sp2));
+    BOOST_CHECK_EQUAL(world->num_molecules_exact(sp2), 0);
+}
+
+BOOST_AUTO_TEST_CASE(MesoscopicSimulator_test_copy_world)
+{
+    Species sp1("A", 0.0025, 1.0), sp2("B", 0.0025, 0.5, "M");
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    boost::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator(1));
+    boost::shared_ptr<MesoscopicWorld> world(
+        new MesoscopicWorld(edge_lengths, Integer3(3, 3, 3), rng));
+    world->add_structure(Species("M"), boost::shared_ptr<const Shape>(
+        new AABB(Real3(0, 0, 0), Real3(L, L, L / 3))));
+    world->add_molecules(sp1, 30, 0);
+    world->add_molecules(sp1, 10, 26);
+    world->add_molecules(sp2, 20, 4);
+    world->set_t(1.5);
+
+    // the state in each subvolume is kept, whatever the factory is set to.
+    const MesoscopicFactory factory(
+        Integer3(1, 1, 1), 0.0, MesoscopicFactory::default_queue_type(), DENSE_SUBVOLUME);
+    boost::scoped_ptr<MesoscopicWorld> copied(factory.copy_world(*world));
+    BOOST_CHECK_EQUAL(copied->t(), world->t());
+    BOOST_CHECK_EQUAL(copied->matrix_sizes(), world->matrix_sizes());
+    BOOST_CHECK_EQUAL(copied->species().size(), world->species().size());
+    BOOST_CHECK_EQUAL(copied->get_pool(sp2)->loc(), "M");
+    for (Integer i(0); i < world->num_subvolumes(); ++i)
+    {
+        BOOST_CHECK_EQUAL(copied->num_molecules_exact(sp1, i), world->num_molecules_exact(sp1, i));
+        BOOST_CHECK_EQUAL(copied->num_molecules_exact(sp2, i), world->num_molecules_exact(sp2, i));
+        BOOST_CHECK_EQUAL(copied->get_occupancy(Species("M"), i), world->get_occupancy(Species("M"), i));
+    }
+}
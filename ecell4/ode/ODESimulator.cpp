@@ -13,19 +13,7 @@ namespace ode
 
 ODESimulator::reaction_container_type ODESimulator::convert_reactions() const
 {
-    const std::vector<Species> species(world_->list_species());
     const Model::reaction_rule_container_type& reaction_rules = model_->reaction_rules();
-    typedef utils::get_mapper_mf<
-        Species, state_type::size_type>::type species_map_type;
-
-    species_map_type index_map;
-    state_type::size_type i(0);
-    for(std::vector<Species>::const_iterator it(species.begin());
-        it != species.end(); it++)
-    {
-        index_map[*it] = i;
-        i++;
-    }
 
     std::vector<reaction_type> reactions;
     reactions.reserve(reaction_rules.size());
@@ -45,14 +33,14 @@ ODESimulator::reaction_container_type ODESimulator::convert_reactions() const
         for(ReactionRule::reactant_container_type::const_iterator j(reactants.begin());
             j != reactants.end(); j++)
         {
-            r.reactants.push_back(index_map[*j]);
+            r.reactants.push_back(world_->get_species_id(*j));
         }
 
         r.products.reserve(products.size());
         for(ReactionRule::product_container_type::const_iterator j(products.begin());
             j != products.end(); j++)
         {
-            r.products.push_back(index_map[*j]);
+            r.products.push_back(world_->get_species_id(*j));
         }
 
         if (rr.has_descriptor() && rr.get_descriptor()->has_coefficients())
@@ -78,13 +66,492 @@ ODESimulator::reaction_container_type ODESimulator::convert_reactions() const
     return reactions;
 }
 
+ODESimulator::flux_kernel::flux_kernel(
+    const reaction_container_type& reactions, const Real volume)
+    : volume_(volume)
+{
+    const std::size_t num_reactions(reactions.size());
+    k_.resize(num_reactions, 0.0);
+    volume_factors_.resize(num_reactions, 0.0);
+    ratelaws_.resize(num_reactions);
+    reactant_states_.resize(num_reactions);
+    product_states_.resize(num_reactions);
+
+    reactant_offsets_.reserve(num_reactions + 1);
+    product_offsets_.reserve(num_reactions + 1);
+    change_offsets_.reserve(num_reactions + 1);
+    reactant_offsets_.push_back(0);
+    product_offsets_.push_back(0);
+    change_offsets_.push_back(0);
+
+    for (std::size_t i(0); i < num_reactions; ++i)
+    {
+        const reaction_type& r(reactions[i]);
+
+        Real k(r.k);
+        coefficient_container_type orders(r.reactant_coefficients);
+        if (boost::shared_ptr<ReactionRuleDescriptor> ratelaw = r.ratelaw.lock())
+        {
+            // A subclass, e.g. one in Python, may override the propensity.
+            if (!is_plain_mass_action(*ratelaw))
+            {
+                assert(ratelaw->is_available());
+                ratelaws_[i] = ratelaw;
+                reactant_states_[i].resize(r.reactants.size());
+                product_states_[i].resize(r.products.size());
+            }
+            else
+            {
+                const ReactionRuleDescriptorMassAction* massaction(
+                    static_cast<const ReactionRuleDescriptorMassAction*>(ratelaw.get()));
+                k = massaction->k();
+                orders = massaction->reactant_coefficients();
+                orders.resize(r.reactants.size(), 0.0);
+            }
+        }
+
+        if (!ratelaws_[i])
+        {
+            // k * V * prod (x / V)^c = k * V^(1 - sum c) * prod x^c
+            const Real order(std::accumulate(orders.begin(), orders.end(), 0.0));
+            volume_factors_[i] = std::pow(volume_, 1.0 - order);
+            k_[i] = k * volume_factors_[i];
+        }
+
+        reactant_indices_.insert(reactant_indices_.end(), r.reactants.begin(), r.reactants.end());
+        reactant_orders_.insert(reactant_orders_.end(), orders.begin(), orders.end());
+        reactant_offsets_.push_back(reactant_indices_.size());
+        product_indices_.insert(product_indices_.end(), r.products.begin(), r.products.end());
+        product_offsets_.push_back(product_indices_.size());
+
+        // The net stoichiometry. The same species may appear more than once.
+        std::vector<std::pair<index_container_type::value_type, Real> > changes;
+        for (std::size_t j(0); j < r.reactants.size(); ++j)
+        {
+            changes.push_back(std::make_pair(r.reactants[j], -r.reactant_coefficients[j]));
+        }
+        for (std::size_t j(0); j < r.products.size(); ++j)
+        {
+            changes.push_back(std::make_pair(r.products[j], +r.product_coefficients[j]));
+        }
+        std::sort(changes.begin(), changes.end());
+        for (std::size_t j(0); j < changes.size(); ++j)
+        {
+            if (change_indices_.size() > change_offsets_.back()
+                && change_indices_.back() == changes[j].first)
+            {
+                change_values_.back() += changes[j].second;
+            }
+            else
+            {
+                change_indices_.push_back(changes[j].first);
+                change_values_.push_back(changes[j].second);
+            }
+        }
+        change_offsets_.push_back(change_indices_.size());
+    }
+}
+
+std::vector<std::pair<std::size_t, std::size_t> >
+ODESimulator::flux_kernel::jacobian_pattern() const
+{
+    std::vector<std::pair<std::size_t, std::size_t> > pattern;
+    for (std::size_t i(0); i < size(); ++i)
+    {
+        std::vector<index_container_type::value_type> cols;
+        for (std::size_t j(reactant_offsets_[i]); j < reactant_offsets_[i + 1]; ++j)
+        {
+            if (ratelaws_[i] || reactant_orders_[j] != 0.0)
+            {
+                cols.push_back(reactant_indices_[j]);
+            }
+        }
+        if (ratelaws_[i])
+        {
+            cols.insert(cols.end(),
+                product_indices_.begin() + product_offsets_[i],
+                product_indices_.begin() + product_offsets_[i + 1]);
+        }
+
+        for (std::size_t j(0); j < cols.size(); ++j)
+        {
+            for (std::size_t l(change_offsets_[i]); l < change_offsets_[i + 1]; ++l)
+            {
+                pattern.push_back(std::make_pair(change_indices_[l], cols[j]));
+            }
+        }
+    }
+    return pattern;
+}
+
+bool ODESimulator::is_kernel_outdated() const
+{
+    if (!kernel_ || kernel_->volume() != world_->volume())
+    {
+        return true;
+    }
+
+    const Model::reaction_rule_container_type& reaction_rules(model_->reaction_rules());
+    if (reaction_rules.size() != kernel_rules_.size())
+    {
+        return true;
+    }
+
+    for (std::size_t i(0); i < reaction_rules.size(); ++i)
+    {
+        const ReactionRule& rr(reaction_rules[i]);
+        const ReactionRule& last(kernel_rules_[i]);
+        if (rr.k() != last.k() || rr.get_descriptor() != last.get_descriptor() || rr != last)
+        {
+            return true;
+        }
+
+        if (rr.has_descriptor() && rr.get_descriptor()->has_coefficients())
+        {
+            const boost::shared_ptr<ReactionRuleDescriptor>& rrd(rr.get_descriptor());
+            if (rrd->reactant_coefficients() != kernel_coefficients_[i].first
+                || rrd->product_coefficients() != kernel_coefficients_[i].second)
+            {
+                return true;
+            }
+            else if (is_plain_mass_action(*rrd)
+                && static_cast<const ReactionRuleDescriptorMassAction&>(*rrd).k()
+                    != kernel_descriptor_ks_[i])
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+const boost::shared_ptr<const ODESimulator::flux_kernel>& ODESimulator::update_kernel()
+{
+    if (!is_kernel_outdated())
+    {
+        return kernel_;
+    }
+
+    const Model::reaction_rule_container_type& reaction_rules(model_->reaction_rules());
+    const boost::shared_ptr<const flux_kernel> kernel(
+        new flux_kernel(convert_reactions(), world_->volume()));
+
+    std::vector<std::size_t> indices;
+    indices.reserve(sensitivity_indices_.size());
+    for (std::vector<std::size_t>::const_iterator i(sensitivity_indices_.begin());
+        i != sensitivity_indices_.end(); ++i)
+    {
+        Model::reaction_rule_container_type::const_iterator
+            it(std::find(reaction_rules.begin(), reaction_rules.end(), kernel_rules_[*i]));
+        if (it == reaction_rules.end()
+            || !kernel->is_mass_action(std::distance(reaction_rules.begin(), it)))
+        {
+            throw NotFound(
+                "A reaction rule selected for the sensitivity analysis was removed.");
+        }
+        indices.push_back(std::distance(reaction_rules.begin(), it));
+    }
+
+    std::vector<std::pair<coefficient_container_type, coefficient_container_type> >
+        coefficients(reaction_rules.size());
+    std::vector<Real> descriptor_ks(reaction_rules.size(), 0.0);
+    for (std::size_t i(0); i < reaction_rules.size(); ++i)
+    {
+        const ReactionRule& rr(reaction_rules[i]);
+        if (rr.has_descriptor() && rr.get_descriptor()->has_coefficients())
+        {
+            const boost::shared_ptr<ReactionRuleDescriptor>& rrd(rr.get_descriptor());
+            coefficients[i].first = rrd->reactant_coefficients();
+            coefficients[i].second = rrd->product_coefficients();
+            if (is_plain_mass_action(*rrd))
+            {
+                descriptor_ks[i] = static_cast<const ReactionRuleDescriptorMassAction&>(*rrd).k();
+            }
+        }
+    }
+
+    kernel_ = kernel;
+    kernel_rules_ = reaction_rules;
+    kernel_coefficients_.swap(coefficients);
+    kernel_descriptor_ks_.swap(descriptor_ks);
+    sensitivity_indices_.swap(indices);
+    return kernel_;
+}
+
+boost::shared_ptr<const ODESimulator::flux_kernel> ODESimulator::current_kernel() const
+{
+    if (is_kernel_outdated())
+    {
+        return boost::shared_ptr<const flux_kernel>(
+            new flux_kernel(convert_reactions(), world_->volume()));
+    }
+    return kernel_;
+}
+
 std::pair<ODESimulator::deriv_func, ODESimulator::jacobi_func>
-ODESimulator::generate_system() const
+ODESimulator::generate_system(const boost::shared_ptr<const flux_kernel>& kernel) const
 {
-    const reaction_container_type reactions(convert_reactions());
     return std::make_pair(
-            deriv_func(reactions, world_->volume()),
-            jacobi_func(reactions, world_->volume(), abs_tol_, rel_tol_));
+            deriv_func(kernel),
+            jacobi_func(kernel, abs_tol_, rel_tol_));
+}
+
+void ODESimulator::set_sensitivity_parameters(const std::vector<ReactionRule>& rules)
+{
+    if (rules.size() > 0 && solver_type_ != ROSENBROCK2_SPARSE)
+    {
+        throw NotSupported(
+            "The sensitivity analysis is only supported by ROSENBROCK2_SPARSE.");
+    }
+
+    // the last selection is dropped before the kernel follows the model.
+    sensitivity_indices_.clear();
+    sensitivities_.clear();
+    const boost::shared_ptr<const flux_kernel> kernel(update_kernel());
+    const Model::reaction_rule_container_type& reaction_rules(kernel_rules_);
+
+    std::vector<std::size_t> indices;
+    indices.reserve(rules.size());
+    for (std::vector<ReactionRule>::const_iterator i(rules.begin()); i != rules.end(); ++i)
+    {
+        Model::reaction_rule_container_type::const_iterator
+            it(std::find(reaction_rules.begin(), reaction_rules.end(), *i));
+        if (it == reaction_rules.end())
+        {
+            throw NotFound("The reaction rule is not in the model.");
+        }
+
+        const std::size_t idx(std::distance(reaction_rules.begin(), it));
+        if (!kernel->is_mass_action(idx))
+        {
+            throw NotSupported(
+                "A reaction rule with a user-defined rate law has no rate constant.");
+        }
+        indices.push_back(idx);
+    }
+
+    sensitivity_indices_.swap(indices);
+    sensitivities_.assign(
+        sensitivity_indices_.size(), state_type(world_->list_species().size(), 0.0));
+}
+
+std::vector<Real> ODESimulator::sensitivity(const Species& sp) const
+{
+    std::vector<Real> retval(sensitivities_.size(), 0.0);
+    if (!world_->has_species(sp))
+    {
+        return retval;
+    }
+
+    const ODEWorld::species_id_type id(world_->get_species_id(sp));
+    for (std::size_t i(0); i < sensitivities_.size(); ++i)
+    {
+        if (id < sensitivities_[i].size())
+        {
+            retval[i] = sensitivities_[i][id];
+        }
+    }
+    return retval;
+}
+
+/**
+ * add each element of the Jacobian at the position given in advance.
+ */
+struct sparse_adder
+{
+    sparse_adder(std::vector<Real>& values, const std::vector<SparseLU::size_type>& positions)
+        : values(values), position(positions.begin())
+    {
+        ;
+    }
+
+    inline void operator()(const std::size_t row, const std::size_t col, const Real value)
+    {
+        values[*position] += value;
+        ++position;
+    }
+
+    std::vector<Real>& values;
+    std::vector<SparseLU::size_type>::const_iterator position;
+};
+
+std::size_t ODESimulator::integrate_sparse(
+    const boost::shared_ptr<const flux_kernel>& kernel,
+    state_type& x, const Real t0, const Real t1, const Real dt)
+{
+    const std::size_t n(x.size());
+    const std::size_t num_params(sensitivity_indices_.size());
+
+    if (kernel != lu_kernel_ || lu_.size() != n)
+    {
+        const std::vector<std::pair<std::size_t, std::size_t> > pattern(kernel->jacobian_pattern());
+        lu_.analyze(n, pattern);
+        jacobian_positions_.resize(pattern.size());
+        for (std::size_t i(0); i < pattern.size(); ++i)
+        {
+            jacobian_positions_[i] = lu_.position(pattern[i].first, pattern[i].second);
+        }
+        lu_kernel_ = kernel;
+        last_dt_ = 0.0;
+    }
+
+    for (std::size_t p(0); p < num_params; ++p)
+    {
+        if (sensitivities_[p].size() != n)
+        {
+            // The sensitivities of the species added later start from zero.
+            state_type s(n, 0.0);
+            std::copy(sensitivities_[p].begin(),
+                sensitivities_[p].begin() + std::min(n, sensitivities_[p].size()), s.begin());
+            sensitivities_[p].swap(s);
+        }
+    }
+
+    const Real gamma(1.0 + 1.0 / std::sqrt(2.0));
+    const Real safety(0.8), min_factor(0.2), max_factor(5.0);
+
+    std::vector<Real> jacobi(lu_.num_nonzeros()), jacobi_y(num_params > 0 ? jacobi.size() : 0);
+    state_type dfdt(n), f(n), k1(n), k2(n), y(n), dfdt_y(num_params > 0 ? n : 0);
+    std::vector<state_type> fs(num_params, state_type(n)), k1s(fs), k2s(fs), ys(fs);
+
+    Real t(t0);
+    Real h(last_dt_ > 0.0 ? std::min(last_dt_, dt) : dt);
+    std::size_t steps(0);
+    while (t < t1)
+    {
+        std::fill(jacobi.begin(), jacobi.end(), 0.0);
+        std::fill(dfdt.begin(), dfdt.end(), 0.0);
+        {
+            sparse_adder add(jacobi, jacobian_positions_);
+            kernel->add_jacobian(x, t, add, dfdt, abs_tol_, rel_tol_);
+        }
+
+        std::fill(f.begin(), f.end(), 0.0);
+        kernel->add_derivatives(x, t, f);
+
+        // d(dx/dk)/dt = J dx/dk + df/dk
+        for (std::size_t p(0); p < num_params; ++p)
+        {
+            std::fill(fs[p].begin(), fs[p].end(), 0.0);
+            lu_.add_product(jacobi, sensitivities_[p], fs[p]);
+            kernel->add_rate_constant_derivatives(sensitivity_indices_[p], x, fs[p]);
+        }
+
+        while (true)
+        {
+            const bool is_last(t + h >= t1);
+            if (is_last)
+            {
+                h = t1 - t;
+            }
+
+            std::vector<Real>& m(lu_.values());
+            const Real c(-gamma * h);
+            for (std::size_t i(0); i < m.size(); ++i)
+            {
+                m[i] = c * jacobi[i];
+            }
+            for (std::size_t i(0); i < n; ++i)
+            {
+                m[lu_.diagonal(i)] += 1.0;
+            }
+
+            Real err(inf);
+            if (lu_.factorize())
+            {
+                // (I - gamma h J) k1 = f(t, x) + gamma h df/dt
+                for (std::size_t i(0); i < n; ++i)
+                {
+                    k1[i] = f[i] + gamma * h * dfdt[i];
+                }
+                lu_.solve(k1);
+
+                // (I - gamma h J) k2 = f(t + h, x + h k1) - 2 k1 - gamma h df/dt
+                for (std::size_t i(0); i < n; ++i)
+                {
+                    y[i] = x[i] + h * k1[i];
+                }
+                std::fill(k2.begin(), k2.end(), 0.0);
+                kernel->add_derivatives(y, t + h, k2);
+                for (std::size_t i(0); i < n; ++i)
+                {
+                    k2[i] -= 2.0 * k1[i] + gamma * h * dfdt[i];
+                }
+                lu_.solve(k2);
+
+                if (num_params > 0)
+                {
+                    std::fill(jacobi_y.begin(), jacobi_y.end(), 0.0);
+                    std::fill(dfdt_y.begin(), dfdt_y.end(), 0.0);
+                    sparse_adder add(jacobi_y, jacobian_positions_);
+                    kernel->add_jacobian(y, t + h, add, dfdt_y, abs_tol_, rel_tol_);
+                }
+
+                for (std::size_t p(0); p < num_params; ++p)
+                {
+                    k1s[p] = fs[p];
+                    lu_.solve(k1s[p]);
+
+                    for (std::size_t i(0); i < n; ++i)
+                    {
+                        ys[p][i] = sensitivities_[p][i] + h * k1s[p][i];
+                    }
+                    std::fill(k2s[p].begin(), k2s[p].end(), 0.0);
+                    lu_.add_product(jacobi_y, ys[p], k2s[p]);
+                    kernel->add_rate_constant_derivatives(sensitivity_indices_[p], y, k2s[p]);
+                    for (std::size_t i(0); i < n; ++i)
+                    {
+                        k2s[p][i] -= 2.0 * k1s[p][i];
+                    }
+                    lu_.solve(k2s[p]);
+                }
+
+                // The difference from the first-order solution x + h k1.
+                err = 0.0;
+                for (std::size_t i(0); i < n; ++i)
+                {
+                    y[i] = x[i] + h * (1.5 * k1[i] + 0.5 * k2[i]);
+                    const Real scale(abs_tol_ + rel_tol_ * std::max(std::abs(x[i]), std::abs(y[i])));
+                    const Real e(0.5 * h * (k1[i] + k2[i]) / scale);
+                    err += e * e;
+                }
+                for (std::size_t p(0); p < num_params; ++p)
+                {
+                    const state_type& s(sensitivities_[p]);
+                    for (std::size_t i(0); i < n; ++i)
+                    {
+                        ys[p][i] = s[i] + h * (1.5 * k1s[p][i] + 0.5 * k2s[p][i]);
+                        const Real scale(abs_tol_ + rel_tol_ * std::max(std::abs(s[i]), std::abs(ys[p][i])));
+                        const Real e(0.5 * h * (k1s[p][i] + k2s[p][i]) / scale);
+                        err += e * e;
+                    }
+                }
+                err = (n > 0 ? std::sqrt(err / (n * (num_params + 1))) : 0.0);
+            }
+
+            if (err <= 1.0)
+            {
+                t = (is_last ? t1 : t + h);
+                x.swap(y);
+                for (std::size_t p(0); p < num_params; ++p)
+                {
+                    sensitivities_[p].swap(ys[p]);
+                }
+                ++steps;
+                h *= (err > 0.0 ? std::min(max_factor, safety / std::sqrt(err)) : max_factor);
+                h = std::min(h, dt);
+                last_dt_ = h;
+                break;
+            }
+
+            h *= (err < inf ? std::max(min_factor, safety / std::sqrt(err)) : 0.5);
+            if (t + h == t)
+            {
+                throw IllegalState("The step size underflowed.");
+            }
+        }
+    }
+    return steps;
 }
 
 bool ODESimulator::step(const Real &upto)
@@ -98,17 +565,12 @@ bool ODESimulator::step(const Real &upto)
     const Real ntime(std::min(upto, t() + dt_));
 
     //initialize();
-    const std::vector<Species> species(world_->list_species());
+    const std::vector<Real> values(world_->get_values());
 
-    state_type x(species.size());
-    state_type::size_type i(0);
-    for(Model::species_container_type::const_iterator it(species.begin());
-        it != species.end(); it++)
-    {
-        x[i] = static_cast<double>(world_->get_value_exact(*it));
-        i++;
-    }
-    std::pair<deriv_func, jacobi_func> system(generate_system());
+    state_type x(values.size());
+    std::copy(values.begin(), values.end(), x.begin());
+    const boost::shared_ptr<const flux_kernel> kernel(update_kernel());
+    std::pair<deriv_func, jacobi_func> system(generate_system(kernel));
     StateAndTimeBackInserter::state_container_type x_vec;
     StateAndTimeBackInserter::time_container_type times;
 
@@ -144,6 +606,13 @@ bool ODESimulator::step(const Real &upto)
                         StateAndTimeBackInserter(x_vec, times)));
             }
             break;
+        case ecell4::ode::ROSENBROCK2_SPARSE:
+            {
+                integrate_sparse(kernel, x, t(), ntime, dt);
+                x_vec.push_back(x);
+                steps = 0;
+            }
+            break;
         default:
             throw IllegalState("Solver is not specified\n");
     };
@@ -153,15 +622,7 @@ bool ODESimulator::step(const Real &upto)
     //     odeint::integrate_adaptive(
     //         controlled_stepper, system, x, t(), upto, dt_,
     //         StateAndTimeBackInserter(x_vec, times)));
-    {
-        state_type::size_type i(0);
-        for(Model::species_container_type::const_iterator
-            it(species.begin()); it != species.end(); it++)
-        {
-            world_->set_value(*it, static_cast<Real>(x_vec[steps](i)));
-            i++;
-        }
-    }
+    world_->set_values(std::vector<Real>(x_vec[steps].begin(), x_vec[steps].end()));
     set_t(ntime);
     num_steps_++;
     return (ntime < upto);
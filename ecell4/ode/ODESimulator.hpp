@@ -2,9 +2,11 @@
 #define ECELL4_ODE_ODE_SIMULATOR_NEW_HPP
 
 #include <cstring>
+#include <cmath>
 #include <vector>
 #include <numeric>
 #include <map>
+#include <typeinfo>
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/scoped_array.hpp>
@@ -20,6 +22,7 @@
 #include <ecell4/core/SimulatorBase.hpp>
 
 #include "ODEWorld.hpp"
+#include "SparseLU.hpp"
 
 namespace ecell4
 {
@@ -30,6 +33,7 @@ enum ODESolverType {
     RUNGE_KUTTA_CASH_KARP54 = 0,
     ROSENBROCK4_CONTROLLER = 1,
     EULER = 2,
+    ROSENBROCK2_SPARSE = 3,
 };
 
 class ODESimulator
@@ -59,80 +63,367 @@ public:
     };
     typedef std::vector<reaction_type> reaction_container_type;
 
-    class deriv_func
+    /**
+     * The reactions flattened when the rules of the model or the volume
+     * of the world change.
+     * Reactant orders and the net stoichiometry are kept in compressed rows,
+     * so that a mass-action flux is evaluated with neither a virtual call
+     * nor an allocation. Only a user-defined rate law keeps its descriptor,
+     * and the states passed to it are preallocated.
+     * This is not thread-safe because of the preallocated states.
+     */
+    class flux_kernel
     {
     public:
-        deriv_func(const reaction_container_type &reactions, const Real &volume)
-            : reactions_(reactions), volume_(volume), vinv_(1.0 / volume)
+
+        typedef ReactionRuleDescriptor::state_container_type state_container_type;
+
+    public:
+
+        flux_kernel(const reaction_container_type& reactions, const Real volume);
+
+        std::size_t size() const
         {
-            ;
+            return ratelaws_.size();
         }
 
-        void operator()(const state_type &x, state_type &dxdt, const double &t)
+        const Real volume() const
         {
-            std::fill(dxdt.begin(), dxdt.end(), 0.0);
-            for(reaction_container_type::const_iterator i(reactions_.begin());
-                i != reactions_.end(); i++)
+            return volume_;
+        }
+
+        inline Real flux(const std::size_t i, const state_type& x, const double t) const
+        {
+            if (ratelaws_[i])
+            {
+                return ratelaw_flux(i, x, t);
+            }
+
+            Real ret(k_[i]);
+            for (std::size_t j(reactant_offsets_[i]); j < reactant_offsets_[i + 1]; ++j)
+            {
+                ret *= power(x[reactant_indices_[j]], reactant_orders_[j]);
+            }
+            return ret;
+        }
+
+        /**
+         * add the fluxes multiplied by the net stoichiometry to dxdt.
+         */
+        void add_derivatives(const state_type& x, const double t, state_type& dxdt) const
+        {
+            for (std::size_t i(0); i < size(); ++i)
+            {
+                const Real v(flux(i, x, t));
+                for (std::size_t j(change_offsets_[i]); j < change_offsets_[i + 1]; ++j)
+                {
+                    dxdt[change_indices_[j]] += change_values_[j] * v;
+                }
+            }
+        }
+
+        bool is_mass_action(const std::size_t i) const
+        {
+            return !ratelaws_[i];
+        }
+
+        /**
+         * add the derivatives of dxdt by the rate constant of the i-th
+         * reaction to dxdt. The reaction must follow the mass action.
+         */
+        void add_rate_constant_derivatives(
+            const std::size_t i, const state_type& x, state_type& dxdt) const
+        {
+            Real deriv(volume_factors_[i]);
+            for (std::size_t j(reactant_offsets_[i]); j < reactant_offsets_[i + 1]; ++j)
             {
-                ReactionRuleDescriptor::state_container_type reactants_states(i->reactants.size());
-                ReactionRuleDescriptor::state_container_type products_states(i->products.size());
-                ReactionRuleDescriptor::state_container_type::size_type cnt(0);
+                deriv *= power(x[reactant_indices_[j]], reactant_orders_[j]);
+            }
+            for (std::size_t j(change_offsets_[i]); j < change_offsets_[i + 1]; ++j)
+            {
+                dxdt[change_indices_[j]] += change_values_[j] * deriv;
+            }
+        }
+
+        /**
+         * add the Jacobian and the time derivative to jacobi and dfdt.
+         * It is exact for mass-action reactions, and approximated by
+         * finite differences for user-defined rate laws.
+         */
+        void add_jacobian(
+            const state_type& x, const double t, matrix_type& jacobi, state_type& dfdt,
+            const Real abs_tol, const Real rel_tol) const
+        {
+            dense_adder add(jacobi);
+            add_jacobian(x, t, add, dfdt, abs_tol, rel_tol);
+        }
+
+        /**
+         * the same as above, but each element of the Jacobian is passed to
+         * add(row, col, value) in the order given by jacobian_pattern().
+         */
+        template <typename Tadder_>
+        void add_jacobian(
+            const state_type& x, const double t, Tadder_& add, state_type& dfdt,
+            const Real abs_tol, const Real rel_tol) const
+        {
+            jacobian_visitor<Tadder_> visitor(*this, add, dfdt);
+            visit_flux_derivatives(x, t, visitor, abs_tol, rel_tol);
+        }
+
+        /**
+         * set the derivative of the i-th flux by the j-th value to
+         * elasticity(i, j). Elements never visited are left as they are.
+         */
+        void add_elasticity(
+            const state_type& x, const double t, matrix_type& elasticity,
+            const Real abs_tol, const Real rel_tol) const
+        {
+            elasticity_visitor visitor(elasticity);
+            visit_flux_derivatives(x, t, visitor, abs_tol, rel_tol);
+        }
+
+        /**
+         * list the (row, column) of the Jacobian elements in the order
+         * add_jacobian passes them. The same element may appear more than once.
+         */
+        std::vector<std::pair<std::size_t, std::size_t> > jacobian_pattern() const;
+
+    protected:
+
+        /**
+         * pass the derivative of the i-th flux by the value of a species
+         * to visitor.flux(i, col, deriv) and that by the time to
+         * visitor.time(i, deriv). The mass action is differentiated
+         * analytically, and user-defined rate laws by finite differences.
+         */
+        template <typename Tvisitor_>
+        void visit_flux_derivatives(
+            const state_type& x, const double t, Tvisitor_& visitor,
+            const Real abs_tol, const Real rel_tol) const
+        {
+            // const Real ETA(2.2204460492503131e-16);
+            const Real SQRTETA(1.4901161193847656e-08);
+            const Real r0(1.0);
+            const Real ht(1.0e-10);
 
-                for(index_container_type::const_iterator j(i->reactants.begin());
-                    j != i->reactants.end(); j++, cnt++)
+            for (std::size_t i(0); i < size(); ++i)
+            {
+                const std::size_t begin(reactant_offsets_[i]), end(reactant_offsets_[i + 1]);
+
+                if (!ratelaws_[i])
                 {
-                    reactants_states[cnt] = x[*j];
+                    // It never depends on the time.
+                    for (std::size_t j(begin); j < end; ++j)
+                    {
+                        const Real order(reactant_orders_[j]);
+                        if (order == 0.0)
+                        {
+                            continue;
+                        }
+
+                        Real deriv(k_[i] * order * power(x[reactant_indices_[j]], order - 1.0));
+                        for (std::size_t l(begin); l < end; ++l)
+                        {
+                            if (l != j)
+                            {
+                                deriv *= power(x[reactant_indices_[l]], reactant_orders_[l]);
+                            }
+                        }
+                        visitor.flux(i, reactant_indices_[j], deriv);
+                    }
+                    continue;
                 }
-                cnt = 0;
-                for(index_container_type::const_iterator j(i->products.begin());
-                    j != i->products.end(); j++, cnt++)
+
+                const Real flux_0(ratelaw_flux(i, x, t));
+                state_container_type& reactants(reactant_states_[i]);
+                state_container_type& products(product_states_[i]);
+
+                // Differentiate by time
                 {
-                    products_states[cnt] = x[*j];
+                    const Real flux(ratelaws_[i]->propensity(reactants, products, volume_, t + ht));
+                    visitor.time(i, (flux - flux_0) / ht);
                 }
-                double flux;
-                // Calculation! XXX
-                if (i->ratelaw.expired())
+
+                // Differentiate by each Reactants
+                for (std::size_t j(0); j < reactants.size(); ++j)
                 {
-                    boost::scoped_ptr<ReactionRuleDescriptor> temporary_ratelaw_obj(new ReactionRuleDescriptorMassAction(i->k, i->reactant_coefficients, i->product_coefficients));
-                    flux = temporary_ratelaw_obj->propensity(reactants_states, products_states, volume_, t);
+                    const Real value(reactants[j]);
+                    const Real ewt(abs_tol + rel_tol * std::abs(value));
+                    const Real h(std::max(SQRTETA * std::abs(value), r0 * ewt));
+                    reactants[j] = value + h;
+                    const Real flux(ratelaws_[i]->propensity(reactants, products, volume_, t));
+                    reactants[j] = value;
+                    visitor.flux(i, reactant_indices_[begin + j], (flux - flux_0) / h);
                 }
-                else
+
+                // Differentiate by Products
+                for (std::size_t j(0); j < products.size(); ++j)
                 {
-                    boost::shared_ptr<ReactionRuleDescriptor> ratelaw = i->ratelaw.lock();
-                    assert(ratelaw->is_available());
-                    flux = ratelaw->propensity(reactants_states, products_states, volume_, t);
+                    const Real value(products[j]);
+                    const Real ewt(abs_tol + rel_tol * std::abs(value));
+                    const Real h(std::max(SQRTETA * std::abs(value), r0 * ewt));
+                    products[j] = value + h;
+                    const Real flux(ratelaws_[i]->propensity(reactants, products, volume_, t));
+                    products[j] = value;
+                    visitor.flux(i, product_indices_[product_offsets_[i] + j], (flux - flux_0) / h);
                 }
-                // Merge each reaction's flux into whole dxdt
-                std::size_t nth = 0;
-                for(index_container_type::const_iterator j(i->reactants.begin());
-                    j != i->reactants.end(); j++)
+            }
+        }
+
+        static inline Real power(const Real x, const Real order)
+        {
+            return (order == 1.0 ? x : (order == 2.0 ? x * x : std::pow(x, order)));
+        }
+
+        Real ratelaw_flux(const std::size_t i, const state_type& x, const double t) const
+        {
+            state_container_type& reactants(reactant_states_[i]);
+            for (std::size_t j(0); j < reactants.size(); ++j)
+            {
+                reactants[j] = x[reactant_indices_[reactant_offsets_[i] + j]];
+            }
+            state_container_type& products(product_states_[i]);
+            for (std::size_t j(0); j < products.size(); ++j)
+            {
+                products[j] = x[product_indices_[product_offsets_[i] + j]];
+            }
+            return ratelaws_[i]->propensity(reactants, products, volume_, t);
+        }
+
+        template <typename Tadder_>
+        inline void add_column(
+            const std::size_t i, const index_container_type::value_type col,
+            const Real deriv, Tadder_& add) const
+        {
+            for (std::size_t j(change_offsets_[i]); j < change_offsets_[i + 1]; ++j)
+            {
+                add(change_indices_[j], col, change_values_[j] * deriv);
+            }
+        }
+
+        /**
+         * add the derivatives multiplied by the net stoichiometry to
+         * the Jacobian, and those by the time to dfdt.
+         */
+        template <typename Tadder_>
+        struct jacobian_visitor
+        {
+            jacobian_visitor(const flux_kernel& kernel, Tadder_& add, state_type& dfdt)
+                : kernel(kernel), add(add), dfdt(dfdt)
+            {
+                ;
+            }
+
+            inline void flux(
+                const std::size_t i, const index_container_type::value_type col, const Real deriv)
+            {
+                kernel.add_column(i, col, deriv, add);
+            }
+
+            inline void time(const std::size_t i, const Real deriv)
+            {
+                if (deriv == 0.0)
                 {
-                    dxdt[*j] -= (flux * (double)i->reactant_coefficients[nth]);
-                    nth++;
+                    return;
                 }
-                nth = 0;
-                for(index_container_type::const_iterator j(i->products.begin()); 
-                    j != i->products.end(); j++)
+
+                for (std::size_t j(kernel.change_offsets_[i]); j < kernel.change_offsets_[i + 1]; ++j)
                 {
-                    dxdt[*j] += (flux * (double)i->product_coefficients[nth]);
-                    nth++;
+                    dfdt[kernel.change_indices_[j]] += kernel.change_values_[j] * deriv;
                 }
             }
-            return;
+
+            const flux_kernel& kernel;
+            Tadder_& add;
+            state_type& dfdt;
+        };
+
+        struct elasticity_visitor
+        {
+            elasticity_visitor(matrix_type& elasticity)
+                : elasticity(elasticity)
+            {
+                ;
+            }
+
+            inline void flux(
+                const std::size_t i, const index_container_type::value_type col, const Real deriv)
+            {
+                elasticity(i, col) += deriv;
+            }
+
+            inline void time(const std::size_t i, const Real deriv)
+            {
+                ; // do nothing
+            }
+
+            matrix_type& elasticity;
+        };
+
+        struct dense_adder
+        {
+            dense_adder(matrix_type& jacobi)
+                : jacobi(jacobi)
+            {
+                ;
+            }
+
+            inline void operator()(const std::size_t row, const std::size_t col, const Real value)
+            {
+                jacobi(row, col) += value;
+            }
+
+            matrix_type& jacobi;
+        };
+
+    protected:
+
+        Real volume_;
+
+        /**
+         * k * V^(1 - order) for a mass-action reaction.
+         */
+        std::vector<Real> k_;
+
+        /**
+         * V^(1 - order) for a mass-action reaction.
+         */
+        std::vector<Real> volume_factors_;
+        std::vector<boost::shared_ptr<ReactionRuleDescriptor> > ratelaws_;
+
+        std::vector<std::size_t> reactant_offsets_, product_offsets_, change_offsets_;
+        index_container_type reactant_indices_, product_indices_, change_indices_;
+        coefficient_container_type reactant_orders_, change_values_;
+
+        mutable std::vector<state_container_type> reactant_states_, product_states_;
+    };
+
+    class deriv_func
+    {
+    public:
+        deriv_func(const boost::shared_ptr<const flux_kernel>& kernel)
+            : kernel_(kernel)
+        {
+            ;
+        }
+
+        void operator()(const state_type &x, state_type &dxdt, const double &t)
+        {
+            std::fill(dxdt.begin(), dxdt.end(), 0.0);
+            kernel_->add_derivatives(x, t, dxdt);
         }
     protected:
-        const reaction_container_type reactions_;
-        const Real volume_;
-        const Real vinv_;
+        boost::shared_ptr<const flux_kernel> kernel_;
     };
 
     class jacobi_func
     {
     public:
         jacobi_func(
-            const reaction_container_type &reactions, const Real& volume,
+            const boost::shared_ptr<const flux_kernel>& kernel,
             const Real& abs_tol, const Real& rel_tol)
-            : reactions_(reactions), volume_(volume), vinv_(1.0 / volume), abs_tol_(abs_tol), rel_tol_(rel_tol)
+            : kernel_(kernel), abs_tol_(abs_tol), rel_tol_(rel_tol)
         {
             ;
         }
@@ -142,199 +433,10 @@ public:
             //fill 0 into jacobi and dfdt
             std::fill(dfdt.begin(), dfdt.end(), 0.0);
             std::fill(jacobi.data().begin(), jacobi.data().end(), 0.0);
-
-            // const Real ETA(2.2204460492503131e-16);
-            const Real SQRTETA(1.4901161193847656e-08);
-            const Real r0(1.0);
-            // Real fac(0.0);
-            // for (std::size_t k(0); k < dfdt.size(); ++k)
-            // {
-            //     const Real ewtk(atol + rtol * x[k]);
-            //     fac = std::max(fac, dfdt[k] * ewtk);
-            // }
-            // const Real r0(1000.0 * h * ETA * dfdt.size() * fac);  //XXX: h means the step interval
-            // {
-            //     const Real ewtj(atol + rtol * x[j]);
-            //     const Real dyj(std::max(SQRTETA * abs(x[j]), r0 * ewtj));
-            // }
-
-            // const Real h(1.0e-8);
-            // const Real ht(1.0e-10);
-            const Real ht(1.0e-10);
-
-            // calculate jacobian for each reaction and merge it.
-            for(reaction_container_type::const_iterator i(reactions_.begin());
-                i != reactions_.end(); i++)
-            {
-                // Calculate one reactions's jabobian
-                //  Prepare the state_array to pass ReactionRuleDescriptor.
-                index_container_type::size_type reactants_size(i->reactants.size());
-                index_container_type::size_type products_size(i->products.size());
-                ReactionRuleDescriptor::state_container_type reactants_states(reactants_size);
-                ReactionRuleDescriptor::state_container_type products_states(products_size);
-                ReactionRuleDescriptor::state_container_type::size_type cnt(0);
-                for(index_container_type::const_iterator j(i->reactants.begin());
-                    j != i->reactants.end(); j++, cnt++)
-                {
-                    reactants_states[cnt] = x[*j];
-                }
-                cnt = 0;
-                for(index_container_type::const_iterator j(i->products.begin());
-                    j != i->products.end(); j++, cnt++)
-                {
-                    products_states[cnt] = x[*j];
-                }
-                // Call the ReactionRuleDescriptor object
-
-                if (i->ratelaw.expired())
-                {
-                    boost::scoped_ptr<ReactionRuleDescriptor> temporary_ratelaw_obj(new ReactionRuleDescriptorMassAction(i->k, i->reactant_coefficients, i->product_coefficients));
-                    Real flux_0 = temporary_ratelaw_obj->propensity(reactants_states, products_states, volume_, t);
-                    // Differentiate by time
-                    {
-                        Real flux = temporary_ratelaw_obj->propensity(reactants_states, products_states, volume_, t + ht);
-                        Real flux_deriv = (flux - flux_0) / ht;
-                        if (flux_deriv != 0.0)
-                        {
-                            for(std::size_t k(0); k < i->reactants.size(); k++)
-                            {
-                                matrix_type::size_type row = i->reactants[k];
-                                Real coeff = i->reactant_coefficients[k];
-                                dfdt[row] -= coeff * flux_deriv;
-                            }
-                            for(std::size_t k(0); k < i->products.size(); k++)
-                            {
-                                matrix_type::size_type row = i->products[k];
-                                Real coeff = i->product_coefficients[k];
-                                dfdt[row] += coeff * flux_deriv;
-                            }
-                        }
-                    }
-                    // Differentiate by each Reactants
-                    for(std::size_t j(0); j < reactants_states.size(); j++)
-                    {
-                        const Real ewt = abs_tol_ + rel_tol_ * abs(reactants_states[j]);
-                        const Real h = std::max(SQRTETA * abs(reactants_states[j]), r0 * ewt);
-                        ReactionRuleDescriptor::state_container_type h_shift(reactants_states);
-                        h_shift[j] += h;
-                        Real flux = temporary_ratelaw_obj->propensity(h_shift, products_states, volume_, t);
-                        Real flux_deriv = (flux - flux_0) / h;
-                        matrix_type::size_type col = i->reactants[j];
-                        for(std::size_t k(0); k < i->reactants.size(); k++)
-                        {
-                            matrix_type::size_type row = i->reactants[k];
-                            Real coeff = i->reactant_coefficients[k];
-                            jacobi(row, col) -= coeff * flux_deriv;
-                        }
-                        for(std::size_t k(0); k < i->products.size(); k++)
-                        {
-                            matrix_type::size_type row = i->products[k];
-                            Real coeff = i->product_coefficients[k];
-                            jacobi(row, col) += coeff * flux_deriv;
-                        }
-                    }
-                    // Differentiate by Products
-                    for(std::size_t j(0); j < products_states.size(); j++)
-                    {
-                        const Real ewt = abs_tol_ + rel_tol_ * abs(products_states[j]);
-                        const Real h = std::max(SQRTETA * abs(products_states[j]), r0 * ewt);
-                        ReactionRuleDescriptor::state_container_type h_shift(products_states);
-                        h_shift[j] += h;
-                        Real flux = temporary_ratelaw_obj->propensity(reactants_states, h_shift, volume_, t);
-                        Real flux_deriv = (flux - flux_0) / h;
-                        matrix_type::size_type col = i->products[j];
-                        for(std::size_t k(0); k < i->reactants.size(); k++)
-                        {
-                            matrix_type::size_type row = i->reactants[k];
-                            Real coeff = i->reactant_coefficients[k];
-                            jacobi(row, col) -= coeff * flux_deriv;
-                        }
-                        for(std::size_t k(0); k < i->products.size(); k++)
-                        {
-                            matrix_type::size_type row = i->products[k];
-                            Real coeff = i->product_coefficients[k];
-                            jacobi(row, col) += coeff * flux_deriv;
-                        }
-                    }
-                }
-                else
-                {
-                    boost::shared_ptr<ReactionRuleDescriptor> ratelaw = i->ratelaw.lock();
-                    assert(ratelaw->is_available());
-                    Real flux_0 = ratelaw->propensity(reactants_states, products_states, volume_, t);
-                    // Differentiate by time
-                    {
-                        Real flux = ratelaw->propensity(reactants_states, products_states, volume_, t + ht);
-                        Real flux_deriv = (flux - flux_0) / ht;
-                        if (flux_deriv != 0.0)
-                        {
-                            for(std::size_t k(0); k < i->reactants.size(); k++)
-                            {
-                                matrix_type::size_type row = i->reactants[k];
-                                Real coeff = i->reactant_coefficients[k];
-                                dfdt[row] -= coeff * flux_deriv;
-                            }
-                            for(std::size_t k(0); k < i->products.size(); k++)
-                            {
-                                matrix_type::size_type row = i->products[k];
-                                Real coeff = i->product_coefficients[k];
-                                dfdt[row] += coeff * flux_deriv;
-                            }
-                        }
-                    }
-                    // Differentiate by each Reactants
-                    for(std::size_t j(0); j < reactants_states.size(); j++)
-                    {
-                        const Real ewt = abs_tol_ + rel_tol_ * abs(reactants_states[j]);
-                        const Real h = std::max(SQRTETA * abs(reactants_states[j]), r0 * ewt);
-                        ReactionRuleDescriptor::state_container_type h_shift(reactants_states);
-                        h_shift[j] += h;
-                        Real flux = ratelaw->propensity(h_shift, products_states, volume_, t);
-                        Real flux_deriv = (flux - flux_0) / h;
-                        matrix_type::size_type col = i->reactants[j];
-                        for(std::size_t k(0); k < i->reactants.size(); k++)
-                        {
-                            matrix_type::size_type row = i->reactants[k];
-                            Real coeff = i->reactant_coefficients[k];
-                            jacobi(row, col) -= coeff * flux_deriv;
-                        }
-                        for(std::size_t k(0); k < i->products.size(); k++)
-                        {
-                            matrix_type::size_type row = i->products[k];
-                            Real coeff = i->product_coefficients[k];
-                            jacobi(row, col) += coeff * flux_deriv;
-                        }
-                    }
-                    // Differentiate by Products
-                    for(std::size_t j(0); j < products_states.size(); j++)
-                    {
-                        const Real ewt = abs_tol_ + rel_tol_ * abs(products_states[j]);
-                        const Real h = std::max(SQRTETA * abs(products_states[j]), r0 * ewt);
-                        ReactionRuleDescriptor::state_container_type h_shift(products_states);
-                        h_shift[j] += h;
-                        Real flux = ratelaw->propensity(reactants_states, h_shift, volume_, t);
-                        Real flux_deriv = (flux - flux_0) / h;
-                        matrix_type::size_type col = i->products[j];
-                        for(std::size_t k(0); k < i->reactants.size(); k++)
-                        {
-                            matrix_type::size_type row = i->reactants[k];
-                            Real coeff = i->reactant_coefficients[k];
-                            jacobi(row, col) -= coeff * flux_deriv;
-                        }
-                        for(std::size_t k(0); k < i->products.size(); k++)
-                        {
-                            matrix_type::size_type row = i->products[k];
-                            Real coeff = i->product_coefficients[k];
-                            jacobi(row, col) += coeff * flux_deriv;
-                        }
-                    }
-                }
-            }
+            kernel_->add_jacobian(x, t, jacobi, dfdt, abs_tol_, rel_tol_);
         }
     protected:
-        const reaction_container_type reactions_;
-        const Real volume_;
-        const Real vinv_;
+        boost::shared_ptr<const flux_kernel> kernel_;
         const Real abs_tol_, rel_tol_;
     };
 
@@ -342,9 +444,9 @@ public:
     {
     public:
         elasticity_func(
-            const reaction_container_type &reactions, const Real& volume,
+            const boost::shared_ptr<const flux_kernel>& kernel,
             const Real& abs_tol, const Real& rel_tol)
-            : reactions_(reactions), volume_(volume), vinv_(1.0 / volume), abs_tol_(abs_tol), rel_tol_(rel_tol)
+            : kernel_(kernel), abs_tol_(abs_tol), rel_tol_(rel_tol)
         {
             ;
         }
@@ -353,122 +455,10 @@ public:
         {
             //fill 0 into elasticity
             std::fill(elasticity.data().begin(), elasticity.data().end(), 0.0);
-
-            // const Real ETA(2.2204460492503131e-16);
-            const Real SQRTETA(1.4901161193847656e-08);
-            const Real r0(1.0);
-            // Real fac(0.0);
-            // for (std::size_t k(0); k < dfdt.size(); ++k)
-            // {
-            //     const Real ewtk(atol + rtol * x[k]);
-            //     fac = std::max(fac, dfdt[k] * ewtk);
-            // }
-            // const Real r0(1000.0 * h * ETA * dfdt.size() * fac);  //XXX: h means the step interval
-            // {
-            //     const Real ewtj(atol + rtol * x[j]);
-            //     const Real dyj(std::max(SQRTETA * abs(x[j]), r0 * ewtj));
-            // }
-
-            // const Real h(1.0e-8);
-            // const Real ht(1.0e-10);
-            const Real ht(1.0e-10);
-
-            // calculate elasticityan for each reaction and merge it.
-            unsigned reaction_idx = 0;
-            for(reaction_container_type::const_iterator i(reactions_.begin());
-                i != reactions_.end(); i++, reaction_idx++)
-            {
-                // Calculate one reactions's jabobian
-                //  Prepare the state_array to pass ReactionRuleDescriptor.
-                index_container_type::size_type reactants_size(i->reactants.size());
-                index_container_type::size_type products_size(i->products.size());
-                ReactionRuleDescriptor::state_container_type reactants_states(reactants_size);
-                ReactionRuleDescriptor::state_container_type products_states(products_size);
-                ReactionRuleDescriptor::state_container_type::size_type cnt(0);
-                for(index_container_type::const_iterator j(i->reactants.begin());
-                    j != i->reactants.end(); j++, cnt++)
-                {
-                    reactants_states[cnt] = x[*j];
-                }
-                cnt = 0;
-                for(index_container_type::const_iterator j(i->products.begin());
-                    j != i->products.end(); j++, cnt++)
-                {
-                    products_states[cnt] = x[*j];
-                }
-                // Call the ReactionRuleDescriptor object
-
-                if (i->ratelaw.expired())
-                {
-                    boost::scoped_ptr<ReactionRuleDescriptor> temporary_ratelaw_obj(new ReactionRuleDescriptorMassAction(i->k, i->reactant_coefficients, i->product_coefficients));
-                    Real flux_0 = temporary_ratelaw_obj->propensity(reactants_states, products_states, volume_, t);
-                    // Differentiate by each Reactants
-                    for(std::size_t j(0); j < reactants_states.size(); j++)
-                    {
-                        const Real ewt = abs_tol_ + rel_tol_ * abs(reactants_states[j]);
-                        const Real h = std::max(SQRTETA * abs(reactants_states[j]), r0 * ewt);
-                        ReactionRuleDescriptor::state_container_type h_shift(reactants_states);
-                        h_shift[j] += h;
-                        const Real flux = temporary_ratelaw_obj->propensity(h_shift, products_states, volume_, t);
-                        const Real flux_deriv = (flux - flux_0) / h;
-                        const matrix_type::size_type row = reaction_idx;
-                        const matrix_type::size_type col = i->reactants[j];
-                        elasticity(row, col) = flux_deriv;
-                    }
-                    // Differentiate by Products
-                    for(std::size_t j(0); j < products_states.size(); j++)
-                    {
-                        const Real ewt = abs_tol_ + rel_tol_ * abs(products_states[j]);
-                        const Real h = std::max(SQRTETA * abs(products_states[j]), r0 * ewt);
-                        ReactionRuleDescriptor::state_container_type h_shift(products_states);
-                        h_shift[j] += h;
-                        const Real flux = temporary_ratelaw_obj->propensity(reactants_states, h_shift, volume_, t);
-                        const Real flux_deriv = (flux - flux_0) / h;
-                        const matrix_type::size_type row = reaction_idx;
-                        const matrix_type::size_type col = i->products[j];
-                        elasticity(row, col) = flux_deriv;
-                    }
-                }
-                else
-                {
-                    boost::shared_ptr<ReactionRuleDescriptor> ratelaw = i->ratelaw.lock();
-                    assert(ratelaw->is_available());
-                    Real flux_0 = ratelaw->propensity(reactants_states, products_states, volume_, t);
-                    // Differentiate by each Reactants
-                    for(std::size_t j(0); j < reactants_states.size(); j++)
-                    {
-                        const Real ewt = abs_tol_ + rel_tol_ * abs(reactants_states[j]);
-                        const Real h = std::max(SQRTETA * abs(reactants_states[j]), r0 * ewt);
-                        ReactionRuleDescriptor::state_container_type h_shift(reactants_states);
-                        h_shift[j] += h;
-                        const Real flux = ratelaw->propensity(h_shift, products_states, volume_, t);
-                        const Real flux_deriv = (flux - flux_0) / h;
-                        const matrix_type::size_type row = reaction_idx;
-                        const matrix_type::size_type col = i->reactants[j];
-                        elasticity(row, col) += flux_deriv;
-                    }
-                    // Differentiate by Products
-                    for(std::size_t j(0); j < products_states.size(); j++)
-                    {
-                        const Real ewt = abs_tol_ + rel_tol_ * abs(products_states[j]);
-                        const Real h = std::max(SQRTETA * abs(products_states[j]), r0 * ewt);
-                        ReactionRuleDescriptor::state_container_type h_shift(products_states);
-                        h_shift[j] += h;
-                        const Real flux = ratelaw->propensity(reactants_states, h_shift, volume_, t);
-                        const Real flux_deriv = (flux - flux_0) / h;
-                        const matrix_type::size_type row = reaction_idx;
-                        const matrix_type::size_type col = i->products[j];
-                        elasticity(row, col) += flux_deriv;
-                    }
-                }
-            }
+            kernel_->add_elasticity(x, t, elasticity, abs_tol_, rel_tol_);
         }
-
     protected:
-
-        const reaction_container_type reactions_;
-        const Real volume_;
-        const Real vinv_;
+        boost::shared_ptr<const flux_kernel> kernel_;
         const Real abs_tol_, rel_tol_;
     };
 
@@ -498,7 +488,7 @@ public:
         const boost::shared_ptr<Model>& model,
         const ODESolverType solver_type = ROSENBROCK4_CONTROLLER)
         : base_type(world, model), dt_(inf), abs_tol_(1e-6), rel_tol_(1e-6),
-          solver_type_(solver_type)
+          solver_type_(solver_type), last_dt_(0.0)
     {
         initialize();
     }
@@ -507,7 +497,7 @@ public:
         const boost::shared_ptr<ODEWorld>& world,
         const ODESolverType solver_type = ROSENBROCK4_CONTROLLER)
         : base_type(world), dt_(inf), abs_tol_(1e-6), rel_tol_(1e-6),
-          solver_type_(solver_type)
+          solver_type_(solver_type), last_dt_(0.0)
     {
         initialize();
     }
@@ -525,6 +515,10 @@ public:
         }
 
         // ode_reaction_rules_ = convert_ode_reaction_rules(model_);
+        kernel_.reset();
+        lu_kernel_.reset();
+        update_kernel();
+        last_dt_ = 0.0;
     }
 
     void step(void)
@@ -599,22 +593,17 @@ public:
 
     std::vector<Real> derivatives() const
     {
-        const std::vector<Species> species_list(world_->list_species());
-        const unsigned n = species_list.size();
+        const unsigned n = world_->list_species().size();
 
         state_type x(n);
         {
-            state_type::size_type i(0);
-            for(Model::species_container_type::const_iterator it(species_list.begin());
-                it != species_list.end(); it++, i++)
-            {
-                x[i] = static_cast<double>(world_->get_value_exact(*it));
-            }
+            const std::vector<Real> values(world_->get_values());
+            std::copy(values.begin(), values.end(), x.begin());
         }
 
         state_type dxdt(n);
 
-        std::pair<deriv_func, jacobi_func> system(generate_system());
+        std::pair<deriv_func, jacobi_func> system(generate_system(current_kernel()));
         system.first(x, dxdt, world_->t());
 
         std::vector<Real> ret(dxdt.size());
@@ -624,23 +613,18 @@ public:
 
     std::vector<std::vector<Real> > jacobian() const
     {
-        const std::vector<Species> species_list(world_->list_species());
-        const unsigned n = species_list.size();
+        const unsigned n = world_->list_species().size();
 
         state_type x(n);
         {
-            state_type::size_type i(0);
-            for(Model::species_container_type::const_iterator it(species_list.begin());
-                it != species_list.end(); it++, i++)
-            {
-                x[i] = static_cast<double>(world_->get_value_exact(*it));
-            }
+            const std::vector<Real> values(world_->get_values());
+            std::copy(values.begin(), values.end(), x.begin());
         }
 
         matrix_type jacobi(n, n);
         state_type dfdt(n);
 
-        std::pair<deriv_func, jacobi_func> system(generate_system());
+        std::pair<deriv_func, jacobi_func> system(generate_system(current_kernel()));
         system.second(x, jacobi, world_->t(), dfdt);
 
         std::vector<std::vector<Real> > ret(jacobi.size1());
@@ -672,25 +656,19 @@ public:
 
     std::vector<std::vector<Real> > elasticity() const
     {
-        const std::vector<Species> species_list(world_->list_species());
         const std::vector<ReactionRule>& reaction_rules(model_->reaction_rules());
-        const unsigned n = species_list.size();
+        const unsigned n = world_->list_species().size();
         const unsigned m = reaction_rules.size();
 
         state_type x(n);
         {
-            state_type::size_type i(0);
-            for(Model::species_container_type::const_iterator it(species_list.begin());
-                it != species_list.end(); it++, i++)
-            {
-                x[i] = static_cast<double>(world_->get_value_exact(*it));
-            }
+            const std::vector<Real> values(world_->get_values());
+            std::copy(values.begin(), values.end(), x.begin());
         }
 
         matrix_type elas(m, n);
 
-        const reaction_container_type reactions(convert_reactions());
-        elasticity_func(reactions, world_->volume(), abs_tol_, rel_tol_)(x, elas, world_->t());
+        elasticity_func(current_kernel(), abs_tol_, rel_tol_)(x, elas, world_->t());
 
         std::vector<std::vector<Real> > ret(elas.size1());
         for (unsigned i = 0; i != elas.size1(); i++)
@@ -704,10 +682,99 @@ public:
         return ret;
     }
 
+    /**
+     * select the rate constants of the given reaction rules for
+     * the forward sensitivity analysis. The sensitivities, the derivatives
+     * of the values by the rate constants, are reset to zero, and then
+     * integrated together with the values in each step.
+     * Only ROSENBROCK2_SPARSE supports this. Pass an empty list to stop it.
+     */
+    void set_sensitivity_parameters(const std::vector<ReactionRule>& rules);
+
+    std::vector<ReactionRule> sensitivity_parameters() const
+    {
+        std::vector<ReactionRule> retval;
+        retval.reserve(sensitivity_indices_.size());
+        for (std::vector<std::size_t>::const_iterator i(sensitivity_indices_.begin());
+            i != sensitivity_indices_.end(); ++i)
+        {
+            retval.push_back(kernel_rules_[*i]);
+        }
+        return retval;
+    }
+
+    /**
+     * return the derivatives of the value of the given species by each
+     * rate constant selected in set_sensitivity_parameters.
+     */
+    std::vector<Real> sensitivity(const Species& sp) const;
+
+    /**
+     * return the sensitivities of all the species. The element (i, j) is
+     * the derivative of the i-th species by the j-th rate constant.
+     */
+    std::vector<std::vector<Real> > sensitivities() const
+    {
+        const std::vector<Species> species(world_->list_species());
+        std::vector<std::vector<Real> > retval;
+        retval.reserve(species.size());
+        for (std::vector<Species>::const_iterator i(species.begin());
+            i != species.end(); ++i)
+        {
+            retval.push_back(sensitivity(*i));
+        }
+        return retval;
+    }
+
 protected:
 
     reaction_container_type convert_reactions() const;
-    std::pair<deriv_func, jacobi_func> generate_system() const;
+
+    /**
+     * return true if the descriptor is no subclass of
+     * ReactionRuleDescriptorMassAction, and thus the kernel may evaluate
+     * its propensity instead.
+     */
+    static bool is_plain_mass_action(const ReactionRuleDescriptor& rrd)
+    {
+        return (typeid(rrd) == typeid(ReactionRuleDescriptorMassAction));
+    }
+
+    /**
+     * return true if the rules of the model, their rate constants and
+     * coefficients, or the volume differ from those the kernel was built
+     * with. Rules are compared one by one, which costs far less than
+     * flattening them again.
+     */
+    bool is_kernel_outdated() const;
+
+    /**
+     * rebuild the kernel if it is outdated, and return it. The rules
+     * selected for the sensitivity analysis are looked up again.
+     */
+    const boost::shared_ptr<const flux_kernel>& update_kernel();
+
+    /**
+     * return the kernel if it is up to date, or a temporary one otherwise.
+     */
+    boost::shared_ptr<const flux_kernel> current_kernel() const;
+
+    std::pair<deriv_func, jacobi_func> generate_system(
+        const boost::shared_ptr<const flux_kernel>& kernel) const;
+
+    /**
+     * integrate x from t0 to t1 with the second-order Rosenbrock method
+     * ROS2 (Verwer et al., 1999) and the embedded first-order estimate.
+     * The Jacobian is assembled directly into the sparse matrix, and
+     * the sparsity pattern is analyzed only when the kernel is renewed.
+     * The sensitivities are integrated in the same steps. ROS2 keeps
+     * the second order with any approximation of the Jacobian, and thus
+     * the block diagonal one shares the decomposition with the values.
+     * Return the number of the accepted steps.
+     */
+    std::size_t integrate_sparse(
+        const boost::shared_ptr<const flux_kernel>& kernel,
+        state_type& x, const Real t0, const Real t1, const Real dt);
 
 protected:
 
@@ -718,6 +785,35 @@ protected:
     Real abs_tol_, rel_tol_;
     ODESolverType solver_type_;
 
+    /**
+     * the kernel, and the rules, the coefficients of their descriptors
+     * and the rate constants of their mass-action descriptors it was
+     * built from. The kernel copies the latter, and thus set_k on
+     * a descriptor renews it.
+     */
+    boost::shared_ptr<const flux_kernel> kernel_;
+    Model::reaction_rule_container_type kernel_rules_;
+    std::vector<std::pair<coefficient_container_type, coefficient_container_type> >
+        kernel_coefficients_;
+    std::vector<Real> kernel_descriptor_ks_;
+
+    /**
+     * the LU decomposition of I - gamma h J for ROSENBROCK2_SPARSE,
+     * the positions of the Jacobian elements in it, and the kernel
+     * whose pattern was analyzed.
+     */
+    SparseLU lu_;
+    std::vector<SparseLU::size_type> jacobian_positions_;
+    boost::shared_ptr<const flux_kernel> lu_kernel_;
+    Real last_dt_;
+
+    /**
+     * the indices of the reaction rules selected for the sensitivity
+     * analysis, and the sensitivities for each of them.
+     */
+    std::vector<std::size_t> sensitivity_indices_;
+    std::vector<state_type> sensitivities_;
+
     // ODENetworkModel::ode_reaction_rule_container_type ode_reaction_rules_;
 };
 
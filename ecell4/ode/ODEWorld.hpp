@@ -56,6 +56,10 @@ protected:
     typedef utils::get_mapper_mf<
         Species, num_molecules_container_type::size_type>::type species_map_type;
 
+public:
+
+    typedef num_molecules_container_type::size_type species_id_type;
+
 public:
 
     ODEWorld(const Real3& edge_lengths = Real3(1, 1, 1))
@@ -143,6 +147,23 @@ public:
         return species_;
     }
 
+    /**
+     * return a dense integer ID of the given species, which is
+     * the index in list_species() and get_values().
+     * IDs are stable until a species is released.
+     */
+    species_id_type get_species_id(const Species& sp) const
+    {
+        species_map_type::const_iterator i(index_map_.find(sp));
+        if (i == index_map_.end())
+        {
+            std::ostringstream message;
+            message << "Speices [" << sp.serial() << "] not found";
+            throw NotFound(message.str());
+        }
+        return (*i).second;
+    }
+
     void add_molecules(const Species& sp, const Real& num)
     {
         species_map_type::const_iterator i(index_map_.find(sp));
@@ -289,6 +310,18 @@ public:
         return num_molecules_;
     }
 
+    /**
+     * set the values of all the species at once in the order of get_values().
+     */
+    void set_values(const std::vector<Real>& values)
+    {
+        if (values.size() != num_molecules_.size())
+        {
+            throw std::invalid_argument("The size of values must be the number of species.");
+        }
+        std::copy(values.begin(), values.end(), num_molecules_.begin());
+    }
+
     Real evaluate(const ReactionRule& rr) const
     {
         if (rr.has_descriptor())
@@ -0,0 +1,40 @@
+#include "SensitivityObserver.hpp"
+
+
+namespace ecell4
+{
+
+namespace ode
+{
+
+bool FixedIntervalSensitivityObserver::fire(
+    const Simulator* sim, const boost::shared_ptr<WorldInterface>& world)
+{
+    const ODESimulator* ode_sim(dynamic_cast<const ODESimulator*>(sim));
+    if (ode_sim == NULL)
+    {
+        throw NotSupported("FixedIntervalSensitivityObserver only supports ODESimulator.");
+    }
+
+    data_container_type::value_type tmp;
+    tmp.push_back(world->t());
+    for (species_container_type::const_iterator i(targets_.begin());
+        i != targets_.end(); ++i)
+    {
+        const std::vector<Real> sensitivity(ode_sim->sensitivity(*i));
+        tmp.insert(tmp.end(), sensitivity.begin(), sensitivity.end());
+    }
+    data_.push_back(tmp);
+
+    return base_type::fire(sim, world);
+}
+
+void FixedIntervalSensitivityObserver::reset()
+{
+    data_.clear();
+    base_type::reset();
+}
+
+} // ode
+
+} // ecell4
@@ -0,0 +1,71 @@
+#ifndef ECELL4_ODE_SENSITIVITY_OBSERVER_HPP
+#define ECELL4_ODE_SENSITIVITY_OBSERVER_HPP
+
+#include <ecell4/core/observers.hpp>
+
+#include "ODESimulator.hpp"
+
+
+namespace ecell4
+{
+
+namespace ode
+{
+
+/**
+ * An observer logging the sensitivities of ODESimulator at a fixed
+ * interval. Each row of data() starts from the time, followed by
+ * the derivatives of each target species by each rate constant
+ * selected with ODESimulator::set_sensitivity_parameters.
+ */
+class FixedIntervalSensitivityObserver
+    : public FixedIntervalObserver
+{
+public:
+
+    typedef FixedIntervalObserver base_type;
+    typedef std::vector<std::vector<Real> > data_container_type;
+    typedef std::vector<Species> species_container_type;
+
+public:
+
+    FixedIntervalSensitivityObserver(const Real& dt, const std::vector<std::string>& species)
+        : base_type(dt)
+    {
+        targets_.reserve(species.size());
+        for (std::vector<std::string>::const_iterator i(species.begin());
+            i != species.end(); ++i)
+        {
+            targets_.push_back(Species(*i));
+        }
+    }
+
+    virtual ~FixedIntervalSensitivityObserver()
+    {
+        ;
+    }
+
+    virtual bool fire(const Simulator* sim, const boost::shared_ptr<WorldInterface>& world);
+    virtual void reset();
+
+    const data_container_type& data() const
+    {
+        return data_;
+    }
+
+    const species_container_type& targets() const
+    {
+        return targets_;
+    }
+
+protected:
+
+    species_container_type targets_;
+    data_container_type data_;
+};
+
+} // ode
+
+} // ecell4
+
+#endif /* ECELL4_ODE_SENSITIVITY_OBSERVER_HPP */
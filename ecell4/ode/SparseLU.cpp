@@ -0,0 +1,125 @@
+#include "SparseLU.hpp"
+
+#include <set>
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+#include <ecell4/core/exceptions.hpp>
+
+
+namespace ecell4
+{
+
+namespace ode
+{
+
+void SparseLU::analyze(const size_type size, const pattern_type& entries)
+{
+    std::vector<std::set<size_type> > rows(size);
+    for (size_type i(0); i < size; ++i)
+    {
+        rows[i].insert(i);
+    }
+    for (pattern_type::const_iterator i(entries.begin()); i != entries.end(); ++i)
+    {
+        if ((*i).first >= size || (*i).second >= size)
+        {
+            throw std::out_of_range("An element is out of the matrix.");
+        }
+        rows[(*i).first].insert((*i).second);
+    }
+
+    // The symbolic elimination. Eliminating (i, k) with the row k fills
+    // every (i, c) for the upper part c > k of the row k. The fill-in
+    // may add a column less than i, which is eliminated later in this loop.
+    for (size_type i(1); i < size; ++i)
+    {
+        std::set<size_type>& row(rows[i]);
+        for (std::set<size_type>::const_iterator k(row.begin()); *k < i; ++k)
+        {
+            const std::set<size_type>& upper(rows[*k]);
+            row.insert(upper.upper_bound(*k), upper.end());
+        }
+    }
+
+    size_ = size;
+    offsets_.assign(1, 0);
+    offsets_.reserve(size + 1);
+    cols_.clear();
+    diagonal_.resize(size);
+    for (size_type i(0); i < size; ++i)
+    {
+        const std::set<size_type>& row(rows[i]);
+        diagonal_[i] = cols_.size() + std::distance(row.begin(), row.find(i));
+        cols_.insert(cols_.end(), row.begin(), row.end());
+        offsets_.push_back(cols_.size());
+    }
+
+    values_.assign(cols_.size(), 0.0);
+    work_.assign(size, 0.0);
+}
+
+SparseLU::size_type SparseLU::position(const size_type row, const size_type col) const
+{
+    if (row < size_)
+    {
+        const std::vector<size_type>::const_iterator
+            begin(cols_.begin() + offsets_[row]), end(cols_.begin() + offsets_[row + 1]);
+        const std::vector<size_type>::const_iterator i(std::lower_bound(begin, end, col));
+        if (i != end && *i == col)
+        {
+            return std::distance(cols_.begin(), i);
+        }
+    }
+
+    std::ostringstream message;
+    message << "The element (" << row << ", " << col << ") is not in the pattern.";
+    throw NotFound(message.str());
+}
+
+bool SparseLU::factorize()
+{
+    for (size_type i(0); i < size_; ++i)
+    {
+        const size_type begin(offsets_[i]), end(offsets_[i + 1]);
+        for (size_type j(begin); j < end; ++j)
+        {
+            work_[cols_[j]] = values_[j];
+        }
+
+        // The columns are sorted, and every update from the row k lands
+        // on a column greater than k in the pattern of the row i.
+        for (size_type j(begin); j < diagonal_[i]; ++j)
+        {
+            const size_type k(cols_[j]);
+            const Real l(work_[k] / values_[diagonal_[k]]);
+            work_[k] = l;
+            if (l == 0.0)
+            {
+                continue;
+            }
+            for (size_type m(diagonal_[k] + 1); m < offsets_[k + 1]; ++m)
+            {
+                work_[cols_[m]] -= l * values_[m];
+            }
+        }
+
+        for (size_type j(begin); j < end; ++j)
+        {
+            values_[j] = work_[cols_[j]];
+            work_[cols_[j]] = 0.0;
+        }
+
+        if (values_[diagonal_[i]] == 0.0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // ode
+
+} // ecell4
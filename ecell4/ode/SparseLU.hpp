@@ -0,0 +1,140 @@
+#ifndef ECELL4_ODE_SPARSE_LU_HPP
+#define ECELL4_ODE_SPARSE_LU_HPP
+
+#include <vector>
+#include <utility>
+
+#include <ecell4/core/types.hpp>
+
+
+namespace ecell4
+{
+
+namespace ode
+{
+
+/**
+ * A sparse LU decomposition without pivoting for a square matrix
+ * in the compressed row storage.
+ * The nonzero pattern, including the fill-in of the factors, is analyzed
+ * once in analyze(). Then, the matrix can be factorized and solved
+ * as many times as needed without any allocation.
+ * The diagonal is always a part of the pattern. This fits a matrix
+ * like I - h J, which is dominated by the diagonal for a small h.
+ */
+class SparseLU
+{
+public:
+
+    typedef std::size_t size_type;
+    typedef std::vector<std::pair<size_type, size_type> > pattern_type;
+
+public:
+
+    SparseLU()
+        : size_(0)
+    {
+        ;
+    }
+
+    /**
+     * build the pattern from the given (row, column) pairs.
+     * Duplicates are allowed. The values are reset to zero.
+     */
+    void analyze(const size_type size, const pattern_type& entries);
+
+    size_type size() const
+    {
+        return size_;
+    }
+
+    size_type num_nonzeros() const
+    {
+        return cols_.size();
+    }
+
+    /**
+     * return the position of (row, col) in values().
+     * Throws NotFound if the element is not a part of the pattern.
+     */
+    size_type position(const size_type row, const size_type col) const;
+
+    size_type diagonal(const size_type row) const
+    {
+        return diagonal_[row];
+    }
+
+    std::vector<Real>& values()
+    {
+        return values_;
+    }
+
+    const std::vector<Real>& values() const
+    {
+        return values_;
+    }
+
+    /**
+     * add the product of a matrix sharing this pattern and x to y.
+     */
+    template <typename Tvector_>
+    void add_product(const std::vector<Real>& matrix, const Tvector_& x, Tvector_& y) const
+    {
+        for (size_type i(0); i < size_; ++i)
+        {
+            Real value(0.0);
+            for (size_type j(offsets_[i]); j < offsets_[i + 1]; ++j)
+            {
+                value += matrix[j] * x[cols_[j]];
+            }
+            y[i] += value;
+        }
+    }
+
+    /**
+     * factorize values() in place. The unit lower and the upper triangular
+     * factors share the pattern. Return false for a zero pivot.
+     */
+    bool factorize();
+
+    /**
+     * solve the system with the factors in place of the right-hand side.
+     */
+    template <typename Tvector_>
+    void solve(Tvector_& b) const
+    {
+        for (size_type i(0); i < size_; ++i)
+        {
+            Real value(b[i]);
+            for (size_type j(offsets_[i]); j < diagonal_[i]; ++j)
+            {
+                value -= values_[j] * b[cols_[j]];
+            }
+            b[i] = value;
+        }
+
+        for (size_type i(size_); i > 0; --i)
+        {
+            const size_type row(i - 1);
+            Real value(b[row]);
+            for (size_type j(diagonal_[row] + 1); j < offsets_[row + 1]; ++j)
+            {
+                value -= values_[j] * b[cols_[j]];
+            }
+            b[row] = value / values_[diagonal_[row]];
+        }
+    }
+
+protected:
+
+    size_type size_;
+    std::vector<size_type> offsets_, cols_, diagonal_;
+    std::vector<Real> values_;
+    std::vector<Real> work_;
+};
+
+} // ode
+
+} // ecell4
+
+#endif /* ECELL4_ODE_SPARSE_LU_HPP */
@@ -11,6 +11,7 @@
 #include <ecell4/core/ReactionRule.hpp>
 #include <ecell4/core/NetworkModel.hpp>
 #include "../ODESimulator.hpp"
+#include "../SensitivityObserver.hpp"
 
 using namespace ecell4;
 using namespace ecell4::ode;
@@ -71,3 +72,299 @@ BOOST_AUTO_TEST_CASE(ODESimulator_test_step2)
 
     // BOOST_ASSERT(false);
 }
+
+static Real ODESimulator_test_ratelaw(
+    const ReactionRuleDescriptor::state_container_type& r,
+    const ReactionRuleDescriptor::state_container_type& p,
+    Real volume, Real t, const ReactionRuleDescriptorCPPfunc& rd)
+{
+    return 0.5 * r[0];
+}
+
+BOOST_AUTO_TEST_CASE(ODESimulator_test_derivatives)
+{
+    const Real3 edge_lengths(1.0, 1.0, 1.0);
+
+    Species sp1("A"), sp2("B"), sp3("C"), sp4("D");
+
+    // A + B -> C
+    ReactionRule rr1;
+    rr1.set_k(2.0);
+    rr1.add_reactant(sp1);
+    rr1.add_reactant(sp2);
+    rr1.add_product(sp3);
+
+    // 2A -> D by the mass action given as a descriptor
+    ReactionRule rr2;
+    rr2.add_reactant(sp1);
+    rr2.add_product(sp4);
+    rr2.set_descriptor(boost::shared_ptr<ReactionRuleDescriptor>(
+        new ReactionRuleDescriptorMassAction(
+            3.0, std::vector<Real>(1, 2.0), std::vector<Real>(1, 1.0))));
+
+    // D -> A by a user-defined rate law
+    ReactionRule rr3;
+    rr3.add_reactant(sp4);
+    rr3.add_product(sp1);
+    rr3.set_descriptor(boost::shared_ptr<ReactionRuleDescriptor>(
+        new ReactionRuleDescriptorCPPfunc(
+            &ODESimulator_test_ratelaw, std::vector<Real>(1, 1.0), std::vector<Real>(1, 1.0))));
+
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_reaction_rule(rr1);
+    model->add_reaction_rule(rr2);
+    model->add_reaction_rule(rr3);
+
+    boost::shared_ptr<ODEWorld> world(new ODEWorld(edge_lengths));
+    world->set_value(sp1, 3.0);
+    world->set_value(sp2, 5.0);
+    world->set_value(sp4, 7.0);
+
+    ODESimulator target(world, model);
+
+    const ODEWorld::species_id_type
+        a(world->get_species_id(sp1)), b(world->get_species_id(sp2)),
+        c(world->get_species_id(sp3)), d(world->get_species_id(sp4));
+
+    // The fluxes are 2 * 3 * 5 = 30, 3 * 3^2 = 27 and 0.5 * 7 = 3.5.
+    const std::vector<Real> dxdt(target.derivatives());
+    BOOST_CHECK_CLOSE(dxdt[a], -30.0 - 2 * 27.0 + 3.5, 1e-10);
+    BOOST_CHECK_CLOSE(dxdt[b], -30.0, 1e-10);
+    BOOST_CHECK_CLOSE(dxdt[c], +30.0, 1e-10);
+    BOOST_CHECK_CLOSE(dxdt[d], 27.0 - 3.5, 1e-10);
+
+    const std::vector<std::vector<Real> > jacobi(target.jacobian());
+    BOOST_CHECK_CLOSE(jacobi[a][a], -2.0 * 5.0 - 2 * 3.0 * 2 * 3.0, 1e-10);
+    BOOST_CHECK_CLOSE(jacobi[a][b], -2.0 * 3.0, 1e-10);
+    BOOST_CHECK_CLOSE(jacobi[b][b], -2.0 * 3.0, 1e-10);
+    BOOST_CHECK_CLOSE(jacobi[c][a], 2.0 * 5.0, 1e-10);
+    BOOST_CHECK_CLOSE(jacobi[d][a], 3.0 * 2 * 3.0, 1e-10);
+    BOOST_CHECK_CLOSE(jacobi[a][d], 0.5, 1e-4);
+    BOOST_CHECK_CLOSE(jacobi[d][d], -0.5, 1e-4);
+    BOOST_CHECK_EQUAL(jacobi[b][d], 0.0);
+
+    const std::vector<std::vector<Real> > elasticity(target.elasticity());
+    BOOST_CHECK_CLOSE(elasticity[0][a], 2.0 * 5.0, 1e-10);
+    BOOST_CHECK_CLOSE(elasticity[0][b], 2.0 * 3.0, 1e-10);
+    BOOST_CHECK_CLOSE(elasticity[1][a], 3.0 * 2 * 3.0, 1e-10);
+    BOOST_CHECK_CLOSE(elasticity[2][d], 0.5, 1e-4);
+    BOOST_CHECK_EQUAL(elasticity[0][d], 0.0);
+    BOOST_CHECK_EQUAL(elasticity[2][a], 0.0);
+}
+
+struct ODESimulator_test_doubled_mass_action
+    : public ReactionRuleDescriptorMassAction
+{
+    ODESimulator_test_doubled_mass_action(const Real k)
+        : ReactionRuleDescriptorMassAction(
+            k, std::vector<Real>(1, 1.0), std::vector<Real>(1, 1.0))
+    {
+        ;
+    }
+
+    virtual ReactionRuleDescriptor* clone() const
+    {
+        return new ODESimulator_test_doubled_mass_action(*this);
+    }
+
+    virtual Real propensity(
+        const state_container_type& reactants, const state_container_type& products,
+        Real volume, Real t) const
+    {
+        return 2.0 * ReactionRuleDescriptorMassAction::propensity(
+            reactants, products, volume, t);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(ODESimulator_test_mass_action_descriptor)
+{
+    Species sp1("A"), sp2("B");
+
+    // A -> B by the mass action given as a descriptor
+    ReactionRule rr1;
+    rr1.add_reactant(sp1);
+    rr1.add_product(sp2);
+    rr1.set_descriptor(boost::shared_ptr<ReactionRuleDescriptor>(
+        new ReactionRuleDescriptorMassAction(
+            3.0, std::vector<Real>(1, 1.0), std::vector<Real>(1, 1.0))));
+
+    // B -> A by a subclass overriding the propensity
+    ReactionRule rr2;
+    rr2.add_reactant(sp2);
+    rr2.add_product(sp1);
+    rr2.set_descriptor(boost::shared_ptr<ReactionRuleDescriptor>(
+        new ODESimulator_test_doubled_mass_action(5.0)));
+
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_reaction_rule(rr1);
+    model->add_reaction_rule(rr2);
+
+    boost::shared_ptr<ODEWorld> world(new ODEWorld(Real3(1.0, 1.0, 1.0)));
+    world->set_value(sp1, 7.0);
+    world->set_value(sp2, 11.0);
+
+    ODESimulator target(world, model);
+    target.initialize();
+
+    const ODEWorld::species_id_type
+        a(world->get_species_id(sp1)), b(world->get_species_id(sp2));
+
+    // The fluxes are 3 * 7 = 21 and 2 * 5 * 11 = 110.
+    std::vector<Real> dxdt(target.derivatives());
+    BOOST_CHECK_CLOSE(dxdt[a], -21.0 + 110.0, 1e-10);
+    BOOST_CHECK_CLOSE(dxdt[b], 21.0 - 110.0, 1e-10);
+
+    // The rate constant of the descriptor is read again.
+    // The model keeps a copy of the descriptor given.
+    boost::dynamic_pointer_cast<ReactionRuleDescriptorMassAction>(
+        model->reaction_rules()[0].get_descriptor())->set_k(4.0);
+    dxdt = target.derivatives();
+    BOOST_CHECK_CLOSE(dxdt[a], -28.0 + 110.0, 1e-10);
+    BOOST_CHECK_CLOSE(dxdt[b], 28.0 - 110.0, 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE(ODESimulator_test_rosenbrock2_sparse)
+{
+    const Real3 edge_lengths(1.0, 1.0, 1.0);
+
+    Species sp1("A"), sp2("B"), sp3("C"), sp4("D");
+
+    // A stiff network, A -> B -> C -> A and B + C -> D
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 0.5));
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp2, sp3, 1000.0));
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp3, sp1, 1.0));
+    model->add_reaction_rule(create_binding_reaction_rule(sp2, sp3, sp4, 10.0));
+
+    std::vector<std::vector<Real> > results;
+    const ODESolverType solvers[] = {ROSENBROCK4_CONTROLLER, ROSENBROCK2_SPARSE};
+    for (std::size_t i(0); i < 2; ++i)
+    {
+        boost::shared_ptr<ODEWorld> world(new ODEWorld(edge_lengths));
+        world->set_value(sp1, 10.0);
+        world->set_value(sp2, 0.0);
+        world->set_value(sp3, 1.0);
+        world->set_value(sp4, 0.0);
+
+        ODESimulator target(world, model, solvers[i]);
+        target.set_dt(0.1);
+        target.run(2.0);
+        BOOST_CHECK_CLOSE(target.t(), 2.0, 1e-10);
+
+        std::vector<Real> values;
+        values.push_back(world->get_value_exact(sp1));
+        values.push_back(world->get_value_exact(sp2));
+        values.push_back(world->get_value_exact(sp3));
+        values.push_back(world->get_value_exact(sp4));
+        results.push_back(values);
+    }
+
+    for (std::size_t j(0); j < 4; ++j)
+    {
+        BOOST_CHECK_CLOSE(results[1][j], results[0][j], 0.1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ODESimulator_test_model_change)
+{
+    Species sp1("A"), sp2("B"), sp3("C");
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 1.0));
+
+    boost::shared_ptr<ODEWorld> world(new ODEWorld(Real3(1.0, 1.0, 1.0)));
+    world->set_value(sp1, 10.0);
+    world->set_value(sp2, 0.0);
+    world->set_value(sp3, 0.0);
+
+    ODESimulator target(world, model, ROSENBROCK2_SPARSE);
+    target.set_dt(0.01);
+    target.step();
+    BOOST_CHECK_EQUAL(world->get_value_exact(sp3), 0.0);
+
+    // rules added or removed after the construction are followed.
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp2, sp3, 2.0));
+    const std::vector<Real> dxdt(target.derivatives());
+    BOOST_CHECK_CLOSE(dxdt[world->get_species_id(sp3)], 2.0 * world->get_value_exact(sp2), 1e-10);
+    target.step();
+    BOOST_CHECK(world->get_value_exact(sp3) > 0.0);
+
+    model->remove_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 1.0));
+    const Real value(world->get_value_exact(sp1));
+    target.step();
+    BOOST_CHECK_EQUAL(world->get_value_exact(sp1), value);
+}
+
+static Real ODESimulator_test_sensitivity_run(const Real k1, const Real k2)
+{
+    Species sp1("A"), sp2("B"), sp3("C");
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, k1));
+    model->add_reaction_rule(create_binding_reaction_rule(sp1, sp2, sp3, k2));
+
+    boost::shared_ptr<ODEWorld> world(new ODEWorld(Real3(1.0, 1.0, 1.0)));
+    world->set_value(sp1, 10.0);
+    world->set_value(sp2, 1.0);
+
+    ODESimulator target(world, model, ROSENBROCK2_SPARSE);
+    target.set_absolute_tolerance(1e-10);
+    target.set_relative_tolerance(1e-10);
+    target.run(1.0);
+    return world->get_value_exact(sp2);
+}
+
+BOOST_AUTO_TEST_CASE(ODESimulator_test_sensitivity)
+{
+    const Real k1(0.5), k2(0.1);
+
+    Species sp1("A"), sp2("B"), sp3("C");
+    const ReactionRule rr1(create_unimolecular_reaction_rule(sp1, sp2, k1));
+    const ReactionRule rr2(create_binding_reaction_rule(sp1, sp2, sp3, k2));
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_reaction_rule(rr1);
+    model->add_reaction_rule(rr2);
+
+    boost::shared_ptr<ODEWorld> world(new ODEWorld(Real3(1.0, 1.0, 1.0)));
+    world->set_value(sp1, 10.0);
+    world->set_value(sp2, 1.0);
+
+    {
+        ODESimulator target(world, model);
+        BOOST_CHECK_THROW(
+            target.set_sensitivity_parameters(std::vector<ReactionRule>(1, rr1)),
+            NotSupported);
+    }
+
+    ODESimulator target(world, model, ROSENBROCK2_SPARSE);
+    target.set_absolute_tolerance(1e-10);
+    target.set_relative_tolerance(1e-10);
+
+    std::vector<ReactionRule> rules;
+    rules.push_back(rr1);
+    rules.push_back(rr2);
+    target.set_sensitivity_parameters(rules);
+    BOOST_CHECK_EQUAL(target.sensitivity_parameters().size(), 2);
+
+    std::vector<std::string> species;
+    species.push_back("A");
+    species.push_back("B");
+    boost::shared_ptr<FixedIntervalSensitivityObserver>
+        obs(new FixedIntervalSensitivityObserver(0.5, species));
+    target.run(1.0, obs);
+
+    BOOST_CHECK_EQUAL(obs->data().size(), 3);
+    BOOST_CHECK_EQUAL(obs->data().back().size(), 1 + 2 * 2);
+    BOOST_CHECK_EQUAL(obs->data().front()[1], 0.0);
+
+    // Compare with the central differences of the separate runs.
+    const Real dk(1e-4);
+    const std::vector<Real> sensitivity(target.sensitivity(sp2));
+    BOOST_CHECK_CLOSE(
+        sensitivity[0],
+        (ODESimulator_test_sensitivity_run(k1 + dk, k2)
+         - ODESimulator_test_sensitivity_run(k1 - dk, k2)) / (2 * dk), 1e-3);
+    BOOST_CHECK_CLOSE(
+        sensitivity[1],
+        (ODESimulator_test_sensitivity_run(k1, k2 + dk)
+         - ODESimulator_test_sensitivity_run(k1, k2 - dk)) / (2 * dk), 1e-3);
+    BOOST_CHECK_CLOSE(obs->data().back()[4], sensitivity[1], 1e-12);
+}
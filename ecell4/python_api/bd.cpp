@@ -22,9 +22,11 @@ void define_bd_factory(py::module& m)
 {
     py::class_<BDFactory> factory(m, "BDFactory");
     factory
-        .def(py::init<const Integer3&, Real>(),
+        .def(py::init<const Integer3&, Real, const BDParticleSpaceType, const Integer>(),
                 py::arg("matrix_sizes") = BDFactory::default_matrix_sizes(),
-                py::arg("bd_dt_factor") = BDFactory::default_bd_dt_factor())
+                py::arg("bd_dt_factor") = BDFactory::default_bd_dt_factor(),
+                py::arg("space_type") = BDFactory::default_space_type(),
+                py::arg("num_threads") = BDFactory::default_num_threads())
         .def("rng", &BDFactory::rng);
     define_factory_functions(factory);
 
@@ -42,7 +44,9 @@ void define_bd_simulator(py::module& m)
         .def(py::init<boost::shared_ptr<BDWorld>, boost::shared_ptr<Model>, Real>(),
                 py::arg("w"), py::arg("m"), py::arg("bd_dt_factor") = 1e-5)
         .def("last_reactions", &BDSimulator::last_reactions)
-        .def("set_t", &BDSimulator::set_t);
+        .def("set_t", &BDSimulator::set_t)
+        .def("set_num_threads", &BDSimulator::set_num_threads)
+        .def("num_threads", &BDSimulator::num_threads);
     define_simulator_functions(simulator);
 
     m.attr("Simulator") = simulator;
@@ -93,6 +97,8 @@ void define_bd_world(py::module& m)
         .def("bind_to", &BDWorld::bind_to)
         .def("rng", &BDWorld::rng);
 
+    m.def("create_bd_world_soa_impl", &create_bd_world_soa_impl);
+
     m.attr("World") = world;
 }
 
@@ -127,6 +133,11 @@ void define_reaction_info(py::module& m)
 
 void setup_bd_module(py::module& m)
 {
+    py::enum_<BDParticleSpaceType>(m, "BDParticleSpaceType")
+        .value("CELL_LIST_SPACE", BDParticleSpaceType::CELL_LIST_SPACE)
+        .value("SOA_SPACE", BDParticleSpaceType::SOA_SPACE)
+        .export_values();
+
     define_bd_factory(m);
     define_bd_simulator(m);
     define_bd_world(m);
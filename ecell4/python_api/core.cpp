@@ -372,6 +372,7 @@ void define_rng(py::module& m)
         .def("gaussian", &RandomNumberGenerator::gaussian,
             py::arg("sigma"), py::arg("mean") = 0.0)
         .def("binomial", &RandomNumberGenerator::binomial)
+        .def("poisson", &RandomNumberGenerator::poisson)
         .def("seed", (void (RandomNumberGenerator::*)()) &RandomNumberGenerator::seed)
         .def("seed", (void (RandomNumberGenerator::*)(Integer)) &RandomNumberGenerator::seed)
         .def("save", (void (RandomNumberGenerator::*)(const std::string&) const) &RandomNumberGenerator::save)
@@ -383,6 +384,14 @@ void define_rng(py::module& m)
         .def(py::init<>())
         .def(py::init<const Integer>(), py::arg("seed"))
         .def(py::init<const std::string&>(), py::arg("filename"));
+
+    py::class_<PhiloxRandomNumberGenerator, GSLRandomNumberGenerator,
+        PyRandomNumberGeneratorImpl<PhiloxRandomNumberGenerator>,
+        boost::shared_ptr<PhiloxRandomNumberGenerator>>(m, "PhiloxRandomNumberGenerator")
+        .def(py::init<const Integer, const Integer>(), py::arg("seed") = 0, py::arg("stream") = 0)
+        .def(py::init<const std::string&>(), py::arg("filename"))
+        .def("stream", &PhiloxRandomNumberGenerator::stream)
+        .def("set_stream", &PhiloxRandomNumberGenerator::set_stream);
 }
 
 static inline
@@ -511,11 +520,36 @@ void define_model(py::module& m)
             }
         ));
 
+    py::class_<extras::NetworkGenerationStats>(m, "NetworkGenerationStats")
+        .def_readonly("iteration", &extras::NetworkGenerationStats::iteration)
+        .def_readonly("num_seeds", &extras::NetworkGenerationStats::num_seeds)
+        .def_readonly("num_applications", &extras::NetworkGenerationStats::num_applications)
+        .def_readonly("num_reactions", &extras::NetworkGenerationStats::num_reactions)
+        .def_readonly("num_new_species", &extras::NetworkGenerationStats::num_new_species)
+        .def_readonly("total_species", &extras::NetworkGenerationStats::total_species)
+        .def_readonly("total_reactions", &extras::NetworkGenerationStats::total_reactions)
+        .def_readonly("elapsed", &extras::NetworkGenerationStats::elapsed);
+
     py::class_<NetfreeModel, Model, PyModelImpl<NetfreeModel>,
         boost::shared_ptr<NetfreeModel>>(m, "NetfreeModel")
         .def(py::init<>())
         .def("set_effective", &NetfreeModel::set_effective)
         .def("effective", &NetfreeModel::effective)
+        .def("set_max_cache_size", &NetfreeModel::set_max_cache_size)
+        .def("max_cache_size", &NetfreeModel::max_cache_size)
+        .def("clear_cache", &NetfreeModel::clear_cache)
+        .def("num_cache_hits", &NetfreeModel::num_cache_hits)
+        .def("num_cache_misses", &NetfreeModel::num_cache_misses)
+        .def("expand",
+            [](const NetfreeModel& self, const std::vector<Species>& sp, const Integer max_itr,
+               const std::map<Species, Integer>& max_stoich, const Integer num_threads,
+               const extras::network_generation_callback& progress) -> boost::shared_ptr<Model>
+            {
+                return extras::generate_network_from_netfree_model(
+                    self, sp, max_itr, max_stoich, num_threads, progress).first;
+            },
+            py::arg("sp"), py::arg("max_itr"), py::arg("max_stoich"), py::arg("num_threads"),
+            py::arg("progress") = py::none())
         .def(py::pickle(
             [](const NetfreeModel& self)
             {
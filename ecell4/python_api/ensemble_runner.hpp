@@ -0,0 +1,83 @@
+#ifndef ECELL4_PYTHON_API_ENSEMBLE_RUNNER_HPP
+#define ECELL4_PYTHON_API_ENSEMBLE_RUNNER_HPP
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <ecell4/core/EnsembleRunner.hpp>
+
+#include "model.hpp"
+#include "reaction_rule_descriptor.hpp"
+
+namespace py = pybind11;
+
+namespace ecell4
+{
+
+namespace python_api
+{
+
+/**
+ * trajectories run on threads without the GIL, and thus neither the model
+ * nor its reaction rules may call back into Python.
+ */
+static inline
+void check_python_callbacks(const Model& model)
+{
+    if (is_python_model(&model))
+    {
+        throw NotSupported(
+            "A model subclassed in Python is not supported by an ensemble runner.");
+    }
+
+    const Model::reaction_rule_container_type& reaction_rules(model.reaction_rules());
+    for (Model::reaction_rule_container_type::const_iterator i(reaction_rules.begin());
+        i != reaction_rules.end(); ++i)
+    {
+        if ((*i).has_descriptor() && is_python_descriptor((*i).get_descriptor().get()))
+        {
+            throw NotSupported(
+                "A reaction rule descriptor in Python is not supported by an ensemble runner.");
+        }
+    }
+}
+
+template<class Factory>
+static inline
+void define_ensemble_runner(py::module& m, const char* name)
+{
+    using runner_type = EnsembleRunner<Factory>;
+    using world_type = typename runner_type::world_type;
+
+    py::class_<runner_type>(m, name)
+        .def(py::init<const Factory&, const boost::shared_ptr<Model>&,
+                const std::vector<Real>&, const std::vector<std::string>&,
+                const std::vector<Real>&>(),
+            py::arg("factory"), py::arg("model"), py::arg("t"), py::arg("species"),
+            py::arg("quantiles") = std::vector<Real>())
+        .def("run",
+            [](runner_type& self, const boost::shared_ptr<world_type>& world,
+               const Integer num_trajectories, const Integer seed, const Integer num_threads)
+            {
+                check_python_callbacks(*self.model());
+
+                py::gil_scoped_release release;
+                self.run(world, num_trajectories, seed, num_threads);
+            },
+            py::arg("world"), py::arg("num_trajectories"),
+            py::arg("seed") = 0, py::arg("num_threads") = 0)
+        .def("reset", &runner_type::reset)
+        .def("t", &runner_type::t)
+        .def("targets", &runner_type::targets)
+        .def("quantiles", &runner_type::quantiles)
+        .def("num_trajectories", &runner_type::num_trajectories)
+        .def("mean", &runner_type::mean)
+        .def("variance", &runner_type::variance)
+        .def("quantile", &runner_type::quantile, py::arg("p"));
+}
+
+}
+
+}
+
+#endif /* ECELL4_PYTHON_API_ENSEMBLE_RUNNER_HPP */
@@ -3,7 +3,10 @@
 #include <ecell4/gillespie/GillespieFactory.hpp>
 #include <ecell4/gillespie/GillespieSimulator.hpp>
 #include <ecell4/gillespie/GillespieWorld.hpp>
+#include <ecell4/gillespie/TauLeapingFactory.hpp>
+#include <ecell4/gillespie/TauLeapingSimulator.hpp>
 
+#include "ensemble_runner.hpp"
 #include "simulator.hpp"
 #include "simulator_factory.hpp"
 #include "world_interface.hpp"
@@ -22,7 +25,8 @@ void define_gillespie_factory(py::module& m)
 {
     py::class_<GillespieFactory> factory(m, "GillespieFactory");
     factory
-        .def(py::init<>())
+        .def(py::init<const GillespieSolverType>(),
+            py::arg("solver_type") = GillespieFactory::default_solver_type())
         .def("rng", &GillespieFactory::rng);
     define_factory_functions(factory);
 
@@ -35,16 +39,54 @@ void define_gillespie_simulator(py::module& m)
     py::class_<GillespieSimulator, Simulator, PySimulator<GillespieSimulator>,
         boost::shared_ptr<GillespieSimulator>> simulator(m, "GillespieSimulator");
     simulator
-        .def(py::init<boost::shared_ptr<GillespieWorld>>(), py::arg("w"))
-        .def(py::init<boost::shared_ptr<GillespieWorld>, boost::shared_ptr<Model>>(),
-                py::arg("w"), py::arg("m"))
+        .def(py::init<boost::shared_ptr<GillespieWorld>, const GillespieSolverType>(),
+                py::arg("w"),
+                py::arg("solver_type") = GillespieSolverType::DIRECT_METHOD)
+        .def(py::init<boost::shared_ptr<GillespieWorld>, boost::shared_ptr<Model>, const GillespieSolverType>(),
+                py::arg("w"), py::arg("m"),
+                py::arg("solver_type") = GillespieSolverType::DIRECT_METHOD)
         .def("last_reactions", &GillespieSimulator::last_reactions)
+        .def("solver_type", &GillespieSimulator::solver_type)
         .def("set_t", &GillespieSimulator::set_t);
     define_simulator_functions(simulator);
 
     m.attr("Simulator") = simulator;
 }
 
+static inline
+void define_tau_leaping_factory(py::module& m)
+{
+    py::class_<TauLeapingFactory> factory(m, "TauLeapingFactory");
+    factory
+        .def(py::init<const Real>(),
+            py::arg("epsilon") = TauLeapingFactory::default_epsilon())
+        .def("rng", &TauLeapingFactory::rng);
+    define_factory_functions(factory);
+}
+
+static inline
+void define_tau_leaping_simulator(py::module& m)
+{
+    py::class_<TauLeapingSimulator, Simulator, PySimulator<TauLeapingSimulator>,
+        boost::shared_ptr<TauLeapingSimulator>> simulator(m, "TauLeapingSimulator");
+    simulator
+        .def(py::init<boost::shared_ptr<GillespieWorld>, const Real>(),
+                py::arg("w"),
+                py::arg("epsilon") = TauLeapingFactory::default_epsilon())
+        .def(py::init<boost::shared_ptr<GillespieWorld>, boost::shared_ptr<Model>, const Real>(),
+                py::arg("w"), py::arg("m"),
+                py::arg("epsilon") = TauLeapingFactory::default_epsilon())
+        .def("is_leaping", &TauLeapingSimulator::is_leaping)
+        .def("epsilon", &TauLeapingSimulator::epsilon)
+        .def("set_epsilon", &TauLeapingSimulator::set_epsilon)
+        .def("ssa_threshold", &TauLeapingSimulator::ssa_threshold)
+        .def("set_ssa_threshold", &TauLeapingSimulator::set_ssa_threshold)
+        .def("critical_threshold", &TauLeapingSimulator::critical_threshold)
+        .def("set_critical_threshold", &TauLeapingSimulator::set_critical_threshold)
+        .def("set_t", &TauLeapingSimulator::set_t);
+    define_simulator_functions(simulator);
+}
+
 static inline
 void define_gillespie_world(py::module& m)
 {
@@ -106,10 +148,20 @@ void define_reaction_info(py::module& m)
 
 void setup_gillespie_module(py::module& m)
 {
+    py::enum_<GillespieSolverType>(m, "GillespieSolverType")
+        .value("DIRECT_METHOD", GillespieSolverType::DIRECT_METHOD)
+        .value("PARTIAL_SUM_TREE", GillespieSolverType::PARTIAL_SUM_TREE)
+        .export_values();
+
     define_gillespie_factory(m);
     define_gillespie_simulator(m);
+    define_tau_leaping_factory(m);
+    define_tau_leaping_simulator(m);
     define_gillespie_world(m);
     define_reaction_info(m);
+
+    define_ensemble_runner<GillespieFactory>(m, "EnsembleRunner");
+    define_ensemble_runner<TauLeapingFactory>(m, "TauLeapingEnsembleRunner");
 }
 
 }
@@ -4,6 +4,7 @@
 #include <ecell4/meso/MesoscopicSimulator.hpp>
 #include <ecell4/meso/MesoscopicWorld.hpp>
 
+#include "ensemble_runner.hpp"
 #include "simulator.hpp"
 #include "simulator_factory.hpp"
 #include "world_interface.hpp"
@@ -22,9 +23,13 @@ void define_meso_factory(py::module& m)
 {
     py::class_<MesoscopicFactory> factory(m, "MesoscopicFactory");
     factory
-        .def(py::init<const Integer3&, const Real>(),
+        .def(py::init<const Integer3&, const Real, const EventQueueType,
+                const SubvolumeSpaceType, const Integer>(),
             py::arg("matrix_sizes") = MesoscopicFactory::default_matrix_sizes(),
-            py::arg("subvolume_length") = MesoscopicFactory::default_subvolume_length())
+            py::arg("subvolume_length") = MesoscopicFactory::default_subvolume_length(),
+            py::arg("queue_type") = MesoscopicFactory::default_queue_type(),
+            py::arg("space_type") = MesoscopicFactory::default_space_type(),
+            py::arg("num_threads") = MesoscopicFactory::default_num_threads())
         .def("rng", &MesoscopicFactory::rng);
     define_factory_functions(factory);
 
@@ -37,9 +42,17 @@ void define_meso_simulator(py::module& m)
     py::class_<MesoscopicSimulator, Simulator, PySimulator<MesoscopicSimulator>,
         boost::shared_ptr<MesoscopicSimulator>> simulator(m, "MesoscopicSimulator");
     simulator
-        .def(py::init<boost::shared_ptr<MesoscopicWorld>>(), py::arg("w"))
-        .def(py::init<boost::shared_ptr<MesoscopicWorld>, boost::shared_ptr<Model>>(),
-                py::arg("w"), py::arg("m"))
+        .def(py::init<boost::shared_ptr<MesoscopicWorld>, const EventQueueType>(),
+                py::arg("w"), py::arg("queue_type") = HEAP_QUEUE)
+        .def(py::init<boost::shared_ptr<MesoscopicWorld>, boost::shared_ptr<Model>,
+                const EventQueueType>(),
+                py::arg("w"), py::arg("m"), py::arg("queue_type") = HEAP_QUEUE)
+        .def("queue_type", &MesoscopicSimulator::queue_type)
+        .def("num_threads", &MesoscopicSimulator::num_threads)
+        .def("set_num_threads", &MesoscopicSimulator::set_num_threads)
+        .def("num_domains", &MesoscopicSimulator::num_domains)
+        .def("window", &MesoscopicSimulator::window)
+        .def("set_window", &MesoscopicSimulator::set_window)
         .def("last_reactions", &MesoscopicSimulator::last_reactions)
         .def("set_t", &MesoscopicSimulator::set_t);
     define_simulator_functions(simulator);
@@ -124,6 +137,8 @@ void define_meso_world(py::module& m)
         .def("bind_to", &MesoscopicWorld::bind_to)
         .def("rng", &MesoscopicWorld::rng);
 
+    m.def("create_mesoscopic_world", &create_mesoscopic_world);
+
     m.attr("World") = world;
 }
 
@@ -161,10 +176,23 @@ void define_reaction_info(py::module& m)
 
 void setup_meso_module(py::module& m)
 {
+    py::enum_<EventQueueType>(m, "EventQueueType")
+        .value("HEAP_QUEUE", EventQueueType::HEAP_QUEUE)
+        .value("CALENDAR_QUEUE", EventQueueType::CALENDAR_QUEUE)
+        .export_values();
+
+    py::enum_<SubvolumeSpaceType>(m, "SubvolumeSpaceType")
+        .value("VECTOR_SUBVOLUME", SubvolumeSpaceType::VECTOR_SUBVOLUME)
+        .value("DENSE_SUBVOLUME", SubvolumeSpaceType::DENSE_SUBVOLUME)
+        .value("DENSE32_SUBVOLUME", SubvolumeSpaceType::DENSE32_SUBVOLUME)
+        .export_values();
+
     define_meso_factory(m);
     define_meso_simulator(m);
     define_meso_world(m);
     define_reaction_info(m);
+
+    define_ensemble_runner<MesoscopicFactory>(m, "EnsembleRunner");
 }
 
 }
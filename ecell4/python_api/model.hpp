@@ -115,6 +115,28 @@ namespace python_api
             PYBIND11_OVERLOAD(std::vector<ReactionRule>, Base, query_reaction_rules, sp1, sp2);
         }
 
+        /**
+         * a view of the rules from query_reaction_rules if it is overridden
+         * in Python, which the view of Base would bypass.
+         */
+        ReactionRuleView query_reaction_rules_view(const Species& sp) const override
+        {
+            if (overrides_query_reaction_rules())
+            {
+                return ReactionRuleView(this->query_reaction_rules(sp));
+            }
+            return Base::query_reaction_rules_view(sp);
+        }
+
+        ReactionRuleView query_reaction_rules_view(const Species& sp1, const Species& sp2) const override
+        {
+            if (overrides_query_reaction_rules())
+            {
+                return ReactionRuleView(this->query_reaction_rules(sp1, sp2));
+            }
+            return Base::query_reaction_rules_view(sp1, sp2);
+        }
+
         const Model::reaction_rule_container_type& reaction_rules() const override
         {
             PYBIND11_OVERLOAD(const Model::reaction_rule_container_type&, Base, reaction_rules,);
@@ -142,8 +164,29 @@ namespace python_api
         {
             PYBIND11_OVERLOAD(boost::shared_ptr<Model>, Base, expand, sp);
         }
+
+    protected:
+
+        bool overrides_query_reaction_rules() const
+        {
+            py::gil_scoped_acquire gil;
+            return static_cast<bool>(
+                py::get_overload(static_cast<const Base*>(this), "query_reaction_rules"));
+        }
     };
 
+    /**
+     * return true if the model is subclassed in Python, and thus may call
+     * back into Python with the GIL.
+     */
+    static inline
+    bool is_python_model(const Model* model)
+    {
+        return (dynamic_cast<const PyModel<>*>(model) != NULL
+            || dynamic_cast<const PyModel<NetworkModel>*>(model) != NULL
+            || dynamic_cast<const PyModel<NetfreeModel>*>(model) != NULL);
+    }
+
 }
 
 }
@@ -3,7 +3,9 @@
 #include <ecell4/ode/ODEFactory.hpp>
 #include <ecell4/ode/ODESimulator.hpp>
 #include <ecell4/ode/ODEWorld.hpp>
+#include <ecell4/ode/SensitivityObserver.hpp>
 
+#include "observers.hpp"
 #include "simulator.hpp"
 #include "simulator_factory.hpp"
 #include "world_interface.hpp"
@@ -55,7 +57,11 @@ void define_ode_simulator(py::module& m)
         .def("jacobian", &ODESimulator::jacobian)
         .def("fluxes", &ODESimulator::fluxes)
         .def("elasticity", &ODESimulator::elasticity)
-        .def("stoichiometry", &ODESimulator::stoichiometry);
+        .def("stoichiometry", &ODESimulator::stoichiometry)
+        .def("set_sensitivity_parameters", &ODESimulator::set_sensitivity_parameters)
+        .def("sensitivity_parameters", &ODESimulator::sensitivity_parameters)
+        .def("sensitivity", &ODESimulator::sensitivity)
+        .def("sensitivities", &ODESimulator::sensitivities);
     define_simulator_functions(simulator);
 
     m.attr("Simulator") = simulator;
@@ -96,17 +102,30 @@ void define_ode_world(py::module& m)
     m.attr("World") = world;
 }
 
+static inline
+void define_sensitivity_observer(py::module& m)
+{
+    py::class_<FixedIntervalSensitivityObserver, Observer, PyObserver<FixedIntervalSensitivityObserver>,
+        boost::shared_ptr<FixedIntervalSensitivityObserver>>(m, "FixedIntervalSensitivityObserver")
+        .def(py::init<const Real&, const std::vector<std::string>&>(),
+                py::arg("dt"), py::arg("species"))
+        .def("data", &FixedIntervalSensitivityObserver::data)
+        .def("targets", &FixedIntervalSensitivityObserver::targets);
+}
+
 void setup_ode_module(py::module& m)
 {
     py::enum_<ODESolverType>(m, "ODESolverType")
         .value("RUNGE_KUTTA_CASH_KARP54", ODESolverType::RUNGE_KUTTA_CASH_KARP54)
         .value("ROSENBROCK4_CONTROLLER", ODESolverType::ROSENBROCK4_CONTROLLER)
         .value("EULER", ODESolverType::EULER)
+        .value("ROSENBROCK2_SPARSE", ODESolverType::ROSENBROCK2_SPARSE)
         .export_values();
 
     define_ode_factory(m);
     define_ode_simulator(m);
     define_ode_world(m);
+    define_sensitivity_observer(m);
 }
 
 }
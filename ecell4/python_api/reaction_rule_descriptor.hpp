@@ -76,6 +76,18 @@ namespace python_api
         std::string name_;
     };
 
+    /**
+     * return true if the descriptor calls back into Python, which needs
+     * the GIL even to be copied or destroyed.
+     */
+    static inline
+    bool is_python_descriptor(const ReactionRuleDescriptor* desc)
+    {
+        return (dynamic_cast<const ReactionRuleDescriptorPyfunc*>(desc) != NULL
+            || dynamic_cast<const PyReactionRuleDescriptor<>*>(desc) != NULL
+            || dynamic_cast<const PyReactionRuleDescriptor<ReactionRuleDescriptorMassAction>*>(desc) != NULL);
+    }
+
 }
 
 }
@@ -57,8 +57,10 @@ void define_spatiocyte_factory(py::module& m)
 {
     py::class_<SpatiocyteFactory> factory(m, "SpatiocyteFactory");
     factory
-        .def(py::init<const Real>(),
-                py::arg("voxel_radius") = SpatiocyteFactory::default_voxel_radius())
+        .def(py::init<const Real, const SpatiocyteLatticeType, const Integer>(),
+                py::arg("voxel_radius") = SpatiocyteFactory::default_voxel_radius(),
+                py::arg("lattice_type") = SpatiocyteFactory::default_lattice_type(),
+                py::arg("num_threads") = SpatiocyteFactory::default_num_threads())
         .def("rng", &SpatiocyteFactory::rng);
     define_factory_functions(factory);
 
@@ -75,6 +77,8 @@ void define_spatiocyte_simulator(py::module& m)
         .def(py::init<boost::shared_ptr<SpatiocyteWorld>, boost::shared_ptr<Model>>(),
                 py::arg("w"), py::arg("m"))
         .def("last_reactions", &SpatiocyteSimulator::last_reactions)
+        .def("num_threads", &SpatiocyteSimulator::num_threads)
+        .def("set_num_threads", &SpatiocyteSimulator::set_num_threads)
         .def("set_t", &SpatiocyteSimulator::set_t);
     define_simulator_functions(simulator);
 
@@ -135,7 +139,9 @@ void define_spatiocyte_world(py::module& m)
             .. deprecated:: 3.0
                Use :func:`get_voxel_nearby` instead.
         )pbdoc")
-        .def("add_structure", &SpatiocyteWorld::add_structure)
+        .def("add_structure", &SpatiocyteWorld::add_structure,
+            py::arg("sp"), py::arg("shape"), py::arg("num_threads") = 1,
+            py::call_guard<py::gil_scoped_release>())
         .def("remove_voxel", &SpatiocyteWorld::remove_particle, R"pbdoc(
             .. deprecated:: 3.0
                Use :func:`remove_particle` instead.
@@ -152,6 +158,7 @@ void define_spatiocyte_world(py::module& m)
 
     m.def("create_spatiocyte_world_cell_list_impl", &create_spatiocyte_world_cell_list_impl_alias);
     m.def("create_spatiocyte_world_vector_impl", &create_spatiocyte_world_vector_impl_alias);
+    m.def("create_spatiocyte_world_compact_impl", &create_spatiocyte_world_compact_impl_alias);
     m.def("create_spatiocyte_world_square_offlattice_impl", &allocate_spatiocyte_world_square_offlattice_impl);
 
     m.attr("World") = world;
@@ -179,6 +186,11 @@ void define_voxel(py::module& m)
 
 void setup_spatiocyte_module(py::module& m)
 {
+    py::enum_<SpatiocyteLatticeType>(m, "SpatiocyteLatticeType")
+        .value("VECTOR_LATTICE", SpatiocyteLatticeType::VECTOR_LATTICE)
+        .value("COMPACT_LATTICE", SpatiocyteLatticeType::COMPACT_LATTICE)
+        .export_values();
+
     define_reaction_info(m);
     define_spatiocyte_factory(m);
     define_spatiocyte_simulator(m);
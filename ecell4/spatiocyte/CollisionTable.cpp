@@ -0,0 +1,74 @@
+#include "CollisionTable.hpp"
+#include "utils.hpp"
+
+namespace ecell4
+{
+
+namespace spatiocyte
+{
+
+CollisionTable::index_type
+CollisionTable::index(const boost::shared_ptr<const VoxelPool>& vp)
+{
+    utils::get_mapper_mf<const VoxelPool*, index_type>::type::const_iterator
+        itr(indices_.find(vp.get()));
+    if (itr != indices_.end())
+    {
+        const index_type idx((*itr).second);
+        if (!pools_[idx].expired())
+        {
+            return idx;
+        }
+
+        // a new pool at the address of an old one
+        pools_[idx] = vp;
+        for (index_type i(0); i < entries_.size(); ++i)
+        {
+            entries_[i][idx] = entry_type();
+            entries_[idx][i] = entry_type();
+        }
+        return idx;
+    }
+
+    const index_type idx(pools_.size());
+    pools_.push_back(vp);
+    indices_.insert(std::make_pair(vp.get(), idx));
+
+    for (std::vector<std::vector<entry_type> >::iterator i(entries_.begin());
+         i != entries_.end(); ++i)
+    {
+        (*i).resize(idx + 1);
+    }
+    entries_.push_back(std::vector<entry_type>(idx + 1));
+    return idx;
+}
+
+void CollisionTable::initialize_entry(
+    const index_type i, const index_type j, entry_type& entry)
+{
+    const boost::shared_ptr<const VoxelPool> from(pools_[i].lock()), to(pools_[j].lock());
+
+    // an entry outlives a query, so it keeps a copy of the rules.
+    const ReactionRuleView rules(
+        model_->query_reaction_rules_view(from->species(), to->species()));
+    entry.rules.assign(rules.begin(), rules.end());
+    entry.accumulated.clear();
+    entry.accumulated.reserve(entry.rules.size());
+
+    if (!entry.rules.empty())
+    {
+        const Real factor(calculate_dimensional_factor(from, to, world_));
+        Real accp(0.0);
+        for (std::vector<ReactionRule>::const_iterator itr(entry.rules.begin());
+             itr != entry.rules.end(); ++itr)
+        {
+            accp += (*itr).k() * factor;
+            entry.accumulated.push_back(accp);
+        }
+    }
+    entry.initialized = true;
+}
+
+} // spatiocyte
+
+} // ecell4
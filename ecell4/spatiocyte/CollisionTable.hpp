@@ -0,0 +1,95 @@
+#ifndef ECELL4_SPATIOCYTE_COLLISION_TABLE_HPP
+#define ECELL4_SPATIOCYTE_COLLISION_TABLE_HPP
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <ecell4/core/Model.hpp>
+#include <ecell4/core/ReactionRule.hpp>
+#include <ecell4/core/ReactionRuleView.hpp>
+#include <ecell4/core/VoxelPool.hpp>
+#include <ecell4/core/get_mapper_mf.hpp>
+
+#include "SpatiocyteWorld.hpp"
+
+namespace ecell4
+{
+
+namespace spatiocyte
+{
+
+/**
+ * A dense table of the second order reactions between two voxel pools.
+ * An entry holds the reaction rules of the pair together with the
+ * cumulative sums of the rate constant times the dimensional factor,
+ * so a collision only multiplies them by alpha to draw a rule.
+ * Pools are indexed at the first time they are seen, and an entry is
+ * filled at the first collision of the pair.
+ */
+class CollisionTable
+{
+public:
+
+    typedef std::size_t index_type;
+
+    struct entry_type
+    {
+        entry_type()
+            : initialized(false)
+        {
+            ;
+        }
+
+        bool initialized;
+        std::vector<ReactionRule> rules;
+        std::vector<Real> accumulated;
+    };
+
+public:
+
+    CollisionTable(boost::shared_ptr<Model> model, boost::shared_ptr<SpatiocyteWorld> world)
+        : model_(model), world_(world)
+    {
+        ;
+    }
+
+    /**
+     * return the index of the given pool, extending the table for a new one.
+     */
+    index_type index(const boost::shared_ptr<const VoxelPool>& vp);
+
+    const entry_type& get(const index_type i, const index_type j)
+    {
+        entry_type& entry(entries_[i][j]);
+        if (!entry.initialized)
+        {
+            initialize_entry(i, j, entry);
+        }
+        return entry;
+    }
+
+    std::size_t size() const
+    {
+        return pools_.size();
+    }
+
+protected:
+
+    void initialize_entry(const index_type i, const index_type j, entry_type& entry);
+
+protected:
+
+    boost::shared_ptr<Model> model_;
+    boost::shared_ptr<SpatiocyteWorld> world_;
+
+    std::vector<boost::weak_ptr<const VoxelPool> > pools_;
+    utils::get_mapper_mf<const VoxelPool*, index_type>::type indices_;
+    std::vector<std::vector<entry_type> > entries_;
+};
+
+} // spatiocyte
+
+} // ecell4
+
+#endif /* ECELL4_SPATIOCYTE_COLLISION_TABLE_HPP */
@@ -6,6 +6,7 @@
 #include <ecell4/core/Model.hpp>
 #include "SpatiocyteReactions.hpp"
 #include "SpatiocyteWorld.hpp"
+#include "CollisionTable.hpp"
 
 namespace ecell4
 {
@@ -47,6 +48,7 @@ struct StepEvent : SpatiocyteEvent
 {
     StepEvent(boost::shared_ptr<Model> model,
               boost::shared_ptr<SpatiocyteWorld> world,
+              boost::shared_ptr<CollisionTable> collision_table,
               const Species& species,
               const Real& t,
               const Real alpha=1.0);
@@ -82,6 +84,8 @@ protected:
     boost::shared_ptr<Model> model_;
     boost::shared_ptr<SpatiocyteWorld> world_;
     boost::shared_ptr<MoleculePool> mpool_;
+    boost::shared_ptr<CollisionTable> collision_table_;
+    CollisionTable::index_type index_;
 
     const Real alpha_;
 };
@@ -90,17 +94,45 @@ struct StepEvent3D : StepEvent
 {
     StepEvent3D(boost::shared_ptr<Model> model,
                 boost::shared_ptr<SpatiocyteWorld> world,
+                boost::shared_ptr<CollisionTable> collision_table,
                 const Species& species,
                 const Real& t,
                 const Real alpha=1.0);
 
     void walk(const Real& alpha);
+
+    Integer num_threads() const
+    {
+        return num_threads_;
+    }
+
+    void set_num_threads(const Integer num_threads)
+    {
+        num_threads_ = num_threads;
+    }
+
+protected:
+
+    typedef std::pair<SpatiocyteWorld::coordinate_id_pair_type,
+                      SpatiocyteWorld::coordinate_type> collision_type;
+
+    bool walk_in_slabs(const Real& alpha);
+    void walk_slab(const std::size_t slab, const Real& alpha);
+
+protected:
+
+    Integer num_threads_;
+
+    std::vector<std::vector<std::size_t> > slabs_; // indices in the pool
+    std::vector<boost::shared_ptr<PhiloxRandomNumberGenerator> > slab_rngs_;
+    std::vector<std::vector<collision_type> > collisions_;
 };
 
 struct StepEvent2D : StepEvent
 {
     StepEvent2D(boost::shared_ptr<Model> model,
                 boost::shared_ptr<SpatiocyteWorld> world,
+                boost::shared_ptr<CollisionTable> collision_table,
                 const Species& species,
                 const Real& t,
                 const Real alpha=1.0);
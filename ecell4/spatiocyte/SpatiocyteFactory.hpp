@@ -15,6 +15,16 @@ namespace ecell4
 namespace spatiocyte
 {
 
+/**
+ * the implementation of the root lattice space of a world.
+ * COMPACT_LATTICE keeps a 16-bit pool index per voxel (LatticeSpaceCompactImpl).
+ */
+enum SpatiocyteLatticeType
+{
+    VECTOR_LATTICE = 0,
+    COMPACT_LATTICE = 1
+};
+
 class SpatiocyteFactory:
     public SimulatorFactory<SpatiocyteWorld, SpatiocyteSimulator>
 {
@@ -27,8 +37,11 @@ public:
 
 public:
 
-    SpatiocyteFactory(const Real voxel_radius = default_voxel_radius())
-        : base_type(), rng_(), voxel_radius_(voxel_radius)
+    SpatiocyteFactory(const Real voxel_radius = default_voxel_radius(),
+                      const SpatiocyteLatticeType lattice_type = default_lattice_type(),
+                      const Integer num_threads = default_num_threads())
+        : base_type(), rng_(), voxel_radius_(voxel_radius), lattice_type_(lattice_type),
+          num_threads_(num_threads)
     {
         ; // do nothing
     }
@@ -43,6 +56,16 @@ public:
         return 0.0;
     }
 
+    static inline const SpatiocyteLatticeType default_lattice_type()
+    {
+        return VECTOR_LATTICE;
+    }
+
+    static inline const Integer default_num_threads()
+    {
+        return 1;
+    }
+
     this_type& rng(const boost::shared_ptr<RandomNumberGenerator>& rng)
     {
         rng_ = rng;
@@ -58,7 +81,14 @@ protected:
 
     virtual world_type* create_world(const Real3& edge_lengths) const
     {
-        if (rng_)
+        if (lattice_type_ == COMPACT_LATTICE)
+        {
+            return create_spatiocyte_world_compact_impl(
+                edge_lengths,
+                (voxel_radius_ > 0 ? voxel_radius_ : edge_lengths[0] / 100),
+                (rng_ ? rng_ : create_rng()));
+        }
+        else if (rng_)
         {
             return new world_type(edge_lengths, voxel_radius_, rng_);
         }
@@ -72,10 +102,30 @@ protected:
         }
     }
 
+    virtual simulator_type* create_simulator(
+        const boost::shared_ptr<world_type>& w, const boost::shared_ptr<Model>& m) const
+    {
+        simulator_type* sim = new simulator_type(w, m);
+        if (num_threads_ != 1)
+        {
+            sim->set_num_threads(num_threads_);
+        }
+        return sim;
+    }
+
+    static boost::shared_ptr<RandomNumberGenerator> create_rng()
+    {
+        boost::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+        rng->seed();
+        return rng;
+    }
+
 protected:
 
     boost::shared_ptr<RandomNumberGenerator> rng_;
     Real voxel_radius_;
+    SpatiocyteLatticeType lattice_type_;
+    Integer num_threads_;
 };
 
 } // spatiocyte
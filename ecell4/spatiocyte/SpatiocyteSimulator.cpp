@@ -19,6 +19,7 @@ void SpatiocyteSimulator::initialize()
 
     scheduler_.clear();
     update_alpha_map();
+    collision_table_.reset(new CollisionTable(model_, world_));
     const std::vector<Species> species(world_->list_species());
     for (std::vector<Species>::const_iterator itr(species.begin());
         itr != species.end(); ++itr)
@@ -84,8 +85,8 @@ void SpatiocyteSimulator::register_events(const Species& sp)
         scheduler_.add(step_event);
     }
 
-    std::vector<ReactionRule> reaction_rules(model_->query_reaction_rules(sp));
-    for (std::vector<ReactionRule>::const_iterator i(reaction_rules.begin());
+    const ReactionRuleView reaction_rules(model_->query_reaction_rules_view(sp));
+    for (ReactionRuleView::const_iterator i(reaction_rules.begin());
         i != reaction_rules.end(); ++i)
     {
         const ReactionRule& rr(*i);
@@ -104,13 +105,15 @@ boost::shared_ptr<SpatiocyteEvent> SpatiocyteSimulator::create_step_event(
 
     if (dimension == Shape::THREE)
     {
-        return boost::shared_ptr<SpatiocyteEvent>(
-                new StepEvent3D(model_, world_, species, t, alpha));
+        StepEvent3D* step_event(
+                new StepEvent3D(model_, world_, collision_table_, species, t, alpha));
+        step_event->set_num_threads(num_threads_);
+        return boost::shared_ptr<SpatiocyteEvent>(step_event);
     }
     else if (dimension == Shape::TWO)
     {
         return boost::shared_ptr<SpatiocyteEvent>(
-                new StepEvent2D(model_, world_, species, t, alpha));
+                new StepEvent2D(model_, world_, collision_table_, species, t, alpha));
     }
     else
     {
@@ -136,6 +139,27 @@ SpatiocyteSimulator::create_first_order_reaction_event(
     return event;
 }
 
+void SpatiocyteSimulator::set_num_threads(const Integer num_threads)
+{
+    if (num_threads < 1)
+    {
+        throw std::invalid_argument("The number of threads must be positive.");
+    }
+
+    num_threads_ = num_threads;
+
+    scheduler_type::events_range events(scheduler_.events());
+    for (scheduler_type::events_range::iterator itr(events.begin());
+            itr != events.end(); ++itr)
+    {
+        StepEvent3D* step_event(dynamic_cast<StepEvent3D*>((*itr).second.get()));
+        if (step_event != NULL)
+        {
+            step_event->set_num_threads(num_threads_);
+        }
+    }
+}
+
 void SpatiocyteSimulator::finalize()
 {
     scheduler_type::events_range events(scheduler_.events());
@@ -210,8 +234,8 @@ void SpatiocyteSimulator::step_()
         itr != events.end(); ++itr)
     {
         (*itr).second->interrupt(time);
-        scheduler_.update(*itr);
     }
+    scheduler_.update(events.begin(), events.end());
     scheduler_.add(top.second);
 
     // update_alpha_map(); // may be performance cost
@@ -10,7 +10,7 @@
 #include <ecell4/core/VoxelPool.hpp>
 #include <ecell4/core/SimulatorBase.hpp>
 #include <ecell4/core/RandomNumberGenerator.hpp>
-#include <ecell4/core/EventScheduler.hpp>
+#include <ecell4/core/FlatEventScheduler.hpp>
 #include <ecell4/core/get_mapper_mf.hpp>
 
 #include "SpatiocyteWorld.hpp"
@@ -29,7 +29,7 @@ public:
 
     typedef SimulatorBase<SpatiocyteWorld> base_type;
     typedef SpatiocyteEvent::reaction_type reaction_type;
-    typedef EventSchedulerBase<SpatiocyteEvent> scheduler_type;
+    typedef FlatEventSchedulerBase<SpatiocyteEvent> scheduler_type;
     typedef utils::get_mapper_mf<Species, Real>::type alpha_map_type;
 
 public:
@@ -37,14 +37,14 @@ public:
     SpatiocyteSimulator(
             boost::shared_ptr<SpatiocyteWorld> world,
             boost::shared_ptr<Model> model)
-        : base_type(world, model)
+        : base_type(world, model), num_threads_(1)
     {
         initialize();
     }
 
     SpatiocyteSimulator(
             boost::shared_ptr<SpatiocyteWorld> world)
-        : base_type(world)
+        : base_type(world), num_threads_(1)
     {
         initialize();
     }
@@ -70,6 +70,18 @@ public:
         return last_reactions_;
     }
 
+    Integer num_threads() const
+    {
+        return num_threads_;
+    }
+
+    /**
+     * walk 3D molecules in slabs of the lattice with the given number of threads.
+     * One thread keeps the serial walk, whose trajectory differs from that
+     * of two or more threads. See StepEvent3D::walk_in_slabs.
+     */
+    void set_num_threads(const Integer num_threads);
+
 protected:
 
     boost::shared_ptr<SpatiocyteEvent> create_step_event(
@@ -96,6 +108,8 @@ protected:
     std::vector<reaction_type> last_reactions_;
 
     std::vector<Species> species_list_;
+    boost::shared_ptr<CollisionTable> collision_table_;
+    Integer num_threads_;
 
     Real dt_;
 };
@@ -2,6 +2,7 @@
 #include <fstream>
 
 #include "SpatiocyteWorld.hpp"
+#include "utils.hpp"
 
 namespace ecell4
 {
@@ -196,7 +197,8 @@ bool SpatiocyteWorld::add_molecules(
 }
 
 Integer SpatiocyteWorld::add_structure(
-    const Species& sp, const boost::shared_ptr<const Shape> shape)
+    const Species& sp, const boost::shared_ptr<const Shape> shape,
+    const Integer num_threads)
 {
     const MoleculeInfo info(get_molecule_info(sp));
     get_root()->make_structure_type(sp, info.loc);
@@ -209,9 +211,9 @@ Integer SpatiocyteWorld::add_structure(
     switch (shape->dimension())
     {
     case Shape::THREE:
-        return add_structure3(sp, info.loc, shape);
+        return add_structure3(sp, info.loc, shape, num_threads);
     case Shape::TWO:
-        return add_structure2(sp, info.loc, shape);
+        return add_structure2(sp, info.loc, shape, num_threads);
     case Shape::ONE:
     case Shape::UNDEF:
         break;
@@ -224,18 +226,36 @@ Integer
 SpatiocyteWorld::add_structure3(
     const Species& sp,
     const std::string& location,
-    const boost::shared_ptr<const Shape> shape
+    const boost::shared_ptr<const Shape> shape,
+    const Integer num_threads
+)
+{
+    return place_structure(sp, location, list_structure_coordinates(shape, false, num_threads));
+}
+
+Integer
+SpatiocyteWorld::add_structure2(
+    const Species& sp,
+    const std::string& location,
+    const boost::shared_ptr<const Shape> shape,
+    const Integer num_threads
+)
+{
+    return place_structure(sp, location, list_structure_coordinates(shape, true, num_threads));
+}
+
+Integer
+SpatiocyteWorld::place_structure(
+    const Species& sp,
+    const std::string& location,
+    const std::vector<coordinate_type>& coords
 )
 {
     Integer count(0);
-    for (coordinate_type coord(0); coord < size(); ++coord)
+    for (std::vector<coordinate_type>::const_iterator itr(coords.begin());
+         itr != coords.end(); ++itr)
     {
-        const Voxel voxel(coordinate2voxel(coord));
-
-        if (!this->is_inside(coord) || shape->is_inside(voxel.position()) > 0)
-        {
-            continue;
-        }
+        const Voxel voxel(coordinate2voxel(*itr));
 
         if (voxel.get_voxel_pool()->species().serial() != location)
         {
@@ -253,36 +273,149 @@ SpatiocyteWorld::add_structure3(
     return count;
 }
 
-Integer
-SpatiocyteWorld::add_structure2(
-    const Species& sp,
-    const std::string& location,
-    const boost::shared_ptr<const Shape> shape
-)
+/**
+ * list the voxels of a shape in the order of the coordinates. When the world
+ * consists of a single HCP lattice, only the voxels around the bounding box of
+ * the shape are tested, layer by layer on the given number of threads, with
+ * the batch interface of the shape. Otherwise, every voxel is tested one by one.
+ */
+std::vector<SpatiocyteWorld::coordinate_type>
+SpatiocyteWorld::list_structure_coordinates(
+    const boost::shared_ptr<const Shape> shape, const bool surface,
+    const Integer num_threads)
 {
-    Integer count(0);
-    for (coordinate_type coord(0); coord < size(); ++coord)
+    const boost::shared_ptr<const HCPLatticeSpace>
+        root(boost::dynamic_pointer_cast<const HCPLatticeSpace>(get_root()));
+
+    std::vector<coordinate_type> retval;
+    if (!root || root->size() != size())
     {
-        const Voxel voxel(coordinate2voxel(coord));
-        if (!this->is_inside(coord) || !is_surface_voxel(voxel, shape))
+        for (coordinate_type coord(0); coord < size(); ++coord)
         {
-            continue;
+            if (!this->is_inside(coord))
+            {
+                continue;
+            }
+
+            const Voxel voxel(coordinate2voxel(coord));
+            if (surface ? is_surface_voxel(voxel, shape)
+                        : shape->is_inside(voxel.position()) <= 0)
+            {
+                retval.push_back(coord);
+            }
         }
+        return retval;
+    }
 
-        if (voxel.get_voxel_pool()->species().serial() != location)
+    const Real3 lengths(edge_lengths());
+    Real3 lower, upper;
+    shape->bounding_box(lengths, lower, upper);
+    for (std::size_t i(0); i < 3; ++i)
+    {
+        if (lower[i] > lengths[i] || upper[i] < 0.0 || lower[i] > upper[i])
         {
-            throw NotSupported(
-                "Mismatch in the location. Failed to place '"
-                + sp.serial() + "' to '"
-                + voxel.get_voxel_pool()->species().serial() + "'. "
-                + "'" + location + "' is expected.");
-            continue;
+            return retval;
         }
+        lower[i] = std::max(lower[i], 0.0);
+        upper[i] = std::min(upper[i], lengths[i]);
+    }
 
-        if (new_voxel_structure(sp, voxel))
-            ++count;
+    // position2global rounds to the nearest, but the rows and the layers are
+    // staggered. Two more voxels on each side cover the box.
+    const Integer3 g0(root->position2global(lower)), g1(root->position2global(upper));
+    const Integer col0(std::max<Integer>(std::min(g0.col, g1.col) - 2, 0)),
+                  col1(std::min<Integer>(std::max(g0.col, g1.col) + 2, root->col_size() - 1)),
+                  row0(std::max<Integer>(std::min(g0.row, g1.row) - 2, 0)),
+                  row1(std::min<Integer>(std::max(g0.row, g1.row) + 2, root->row_size() - 1)),
+                  layer0(std::max<Integer>(std::min(g0.layer, g1.layer) - 2, 0)),
+                  layer1(std::min<Integer>(std::max(g0.layer, g1.layer) + 2, root->layer_size() - 1));
+    if (col0 > col1 || row0 > row1 || layer0 > layer1)
+    {
+        return retval;
     }
-    return count;
+
+    const Real threshold(-2 * voxel_radius());
+    std::vector<std::vector<coordinate_type> > selected(layer1 - layer0 + 1);
+    std::vector<std::size_t> layers(selected.size());
+    for (std::size_t i(0); i < layers.size(); ++i)
+    {
+        layers[i] = i;
+    }
+
+    const auto rasterize = [&](const std::size_t i)
+    {
+        const Integer layer(layer0 + i);
+        std::vector<coordinate_type> coords;
+        std::vector<Real3> positions;
+        std::vector<Real> values;
+        for (Integer col(col0); col <= col1; ++col)
+        {
+            for (Integer row(row0); row <= row1; ++row)
+            {
+                const coordinate_type coord(root->global2coordinate(Integer3(col, row, layer)));
+                coords.push_back(coord);
+                positions.push_back(root->coordinate2position(coord));
+            }
+        }
+        shape->batch_is_inside(positions, values);
+
+        std::vector<coordinate_type>& layer_selected(selected[i]);
+        if (!surface)
+        {
+            for (std::size_t j(0); j < coords.size(); ++j)
+            {
+                if (values[j] <= 0)
+                {
+                    layer_selected.push_back(coords[j]);
+                }
+            }
+            return;
+        }
+
+        // a voxel within the shell needs a neighbor outside the shape.
+        std::vector<coordinate_type> candidates;
+        std::vector<Real3> neighbors;
+        for (std::size_t j(0); j < coords.size(); ++j)
+        {
+            if (values[j] > 0 || values[j] < threshold)
+            {
+                continue;
+            }
+
+            candidates.push_back(coords[j]);
+            for (Integer k(0); k < root->num_neighbors(coords[j]); ++k)
+            {
+                neighbors.push_back(
+                    root->coordinate2position(root->get_neighbor(coords[j], k)));
+            }
+        }
+        shape->batch_is_inside(neighbors, values);
+
+        std::size_t offset(0);
+        for (std::vector<coordinate_type>::const_iterator itr(candidates.begin());
+             itr != candidates.end(); ++itr)
+        {
+            const Integer num_neighbors(root->num_neighbors(*itr));
+            for (Integer k(0); k < num_neighbors; ++k)
+            {
+                if (values[offset + k] > 0)
+                {
+                    layer_selected.push_back(*itr);
+                    break;
+                }
+            }
+            offset += num_neighbors;
+        }
+    };
+
+    parallel_for_each(std::max<Integer>(num_threads, 1), layers, rasterize);
+
+    for (std::vector<std::vector<coordinate_type> >::const_iterator itr(selected.begin());
+         itr != selected.end(); ++itr)
+    {
+        retval.insert(retval.end(), (*itr).begin(), (*itr).end());
+    }
+    return retval;
 }
 
 bool
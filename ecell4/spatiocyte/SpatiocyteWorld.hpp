@@ -8,6 +8,7 @@
 
 #include <ecell4/core/LatticeSpaceCellListImpl.hpp>
 #include <ecell4/core/LatticeSpaceVectorImpl.hpp>
+#include <ecell4/core/LatticeSpaceCompactImpl.hpp>
 #include <ecell4/core/OffLatticeSpace.hpp>
 #include <ecell4/core/VoxelPool.hpp>
 #include <ecell4/core/RandomNumberGenerator.hpp>
@@ -816,7 +817,15 @@ public:
 
     bool add_molecules(const Species& sp, const Integer& num);
     bool add_molecules(const Species& sp, const Integer& num, const boost::shared_ptr<const Shape> shape);
-    Integer add_structure(const Species& sp, const boost::shared_ptr<const Shape> shape);
+
+    /**
+     * place the given structure on the voxels within the shape.
+     * The shape is tested on num_threads threads when the world is
+     * a single HCP lattice, and thus its batch_is_inside must be
+     * thread-safe if num_threads is more than one.
+     */
+    Integer add_structure(const Species& sp, const boost::shared_ptr<const Shape> shape,
+                          const Integer num_threads = 1);
 
     void remove_molecules(const Species& sp, const Integer& num);
     // void remove_molecules_exact(const Species& sp, const Integer& num);
@@ -911,9 +920,11 @@ protected:
         return space_type();
     }
 
-    Integer add_structure2(const Species& sp, const std::string& location, const boost::shared_ptr<const Shape> shape);
-    Integer add_structure3(const Species& sp, const std::string& location, const boost::shared_ptr<const Shape> shape);
+    Integer add_structure2(const Species& sp, const std::string& location, const boost::shared_ptr<const Shape> shape, const Integer num_threads);
+    Integer add_structure3(const Species& sp, const std::string& location, const boost::shared_ptr<const Shape> shape, const Integer num_threads);
     bool is_surface_voxel(const Voxel& voxel, const boost::shared_ptr<const Shape> shape) const;
+    Integer place_structure(const Species& sp, const std::string& location, const std::vector<coordinate_type>& coords);
+    std::vector<coordinate_type> list_structure_coordinates(const boost::shared_ptr<const Shape> shape, const bool surface, const Integer num_threads);
 
 public:
 
@@ -964,6 +975,17 @@ create_spatiocyte_world_vector_impl(
         new LatticeSpaceVectorImpl(edge_lengths, voxel_radius), rng);
 }
 
+inline
+SpatiocyteWorld*
+create_spatiocyte_world_compact_impl(
+        const Real3& edge_lengths,
+        const Real& voxel_radius,
+        const boost::shared_ptr<RandomNumberGenerator>& rng)
+{
+    return new SpatiocyteWorld(
+        new LatticeSpaceCompactImpl(edge_lengths, voxel_radius), rng);
+}
+
 inline
 SpatiocyteWorld*
 allocate_spatiocyte_world_square_offlattice_impl(
@@ -1033,6 +1055,13 @@ inline SpatiocyteWorld* create_spatiocyte_world_vector_impl_alias(
     return create_spatiocyte_world_vector_impl(edge_lengths, voxel_radius, rng);
 }
 
+inline SpatiocyteWorld* create_spatiocyte_world_compact_impl_alias(
+    const Real3& edge_lengths, const Real& voxel_radius,
+    const boost::shared_ptr<RandomNumberGenerator>& rng)
+{
+    return create_spatiocyte_world_compact_impl(edge_lengths, voxel_radius, rng);
+}
+
 } // spatiocyte
 
 } // ecell4
@@ -1,3 +1,6 @@
+#include <ecell4/core/LatticeSpaceVectorImpl.hpp>
+#include <ecell4/core/LatticeSpaceCompactImpl.hpp>
+
 #include "SpatiocyteEvent.hpp"
 #include "utils.hpp"
 
@@ -8,11 +11,14 @@ namespace spatiocyte
 {
 
 StepEvent::StepEvent(boost::shared_ptr<Model> model, boost::shared_ptr<SpatiocyteWorld> world,
+        boost::shared_ptr<CollisionTable> collision_table,
         const Species& species, const Real& t, const Real alpha)
     : SpatiocyteEvent(t),
       model_(model),
       world_(world),
       mpool_(world_->find_molecule_pool(species)),
+      collision_table_(collision_table),
+      index_(collision_table_->index(mpool_)),
       alpha_(alpha)
 {
     time_ = t;
@@ -20,10 +26,11 @@ StepEvent::StepEvent(boost::shared_ptr<Model> model, boost::shared_ptr<Spatiocyt
 
 StepEvent3D::StepEvent3D(boost::shared_ptr<Model> model,
                          boost::shared_ptr<SpatiocyteWorld> world,
+                         boost::shared_ptr<CollisionTable> collision_table,
                          const Species& species,
                          const Real& t,
                          const Real alpha)
-    : StepEvent(model, world, species, t, alpha)
+    : StepEvent(model, world, collision_table, species, t, alpha), num_threads_(1)
 {
     const MoleculeInfo minfo(world_->get_molecule_info(species));
     const Real D(minfo.D);
@@ -44,47 +51,162 @@ void StepEvent3D::walk(const Real& alpha)
         return; // INVALID ALPHA VALUE
     }
 
+    if (num_threads_ > 1 && walk_in_slabs(alpha))
+    {
+        return;
+    }
+
     const boost::shared_ptr<RandomNumberGenerator>& rng(world_->rng());
-    MoleculePool::container_type voxels;
-    copy(mpool_->begin(), mpool_->end(), back_inserter(voxels));
 
-    std::size_t idx(0);
-    for (MoleculePool::container_type::iterator itr(voxels.begin());
-         itr != voxels.end(); ++itr)
+    mpool_->begin_sweep();
+    while (mpool_->sweep_size() > 0)
     {
-        const SpatiocyteWorld::coordinate_id_pair_type& info(*itr);
+        // a molecule removed by a reaction leaves the sweep.
+        const std::size_t idx(mpool_->next_in_sweep());
+        const SpatiocyteWorld::coordinate_id_pair_type info((*mpool_)[idx]);
         const Voxel voxel(world_->coordinate2voxel(info.coordinate));
         const Integer rnd(rng->uniform_int(0, voxel.num_neighbors()-1));
+        const Voxel neighbor(voxel.get_neighbor(rnd));
 
-        if (voxel.get_voxel_pool() != mpool_)
+        if (world_->can_move(voxel, neighbor))
+        {
+            if (rng->uniform(0,1) <= alpha)
+                world_->move(voxel, neighbor, /*candidate=*/idx);
+        }
+        else
         {
-            // should skip if a voxel is not the target species.
-            // when reaction has occured before, a voxel can be changed.
-            continue;
+            attempt_reaction_(info, neighbor, alpha);
         }
+    }
+    mpool_->end_sweep();
+}
 
+/**
+ * Walk the molecules in slabs of layers concurrently. Each slab is at least
+ * two layers thick and their number is even, so the slabs of the same parity
+ * never touch the same voxel when walked together. Each slab draws from its
+ * own Philox stream of a seed drawn from the world at each step, and blocked
+ * moves are attempted to react afterwards, serially in the order of the
+ * slabs. Thus, a trajectory depends on the seed and the lattice, but not on
+ * the number of threads as long as it is more than one. With one thread,
+ * walk takes the serial walk above instead, which attempts a reaction as
+ * soon as a move is blocked, and so draws a different trajectory from the
+ * same seed.
+ * Returns false without doing anything when the world is not supported.
+ */
+bool StepEvent3D::walk_in_slabs(const Real& alpha)
+{
+    {
+        // only a voxel of the molecule itself changes in a move
+        const boost::shared_ptr<VoxelPool> location(mpool_->location());
+        if (!location || !(location->is_vacant() || location->is_structure()))
+        {
+            return false;
+        }
+    }
+
+    const boost::shared_ptr<VoxelSpaceBase> space(world_->coordinate2voxel(0).space.lock());
+    if (space->size() != world_->size()
+        || !(boost::dynamic_pointer_cast<LatticeSpaceVectorImpl>(space)
+             || boost::dynamic_pointer_cast<LatticeSpaceCompactImpl>(space)))
+    {
+        return false;
+    }
+
+    const Integer3 shape(space->shape());
+    const Integer num_colrow(shape.col * shape.row);
+    const Integer num_layers(shape.layer - 2);
+    const std::size_t num_slabs((num_layers / 4) * 2);
+    if (num_slabs < 2)
+    {
+        return false;
+    }
+
+    slabs_.resize(num_slabs);
+    collisions_.resize(num_slabs);
+    while (slab_rngs_.size() < num_slabs)
+    {
+        slab_rngs_.push_back(boost::shared_ptr<PhiloxRandomNumberGenerator>(
+            new PhiloxRandomNumberGenerator(0, slab_rngs_.size())));
+    }
+
+    // the streams of one seed are independent, and reseeding one keeps its stream.
+    const Integer seed(world_->rng()->uniform_int(0, 2147483647));
+    for (std::size_t i(0); i < num_slabs; ++i)
+    {
+        slabs_[i].clear();
+        collisions_[i].clear();
+        slab_rngs_[i]->seed(seed);
+    }
+
+    for (std::size_t idx(0); idx < static_cast<std::size_t>(mpool_->size()); ++idx)
+    {
+        const Integer layer((*mpool_)[idx].coordinate / num_colrow - 1);
+        slabs_[layer * num_slabs / num_layers].push_back(idx);
+    }
+
+    std::vector<std::size_t> even, odd;
+    for (std::size_t i(0); i < num_slabs; i += 2)
+    {
+        even.push_back(i);
+        odd.push_back(i + 1);
+    }
+
+    const auto walk = [this, &alpha](const std::size_t slab) { walk_slab(slab, alpha); };
+    parallel_for_each(num_threads_, even, walk);
+    parallel_for_each(num_threads_, odd, walk);
+
+    for (std::size_t i(0); i < num_slabs; ++i)
+    {
+        for (std::vector<collision_type>::const_iterator itr(collisions_[i].begin());
+             itr != collisions_[i].end(); ++itr)
+        {
+            const Voxel voxel(world_->coordinate2voxel((*itr).first.coordinate));
+            if (voxel.get_voxel_pool() != mpool_)
+            {
+                // the molecule has reacted with another already.
+                continue;
+            }
+
+            attempt_reaction_((*itr).first, world_->coordinate2voxel((*itr).second), alpha);
+        }
+    }
+    return true;
+}
+
+void StepEvent3D::walk_slab(const std::size_t slab, const Real& alpha)
+{
+    RandomNumberGenerator& rng(*slab_rngs_[slab]);
+    std::vector<collision_type>& collisions(collisions_[slab]);
+
+    for (std::vector<std::size_t>::const_iterator itr(slabs_[slab].begin());
+         itr != slabs_[slab].end(); ++itr)
+    {
+        const std::size_t idx(*itr);
+        const SpatiocyteWorld::coordinate_id_pair_type info((*mpool_)[idx]);
+        const Voxel voxel(world_->coordinate2voxel(info.coordinate));
+        const Integer rnd(rng.uniform_int(0, voxel.num_neighbors()-1));
         const Voxel neighbor(voxel.get_neighbor(rnd));
 
         if (world_->can_move(voxel, neighbor))
         {
-            if (rng->uniform(0,1) <= alpha)
+            if (rng.uniform(0,1) <= alpha)
                 world_->move(voxel, neighbor, /*candidate=*/idx);
         }
         else
         {
-            attempt_reaction_(info, neighbor, alpha);
+            collisions.push_back(collision_type(info, neighbor.coordinate));
         }
-
-        ++idx;
     }
 }
 
 StepEvent2D::StepEvent2D(boost::shared_ptr<Model> model,
                          boost::shared_ptr<SpatiocyteWorld> world,
+                         boost::shared_ptr<CollisionTable> collision_table,
                          const Species& species,
                          const Real& t,
                          const Real alpha)
-    : StepEvent(model, world, species, t, alpha)
+    : StepEvent(model, world, collision_table, species, t, alpha)
 {
     const MoleculeInfo minfo(world_->get_molecule_info(species));
     const Real D(minfo.D);
@@ -110,25 +232,17 @@ void StepEvent2D::walk(const Real& alpha)
     }
 
     const boost::shared_ptr<RandomNumberGenerator>& rng(world_->rng());
-    MoleculePool::container_type voxels;
-    copy(mpool_->begin(), mpool_->end(), back_inserter(voxels));
 
-    std::size_t idx(0);
-    for (MoleculePool::container_type::iterator itr(voxels.begin());
-         itr != voxels.end(); ++itr)
+    mpool_->begin_sweep();
+    while (mpool_->sweep_size() > 0)
     {
-        const SpatiocyteWorld::coordinate_id_pair_type& info(*itr);
+        // a molecule removed by a reaction leaves the sweep.
+        const std::size_t idx(mpool_->next_in_sweep());
+        const SpatiocyteWorld::coordinate_id_pair_type info((*mpool_)[idx]);
 
         // TODO: Calling coordinate2voxel is invalid
         const Voxel voxel(world_->coordinate2voxel(info.coordinate));
 
-        if (voxel.get_voxel_pool() != mpool_)
-        {
-            // should skip if a voxel is not the target species.
-            // when reaction has occured before, a voxel can be changed.
-            continue;
-        }
-
         const std::size_t num_neighbors(voxel.num_neighbors());
 
         ecell4::shuffle(*(rng.get()), nids_);
@@ -155,8 +269,8 @@ void StepEvent2D::walk(const Real& alpha)
             }
             break;
         }
-        ++idx;
     }
+    mpool_->end_sweep();
 }
 
 void StepEvent::attempt_reaction_(
@@ -174,41 +288,37 @@ void StepEvent::attempt_reaction_(
         return;
     }
 
-    const Species& speciesA(from_mt->species());
-    const Species& speciesB(to_mt->species());
-
-    const std::vector<ReactionRule> rules(model_->query_reaction_rules(speciesA, speciesB));
+    const CollisionTable::entry_type& entry(
+        collision_table_->get(index_, collision_table_->index(to_mt)));
+    const std::vector<ReactionRule>& rules(entry.rules);
 
     if (rules.empty())
     {
         return;
     }
 
-    const Real factor(calculate_dimensional_factor(from_mt, to_mt, world_));
     const Real rnd(world_->rng()->uniform(0,1));
-    Real accp(0.0);
 
-    for (std::vector<ReactionRule>::const_iterator itr(rules.begin()); itr != rules.end(); ++itr)
+    for (std::size_t i(0); i < rules.size(); ++i)
     {
-        const Real k((*itr).k());
-        const Real P(k * factor * alpha);
-        accp += P;
-        if (accp > 1 && k != std::numeric_limits<Real>::infinity())
+        const ReactionRule& rule(rules[i]);
+        const Real accp(entry.accumulated[i] * alpha);
+        if (accp > 1 && rule.k() != std::numeric_limits<Real>::infinity())
         {
             std::cerr << "The total acceptance probability [" << accp
-                << "] exceeds 1 for '" << speciesA.serial()
-                << "' and '" << speciesB.serial() << "'." << std::endl;
+                << "] exceeds 1 for '" << from_mt->species().serial()
+                << "' and '" << to_mt->species().serial() << "'." << std::endl;
         }
         if (accp >= rnd)
         {
             ReactionInfo rinfo(apply_second_order_reaction(
-                        world_, *itr,
+                        world_, rule,
                         ReactionInfo::Item(info.pid, from_mt->species(), voxel),
                         ReactionInfo::Item(to_mt->get_particle_id(dst.coordinate),
                                            to_mt->species(), dst)));
             if (rinfo.has_occurred())
             {
-                reaction_type reaction(std::make_pair(*itr, rinfo));
+                reaction_type reaction(std::make_pair(rule, rinfo));
                 push_reaction(reaction);
             }
             return;
@@ -11,6 +11,9 @@
 
 #include <ecell4/core/NetworkModel.hpp>
 #include "../SpatiocyteSimulator.hpp"
+#include "../SpatiocyteFactory.hpp"
+#include "../CollisionTable.hpp"
+#include "../utils.hpp"
 #include <ecell4/core/Sphere.hpp>
 
 using namespace ecell4;
@@ -262,6 +265,161 @@ BOOST_AUTO_TEST_CASE(SpatiocyteSimulator_test_binding_reaction)
     BOOST_CHECK_EQUAL(25 - world->num_molecules(sp2), num_sp3);
 }
 
+BOOST_AUTO_TEST_CASE(SpatiocyteSimulator_test_binding_reaction_with_compact_lattice)
+{
+    const Real L(2.5e-8);
+    const Real3 edge_lengths(L, L, L);
+    const Real voxel_radius(2.5e-9);
+    const Real radius(1.25e-9);
+    const ecell4::Species sp1("A", radius, 1.0e-12),
+          sp2("B", radius, 1.1e-12),
+          sp3("C", 2.5e-9, 1.2e-12);
+
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+
+    model->add_reaction_rule(create_binding_reaction_rule(sp1,sp2,sp3,1e-20));
+
+    SpatiocyteFactory factory(voxel_radius, COMPACT_LATTICE);
+    boost::shared_ptr<SpatiocyteWorld> world(factory.world(edge_lengths));
+
+    boost::shared_ptr<SpatiocyteSimulator> sim(factory.simulator(world, model));
+
+    BOOST_CHECK(world->add_molecules(sp1, 25));
+    BOOST_CHECK(world->add_molecules(sp2, 25));
+    sim->initialize();
+
+    for (Integer i(0); i < 20; ++i)
+    {
+        sim->step();
+    }
+    Integer num_sp3(world->num_molecules(sp3));
+    BOOST_ASSERT(num_sp3 > 0);
+    BOOST_CHECK_EQUAL(25 - world->num_molecules(sp1), num_sp3);
+    BOOST_CHECK_EQUAL(25 - world->num_molecules(sp2), num_sp3);
+}
+
+BOOST_AUTO_TEST_CASE(SpatiocyteSimulator_test_collision_table)
+{
+    const Real L(2.5e-8);
+    const Real3 edge_lengths(L, L, L);
+    const Real voxel_radius(2.5e-9);
+    const Real radius(1.25e-9);
+    const ecell4::Species sp1("A", radius, 1.0e-12),
+          sp2("B", radius, 1.1e-12),
+          sp3("C", 2.5e-9, 1.2e-12),
+          sp4("D", 2.5e-9, 1.3e-12);
+
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+    model->add_species_attribute(sp4);
+
+    model->add_reaction_rule(create_binding_reaction_rule(sp1,sp2,sp3,1e-20));
+    model->add_reaction_rule(create_binding_reaction_rule(sp1,sp2,sp4,2e-20));
+
+    boost::shared_ptr<GSLRandomNumberGenerator>
+        rng(new GSLRandomNumberGenerator());
+    boost::shared_ptr<SpatiocyteWorld> world(
+            new SpatiocyteWorld(edge_lengths, voxel_radius, rng));
+    world->bind_to(model);
+    BOOST_CHECK(world->add_molecules(sp1, 1));
+    BOOST_CHECK(world->add_molecules(sp2, 1));
+    BOOST_CHECK(world->add_molecules(sp3, 1));
+
+    CollisionTable table(model, world);
+    const boost::shared_ptr<const VoxelPool>
+        mt1(world->find_molecule_pool(sp1)),
+        mt2(world->find_molecule_pool(sp2)),
+        mt3(world->find_molecule_pool(sp3));
+    const CollisionTable::index_type i1(table.index(mt1)), i2(table.index(mt2));
+    BOOST_CHECK_EQUAL(table.index(mt1), i1);
+    BOOST_CHECK_EQUAL(table.size(), 2);
+
+    const CollisionTable::entry_type& entry(table.get(i1, i2));
+    BOOST_CHECK_EQUAL(entry.rules.size(), 2);
+    BOOST_CHECK_EQUAL(entry.accumulated.size(), 2);
+    const Real factor(calculate_dimensional_factor(mt1, mt2, world));
+    BOOST_CHECK_CLOSE(entry.accumulated[0], 1e-20 * factor, 1e-10);
+    BOOST_CHECK_CLOSE(entry.accumulated[1], 3e-20 * factor, 1e-10);
+
+    // a new pool extends the table
+    const CollisionTable::index_type i3(table.index(mt3));
+    BOOST_CHECK_EQUAL(table.size(), 3);
+    BOOST_CHECK(table.get(i1, i3).rules.empty());
+    BOOST_CHECK_EQUAL(table.get(i2, i1).rules.size(), 2);
+
+    // an entry keeps its rules even if the model is modified
+    model->remove_reaction_rule(create_binding_reaction_rule(sp1,sp2,sp3,1e-20));
+    const std::vector<ReactionRule>& rules(table.get(i1, i2).rules);
+    BOOST_CHECK_EQUAL(rules.size(), 2);
+    BOOST_CHECK_EQUAL(rules[0].k(), 1e-20);
+    BOOST_CHECK_EQUAL(rules[1].k(), 2e-20);
+}
+
+BOOST_AUTO_TEST_CASE(SpatiocyteSimulator_test_num_threads)
+{
+    const Real L(5e-8);
+    const Real3 edge_lengths(L, L, L);
+    const Real voxel_radius(2.5e-9);
+    const Real radius(1.25e-9);
+    const ecell4::Species sp1("A", radius, 1.0e-12),
+          sp2("B", radius, 1.1e-12),
+          sp3("C", 2.5e-9, 1.2e-12);
+
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+
+    model->add_reaction_rule(create_binding_reaction_rule(sp1,sp2,sp3,1e-20));
+
+    std::vector<std::pair<ParticleID, Particle> > particles[4];
+    const Integer num_threads[] = {1, 1, 2, 4};
+    for (std::size_t i(0); i < 4; ++i)
+    {
+        boost::shared_ptr<GSLRandomNumberGenerator>
+            rng(new GSLRandomNumberGenerator(1));
+        boost::shared_ptr<SpatiocyteWorld> world(
+                new SpatiocyteWorld(edge_lengths, voxel_radius, rng));
+
+        SpatiocyteSimulator sim(world, model);
+        sim.set_num_threads(num_threads[i]);
+        BOOST_CHECK_EQUAL(sim.num_threads(), num_threads[i]);
+
+        BOOST_CHECK(world->add_molecules(sp1, 200));
+        BOOST_CHECK(world->add_molecules(sp2, 200));
+        sim.initialize();
+
+        for (Integer j(0); j < 50; ++j)
+        {
+            sim.step();
+        }
+
+        const Integer num_sp3(world->num_molecules(sp3));
+        BOOST_CHECK(num_sp3 > 0);
+        BOOST_CHECK_EQUAL(200 - world->num_molecules(sp1), num_sp3);
+        BOOST_CHECK_EQUAL(200 - world->num_molecules(sp2), num_sp3);
+        particles[i] = world->list_particles();
+    }
+
+    // one thread walks serially, and more threads walk in slabs. Either
+    // trajectory depends only on the seed, and the latter does not depend
+    // on the number of threads.
+    for (std::size_t j(0); j < 4; j += 2)
+    {
+        BOOST_REQUIRE_EQUAL(particles[j].size(), particles[j + 1].size());
+        for (std::size_t i(0); i < particles[j].size(); ++i)
+        {
+            BOOST_CHECK_EQUAL(particles[j][i].first, particles[j + 1][i].first);
+            BOOST_CHECK_EQUAL(particles[j][i].second.position(), particles[j + 1][i].second.position());
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(SpatiocyteSimulator_test_unbinding_reaction)
 {
     const Real L(2.5e-8);
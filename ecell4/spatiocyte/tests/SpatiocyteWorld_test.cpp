@@ -11,8 +11,12 @@
 
 #include "../SpatiocyteWorld.hpp"
 #include "../../core/Sphere.hpp"
+#include "../../core/Rod.hpp"
+#include "../../core/PlanarSurface.hpp"
+#include "../../core/NetworkModel.hpp"
 //#include <ecell4/core/Sphere.hpp>
 #include <fstream>
+#include <algorithm>
 
 using namespace ecell4;
 using namespace ecell4::spatiocyte;
@@ -254,3 +258,91 @@ BOOST_AUTO_TEST_CASE(SpatiocyteWorld_test_structure)
     world.save("structure.h5");
 #endif
 }
+
+/**
+ * a shape hiding the bounding box and the batch interface of another.
+ */
+struct UnboundedShape
+    : public Shape
+{
+    UnboundedShape(const boost::shared_ptr<const Shape>& root)
+        : root_(root)
+    {
+        ;
+    }
+
+    dimension_kind dimension() const
+    {
+        return root_->dimension();
+    }
+
+    Real is_inside(const Real3& coord) const
+    {
+        return root_->is_inside(coord);
+    }
+
+    Real3 draw_position(boost::shared_ptr<RandomNumberGenerator>& rng) const
+    {
+        return root_->draw_position(rng);
+    }
+
+    bool test_AABB(const Real3& l, const Real3& u) const
+    {
+        return root_->test_AABB(l, u);
+    }
+
+    boost::shared_ptr<const Shape> root_;
+};
+
+std::vector<SpatiocyteWorld::coordinate_type>
+sorted_coordinates(const SpatiocyteWorld& world, const Species& sp)
+{
+    const std::vector<std::pair<ParticleID, ParticleVoxel> > voxels(world.list_voxels_exact(sp));
+    std::vector<SpatiocyteWorld::coordinate_type> retval;
+    for (std::vector<std::pair<ParticleID, ParticleVoxel> >::const_iterator itr(voxels.begin());
+         itr != voxels.end(); ++itr)
+    {
+        retval.push_back((*itr).second.coordinate);
+    }
+    std::sort(retval.begin(), retval.end());
+    return retval;
+}
+
+BOOST_AUTO_TEST_CASE(SpatiocyteWorld_test_structure_bounding_box)
+{
+    const Real3 edge_lengths(5e-7, 5e-7, 5e-7);
+    const Real voxel_radius(DEFAULT_VOXEL_RADIUS);
+    boost::shared_ptr<GSLRandomNumberGenerator>
+        rng(new GSLRandomNumberGenerator());
+
+    std::vector<boost::shared_ptr<const Shape> > shapes;
+    shapes.push_back(boost::shared_ptr<const Shape>(
+        new Sphere(Real3(4e-7, 1e-7, 2.5e-7), 1.5e-7)));
+    shapes.push_back(boost::shared_ptr<const Shape>(
+        new SphericalSurface(Real3(4e-7, 1e-7, 2.5e-7), 1.5e-7)));
+    shapes.push_back(boost::shared_ptr<const Shape>(
+        new RodSurface(2e-7, 1e-7, Real3(2.5e-7, 2.5e-7, 2.5e-7))));
+    shapes.push_back(boost::shared_ptr<const Shape>(
+        new PlanarSurface(Real3(3e-7, 0, 0), Real3(-1e-7, 0, 1e-7), Real3(0, 1e-7, 0))));
+
+    const Species cytoplasm("Cytoplasm", 2.5e-9, 0, "", 3), membrane("Membrane", 2.5e-9, 0, "", 2);
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_species_attribute(cytoplasm);
+    model->add_species_attribute(membrane);
+
+    for (std::vector<boost::shared_ptr<const Shape> >::const_iterator itr(shapes.begin());
+         itr != shapes.end(); ++itr)
+    {
+        const Species& structure((*itr)->dimension() == Shape::THREE ? cytoplasm : membrane);
+        SpatiocyteWorld clipped(edge_lengths, voxel_radius, rng);
+        SpatiocyteWorld unclipped(edge_lengths, voxel_radius, rng);
+        clipped.bind_to(model);
+        unclipped.bind_to(model);
+
+        const Integer n(clipped.add_structure(structure, *itr, 4));
+        BOOST_CHECK(n > 0);
+        BOOST_CHECK_EQUAL(n, unclipped.add_structure(
+            structure, boost::shared_ptr<const Shape>(new UnboundedShape(*itr))));
+        BOOST_CHECK(sorted_coordinates(clipped, structure) == sorted_coordinates(unclipped, structure));
+    }
+}
@@ -1,6 +1,8 @@
 #ifndef ECELL4_SPATIOCYTE_UTILS_HPP
 #define ECELL4_SPATIOCYTE_UTILS_HPP
 
+#include <ecell4/core/parallel.hpp>
+
 #include "SpatiocyteWorld.hpp"
 
 namespace ecell4
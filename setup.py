@@ -103,5 +103,6 @@ setup(
     data_files = [('ecell4-licenses', glob.glob('licenses/*'))],
     ext_modules=[CMakeExtension('ecell4_base')],
     cmdclass=dict(build_ext=CMakeBuild, test=CustomTestCommand),
+    test_suite='tests',
     zip_safe=False,
 )
@@ -0,0 +1,29 @@
+import unittest
+from ecell4_base.core import *
+from ecell4_base.bd import *
+
+class BDSimulatorTest(unittest.TestCase):
+
+    def setUp(self):
+        self.world = BDWorld(Real3(1, 1, 1), Integer3(3, 3, 3))
+        self.world.add_molecules(Species("A", 0.005, 1), 10)
+
+    def test_python_model(self):
+        class DegradationModel(NetworkModel):
+            def query_reaction_rules(self, *args):
+                if len(args) == 1 and args[0].serial() == "A":
+                    return [create_degradation_reaction_rule(Species("A"), self.k)]
+                return []
+
+        m = DegradationModel()
+        m.add_species_attribute(Species("A", 0.005, 1))
+        m.k = 0.0
+
+        # the reaction rules are given only by the method overridden in Python.
+        sim = BDSimulator(self.world, m)
+        m.k = 2.0 / sim.dt()
+        sim.step()
+        self.assertEqual(self.world.num_molecules(Species("A")), 0)
+
+if __name__ == '__main__':
+    unittest.main()
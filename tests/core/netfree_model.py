@@ -0,0 +1,31 @@
+import unittest
+from ecell4_base.core import *
+
+class NetfreeModelTest(unittest.TestCase):
+
+    def setUp(self):
+        pass
+
+    def test_expand_progress(self):
+        model = NetfreeModel()
+        model.add_reaction_rule(
+            create_unimolecular_reaction_rule(Species("A"), Species("B"), 1))
+        model.add_reaction_rule(
+            create_unimolecular_reaction_rule(Species("B"), Species("C"), 1))
+
+        stats = []
+        m = model.expand([Species("A")], 10, {}, 2, progress=stats.append)
+
+        self.assertEqual(len(m.reaction_rules()), 2)
+        self.assertEqual([s.iteration for s in stats], [1, 2, 3])
+        self.assertEqual([s.num_seeds for s in stats], [1, 1, 1])
+        self.assertEqual([s.num_new_species for s in stats], [1, 1, 0])
+        self.assertEqual(stats[-1].total_species, 3)
+        self.assertEqual(stats[-1].total_reactions, 2)
+
+        # progress is optional.
+        m = model.expand([Species("A")], 10, {}, 1)
+        self.assertEqual(len(m.reaction_rules()), 2)
+
+if __name__ == '__main__':
+    unittest.main()
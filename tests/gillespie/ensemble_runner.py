@@ -0,0 +1,46 @@
+import unittest
+from ecell4_base.core import *
+from ecell4_base.gillespie import *
+
+class EnsembleRunnerTest(unittest.TestCase):
+
+    def setUp(self):
+        self.world = GillespieWorld(Real3(1, 1, 1))
+        self.world.add_molecules(Species("A"), 10)
+
+    def test_run(self):
+        m = NetworkModel()
+        m.add_reaction_rule(create_degradation_reaction_rule(Species("A"), 1.0))
+
+        runner = EnsembleRunner(GillespieFactory(), m, [0.0, 1.0], ["A"])
+        runner.run(self.world, 4, 0, 2)
+        self.assertEqual(runner.num_trajectories(), 4)
+        self.assertEqual(runner.mean()[0][1], 10.0)
+
+    def test_python_descriptor(self):
+        m = NetworkModel()
+        rr = create_degradation_reaction_rule(Species("A"), 0.0)
+        rr.set_descriptor(ReactionRuleDescriptorPyfunc(lambda r, p, v, t, rc, pc: 1.0 * r[0], "test"))
+        m.add_reaction_rule(rr)
+
+        # a Python function cannot be called by threads without the GIL.
+        runner = EnsembleRunner(GillespieFactory(), m, [0.0, 1.0], ["A"])
+        with self.assertRaises(RuntimeError):
+            runner.run(self.world, 4, 0, 2)
+        self.assertEqual(runner.num_trajectories(), 0)
+
+    def test_python_model(self):
+        class DegradationModel(NetworkModel):
+            pass
+
+        m = DegradationModel()
+        m.add_reaction_rule(create_degradation_reaction_rule(Species("A"), 1.0))
+
+        # nor can a model subclassed in Python.
+        runner = EnsembleRunner(GillespieFactory(), m, [0.0, 1.0], ["A"])
+        with self.assertRaises(RuntimeError):
+            runner.run(self.world, 4, 0, 2)
+        self.assertEqual(runner.num_trajectories(), 0)
+
+if __name__ == '__main__':
+    unittest.main()